@@ -55,6 +55,7 @@
 #define SENSOR_TIMEOUT_MS                   4
 #define SENSOR_CONFIG_REG_INIT              (CT_PIN_POL_HIGH | INT_PIN_POL_HIGH | COMPARATOR_MODE | ONE_SPS_MODE | RESOLUTION_16_BIT)
 #define SENSOR_TEMP_QUANTUM                 0.0078125
+#define SENSOR_TEMP_FRAC_BITS               7
 #define H_DELTA                             4
 #define RUNNING_AVG_FIFO_SIZE               16
 
@@ -64,6 +65,7 @@
 
 #define FUZZYREG_MAILBOX_SIZE               10
 #define TEMP_FIFO_SIZE                      4
+#define TEMP_CHANNEL_SIZE                   4
 #define PWM_CLOCK                           10000
 #define PWM_COUNT                           10000
 #define PWM_STEP                            PWM_CLOCK/100
@@ -201,8 +203,22 @@
 #define FILE_BUFFER_ITEM_SIZE               50
 #define FILE_BUFFER_SIZE                    10
 
+#define LOG_FILE_PREALLOC_SIZE              (64UL * 1024UL)
+#define RESULT_FILE_PREALLOC_SIZE           (8UL * 1024UL)
+#define FILE_CLMT_SIZE                      16
+
+#define LOG_FILE_JOURNAL                    FALSE
+#define LOG_RECORD_SIZE                     64
+#define LOG_JOURNAL_COMMIT_RECORDS          32
+#define LOG_JOURNAL_MARKER                  "/logs/open.jnl"
+#define LOG_FOREIGN_SUFFIX                  ".old"
+
 #define SDC_POLLING_INTERVAL                10
 #define SDC_POLLING_DELAY_MS                10
 
+#define TRACE_FILE_NAME                     "/traces/trace.bin"
+#define TRACE_FILE_CHUNK_SIZE               512
+#define TRACE_FILE_MAX_CHUNKS               8
+
 
 #endif // APPCONF_H_INCLUDED
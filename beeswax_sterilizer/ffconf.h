@@ -44,7 +44,7 @@
 /* To enable f_mkfs() function, set _USE_MKFS to 1 and set _FS_READONLY to 0 */
 
 
-#define _USE_FASTSEEK   0   /* 0:Disable or 1:Enable */
+#define _USE_FASTSEEK   1   /* 0:Disable or 1:Enable */
 /* To enable fast seek feature, set _USE_FASTSEEK to 1. */
 
 
@@ -227,4 +227,29 @@
 */
 
 
+/*---------------------------------------------------------------------------/
+/ ChibiOS disk I/O bindings
+/---------------------------------------------------------------------------*/
+
+#define FATFS_USE_WRITE_BEHIND     1
+#define FATFS_WB_BUFFERS           4
+#define FATFS_WB_BUFFER_SECTORS    8
+/* Writes to the card are queued and done by a separate thread, up to
+/  FATFS_WB_BUFFERS buffers of FATFS_WB_BUFFER_SECTORS contiguous sectors.
+/  f_sync() and f_close() wait until the queue is empty. */
+
+#include <board_sdram.h>
+#define FATFS_CACHE_SECTORS        32
+#define FATFS_CACHE_ADDR           BOARD_SDRAM_FB_END
+#define FATFS_CACHE_BUFFER         ((uint8_t *)FATFS_CACHE_ADDR)
+/* LRU cache of FATFS_CACHE_SECTORS sectors with write-back, in the external
+/  SDRAM after the LTDC frame buffers (see board_sdram.h). The SDRAM is
+/  started by gfxInit() before the card handler. */
+
+#if (FATFS_CACHE_ADDR < BOARD_SDRAM_FB_END) || (FATFS_CACHE_ADDR % 4) || \
+    (FATFS_CACHE_ADDR + FATFS_CACHE_SECTORS * 512 > BOARD_SDRAM_END)
+#error "FatFs sector cache overlaps the frame buffers or is out of the SDRAM"
+#endif
+
+
 #endif /* _FFCONF */
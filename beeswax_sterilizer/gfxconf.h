@@ -65,7 +65,7 @@
 #define GFX_USE_GDISP                                TRUE
 
 //#define GDISP_NEED_AUTOFLUSH                         FALSE
-//#define GDISP_NEED_TIMERFLUSH                        FALSE
+#define GDISP_NEED_TIMERFLUSH                        50        // Page flip period in ms for LTDC_USE_DOUBLEBUFFER
 #define GDISP_NEED_VALIDATION                        TRUE
 #define GDISP_NEED_CLIP                              TRUE
 #define GDISP_NEED_CIRCLE                            TRUE
@@ -82,7 +82,7 @@
 //#define GDISP_NEED_STREAMING                         FALSE
 #define GDISP_NEED_TEXT                              TRUE
 //    #define GDISP_NEED_TEXT_WORDWRAP                 FALSE
-//    #define GDISP_NEED_ANTIALIAS                     FALSE
+    #define GDISP_NEED_ANTIALIAS                     TRUE		// Glyphs are blended by the DMA2D (GDISP_HARDWARE_ALPHABLIT)
     #define GDISP_NEED_UTF8                          TRUE
     #define GDISP_NEED_TEXT_KERNING                  TRUE
 //    #define GDISP_INCLUDE_FONT_UI1                   TRUE
@@ -91,18 +91,18 @@
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS10          FALSE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS12          FALSE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS16          FALSE
-    #define GDISP_INCLUDE_FONT_DEJAVUSANS20          TRUE
+//    #define GDISP_INCLUDE_FONT_DEJAVUSANS20          FALSE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS24          FALSE
-    #define GDISP_INCLUDE_FONT_DEJAVUSANS32          TRUE
+//    #define GDISP_INCLUDE_FONT_DEJAVUSANS32          FALSE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANSBOLD12      FALSE
 //    #define GDISP_INCLUDE_FONT_FIXED_10X20           TRUE
 //    #define GDISP_INCLUDE_FONT_FIXED_7X14            FALSE
 //    #define GDISP_INCLUDE_FONT_FIXED_5X8             FALSE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS12_AA       FALSE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS16_AA       FALSE
-//    #define GDISP_INCLUDE_FONT_DEJAVUSANS20_AA       FALSE
+    #define GDISP_INCLUDE_FONT_DEJAVUSANS20_AA       TRUE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANS24_AA       TRUE
-//    #define GDISP_INCLUDE_FONT_DEJAVUSANS32_AA       FALSE
+    #define GDISP_INCLUDE_FONT_DEJAVUSANS32_AA       TRUE
 //    #define GDISP_INCLUDE_FONT_DEJAVUSANSBOLD12_AA   FALSE
 //    #define GDISP_INCLUDE_USER_FONTS                 FALSE
 
@@ -145,6 +145,11 @@
 #define GDISP_STARTUP_COLOR                          HTML2COLOR(0xEE9A49)
 #define GDISP_NEED_STARTUP_LOGO                      TRUE
 
+// STM32LTDC driver options (see stmlib/lld/gdisp_lld_ltdc/gdisp_lld_config.h)
+#define LTDC_USE_DOUBLEBUFFER                        TRUE
+//    #define LTDC_DOUBLEBUFFER_DIRTYCOPY              TRUE
+//#define LTDC_USE_LAYER2                              FALSE		// Overlay display on the second LTDC layer (needs GDISP_TOTAL_DISPLAYS 2)
+
 //#define GDISP_TOTAL_DISPLAYS                         1
 
 //#define GDISP_DRIVER_LIST                            GDISPVMT_STM32LTDC
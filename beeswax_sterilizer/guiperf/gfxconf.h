@@ -0,0 +1,86 @@
+/**
+ * This file has a different license to the rest of the uGFX system.
+ * You can copy, modify and distribute this file as you see fit.
+ * You do not need to publish your source modifications to this file.
+ * The only thing you are not permitted to do is to relicense it
+ * under a different license.
+ */
+
+/**
+ * uGFX configuration of the host GUI performance test.
+ * Mirrors ../gfxconf.h with the Linux port, the host framebuffer board
+ * (stmlib/ugfx_boardfiles/host_framebuffer) and the scripted touch panel.
+ * Keep the GDISP/GWIN options in sync with the application configuration.
+ */
+
+#ifndef _GFXCONF_H
+#define _GFXCONF_H
+
+// GOS - GFX_USE_OS_LINUX comes from the board makefile
+#define GOS_NEED_X_THREADS                           FALSE
+#define GOS_NEED_X_HEAP                              FALSE
+
+// GDISP
+#define GFX_USE_GDISP                                TRUE
+
+#define GDISP_NEED_VALIDATION                        TRUE
+#define GDISP_NEED_CLIP                              TRUE
+#define GDISP_NEED_CIRCLE                            TRUE
+#define GDISP_NEED_CONVEX_POLYGON                    TRUE
+#define GDISP_NEED_PIXELREAD                         TRUE
+#define GDISP_NEED_CONTROL                           TRUE
+#define GDISP_NEED_MULTITHREAD                       TRUE
+#define GDISP_NEED_TEXT                              TRUE
+    #define GDISP_NEED_ANTIALIAS                     TRUE
+    #define GDISP_NEED_UTF8                          TRUE
+    #define GDISP_NEED_TEXT_KERNING                  TRUE
+    #define GDISP_INCLUDE_FONT_UI2                   TRUE
+    #define GDISP_INCLUDE_FONT_DEJAVUSANS20_AA       TRUE
+    #define GDISP_INCLUDE_FONT_DEJAVUSANS32_AA       TRUE
+
+#define GDISP_DEFAULT_ORIENTATION                    GDISP_ROTATE_0
+#define GDISP_STARTUP_COLOR                          HTML2COLOR(0xEE9A49)
+#define GDISP_NEED_STARTUP_LOGO                      FALSE     // Would only add a constant delay
+
+// GWIN
+#define GFX_USE_GWIN                                 TRUE
+
+#define GWIN_NEED_WINDOWMANAGER                      TRUE
+#define GWIN_NEED_CONSOLE                            TRUE
+#define GWIN_NEED_WIDGET                             TRUE
+    #define GWIN_NEED_LABEL                          TRUE
+    #define GWIN_NEED_BUTTON                         TRUE
+    #define GWIN_NEED_RADIO                          TRUE
+    #define GWIN_NEED_LIST                           TRUE
+    #define GWIN_NEED_PROGRESSBAR                    TRUE
+    #define GWIN_NEED_KEYBOARD                       TRUE
+    #define GWIN_NEED_TEXTEDIT                       TRUE
+#define GWIN_NEED_CONTAINERS                         TRUE
+    #define GWIN_NEED_CONTAINER                      TRUE
+    #define GWIN_NEED_TABSET                         TRUE
+        #define GWIN_TABSET_TABHEIGHT                32
+
+// GEVENT
+#define GFX_USE_GEVENT                               TRUE
+
+// GTIMER
+#define GFX_USE_GTIMER                               TRUE
+
+// GQUEUE
+#define GFX_USE_GQUEUE                               TRUE
+#define GQUEUE_NEED_ASYNC                            TRUE
+
+// GINPUT
+#define GFX_USE_GINPUT                               TRUE
+#define GINPUT_NEED_MOUSE                            TRUE
+    #define GINPUT_MOUSE_POLL_PERIOD                 25
+
+// GFILE
+#define GFX_USE_GFILE                                TRUE
+#define GFILE_NEED_PRINTG                            TRUE
+#define GFILE_NEED_STRINGS                           TRUE
+
+// GMISC
+#define GMISC_NEED_MATRIXFLOAT2D                     FALSE
+
+#endif /* _GFXCONF_H */
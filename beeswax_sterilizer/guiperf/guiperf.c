@@ -0,0 +1,344 @@
+/*
+ *   Copyright (C) 2017  Gyorgy Stercz
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/** \file guiperf.c
+  * \brief  Host GUI performance test.
+  *
+  * Builds the pages of the lcd controller thread with src/lcdpages.c, the
+  * same code the firmware runs, on the host frame buffer and plays scenario
+  * scripts on them. After each scenario
+  * the frame, flush and driver operation counters, the run time and the
+  * checksum of the final frame buffer contents are printed.
+  *
+  * Scenario commands (one per line, '#' starts a comment):
+  *     touch X Y       Press the touch panel.
+  *     release         Release the touch panel.
+  *     click X Y       Press and release.
+  *     wait MS         Let the GUI run for MS milliseconds.
+  *     tab NAME        Show a tabset page (Sterilizer, Result, Errors, Time).
+  *     temps A B C     Set the channel temperatures (0.1 degC).
+  *     power A B C     Set the heat power of the channels (%).
+  *     state TEXT      Set the sterilizer state label.
+  *     sdc TEXT        Set the SD card label.
+  *     date TEXT       Set the date label.
+  *     result TEXT     Add an item to the result list ("\t" is a tab).
+  *     error TEXT      Add an item to the error list.
+  *     expect HEX      Expected checksum of the final frame (the program exits
+  *                     with 1 if it differs).
+  *     repeat N        Repeat the commands until the matching "end" N times.
+  *     end
+  */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gfx.h"
+#include "src/gwin/gwin_class.h"
+#include "gmouse_lld_script.h"
+#include "lcdpages.h"
+
+#define SCRIPT_LINE_SIZE    128         /**< Maximum scenario line length. */
+#define SCRIPT_MAX_LINES    1024        /**< Maximum scenario length. */
+#define SCRIPT_MAX_DEPTH    8           /**< Maximum nesting of repeat blocks. */
+#define TOUCH_SETTLE_MS     (GINPUT_MOUSE_POLL_PERIOD*3)  /**< Time for a touch change to be seen. */
+
+/** \brief Handlers of displayed objects.
+  */
+static struct lcd_pages gh;
+
+static GListener gl;
+static bool_t expect;                   /**< The scenario has an expected checksum. */
+static unsigned long expected;          /**< Expected checksum of the final frame. */
+
+/** \brief Destroys the GUI so the next scenario starts from a fresh one.
+  */
+static void destroyGUI(void){
+    gwinDestroy(gh.tabset);
+    gwinDestroy(gh.sdc);
+    gwinDestroy(gh.date);
+}
+
+/** \brief Formatted widget text.
+  *
+  * gwinPrintg() walks its va_list twice, which only works where va_list is
+  * passed by value (ARM). On x86-64 the second pass prints garbage.
+  */
+static void setTextf(GHandle gh, const char *fmt, ...){
+    char str[64];
+    va_list va;
+
+    va_start(va, fmt);
+    vsnprintg(str, sizeof(str), fmt, va);
+    va_end(va);
+    gwinSetText(gh, str, TRUE);
+}
+
+/** \brief Sets the state label with the colors lcdcontrol.c uses for the
+  *        given state text.
+  */
+static void setState(const char *state){
+    if (!strcmp(state, "In Progress") || !strcmp(state, "Save") || !strcmp(state, "Print")){
+        gh.statestyle.background = Yellow;
+        gh.statestyle.enabled.text = Black;
+    } else if (!strcmp(state, "Error")){
+        gh.statestyle.background = Red;
+        gh.statestyle.enabled.text = White;
+    } else {
+        gh.statestyle.background = Gray;
+        gh.statestyle.enabled.text = White;
+    }
+    setTextf(gh.ster_state, "State: %s", state);
+    gwinSetStyle(gh.ster_state, &gh.statestyle);
+}
+
+/** \brief Handles the widget events like the lcd controller thread.
+  */
+static void handleEvents(void){
+    GEvent *pe;
+
+    while ((pe = geventEventWait(&gl, TIME_IMMEDIATE))){
+        switch(pe->type){
+        case GEVENT_GWIN_BUTTON:
+            if (((GEventGWinButton*)pe)->gwin == gh.ster_start)
+                setState("In Progress");
+            else if (((GEventGWinButton*)pe)->gwin == gh.ster_stop)
+                setState("Stop");
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/** \brief Runs the queued redraws and ends the frame.
+  */
+static void finishFrame(void){
+    handleEvents();
+    _gwinFlushRedraws(REDRAW_WAIT);
+    gdispFlush();
+}
+
+/** \brief Executes one scenario line.
+  *
+  * \param line     Command line without comment.
+  * \return 0 on success, -1 on unknown command or bad arguments.
+  */
+static int runCommand(char *line){
+    char cmd[16];
+    int a[CHANNEL_NUM], n, i;
+    const char *arg;
+
+    if (sscanf(line, "%15s%n", cmd, &n) != 1)
+        return 0;
+    arg = line + n;
+    while (*arg == ' ' || *arg == '\t')
+        arg++;
+    if (!strcmp(cmd, "touch")){
+        if (sscanf(arg, "%d %d", &a[0], &a[1]) != 2)
+            return -1;
+        gmouseScriptTouch(a[0], a[1]);
+        gfxSleepMilliseconds(TOUCH_SETTLE_MS);
+    } else if (!strcmp(cmd, "release")){
+        gmouseScriptRelease();
+        gfxSleepMilliseconds(TOUCH_SETTLE_MS);
+    } else if (!strcmp(cmd, "click")){
+        if (sscanf(arg, "%d %d", &a[0], &a[1]) != 2)
+            return -1;
+        gmouseScriptTouch(a[0], a[1]);
+        gfxSleepMilliseconds(TOUCH_SETTLE_MS);
+        gmouseScriptRelease();
+        gfxSleepMilliseconds(TOUCH_SETTLE_MS);
+    } else if (!strcmp(cmd, "wait")){
+        if (sscanf(arg, "%d", &a[0]) != 1)
+            return -1;
+        gfxSleepMilliseconds(a[0]);
+    } else if (!strcmp(cmd, "tab")){
+        if (!strcmp(arg, "Sterilizer"))
+            gwinTabsetSetTab(gh.sterilizer);
+        else if (!strcmp(arg, "Result"))
+            gwinTabsetSetTab(gh.result);
+        else if (!strcmp(arg, "Errors"))
+            gwinTabsetSetTab(gh.errors);
+        else if (!strcmp(arg, "Time"))
+            gwinTabsetSetTab(gh.time);
+        else
+            return -1;
+    } else if (!strcmp(cmd, "temps")){
+        if (sscanf(arg, "%d %d %d", &a[0], &a[1], &a[2]) != CHANNEL_NUM)
+            return -1;
+        for (i = 0; i < CHANNEL_NUM; i++){
+            snprintg(gh.curr_tempstr[i], sizeof(gh.curr_tempstr[i]), "T%d: %d.%d C", i, a[i]/10, abs(a[i]%10));
+            gwinSetText(gh.curr_temp[i], gh.curr_tempstr[i], FALSE);
+        }
+    } else if (!strcmp(cmd, "power")){
+        if (sscanf(arg, "%d %d %d", &a[0], &a[1], &a[2]) != CHANNEL_NUM)
+            return -1;
+        for (i = 0; i < CHANNEL_NUM; i++){
+            gwinProgressbarSetPosition(gh.heatpower[i], a[i]);
+            setTextf(gh.heatpower[i], "CH%d: %d%%", i, a[i]);
+        }
+    } else if (!strcmp(cmd, "state")){
+        setState(arg);
+    } else if (!strcmp(cmd, "sdc")){
+        setTextf(gh.sdc, "SDCard: %s", arg);
+    } else if (!strcmp(cmd, "date")){
+        gwinSetText(gh.date, arg, TRUE);
+    } else if (!strcmp(cmd, "result")){
+        gwinListAddItem(gh.res_list, arg, TRUE);
+        gwinListViewItem(gh.res_list, gwinListItemCount(gh.res_list)-1);
+        gwinProgressbarSetPosition(gh.steriletemps, gwinListItemCount(gh.res_list));
+        setTextf(gh.steriletemps, "OK: %d/%d", gwinListItemCount(gh.res_list), RESULT_LIST_SIZE);
+    } else if (!strcmp(cmd, "expect")){
+        if (sscanf(arg, "%lx", &expected) != 1)
+            return -1;
+        expect = TRUE;
+        return 0;
+    } else if (!strcmp(cmd, "error")){
+        gwinListAddItem(gh.err_list, arg, TRUE);
+        gwinListViewItem(gh.err_list, gwinListItemCount(gh.err_list)-1);
+    } else {
+        return -1;
+    }
+    finishFrame();
+    return 0;
+}
+
+/** \brief Runs a scenario file.
+  *
+  * \param filename Scenario file name.
+  * \return 0 on success, -1 on error.
+  */
+static int runScenario(const char *filename){
+    static char lines[SCRIPT_MAX_LINES][SCRIPT_LINE_SIZE];
+    int begin[SCRIPT_MAX_DEPTH], count[SCRIPT_MAX_DEPTH];
+    int nlines, pc, depth;
+    FILE *f;
+    char *p;
+
+    if (!(f = fopen(filename, "r"))){
+        fprintf(stderr, "%s: cannot open\n", filename);
+        return -1;
+    }
+    for (nlines = 0; nlines < SCRIPT_MAX_LINES && fgets(lines[nlines], SCRIPT_LINE_SIZE, f); nlines++){
+        if ((p = strchr(lines[nlines], '#')))
+            *p = 0;
+        for (p = lines[nlines]; (p = strstr(p, "\\t")); p++){
+            *p = '\t';
+            memmove(p + 1, p + 2, strlen(p + 2) + 1);
+        }
+        for (p = lines[nlines] + strlen(lines[nlines]); p > lines[nlines] && (p[-1] == '\n' || p[-1] == '\r' || p[-1] == ' '); p--)
+            p[-1] = 0;
+    }
+    fclose(f);
+
+    depth = 0;
+    for (pc = 0; pc < nlines; pc++){
+        if (!strncmp(lines[pc], "repeat", 6)){
+            if (depth == SCRIPT_MAX_DEPTH || sscanf(lines[pc] + 6, "%d", &count[depth]) != 1)
+                break;
+            begin[depth++] = pc;
+        } else if (!strcmp(lines[pc], "end")){
+            if (!depth)
+                break;
+            if (--count[depth-1] > 0)
+                pc = begin[depth-1];
+            else
+                depth--;
+        } else if (runCommand(lines[pc])){
+            break;
+        }
+    }
+    if (pc < nlines){
+        fprintf(stderr, "%s:%d: bad command: %s\n", filename, pc + 1, lines[pc]);
+        return -1;
+    }
+    return 0;
+}
+
+/** \brief Returns the time of the given clock in ms.
+  */
+static double clockMs(clockid_t clk){
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "Usage: %s [-p out.ppm] scenario...\n"
+                    "  -p  Save the final frame of each scenario (%%s is the scenario name).\n", name);
+}
+
+int main(int argc, char *argv[]){
+    const char *ppm = 0;
+    const char *name;
+    char fname[256];
+    double wall, cpu;
+    uint32_t sum;
+    int i, ret = 0;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++){
+        if (!strcmp(argv[i], "-p") && i + 1 < argc)
+            ppm = argv[++i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (i == argc){
+        usage(argv[0]);
+        return 2;
+    }
+
+    gfxInit();
+    geventListenerInit(&gl);
+    gwinAttachListener(&gl);
+
+    for (; i < argc; i++){
+        lcdpagesCreate(&gh);
+        finishFrame();
+        name = strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i];
+        memset(&hostfb_stats, 0, sizeof(hostfb_stats));
+        expect = FALSE;
+        wall = clockMs(CLOCK_MONOTONIC);
+        cpu = clockMs(CLOCK_PROCESS_CPUTIME_ID);
+        if (runScenario(argv[i])){
+            ret = 2;
+        } else {
+            wall = clockMs(CLOCK_MONOTONIC) - wall;
+            cpu = clockMs(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+            sum = hostfbChecksum();
+            printf("scenario=%s frames=%u flushes=%u ops=%u pixelops=%llu wall_ms=%.1f cpu_ms=%.1f checksum=%08x\n",
+                   name, hostfb_stats.frames, hostfb_stats.flushes, hostfb_stats.ops,
+                   (unsigned long long)hostfb_stats.pixelops, wall, cpu, sum);
+            if (ppm){
+                snprintf(fname, sizeof(fname), ppm, name);
+                if (hostfbSavePPM(fname))
+                    fprintf(stderr, "%s: cannot write\n", fname);
+            }
+            if (expect && sum != expected){
+                fprintf(stderr, "%s: checksum %08x, expected %08lx\n", name, sum, expected);
+                ret = 1;
+            }
+        }
+        gmouseScriptRelease();
+        destroyGUI();
+    }
+    gfxDeinit();
+    return ret;
+}
@@ -177,6 +177,13 @@
 #define HAL_USE_USB                 TRUE
 #endif
 
+/**
+ * @brief   Enables the USB_MSD subsystem.
+ */
+#if !defined(HAL_USE_USB_MSD) || defined(__DOXYGEN__)
+#define HAL_USE_USB_MSD             TRUE
+#endif
+
 /**
  * @brief   Enables the WDG subsystem.
  */
@@ -291,6 +298,15 @@
 #define SDC_NICE_WAITING            TRUE
 #endif
 
+/**
+ * @brief   Pre-erase before multiple blocks writes.
+ * @details If enabled the number of blocks is sent to SD cards using
+ *          ACMD23 before each multiple blocks write.
+ */
+#if !defined(SDC_WRITE_PRE_ERASE) || defined(__DOXYGEN__)
+#define SDC_WRITE_PRE_ERASE         TRUE
+#endif
+
 /*===========================================================================*/
 /* SERIAL driver related settings.                                           */
 /*===========================================================================*/
@@ -390,6 +406,17 @@
 #define USB_USE_WAIT                FALSE
 #endif
 
+/*===========================================================================*/
+/* USB_MSD driver related settings.                                          */
+/*===========================================================================*/
+
+/**
+ * @brief   Number of blocks in each of the two transfer buffers.
+ */
+#if !defined(USB_MSD_BUFFER_BLOCKS) || defined(__DOXYGEN__)
+#define USB_MSD_BUFFER_BLOCKS       8
+#endif
+
 #endif /* HALCONF_H */
 
 /** @} */
@@ -26,6 +26,7 @@
 #define CARDHANDLER_H_INCLUDED
 
 #include <inner_buffer.h>
+#include <shell.h>
 
 #define CARDHANDLER_STACK_SIZE 256
 
@@ -40,6 +41,15 @@
 #define SDC_CMD_NAME "sdc"
 #define SDC_CMD {SDC_CMD_NAME, cmd_sdc}
 
+#define TRACE_FILE_CMD_NAME "tracefile"
+#define TRACE_FILE_CMD {TRACE_FILE_CMD_NAME, cmd_tracefile}
+
+#define DUMP_FILE_CMD_NAME "dumpfile"
+#define DUMP_FILE_CMD {DUMP_FILE_CMD_NAME, cmd_dumpfile}
+
+#define USB_DISK_CMD_NAME "usbdisk"
+#define USB_DISK_CMD {USB_DISK_CMD_NAME, cmd_usbdisk}
+
 /** \brief Structure of file buffer item.
   */
 struct fbuff_item{
@@ -51,7 +61,7 @@ struct fbuff_item{
 
 /** \brief Enumeration of SD Card states
   */
-typedef enum{SDC_NOTINSERTED, SDC_ERROR, SDC_BUSY, SDC_READY, SDC_FULL}sdc_state_t;
+typedef enum{SDC_NOTINSERTED, SDC_ERROR, SDC_BUSY, SDC_READY, SDC_FULL, SDC_USBHOST}sdc_state_t;
 
 /** \brief Structure of Human date.
   */
@@ -102,7 +112,8 @@ void postFullLogFileBuffer(struct inner_buffer_item *item);
 int8_t isLogFileBufferFull(void);
 
 /** \brief Creates new result file, if exist,
-  *        will be overwritten.
+  *        will be overwritten. Space is preallocated and the unused
+  *        part is released at close.
   * \param filename     Pointer to string of the filename with full path, NULL save.
   * \note  The /results is always the beginning of the string!
   * \return Result of file open operation (see Chan FAT FS ff.h file)
@@ -116,6 +127,8 @@ void closeResultFile(void);
 
 /** \brief Creates new log file, if exist,
   *        the data will be appended to the end.
+  *        The file stays open until closeLogFile(), opening it again only
+  *        cancels a pending sync. Space is preallocated after the end.
   * \param filename     Pointer to string of the filename with full path, NULL save.
   * \note  The /logs is always the beginning of the string!
   * \return Result of file open operation (see Chan FAT FS ff.h file)
@@ -123,6 +136,10 @@ void closeResultFile(void);
   */
 uint8_t openLogFile(const char* filename);
 
+/** \brief Syncs log file, it remains open.
+  */
+void syncLogFile(void);
+
 /** \brief Closes log file.
   */
 void closeLogFile(void);
@@ -167,6 +184,37 @@ void cmd_resultfilebuff(BaseSequentialStream *chp, int argc, char *argv[]);
   */
 void cmd_sdc(BaseSequentialStream *chp, int argc, char *argv[]);
 
+/** \brief Trace file user interface, starts and stops writing the kernel
+  *        trace stream into a file.
+  */
+void cmd_tracefile(BaseSequentialStream *chp, int argc, char *argv[]);
+
+/** \brief Dump file user interface, sends the raw content of a file.
+  *        On the USB shell the file is read straight into the USB
+  *        packet buffers.
+  */
+void cmd_dumpfile(BaseSequentialStream *chp, int argc, char *argv[]);
+
+/** \brief USB disk user interface, gives the SD Card to the USB host
+  *        as mass storage and takes it back. The card is given only
+  *        while no file is open, it is taken back also when the host
+  *        ejects it or the USB is disconnected.
+  */
+void cmd_usbdisk(BaseSequentialStream *chp, int argc, char *argv[]);
+
+/** \brief Runs a shell script from the SD Card in batch mode.
+  *        Each line of the file is a command line, the commands are found
+  *        in the dispatch index and their outputs are terminated by status
+  *        lines. The status lines only tell if a command was dispatched or
+  *        rejected, the commands report their own errors. A summary line
+  *        with the number of rejected commands closes the script output.
+  *
+  * \param chp       output stream
+  * \param sip       shell command dispatch index
+  * \param filename  name of the script file
+  */
+void cardhandlerRunScript(BaseSequentialStream *chp, const ShellIndex *sip, const char *filename);
+
 /** \brief Initializes cardhandler thread.
   *         - Start SDC Driver.
   *         - SDC monitor timer init.
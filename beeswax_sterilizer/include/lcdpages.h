@@ -0,0 +1,82 @@
+/*
+ *   Copyright (C) 2017  Gyorgy Stercz
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/** \file lcdpages.h
+  * \brief Pages of the lcd controller.
+  *        Creates the tabset pages and their widgets. Uses only uGFX, so
+  *        the host GUI performance test (guiperf) builds the same pages.
+  * \author Gyorgy Stercz
+  */
+#ifndef LCDPAGES_H_INCLUDED
+#define LCDPAGES_H_INCLUDED
+
+#include <gfx.h>
+#include <appconf.h>
+
+/** \brief Structure for handlers of displayed objects.
+  */
+struct lcd_pages{
+    GHandle tabset;
+    GHandle date;
+    char datestr[25];
+    GHandle sdc;
+    GHandle sterilizer;
+    GHandle result;
+    GHandle errors;
+    GHandle time;
+    /*Sterilzer Page*/
+    GWidgetStyle statestyle;
+    GHandle curr_temp[CHANNEL_NUM];
+    char curr_tempstr[CHANNEL_NUM][50];
+    GHandle ster_state;
+    GHandle ster_start;
+    GHandle ster_stop;
+    GHandle heatpower[CHANNEL_NUM];
+    GHandle steriletemps;
+    /* Result Page */
+    GHandle res_date;
+    GHandle res_begin;
+    GHandle res_end;
+    GHandle final_result;
+    GWidgetStyle finalresstyle;
+    GHandle reslist_header;
+    GHandle res_list;
+    GHandle res_print;
+    /*Errors Page*/
+    GHandle err_list;
+    /*Time Page*/
+    GHandle keyboard;
+    GHandle setyear;
+    GHandle setmonth;
+    GHandle setday;
+    GHandle sethour;
+    GHandle setmin;
+    GHandle setsec;
+    GHandle setdatelabel;
+    GHandle setdatebtn;
+};
+
+/** \brief Creates GUI, set default setting, create tabset object,
+  *        time and SDC state labels and the tabset pages.
+  *        The widget objects are static, the GUI can be created again
+  *        after the tabset and the time and SDC state labels are
+  *        destroyed.
+  *
+  * \param gh   Pointer to the handlers of displayed objects, NULL save.
+  */
+void lcdpagesCreate(struct lcd_pages *gh);
+
+#endif // LCDPAGES_H_INCLUDED
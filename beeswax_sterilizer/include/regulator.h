@@ -151,14 +151,23 @@ void sendMailToRegulator(msg_t msg);
   */
 void sendDisableMailToRegluator(msg_t msg);
 
-/** \brief Get current temperature.
+/** \brief Receives the newest temperature from the temperature channel.
+  *         - Older temperatures are given back to the channel.
+  *
+  * \return Pointer to the temperature object or NULL, if there is no new temperature.
+  *         The object must be given back with releaseCurrentTemp().
+  */
+temperature_t *receiveCurrentTemp(void);
+
+/** \brief Gives back a temperature object to the temperature channel.
   *
   * \param data     Pointer to temperature object, NULL save.
   */
-void getCurrentTemp(temperature_t *data);
+void releaseCurrentTemp(temperature_t *data);
 
 /** \brief Initializes regulator
   *         - Temperature FIFO init.
+  *         - Temperature channel init.
   *         - PWM driver init.
   *         - Creates regulator thread.
   */
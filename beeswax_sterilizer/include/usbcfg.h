@@ -20,6 +20,8 @@
 extern const USBConfig usbcfg;
 extern SerialUSBConfig serusbcfg;
 extern SerialUSBDriver SDU1;
+extern const USBMassStorageConfig msdcfg;
+extern USBMassStorageDriver UMSD1;
 
 #endif  /* USBCFG_H */
 
@@ -116,6 +116,15 @@
 #define STM32_CAN_CAN1_IRQ_PRIORITY         11
 #define STM32_CAN_CAN2_IRQ_PRIORITY         11
 
+/*
+ * CRC unit settings.
+ */
+#define STM32_CRC_USE_DMA                   TRUE
+#define STM32_CRC_DMA_THRESHOLD             256
+#define STM32_CRC_DMA_STREAM                STM32_DMA_STREAM_ID(2, 7)
+#define STM32_CRC_DMA_PRIORITY              0
+#define STM32_CRC_DMA_IRQ_PRIORITY          12
+
 /*
  * DAC driver system settings.
  */
@@ -100,6 +100,7 @@ include $(CHIBIOS)/os/common/ports/ARMCMx/compilers/GCC/mk/$(PORT)
 # Other files (optional).
 include $(CHIBIOS)/test/rt/test.mk
 include $(CHIBIOS)/os/hal/lib/streams/streams.mk
+include $(CHIBIOS)/os/hal/lib/crc/crc.mk
 include $(CHIBIOS)/os/various/shell/shell.mk
 
 # Define linker script file here
@@ -116,6 +117,7 @@ CSRC = $(STARTUPSRC) \
        $(BOARDSRC) \
        $(TESTSRC) \
        $(STREAMSSRC) \
+       $(CRCSRC) \
        $(SHELLSRC) \
        $(CHIBIOS)/os/various/syscalls.c \
        $(PROJECTSRC)
@@ -151,7 +153,7 @@ ASMXSRC = $(STARTUPASM) $(PORTASM) $(OSALASM)
 INCDIR = $(CHIBIOS)/os/license \
          $(STARTUPINC) $(KERNINC) $(PORTINC) $(OSALINC) \
          $(HALINC) $(PLATFORMINC) $(BOARDINC) $(TESTINC) \
-         $(STREAMSINC) $(SHELLINC) $(PROJECTINC) $(CHIBIOS)/os/various
+         $(STREAMSINC) $(CRCINC) $(SHELLINC) $(PROJECTINC) $(CHIBIOS)/os/various
 
 ifeq ($(USE_STMLIB),yes)
 include $(STMLIB)/stmlib.mk
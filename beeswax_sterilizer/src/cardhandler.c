@@ -24,11 +24,14 @@
 #include <ch.h>
 #include <hal.h>
 #include <chprintf.h>
+#include <crc.h>
 #include <limits.h>
 #include <ff.h>
+#include <diskio.h>
 #include <appconf.h>
 #include <cardhandler.h>
 #include <lcdcontrol.h>
+#include <usbcfg.h>
 
 #if CARDHANDLER_STACK_SIZE < 128
     #error Minimum task stack size is 128!
@@ -46,6 +49,13 @@
 static THD_WORKING_AREA(waThreadcardhandler, CARDHANDLER_STACK_SIZE);
 static MUTEX_DECL(chrmtx);
 
+/** \brief Date and time snapshot, published by cardhandler thread.
+  * \{
+  */
+static RTCDateTime rtcsnapbuff[2];
+static SNAPSHOT_DECL(rtcsnap, rtcsnapbuff, sizeof(RTCDateTime));
+/**\} */
+
 /*===========================================================================*/
 /* File buffers to write operations.                                         */
 /*===========================================================================*/
@@ -121,6 +131,7 @@ int8_t isLogFileBufferFull(void){
   */
 static struct{
     bool fs_ready;
+    bool usbdisk;
     FATFS SDC_FS;
     uint64_t freespace;
     sdc_state_t state;
@@ -135,18 +146,338 @@ static struct{
     FIL file;
     FRESULT fr;
     UINT bw;
+    DWORD clmt[FILE_CLMT_SIZE];
 }resultfile;
 
 /** \brief Structure of log file.
   */
 static struct{
     bool isopen;
+    bool sync;
     bool close;
     FIL file;
     FRESULT fr;
     UINT bw;
+    DWORD clmt[FILE_CLMT_SIZE];
+    char name[FILE_BUFFER_ITEM_SIZE];
+#if LOG_FILE_JOURNAL
+    uint32_t seq;
+    uint32_t runid;
+    uint32_t uncommitted;
+#endif
 }logfile;
 
+/** \brief Preallocates clusters after the current position of the file
+  *        and creates its cluster link map.
+  *        While the map is set, FatFS finds the cluster of any position
+  *        without following the FAT chain, but cannot stretch the file.
+  *        If the map is too small for the fragments of the file, the file
+  *        is left in normal seek mode. If the card is full, less space is
+  *        preallocated.
+  *
+  * \param fp       Pointer to the open file.
+  * \param clmt     Pointer to the cluster link map table.
+  * \param items    Number of items in the table.
+  * \param size     Number of bytes to preallocate.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT preallocFile(FIL *fp, DWORD *clmt, UINT items, DWORD size){
+    DWORD pos = f_tell(fp);
+    FRESULT fr;
+    /* In normal seek mode seeking over the end allocates the clusters */
+    fp->cltbl = NULL;
+    fr = f_lseek(fp, pos + size);
+    if (fr != FR_OK)
+        return fr;
+    clmt[0] = items;
+    fp->cltbl = clmt;
+    fr = f_lseek(fp, CREATE_LINKMAP);
+    if (fr == FR_NOT_ENOUGH_CORE)
+        fp->cltbl = NULL;
+    else if (fr != FR_OK)
+        return fr;
+    return f_lseek(fp, pos);
+}
+
+/** \brief Writes data at the current position of a preallocated file,
+  *        the file is preallocated again if the data does not fit.
+  *        Returns FR_DENIED if the card is full.
+  *
+  * \param fp       Pointer to the open file.
+  * \param clmt     Pointer to the cluster link map table.
+  * \param items    Number of items in the table.
+  * \param size     Number of bytes to preallocate.
+  * \param buff     Pointer to the data.
+  * \param btw      Number of bytes to write.
+  * \param bw       Pointer to the number of bytes written.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT appendFile(FIL *fp, DWORD *clmt, UINT items, DWORD size,
+                          const void *buff, UINT btw, UINT *bw){
+    FRESULT fr;
+    *bw = 0;
+    if (f_tell(fp) + btw > f_size(fp)){
+        fr = preallocFile(fp, clmt, items, size < btw ? btw : size);
+        if (fr != FR_OK)
+            return fr;
+        if (f_tell(fp) + btw > f_size(fp))
+            return FR_DENIED;
+    }
+    return f_write(fp, buff, btw, bw);
+}
+
+/** \brief Closes a preallocated file, the unused space after the current
+  *        position is released.
+  *
+  * \param fp       Pointer to the open file.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT closePreallocFile(FIL *fp){
+    FRESULT fr = f_truncate(fp);
+    FRESULT frclose = f_close(fp);
+    return fr != FR_OK ? fr : frclose;
+}
+
+/** \brief Syncs a preallocated file, it remains open. The directory entry
+  *        gets the size of the written data, so after a power loss the
+  *        file ends at the last sync and not with the unused space.
+  *        The preallocated clusters stay in the chain, they are used
+  *        again when the file is extended.
+  *
+  * \param fp       Pointer to the open file.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT syncPreallocFile(FIL *fp){
+    DWORD size = fp->fsize;
+    FRESULT fr;
+    fp->fsize = f_tell(fp);
+    fr = f_sync(fp);
+    fp->fsize = size;
+    return fr;
+}
+
+#if LOG_FILE_JOURNAL
+/*===========================================================================*/
+/* Log file journal                                                          */
+/*===========================================================================*/
+/*
+ * The log file is a sequence of fixed size records, each log buffer item
+ * is written in a record. A record never crosses a sector boundary, so a
+ * write interrupted by a power fail damages only the records of the last
+ * sector. The space of the file is preallocated and committed before the
+ * records are written in it, then the data sectors are the only ones
+ * written until the next preallocation.
+ * After a power fail the directory entry covers the whole preallocated
+ * space, the end of the log is found scanning forward to the last valid
+ * record: its CRC matches, its sequence number is its index in the file
+ * and its run id is the one of the open file. The records of deleted
+ * files found in the preallocated clusters have a different run id.
+ * The run id and the name of the open log file are kept in
+ * LOG_JOURNAL_MARKER, it is deleted on close and the file is recovered
+ * at the next card mount if present.
+ * An existing file with an invalid first record is not a journal, it is
+ * renamed with LOG_FOREIGN_SUFFIX instead of being overwritten.
+ */
+
+#if FILE_BUFFER_ITEM_SIZE > LOG_RECORD_SIZE - 13
+    #error log buffer items do not fit in log records!
+#endif
+
+#if MMCSD_BLOCK_SIZE % LOG_RECORD_SIZE
+    #error log records must not cross sector boundaries!
+#endif
+
+/** \brief Log journal record, little endian.
+  */
+struct log_record{
+    uint32_t seq;           /**< Index of the record in the file. */
+    uint32_t runid;         /**< Equal in all records of the file. */
+    uint8_t len;            /**< Number of bytes in the payload. */
+    uint8_t payload[LOG_RECORD_SIZE - 13];
+    uint32_t crc;           /**< CRC-32 of the previous fields. */
+};
+
+/* Compile time check of the record size */
+typedef char log_record_size_check[sizeof(struct log_record) == LOG_RECORD_SIZE ? 1 : -1];
+
+/** \brief Records read in a step of the journal scan.
+  */
+static struct log_record logscanbuff[MMCSD_BLOCK_SIZE / LOG_RECORD_SIZE];
+
+/** \brief Marker file, used only while the log file is opened or closed.
+  */
+static FIL logmarker;
+
+/** \brief Scans the records of an open log file from the beginning and
+  *        moves the file pointer after the last valid one.
+  *
+  * \param fp       Pointer to the open file, with read access.
+  * \param seq      Pointer to the number of valid records.
+  * \param runid    Pointer to the run id of the records. If zero, it is
+  *                 taken from the first record and left zero if none.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT scanLogJournal(FIL *fp, uint32_t *seq, uint32_t *runid){
+    FRESULT fr;
+    UINT br, i, n;
+    struct log_record *rp;
+    *seq = 0;
+    fr = f_lseek(fp, 0);
+    while (fr == FR_OK){
+        fr = f_read(fp, logscanbuff, sizeof(logscanbuff), &br);
+        n = br / sizeof(struct log_record);
+        for (i = 0; i < n; i++){
+            rp = &logscanbuff[i];
+            if (rp->seq != *seq || (*runid && rp->runid != *runid) || rp->len > sizeof(rp->payload) ||
+                rp->crc != crc32(CRC32_INIT, rp, offsetof(struct log_record, crc)))
+                break;
+            *runid = rp->runid;
+            (*seq)++;
+        }
+        if (i < n || br < sizeof(logscanbuff))
+            break;
+    }
+    if (fr == FR_OK)
+        fr = f_lseek(fp, *seq * sizeof(struct log_record));
+    return fr;
+}
+
+/** \brief Writes a log buffer item in a record of the log file, the
+  *        space is preallocated and committed first if needed.
+  *
+  * \param data     Pointer to the data.
+  * \param n        Number of bytes, at most the payload size.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT appendLogRecord(const uint8_t *data, uint8_t n){
+    static struct log_record record;
+    FRESULT fr;
+    if (f_tell(&logfile.file) + sizeof(record) > f_size(&logfile.file)){
+        fr = preallocFile(&logfile.file, logfile.clmt, FILE_CLMT_SIZE, LOG_FILE_PREALLOC_SIZE);
+        if (fr == FR_OK)
+            fr = f_sync(&logfile.file);
+        if (fr != FR_OK)
+            return fr;
+        logfile.uncommitted = 0;
+    }
+    record.seq = logfile.seq;
+    record.runid = logfile.runid;
+    record.len = n;
+    memcpy(record.payload, data, n);
+    memset(&record.payload[n], 0, sizeof(record.payload) - n);
+    record.crc = crc32(CRC32_INIT, &record,
+                       offsetof(struct log_record, crc));
+    fr = appendFile(&logfile.file, logfile.clmt, FILE_CLMT_SIZE, LOG_FILE_PREALLOC_SIZE,
+                    &record, sizeof(record), &logfile.bw);
+    if (fr == FR_OK){
+        logfile.seq++;
+        logfile.uncommitted++;
+    }
+    return fr;
+}
+
+/** \brief Stores the run id and the name of the open log file in the
+  *        marker file.
+  *
+  * \param filename Pointer to string of the filename with full path.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT writeLogMarker(const char *filename){
+    UINT bw;
+    FRESULT fr = f_open(&logmarker, LOG_JOURNAL_MARKER, FA_CREATE_ALWAYS | FA_WRITE);
+    if (fr != FR_OK)
+        return fr;
+    fr = f_write(&logmarker, &logfile.runid, sizeof(logfile.runid), &bw);
+    if (fr == FR_OK)
+        fr = f_write(&logmarker, filename, strlen(filename), &bw);
+    f_close(&logmarker);
+    return fr;
+}
+
+/** \brief Recovers the log file left open by a power fail or card
+  *        removal: its size is truncated after the last valid record.
+  */
+static void recoverLogJournal(void){
+    char filename[FILE_BUFFER_ITEM_SIZE];
+    uint32_t seq, runid = 0;
+    UINT br;
+    chMtxLock(&chrmtx);
+    if (f_open(&logmarker, LOG_JOURNAL_MARKER, FA_READ) != FR_OK){
+        chMtxUnlock(&chrmtx);
+        return;
+    }
+    if (f_read(&logmarker, &runid, sizeof(runid), &br) != FR_OK || br != sizeof(runid) ||
+        f_read(&logmarker, filename, sizeof(filename) - 1, &br) != FR_OK)
+        br = 0;
+    f_close(&logmarker);
+    filename[br] = 0;
+    if (br && f_open(&logfile.file, filename, FA_OPEN_EXISTING | FA_READ | FA_WRITE) == FR_OK){
+        if (scanLogJournal(&logfile.file, &seq, &runid) == FR_OK)
+            f_truncate(&logfile.file);
+        f_close(&logfile.file);
+    }
+    f_unlink(LOG_JOURNAL_MARKER);
+    chMtxUnlock(&chrmtx);
+}
+
+/** \brief Keeps a file, that is not a log journal, under a new name.
+  *
+  * \param filename Pointer to string of the filename with full path.
+  * \return Result of the file operations (see Chan FAT FS ff.h file).
+  */
+static FRESULT renameForeignLogFile(const char *filename){
+    char newname[FILE_BUFFER_ITEM_SIZE + sizeof(LOG_FOREIGN_SUFFIX)];
+    chsnprintf(newname, sizeof(newname), "%s%s", filename, LOG_FOREIGN_SUFFIX);
+    return f_rename(filename, newname);
+}
+#endif /* LOG_FILE_JOURNAL */
+
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+/** \brief Structure of trace file.
+  */
+static struct{
+    bool isopen;
+    bool close;
+    FIL file;
+    FRESULT fr;
+    UINT bw;
+    uint32_t written;
+    size_t fill;
+    uint8_t buff[TRACE_FILE_CHUNK_SIZE + CH_TRACE_STREAM_READ_MIN];
+}tracefile;
+
+/** \brief Writes the kernel trace stream into the trace file in
+  *        TRACE_FILE_CHUNK_SIZE chunks, so FatFS can write whole sectors.
+  *
+  * \param flush    Writes also the last partial chunk and the stream end.
+  */
+static void writeTraceFile(bool flush){
+    size_t n;
+    unsigned chunks = 0;
+    do {
+        n = chDbgReadTraceStream(&tracefile.buff[tracefile.fill], sizeof(tracefile.buff) - tracefile.fill);
+        tracefile.fill += n;
+        if (tracefile.fill >= TRACE_FILE_CHUNK_SIZE){
+            chMtxLock(&chrmtx);
+            tracefile.fr = f_write(&tracefile.file, tracefile.buff, TRACE_FILE_CHUNK_SIZE, &tracefile.bw);
+            chMtxUnlock(&chrmtx);
+            tracefile.written += tracefile.bw;
+            tracefile.fill -= TRACE_FILE_CHUNK_SIZE;
+            memmove(tracefile.buff, &tracefile.buff[TRACE_FILE_CHUNK_SIZE], tracefile.fill);
+            chunks++;
+        }
+    } while (n && chunks < TRACE_FILE_MAX_CHUNKS && tracefile.fr == FR_OK);
+    if (flush){
+        tracefile.buff[tracefile.fill++] = CH_TRACE_TYPE_UNUSED;
+        chMtxLock(&chrmtx);
+        tracefile.fr = f_write(&tracefile.file, tracefile.buff, tracefile.fill, &tracefile.bw);
+        chMtxUnlock(&chrmtx);
+        tracefile.written += tracefile.bw;
+        tracefile.fill = 0;
+    }
+}
+#endif
+
 /*===========================================================================*/
 /* Card monitor                                                              */
 /*===========================================================================*/
@@ -215,41 +546,138 @@ static void InsertHandler(eventid_t id) {
    */
     if (sdcConnect(&SDCD1))
         return;
+    chMtxLock(&chrmtx);
     err = f_mount(&cardhandler.SDC_FS, "/", 1);
+    if (err == FR_OK)
+        err = f_getfree("/", &clusters, &fsp);
+    chMtxUnlock(&chrmtx);
     if (err != FR_OK){
         sdcDisconnect(&SDCD1);
         cardhandler.state = SDC_ERROR;
         displaySdcState(&cardhandler.state);
         return;
     }
-    err = f_getfree("/", &clusters, &fsp);
-        if(err != FR_OK){
-            sdcDisconnect(&SDCD1);
-            cardhandler.state = SDC_ERROR;
-            displaySdcState(&cardhandler.state);
-            return;
-        }
     cardhandler.freespace = clusters*(uint32_t)cardhandler.SDC_FS.csize*(uint32_t)MMCSD_BLOCK_SIZE;
     if (!cardhandler.freespace){
         cardhandler.state = SDC_FULL;
         displaySdcState(&cardhandler.state);
         return;
         }
+#if LOG_FILE_JOURNAL
+    recoverLogJournal();
+#endif
     cardhandler.fs_ready = TRUE;
     cardhandler.state = SDC_READY;
     displaySdcState(&cardhandler.state);
 }
 
 /** \brief Card removal event.
+  *
+  * Queued writes are drained first, the driver must be idle when stopped.
   */
 static void RemoveHandler(eventid_t id) {
     (void)id;
-    sdcDisconnect(&SDCD1);
-    cardhandler.fs_ready = FALSE;
+    if (cardhandler.state == SDC_USBHOST)
+        msdDetachMedium(&UMSD1);
+    cardhandler.usbdisk = FALSE;
+    chMtxLock(&chrmtx);
+    (void)disk_ioctl(0, CTRL_SYNC, NULL);
+    sdcDisconnect(&SDCD1);
+    cardhandler.fs_ready = FALSE;
+    resultfile.isopen = 0;
+    logfile.isopen = 0;
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+    /* The stream is not drained any more, the next start discards it */
+    tracefile.isopen = 0;
+    tracefile.close = 0;
+    tracefile.fill = 0;
+#endif
+    chMtxUnlock(&chrmtx);
     cardhandler.state = SDC_NOTINSERTED;
     displaySdcState(&cardhandler.state);
 }
 
+/*===========================================================================*/
+/* USB disk                                                                  */
+/*===========================================================================*/
+/** \brief USB disk request event, broadcast by the user interface.
+  */
+static event_source_t usbdisk_event;
+
+/** \brief Listener of the USB mass storage driver events.
+  */
+static event_listener_t msdel;
+
+/** \brief A script file is open.
+  */
+static bool scriptopen = FALSE;
+
+/** \brief A file is open by the dump file command.
+  */
+static bool dumpopen = FALSE;
+
+/** \brief Says, that a file is open on the card.
+  */
+static bool isFileOpen(void){
+    return resultfile.isopen || logfile.isopen || scriptopen || dumpopen
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+           || tracefile.isopen
+#endif
+           ;
+}
+
+/** \brief Gives the card to the USB host.
+  *        Only when no file is open, the queued writes are flushed and the
+  *        file system is unmounted, so later file operations fail until
+  *        the card is given back.
+  */
+static void attachUsbDisk(void){
+    chMtxLock(&chrmtx);
+    if (isFileOpen() || (cardhandler.state != SDC_READY && cardhandler.state != SDC_FULL)){
+        cardhandler.usbdisk = FALSE;
+        chMtxUnlock(&chrmtx);
+        return;
+    }
+    cardhandler.fs_ready = FALSE;
+    (void)disk_ioctl(0, CTRL_SYNC, NULL);
+    f_mount(NULL, "/", 0);
+    cardhandler.state = SDC_USBHOST;
+    chMtxUnlock(&chrmtx);
+    msdAttachMedium(&UMSD1, (BaseBlockDevice *)&SDCD1);
+    displaySdcState(&cardhandler.state);
+}
+
+/** \brief Takes the card back from the USB host.
+  *        The host could have changed anything, the card is mounted
+  *        again like a new one.
+  */
+static void detachUsbDisk(void){
+    msdDetachMedium(&UMSD1);
+    sdcDisconnect(&SDCD1);
+    InsertHandler(0);
+    if (cardhandler.state == SDC_USBHOST){
+        cardhandler.state = SDC_ERROR;
+        displaySdcState(&cardhandler.state);
+    }
+}
+
+/** \brief USB disk event, user request, host eject or USB disconnection.
+  */
+static void UsbDiskHandler(eventid_t id) {
+    (void)id;
+    bool request;
+    eventflags_t flags = chEvtGetAndClearFlags(&msdel);
+    chMtxLock(&chrmtx);
+    if (flags & (MSD_EJECTED | MSD_DISCONNECTED))
+        cardhandler.usbdisk = FALSE;
+    request = cardhandler.usbdisk;
+    chMtxUnlock(&chrmtx);
+    if (request && cardhandler.state != SDC_USBHOST)
+        attachUsbDisk();
+    else if (!request && cardhandler.state == SDC_USBHOST)
+        detachUsbDisk();
+}
+
 /*===========================================================================*/
 /* Thread function.                                                          */
 /*===========================================================================*/
@@ -265,15 +693,20 @@ static THD_FUNCTION(Threadcardhandler, arg) {
     struct fbuff_item *buffer;
     static const evhandler_t evhndl[] = {
         InsertHandler,
-        RemoveHandler
+        RemoveHandler,
+        UsbDiskHandler
     };
-    event_listener_t el0, el1;
+    event_listener_t el0, el1, el2;
     chEvtRegister(&inserted_event, &el0, 0);
     chEvtRegister(&removed_event, &el1, 1);
+    chEvtRegister(&usbdisk_event, &el2, 2);
+    chEvtRegisterMaskWithFlags(msdGetEventSource(&UMSD1), &msdel, EVENT_MASK(2),
+                               MSD_EJECTED | MSD_DISCONNECTED);
     displaySdcState(&cardhandler.state);
     while(TRUE) {
-        /* Read date and time from RTC*/
+        /* Read date and time from RTC and publish it */
         rtcGetTime(&RTCD1, &cardhandler.rtctime);
+        chSnapshotPublish(&rtcsnap, &cardhandler.rtctime);
         /* Wait for SDC event with timeout */
         chEvtDispatch(evhndl, chEvtWaitOneTimeout(ALL_EVENTS, US2ST(CARDHANDLER_SLEEP_TIME_US)));
         if (cardhandler.state == SDC_READY || cardhandler.state == SDC_BUSY){
@@ -287,7 +720,10 @@ static THD_FUNCTION(Threadcardhandler, arg) {
                     item = getFullInnerBufferItem(&resfilequeue);
                     if (item){
                         buffer = (struct fbuff_item*)item->data;
-                        resultfile.fr = f_write(&resultfile.file, buffer->fbuff, buffer->element_num, &resultfile.bw);
+                        chMtxLock(&chrmtx);
+                        resultfile.fr = appendFile(&resultfile.file, resultfile.clmt, FILE_CLMT_SIZE, RESULT_FILE_PREALLOC_SIZE,
+                                                   buffer->fbuff, buffer->element_num, &resultfile.bw);
+                        chMtxUnlock(&chrmtx);
                         bzero(buffer->fbuff, FILE_BUFFER_ITEM_SIZE);
                         releaseEmptyInnerBufferItem(&resfilequeue, item);
                     }
@@ -295,8 +731,8 @@ static THD_FUNCTION(Threadcardhandler, arg) {
             }
             /* Close result file, if the buffer is empty */
             if (resultfile.close && isInnerBufferEmpty(&resfilequeue)){
-                    resultfile.fr = f_close(&resultfile.file);
                     chMtxLock(&chrmtx);
+                    resultfile.fr = closePreallocFile(&resultfile.file);
                     resultfile.isopen = 0;
                     resultfile.close = 0;
                     chMtxUnlock(&chrmtx);
@@ -313,22 +749,59 @@ static THD_FUNCTION(Threadcardhandler, arg) {
                     item = getFullInnerBufferItem(&logfilequeue);
                     if (item){
                         buffer = (struct fbuff_item*)item->data;
-                        logfile.fr = f_write(&logfile.file, buffer->fbuff, buffer->element_num, &logfile.bw);
+                        chMtxLock(&chrmtx);
+#if LOG_FILE_JOURNAL
+                        logfile.fr = appendLogRecord(buffer->fbuff, buffer->element_num);
+#else
+                        logfile.fr = appendFile(&logfile.file, logfile.clmt, FILE_CLMT_SIZE, LOG_FILE_PREALLOC_SIZE,
+                                                buffer->fbuff, buffer->element_num, &logfile.bw);
+#endif
+                        chMtxUnlock(&chrmtx);
                         bzero(buffer->fbuff, FILE_BUFFER_ITEM_SIZE);
                         releaseEmptyInnerBufferItem(&logfilequeue, item);
                     }
                 }
             }
-            /* Close log file, if the buffer is empty */
-            if (logfile.close && isInnerBufferEmpty(&logfilequeue)){
-                logfile.fr = f_close(&logfile.file);
+            /* Sync or close log file, if the buffer is empty */
+            if ((logfile.sync || logfile.close) && isInnerBufferEmpty(&logfilequeue)){
                 chMtxLock(&chrmtx);
-                logfile.isopen = 0;
+                if (logfile.close){
+                    logfile.fr = closePreallocFile(&logfile.file);
+                    logfile.isopen = 0;
+#if LOG_FILE_JOURNAL
+                    if (logfile.fr == FR_OK)
+                        f_unlink(LOG_JOURNAL_MARKER);
+#endif
+                }
+#if LOG_FILE_JOURNAL
+                /* Commit point, the records are valid without it */
+                else if (logfile.uncommitted >= LOG_JOURNAL_COMMIT_RECORDS){
+                    logfile.fr = f_sync(&logfile.file);
+                    logfile.uncommitted = 0;
+                }
+#else
+                else
+                    logfile.fr = syncPreallocFile(&logfile.file);
+#endif
+                logfile.sync = 0;
                 logfile.close = 0;
                 chMtxUnlock(&chrmtx);
                 cardhandler.state = SDC_READY;
                 displaySdcState(&cardhandler.state);
             }
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+            /* Write the trace stream into the trace file */
+            if (tracefile.isopen){
+                writeTraceFile(tracefile.close);
+                if (tracefile.close){
+                    chMtxLock(&chrmtx);
+                    tracefile.fr = f_close(&tracefile.file);
+                    tracefile.isopen = 0;
+                    tracefile.close = 0;
+                    chMtxUnlock(&chrmtx);
+                }
+            }
+#endif
         }
     }
     chThdExit(1);
@@ -338,7 +811,8 @@ static THD_FUNCTION(Threadcardhandler, arg) {
 /* Exported functions.                                                       */
 /*===========================================================================*/
 /** \brief Creates new result file, if exist,
-  *        will be overwritten.
+  *        will be overwritten. Space is preallocated and the unused
+  *        part is released at close.
   * \param filename     Pointer to string of the filename with full path, NULL save.
   * \note  The /results is always the beginning of the string!
   * \return Result of file open operation (see Chan FAT FS ff.h file)
@@ -347,9 +821,14 @@ static THD_FUNCTION(Threadcardhandler, arg) {
 uint8_t openResultFile(const char* filename){
     if (!filename)
         return UCHAR_MAX;
-    f_mkdir("/results");
     chMtxLock(&chrmtx);
+    f_mkdir("/results");
     resultfile.fr = f_open(&resultfile.file, filename, FA_OPEN_ALWAYS | FA_WRITE);
+    if (!resultfile.fr){
+        resultfile.fr = preallocFile(&resultfile.file, resultfile.clmt, FILE_CLMT_SIZE, RESULT_FILE_PREALLOC_SIZE);
+        if (resultfile.fr)
+            closePreallocFile(&resultfile.file);
+    }
     if (!resultfile.fr){
         resultfile.isopen = 1;
         resultfile.close = 0;
@@ -368,6 +847,8 @@ void closeResultFile(void){
 
 /** \brief Creates new log file, if exist,
   *        the data will be appended to the end.
+  *        The file stays open until closeLogFile(), opening it again only
+  *        cancels a pending sync. Space is preallocated after the end.
   * \param filename     Pointer to string of the filename with full path, NULL save.
   * \note  The /logs is always the beginning of the string!
   * \return Result of file open operation (see Chan FAT FS ff.h file)
@@ -376,23 +857,84 @@ void closeResultFile(void){
 uint8_t openLogFile(const char* filename){
     if (!filename)
         return UCHAR_MAX;
-    f_mkdir("/logs");
     chMtxLock(&chrmtx);
+    if (logfile.isopen && !logfile.close && logfile.fr == FR_OK &&
+        !strncmp(logfile.name, filename, sizeof(logfile.name))){
+        logfile.sync = 0;
+        chMtxUnlock(&chrmtx);
+        return FR_OK;
+    }
+    if (logfile.isopen){
+        closePreallocFile(&logfile.file);
+        logfile.isopen = 0;
+    }
+    f_mkdir("/logs");
+#if LOG_FILE_JOURNAL
+    logfile.fr = f_open(&logfile.file, filename, FA_OPEN_ALWAYS | FA_READ | FA_WRITE);
+    if (!logfile.fr){
+        logfile.runid = 0;
+        logfile.fr = scanLogJournal(&logfile.file, &logfile.seq, &logfile.runid);
+        if (!logfile.fr && !logfile.seq && f_size(&logfile.file)){
+            /* Not a journal, the log starts in a new file */
+            f_close(&logfile.file);
+            logfile.fr = renameForeignLogFile(filename);
+            if (!logfile.fr)
+                logfile.fr = f_open(&logfile.file, filename, FA_CREATE_NEW | FA_READ | FA_WRITE);
+            if (logfile.fr){
+                chMtxUnlock(&chrmtx);
+                return (uint8_t)logfile.fr;
+            }
+        }
+        if (!logfile.seq){
+            /* Differs from the run id of records left by deleted files */
+            RTCDateTime rtctime;
+            chSnapshotRead(&rtcsnap, &rtctime);
+            logfile.runid = ((rtctime.millisecond ^ ((uint32_t)rtctime.day << 27)) + chVTGetSystemTimeX()) | 1U;
+        }
+        logfile.uncommitted = 0;
+        if (!logfile.fr)
+            logfile.fr = writeLogMarker(filename);
+        if (!logfile.fr)
+            logfile.fr = preallocFile(&logfile.file, logfile.clmt, FILE_CLMT_SIZE, LOG_FILE_PREALLOC_SIZE);
+        if (!logfile.fr)
+            logfile.fr = f_sync(&logfile.file);
+        if (logfile.fr)
+            closePreallocFile(&logfile.file);
+    }
+#else
     logfile.fr = f_open(&logfile.file, filename, FA_OPEN_ALWAYS | FA_WRITE);
+    if (!logfile.fr){
+        logfile.fr = f_lseek(&logfile.file, f_size(&logfile.file));
+        if (!logfile.fr)
+            logfile.fr = preallocFile(&logfile.file, logfile.clmt, FILE_CLMT_SIZE, LOG_FILE_PREALLOC_SIZE);
+        if (logfile.fr)
+            closePreallocFile(&logfile.file);
+    }
+#endif
     if (!logfile.fr){
         logfile.isopen = 1;
+        logfile.sync = 0;
         logfile.close = 0;
-        f_lseek(&logfile.file, f_size(&logfile.file));
+        strncpy(logfile.name, filename, sizeof(logfile.name) - 1);
     }
     chMtxUnlock(&chrmtx);
     return (uint8_t)logfile.fr;
 }
 
+/** \brief Syncs log file, it remains open.
+  */
+void syncLogFile(void){
+    chMtxLock(&chrmtx);
+    logfile.sync = 1;
+    chMtxUnlock(&chrmtx);
+}
+
 /** \brief Closes log file.
   */
 void closeLogFile(void){
     chMtxLock(&chrmtx);
-    logfile.close = 1;
+    if (logfile.isopen)
+        logfile.close = 1;
     chMtxUnlock(&chrmtx);
 }
 
@@ -405,9 +947,8 @@ void closeLogFile(void){
 void getDateStr(char *str, size_t size){
     if (!str || size < 25)
         return;
-    chMtxLock(&chrmtx);
-    RTCDateTime rtctime = cardhandler.rtctime;
-    chMtxUnlock(&chrmtx);
+    RTCDateTime rtctime;
+    chSnapshotRead(&rtcsnap, &rtctime);
     uint32_t sec = rtctime.millisecond / 1000;
     chsnprintf(str, size, "%4d.%02d.%02d. %02d:%02d:%02d", rtctime.year+1980, rtctime.month, rtctime.day,
                                                 sec/3600,  (sec%3600/60), (sec%3600)%60);
@@ -420,9 +961,7 @@ void getDateStr(char *str, size_t size){
 void getDate(RTCDateTime *date){
     if (!date)
         return;
-    chMtxLock(&chrmtx);
-    *date = cardhandler.rtctime;
-    chMtxUnlock(&chrmtx);
+    chSnapshotRead(&rtcsnap, date);
 }
 
 /** \brief Says date and time in millisecond since midnight.
@@ -432,9 +971,9 @@ void getDate(RTCDateTime *date){
 void getTime(uint32_t *time){
     if (!time)
         return;
-    chMtxLock(&chrmtx);
-    *time = cardhandler.rtctime.millisecond;
-    chMtxUnlock(&chrmtx);
+    RTCDateTime rtctime;
+    chSnapshotRead(&rtcsnap, &rtctime);
+    *time = rtctime.millisecond;
 }
 
 /** \brief Set RTC date and time from human date and time.
@@ -509,10 +1048,222 @@ void cmd_sdc(BaseSequentialStream *chp, int argc, char *argv[]) {
         case SDC_READY:            chprintf(chp, "SD Card ready\r\n");
                                    break;
         case SDC_FULL:             chprintf(chp, "SD Card full\r\n");
+                                   break;
+        case SDC_USBHOST:          chprintf(chp, "SD Card used by USB host\r\n");
     }
     chprintf(chp, "Free space: %ld byte\r\n", freespace);
+    DWORD cachestats[3];
+    if (disk_ioctl(0, CTRL_CACHE_STATS, cachestats) == RES_OK)
+        chprintf(chp, "Sector cache hits: %lu misses: %lu write-backs: %lu\r\n",
+                 cachestats[0], cachestats[1], cachestats[2]);
 }
 
+/** \brief Trace file user interface, starts and stops writing the kernel
+  *        trace stream into a file.
+  */
+void cmd_tracefile(BaseSequentialStream *chp, int argc, char *argv[]) {
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+    const char *filename = TRACE_FILE_NAME;
+    if (argc >= 1 && argc <= 2 && !strcmp(argv[0], "start")){
+        if (argc == 2)
+            filename = argv[1];
+        if (tracefile.isopen){
+            chprintf(chp, "Trace file already open\r\n");
+            return;
+        }
+        if (!cardhandler.fs_ready){
+            chprintf(chp, "SD Card not ready\r\n");
+            return;
+        }
+        chMtxLock(&chrmtx);
+        f_mkdir("/traces");
+        tracefile.fr = f_open(&tracefile.file, filename, FA_CREATE_ALWAYS | FA_WRITE);
+        if (!tracefile.fr){
+            tracefile.written = 0;
+            tracefile.fill = 0;
+            chDbgStartTraceStream();
+            tracefile.close = 0;
+            tracefile.isopen = 1;
+        }
+        chMtxUnlock(&chrmtx);
+        chprintf(chp, "Trace file open: %d\r\n", tracefile.fr);
+    }
+    else if (argc == 1 && !strcmp(argv[0], "stop")){
+        chMtxLock(&chrmtx);
+        tracefile.close = tracefile.isopen;
+        chMtxUnlock(&chrmtx);
+    }
+    else if (argc == 0){
+        chprintf(chp, "Trace file %s, written: %lu byte, result: %d\r\n",
+                 tracefile.isopen ? "open" : "closed", tracefile.written, tracefile.fr);
+    }
+    else {
+        chprintf(chp, "Usage: tracefile [start [filename]|stop]\r\n");
+    }
+#else
+    (void) argc;
+    (void) argv;
+    chprintf(chp, "Trace stream disabled\r\n");
+#endif
+}
+
+void cmd_dumpfile(BaseSequentialStream *chp, int argc, char *argv[]) {
+    /* Kept off the shell stack, guarded by dumpopen */
+    static FIL file;
+    FRESULT fr;
+    UINT br;
+    size_t size;
+    uint8_t *buf;
+    uint32_t dumped = 0;
+    bool running;
+    if (argc != 1){
+        chprintf(chp, "Usage: dumpfile filename\r\n");
+        return;
+    }
+    if (!cardhandler.fs_ready){
+        chprintf(chp, "SD Card not ready\r\n");
+        return;
+    }
+    chMtxLock(&chrmtx);
+    running = dumpopen;
+    fr = FR_OK;
+    if (!running)
+        fr = f_open(&file, argv[0], FA_OPEN_EXISTING | FA_READ);
+    if (!running && !fr)
+        dumpopen = TRUE;
+    chMtxUnlock(&chrmtx);
+    if (running){
+        chprintf(chp, "Dump already running\r\n");
+        return;
+    }
+    if (fr){
+        chprintf(chp, "File open error: %d\r\n", fr);
+        return;
+    }
+    do {
+        br = 0;
+        if (chp == (BaseSequentialStream *)&SDU1){
+            /* Reading straight into the USB packet buffer, no copy. */
+            buf = sduGetEmptyBufferTimeout(&SDU1, &size, TIME_INFINITE);
+            if (buf == NULL)
+                break;
+            chMtxLock(&chrmtx);
+            fr = f_read(&file, buf, size, &br);
+            chMtxUnlock(&chrmtx);
+            if (br)
+                sduPostFullBuffer(&SDU1, br);
+        }
+        else {
+            uint8_t tmp[64];
+            size = sizeof(tmp);
+            chMtxLock(&chrmtx);
+            fr = f_read(&file, tmp, size, &br);
+            chMtxUnlock(&chrmtx);
+            streamWrite(chp, tmp, br);
+        }
+        dumped += br;
+    } while (!fr && br == size);
+    chMtxLock(&chrmtx);
+    f_close(&file);
+    dumpopen = FALSE;
+    chMtxUnlock(&chrmtx);
+    if (fr)
+        chprintf(chp, "\r\nFile read error: %d after %lu byte\r\n", fr, dumped);
+}
+
+/** \brief Reads the next line of a script file.
+  *        Lines longer than the buffer are split.
+  * \return FALSE at the end of the file or on error.
+  */
+static bool readScriptLine(FIL *fp, char *line, UINT size, FRESULT *frp){
+    UINT br = 0;
+    char *end;
+    chMtxLock(&chrmtx);
+    *frp = f_read(fp, line, size - 1, &br);
+    if (*frp == FR_OK && br){
+        line[br] = '\0';
+        end = strpbrk(line, "\r\n");
+        if (end != NULL){
+            /* Rewinding to the start of the next line. */
+            *end = '\0';
+            *frp = f_lseek(fp, f_tell(fp) - br + (UINT)(end - line) + 1);
+        }
+    }
+    chMtxUnlock(&chrmtx);
+    return *frp == FR_OK && br;
+}
+
+void cardhandlerRunScript(BaseSequentialStream *chp, const ShellIndex *sip, const char *filename) {
+    /* Kept off the shell stack, guarded by scriptopen */
+    static FIL file;
+    static char line[SHELL_MAX_LINE_LENGTH];
+    FRESULT fr;
+    bool batch = TRUE;
+    bool running;
+    uint32_t lines = 0, rejected = 0;
+    if (!cardhandler.fs_ready){
+        chprintf(chp, "SD Card not ready\r\n");
+        return;
+    }
+    chMtxLock(&chrmtx);
+    running = scriptopen;
+    fr = FR_OK;
+    if (!running)
+        fr = f_open(&file, filename, FA_OPEN_EXISTING | FA_READ);
+    if (!running && !fr)
+        scriptopen = TRUE;
+    chMtxUnlock(&chrmtx);
+    if (running){
+        chprintf(chp, "Script already running\r\n");
+        return;
+    }
+    if (fr){
+        chprintf(chp, "File open error: %d\r\n", fr);
+        return;
+    }
+    while (readScriptLine(&file, line, sizeof(line), &fr)){
+        if (line[0] == '\0')
+            continue;
+        lines++;
+        if (shellExecute(sip, chp, line, &batch))
+            rejected++;
+    }
+    chMtxLock(&chrmtx);
+    f_close(&file);
+    scriptopen = FALSE;
+    chMtxUnlock(&chrmtx);
+    if (fr)
+        chprintf(chp, "File read error: %d\r\n", fr);
+    chprintf(chp, "#END %lu lines %lu rejected\r\n", lines, rejected);
+}
+
+void cmd_usbdisk(BaseSequentialStream *chp, int argc, char *argv[]) {
+    bool busy = FALSE;
+    if (argc == 1 && !strcmp(argv[0], "on")){
+        chMtxLock(&chrmtx);
+        busy = isFileOpen();
+        if (!busy)
+            cardhandler.usbdisk = TRUE;
+        chMtxUnlock(&chrmtx);
+        if (busy){
+            chprintf(chp, "SD Card in use, files are open\r\n");
+            return;
+        }
+        chEvtBroadcast(&usbdisk_event);
+    }
+    else if (argc == 1 && !strcmp(argv[0], "off")){
+        chMtxLock(&chrmtx);
+        cardhandler.usbdisk = FALSE;
+        chMtxUnlock(&chrmtx);
+        chEvtBroadcast(&usbdisk_event);
+    }
+    else if (argc == 0){
+        chprintf(chp, "USB disk %s\r\n", cardhandler.state == SDC_USBHOST ? "attached" : "detached");
+    }
+    else {
+        chprintf(chp, "Usage: usbdisk [on|off]\r\n");
+    }
+}
 
 /** \brief Initializes cardhandler thread.
   *         - Start SDC Driver.
@@ -524,7 +1275,10 @@ void cmd_sdc(BaseSequentialStream *chp, int argc, char *argv[]) {
 void cardhandlerInit(void){
     sdcStart(&SDCD1, NULL);
     tmr_init(&SDCD1);
+    chEvtObjectInit(&usbdisk_event);
     innerBufferInit(&resfilequeue, &resfilepool, resfilebuff, FILE_BUFFER_SIZE);
+    chPoolRegister(&resfilepool, "resfile");
     innerBufferInit(&logfilequeue, &logfilepool, logfilebuff, FILE_BUFFER_SIZE);
+    chPoolRegister(&logfilepool, "logfile");
     chThdCreateStatic(waThreadcardhandler, sizeof(waThreadcardhandler), NORMALPRIO, Threadcardhandler, NULL);
 }
@@ -69,6 +69,7 @@ static char *errortypes[] = {"Sensor0 error",
   */
 static struct{
     msg_t mb_buff[ERR_HANDL_MAILBOX_SIZE];
+    msg_t fetched[ERR_HANDL_MAILBOX_SIZE];
     msg_t curr_massage;
     STAILQ_HEAD(errorlisthead, error_item) head;
     struct errorlisthead *headp;
@@ -171,53 +172,71 @@ static const EXTConfig extcfg ={
     }
 };
 
+/** \brief Adds an error to the error list.
+  *         - Stops the regulator and the sterilizer.
+  *
+  * \param msg  error massage code.
+  */
+static void processErrMail(msg_t msg){
+    struct error_item *item = NULL;
+    errhandl.curr_massage = msg;
+    if (errhandl.curr_massage)
+        item = chPoolAlloc(&errpool);
+    if(item){
+        switch(errhandl.curr_massage){
+            case SENSOR0_ERR_MSG:
+            case SENSOR1_ERR_MSG:
+            case SENSOR2_ERR_MSG:
+            case CRIT_DTEMP_ERR_MSG:
+            case CRIT_TEMP_ERR_MSG:
+            case FUZZY_LOGIC_ERR_MSG:
+            case CH0_FUSE_ERROR:
+            case CH1_FUSE_ERROR:
+            case CH2_FUSE_ERROR:        chMtxLock(&errmtx);
+                                        item->error_str = errortypes[errhandl.curr_massage-1];
+                                        if (STAILQ_EMPTY(&errhandl.head))
+                                            STAILQ_INSERT_HEAD(&errhandl.head, item, entries);
+                                        else
+                                            STAILQ_INSERT_TAIL(&errhandl.head, item, entries);
+                                        errhandl.erroritems++;
+                                        errhandl.freeitems--;
+                                        chMtxUnlock(&errmtx);
+                                        errhandl.curr_massage = 0;
+                                        sendDisableMailToRegluator(FUZZY_REG_DISABLE_MSG);
+                                        sendMailtoSterilizer(STOPERROR_STERILIZER);
+                                        displayErrorListItem(item->error_str);
+                                        break;
+        }
+    }
+    else{
+        errhandl.poolunderflow++;
+    }
+}
+
 /** \brief Errorhandler thread function.
-  *         - Receive massage for error mailbox and create error list.
+  *         - Receive massages for error mailbox in batches and create error list.
   */
 __attribute__((noreturn))
 static THD_FUNCTION(Threaderrorhandler, arg) {
     (void) arg;
     chRegSetThreadName("errorhandler");
-    struct error_item *item;
+    msg_t fuse_msgs[CHANNEL_NUM];
+    cnt_t n = 0, j, posted;
     uint8_t i;
     for(i=0; i<CHANNEL_NUM; i++){
         if (palReadPad(int_ch[i].port, int_ch[i].pin))
-            chMBPost(&error_mb, CH0_FUSE_ERROR+i, TIME_INFINITE);
+            fuse_msgs[n++] = CH0_FUSE_ERROR+i;
+    }
+    /* The batch is posted as far as there are free slots, the rest is posted again */
+    for(j=0; j<n; j+=posted){
+        posted = chMBPostBatch(&error_mb, &fuse_msgs[j], n-j, TIME_INFINITE);
+        if (!posted)
+            break;
     }
     while(TRUE) {
-        chMBFetch(&error_mb, &errhandl.curr_massage, TIME_INFINITE);
-        if (errhandl.curr_massage)
-            item = chPoolAlloc(&errpool);
-        if(item){
-            switch(errhandl.curr_massage){
-                case SENSOR0_ERR_MSG:
-                case SENSOR1_ERR_MSG:
-                case SENSOR2_ERR_MSG:
-                case CRIT_DTEMP_ERR_MSG:
-                case CRIT_TEMP_ERR_MSG:
-                case FUZZY_LOGIC_ERR_MSG:
-                case CH0_FUSE_ERROR:
-                case CH1_FUSE_ERROR:
-                case CH2_FUSE_ERROR:        chMtxLock(&errmtx);
-                                            item->error_str = errortypes[errhandl.curr_massage-1];
-                                            if (STAILQ_EMPTY(&errhandl.head))
-                                                STAILQ_INSERT_HEAD(&errhandl.head, item, entries);
-                                            else
-                                                STAILQ_INSERT_TAIL(&errhandl.head, item, entries);
-                                            errhandl.erroritems++;
-                                            errhandl.freeitems--;
-                                            chMtxUnlock(&errmtx);
-                                            errhandl.curr_massage = 0;
-                                            sendDisableMailToRegluator(FUZZY_REG_DISABLE_MSG);
-                                            sendMailtoSterilizer(STOPERROR_STERILIZER);
-                                            displayErrorListItem(item->error_str);
-                                            break;
-            }
-        }
-        else{
-            errhandl.poolunderflow++;
-        }
-        item = NULL;
+        n = chMBFetchBatch(&error_mb, errhandl.fetched, ERR_HANDL_MAILBOX_SIZE, TIME_INFINITE);
+        for(j=0; j<n; j++)
+            processErrMail(errhandl.fetched[j]);
         chThdSleepMicroseconds(ERRORHANDLER_SLEEP_TIME_US);
     }
     chThdExit(1);
@@ -254,6 +273,7 @@ void errorhandlerInit(void){
     STAILQ_INIT(&errhandl.head);
     errhandl.freeitems = ERROR_LIST_MAX_SIZE;
     chPoolLoadArray(&errpool, err_items, ERROR_LIST_MAX_SIZE);
+    chPoolRegister(&errpool, "errors");
     extStart(&EXTD1, &extcfg);
     chThdCreateStatic(waThreaderrorhandler, sizeof(waThreaderrorhandler), NORMALPRIO+30, Threaderrorhandler, NULL);
 }
@@ -0,0 +1,395 @@
+/*
+ *   Copyright (C) 2017  Gyorgy Stercz
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/** \file lcdpages.c
+  * \brief  Pages of the lcd controller source.
+  */
+
+#include <gfx.h>
+#include <lcdpages.h>
+#include <numkeys.h>
+
+/*===========================================================================*/
+/* Displayed objects                                                         */
+/*===========================================================================*/
+
+/** \brief Structure for displayed objects.
+  */
+static struct{
+    GTabsetObject tabset;
+    GLabelObject date;
+    GLabelObject sdc;
+    /*Sterilzer Page*/
+    GLabelObject curr_temp[CHANNEL_NUM];
+    GLabelObject ster_state;
+    GButtonObject ster_start;
+    GButtonObject ster_stop;
+    GProgressbarObject heatpower[CHANNEL_NUM];
+    GProgressbarObject steriletemps;
+    /*Result Page */
+    GLabelObject res_date;
+    GLabelObject final_result;
+    GLabelObject res_begin;
+    GLabelObject res_end;
+    GLabelObject reslist_header;
+    GListObject res_list;
+    GButtonObject res_print;
+    /*Errors Page*/
+    GListObject err_list;
+    /*Time Page */
+    GKeyboardObject keyboard;
+    GTexteditObject setyear;
+    GTexteditObject setmonth;
+    GTexteditObject setday;
+    GTexteditObject sethour;
+    GTexteditObject setmin;
+    GTexteditObject setsec;
+    GLabelObject setdatelabel;
+    GButtonObject setdatebtn;
+}go;
+
+/*===========================================================================*/
+/* Local functions                                                           */
+/*===========================================================================*/
+
+/** \brief Creates sterilizer tabset page.
+  *
+  * \param gh   Pointer to the handlers of displayed objects.
+  * \param wip  Pointer to widget init object, NULL save.
+  */
+static inline void createPageSterilizer(struct lcd_pages *gh, GWidgetInit *wip){
+    if (!wip)
+        return;
+    /* State label init */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 125; wip->g.y = 15;
+    wip->g.height = 45 ; wip->g.width = 300;
+    wip->g.parent =gh->sterilizer;
+    wip->customDraw = gwinLabelDrawJustifiedCenter;
+    gh->ster_state = gwinLabelCreate(&go.ster_state, wip);
+    gwinSetFont(gh->ster_state, gdispOpenFont("DejaVuSans32_aa"));
+    gh->statestyle = WhiteWidgetStyle;
+    gwinSetStyle(gh->ster_state, &gh->statestyle);
+
+    /* Tempreatue channel 0 label init */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 160; wip->g.y = 75;
+    wip->g.height = 45 ; wip->g.width = 200;
+    wip->g.parent =gh->sterilizer;
+    gh->curr_temp[0] = gwinLabelCreate(&go.curr_temp[0], wip);
+    gwinSetFont(gh->curr_temp[0], gdispOpenFont("DejaVuSans32_aa"));
+
+    /* Channel 1 label init */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 160; wip->g.y = 130;
+    wip->g.height = 45 ; wip->g.width = 200;
+    wip->g.parent =gh->sterilizer;
+    gh->curr_temp[1] = gwinLabelCreate(&go.curr_temp[1], wip);
+    gwinSetFont(gh->curr_temp[1], gdispOpenFont("DejaVuSans32_aa"));
+
+    /* Channel 2 label init */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 160; wip->g.y = 185;
+    wip->g.height = 45 ; wip->g.width = 200;
+    wip->g.parent =gh->sterilizer;
+    gh->curr_temp[2] = gwinLabelCreate(&go.curr_temp[2], wip);
+    gwinSetFont(gh->curr_temp[2], gdispOpenFont("DejaVuSans32_aa"));
+
+    /* Strerilizer start stop switch */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 5; wip->g.y = 5;
+    wip->g.height = 40 ; wip->g.width = 80; wip->text = "Start";
+    wip->g.parent =gh->sterilizer;
+    gh->ster_start = gwinButtonCreate(&go.ster_start, wip);
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 5; wip->g.y = 50;
+    wip->g.height = 40 ; wip->g.width = 80; wip->text = "Stop";
+    wip->g.parent =gh->sterilizer;
+    gh->ster_stop = gwinButtonCreate(&go.ster_stop, wip);
+
+    /* Heat power progressbars */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 370; wip->g.y = 75;
+    wip->g.height = 45 ; wip->g.width = 100; wip->text = "CH0";
+    wip->g.parent =gh->sterilizer;
+    gh->heatpower[0] = gwinProgressbarCreate(&go.heatpower[0], wip);
+
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 370; wip->g.y = 130;
+    wip->g.height = 45 ; wip->g.width = 100; wip->text = "CH1";
+    wip->g.parent =gh->sterilizer;
+    gh->heatpower[1] = gwinProgressbarCreate(&go.heatpower[1], wip);
+
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 370; wip->g.y = 185;
+    wip->g.height = 45 ; wip->g.width = 100; wip->text = "CH2";
+    wip->g.parent =gh->sterilizer;
+    gh->heatpower[2] = gwinProgressbarCreate(&go.heatpower[2], wip);
+
+    /* sterile temps progressbar */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 5; wip->g.y = 110;
+    wip->g.height = 100 ; wip->g.width = 150; wip->text = "OK:";
+    wip->g.parent =gh->sterilizer;
+    gh->steriletemps = gwinProgressbarCreate(&go.steriletemps, wip);
+    gwinSetFont(gh->steriletemps, gdispOpenFont("DejaVuSans20_aa"));
+    gwinProgressbarSetRange(gh->steriletemps, 0, RESULT_LIST_SIZE);
+
+}
+
+/** \brief Creates result tabset page.
+  *
+  * \param gh   Pointer to the handlers of displayed objects.
+  * \param wip  Pointer to widget init object, NULL save.
+  */
+static inline void createPageResult(struct lcd_pages *gh, GWidgetInit *wip){
+    if (!wip)
+        return;
+    /* Result Date */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 5; wip->g.y = 5;
+    wip->g.height = 15 ; wip->g.width = 100;
+    wip->g.parent =gh->result;
+    wip->text = "Date:";
+    gh->res_date = gwinLabelCreate(&go.res_date, wip);
+    /* Result begin time */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 5; wip->g.y = 25;
+    wip->g.height = 15 ; wip->g.width = 100;
+    wip->g.parent =gh->result;
+    wip->text = "Start:";
+    gh->res_begin = gwinLabelCreate(&go.res_begin, wip);
+
+    /* Result end time */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 120; wip->g.y = 25;
+    wip->g.height = 15 ; wip->g.width = 100;
+    wip->g.parent =gh->result;
+    wip->text = "End:";
+    gh->res_end = gwinLabelCreate(&go.res_end, wip);
+
+    /* Final result */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 120; wip->g.y = 5;
+    wip->g.height = 15 ; wip->g.width = 100;
+    wip->g.parent =gh->result;
+    wip->customDraw = gwinLabelDrawJustifiedCenter;
+    wip->text = "Result:";
+    gh->final_result = gwinLabelCreate(&go.final_result, wip);
+    gh->finalresstyle = WhiteWidgetStyle;
+    gh->finalresstyle.enabled.text = White;
+    gwinSetStyle(gh->final_result, &gh->finalresstyle);
+
+    /* Result list header */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 10; wip->g.y = 45;
+    wip->g.height = 15 ; wip->g.width = 480;
+    wip->g.parent =gh->result;
+    wip->text = "Nr.\tTime\tCH0\tCH1\tCH2\tStatus";
+    gh->reslist_header = gwinLabelCreate(&go.reslist_header, wip);
+
+    /* Result list */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 5; wip->g.y = 60; wip->g.width = 470; wip->g.height = 180;
+    wip->g.parent = gh->result;
+    gh->res_list = gwinListCreate(&go.res_list, wip, FALSE);
+    gwinListSetScroll(gh->res_list, scrollSmooth);
+
+    /* Print button */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 380; wip->g.y = 5;
+    wip->g.height = 40 ; wip->g.width = 80; wip->text = "Print";
+    wip->g.parent =gh->result;
+    gh->res_print = gwinButtonCreate(&go.res_print, wip);
+}
+
+/** \brief Creates error tabset page.
+  *
+  * \param gh    Pointer to the handlers of displayed objects.
+  * \param wip   Pointer to widget init object, NULL save.
+  */
+static inline void createPageErrors(struct lcd_pages *gh, GWidgetInit *wip){
+    if (!(wip))
+        return;
+    /* Error list */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 0; wip->g.y = 0; wip->g.width = 480; wip->g.height = 240;
+    wip->g.parent = gh->errors;
+    gh->err_list = gwinListCreate(&go.err_list, wip, FALSE);
+    gwinListSetScroll(gh->err_list, scrollSmooth);
+    gwinSetFont(gh->err_list, gdispOpenFont("DejaVuSans20_aa"));
+}
+
+/** \brief Creates time tabset page.
+  *
+  * \param gh   Pointer to the handlers of displayed objects.
+  * \param wip  Pointer to widget init object, NULL save.
+  */
+static inline void createPageTime(struct lcd_pages *gh, GWidgetInit *wip){
+    if(!wip)
+        return;
+    /* Numeric keys */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 0; wip->g.y = 60;
+    wip->g.height = 180 ; wip->g.width = 480;
+    wip->g.parent =gh->time;
+    gh->keyboard = gwinKeyboardCreate(&go.keyboard, wip);
+    gwinKeyboardSetLayout(gh->keyboard, &NumKeys);
+
+    /* Text edit labels */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 0; wip->g.y = 0;
+    wip->g.height = 20 ; wip->g.width = 480;
+    wip->g.parent =gh->time;
+    wip->text = "Year:\tMonth:        Day:          Hour:          Min:            Sec:";
+    gh->setdatelabel = gwinLabelCreate(&go.setdatelabel, wip);
+
+    /* Year text edit */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 0; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 60;
+    wip->g.parent =gh->time;
+    gh->setyear = gwinTexteditCreate(&go.setyear, wip, 4);
+    gwinSetFont(gh->setyear, gdispOpenFont("DejaVuSans20_aa"));
+    gwinSetText(gh->setyear, "", TRUE);
+
+    /* Month text edit */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 80; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 40;
+    wip->g.parent =gh->time;
+    gh->setmonth = gwinTexteditCreate(&go.setmonth, wip, 2);
+    gwinSetFont(gh->setmonth, gdispOpenFont("DejaVuSans20_aa"));
+    gwinSetText(gh->setmonth, "", TRUE);
+
+    /* Day text edit */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 140; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 40;
+    wip->g.parent =gh->time;
+    gh->setday = gwinTexteditCreate(&go.setday, wip, 2);
+    gwinSetFont(gh->setday, gdispOpenFont("DejaVuSans20_aa"));
+    gwinSetText(gh->setday, "", TRUE);
+
+    /* Hour text edit */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 200; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 40;
+    wip->g.parent =gh->time;
+    gh->sethour = gwinTexteditCreate(&go.sethour, wip, 2);
+    gwinSetFont(gh->sethour, gdispOpenFont("DejaVuSans20_aa"));
+    gwinSetText(gh->sethour, "", TRUE);
+
+    /* Min text edit */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 260; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 40;
+    wip->g.parent =gh->time;
+    gh->setmin = gwinTexteditCreate(&go.setmin, wip, 2);
+    gwinSetFont(gh->setmin, gdispOpenFont("DejaVuSans20_aa"));
+    gwinSetText(gh->setmin, "", TRUE);
+
+    /* Sec text edit */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 320; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 40;
+    wip->g.parent =gh->time;
+    gh->setsec = gwinTexteditCreate(&go.setsec, wip, 2);
+    gwinSetFont(gh->setsec, gdispOpenFont("DejaVuSans20_aa"));
+    gwinSetText(gh->setsec, "", TRUE);
+
+    /* Set button */
+    gwinWidgetClearInit(wip);
+    wip->g.show = TRUE;
+    wip->g.x = 420; wip->g.y = 20;
+    wip->g.height = 40 ; wip->g.width = 60;
+    wip->g.parent =gh->time;
+    wip->text = "Set";
+    gh->setdatebtn = gwinButtonCreate(&go.setdatebtn, wip);
+}
+
+/*===========================================================================*/
+/* Exported functions                                                        */
+/*===========================================================================*/
+
+/** \brief Creates GUI, set default setting, create tabset object,
+  *        time and SDC state labels and the tabset pages.
+  *
+  * \param gh   Pointer to the handlers of displayed objects, NULL save.
+  */
+void lcdpagesCreate(struct lcd_pages *gh){
+    GWidgetInit wi;
+
+    if (!gh)
+        return;
+
+    gwinSetDefaultFont(gdispOpenFont("UI2"));
+    gwinSetDefaultStyle(&WhiteWidgetStyle, FALSE);
+    gdispClear(White);
+    /* Time label init*/
+    gwinWidgetClearInit(&wi);
+    wi.g.show = TRUE;
+    wi.g.x = 360; wi.g.y = 0;
+    wi.g.height = GWIN_TABSET_TABHEIGHT-1 ; wi.g.width = 120;
+    gh->date = gwinLabelCreate(&go.date, &wi);
+    /* SDCard label init*/
+    gwinWidgetClearInit(&wi);
+    wi.g.show = TRUE;
+    wi.g.x = 240; wi.g.y = 0;
+    wi.g.height = GWIN_TABSET_TABHEIGHT-1 ; wi.g.width = 120;
+    gh->sdc = gwinLabelCreate(&go.sdc, &wi);
+    /* Tabset init */
+    gwinWidgetClearInit(&wi);
+    wi.g.show = TRUE;
+    wi.g.x = 0; wi.g.y = 0;
+    wi.g.height = gdispGetHeight(); wi.g.width = gdispGetWidth();
+    gh->tabset = gwinTabsetCreate(&go.tabset, &wi, 0);
+    gh->sterilizer = gwinTabsetAddTab(gh->tabset, "Sterilizer", FALSE);
+    gh->result = gwinTabsetAddTab(gh->tabset, "Result", FALSE);
+    gh->errors = gwinTabsetAddTab(gh->tabset, "Errors", FALSE);
+    gh->time = gwinTabsetAddTab(gh->tabset, "Time", FALSE);
+    createPageSterilizer(gh, &wi);
+    createPageTime(gh, &wi);
+    createPageErrors(gh, &wi);
+    createPageResult(gh, &wi);
+}
+
@@ -47,6 +47,8 @@
 
 #define SHELL_WA_SIZE   THD_WORKING_AREA_SIZE(2048)
 
+static void cmd_script(BaseSequentialStream *chp, int argc, char *argv[]);
+
 /** \brief Shell commands
   */
 static const ShellCommand commands[] = {
@@ -56,6 +58,10 @@ static const ShellCommand commands[] = {
     LOG_BUFFER_CMD,
     RESULT_FILE_BUFFER_CMD,
     SDC_CMD,
+    TRACE_FILE_CMD,
+    DUMP_FILE_CMD,
+    USB_DISK_CMD,
+    {"script", cmd_script},
     PRINT_BUFF_CMD,
     TEMPFIFO_CMD,
     FUZYYERROR_CMD,
@@ -70,6 +76,20 @@ static const ShellConfig shell_cfg1 = {
     commands
 };
 
+/** \brief Command dispatch index of the scripts.
+  */
+static ShellIndex script_index;
+
+/** \brief Script user interface, runs a command script from the SD Card.
+  */
+static void cmd_script(BaseSequentialStream *chp, int argc, char *argv[]) {
+    if (argc != 1){
+        chprintf(chp, "Usage: script filename\r\n");
+        return;
+    }
+    cardhandlerRunScript(chp, &script_index, argv[0]);
+}
+
 /*===========================================================================*/
 /* Main and generic code.                                                    */
 /*===========================================================================*/
@@ -87,7 +107,7 @@ static void ShellHandler(eventid_t id) {
     }
 }
 
-/** \brief  Initializes a serial-over-USB CDC driver.
+/** \brief  Initializes a serial-over-USB CDC driver and the USB mass storage driver.
   *         Activates the USB driver and then the USB bus pull-up on D+.
   *         Note, a delay is inserted in order to not have to disconnect the cable
   *         after a reset.
@@ -97,11 +117,14 @@ static void ShellHandler(eventid_t id) {
 static void connectConsole(void){
     sduObjectInit(&SDU1);
     sduStart(&SDU1, &serusbcfg);
+    msdObjectInit(&UMSD1);
+    msdStart(&UMSD1, &msdcfg);
     usbDisconnectBus(serusbcfg.usbp);
     chThdSleepMilliseconds(1500);
     usbStart(serusbcfg.usbp, &usbcfg);
     usbConnectBus(serusbcfg.usbp);
     shellInit();
+    shellIndexInit(&script_index, commands);
 }
 
 
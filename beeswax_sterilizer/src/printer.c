@@ -144,5 +144,6 @@ void cmd_printbuff(BaseSequentialStream *chp, int argc, char *argv[]) {
 void printerInit(void){
     sdStart(&SD6, &spcfg);
     innerBufferInit(&printerqueue, &printerpool, printerbuffer, PRINTER_BUFFER_SIZE);
+    chPoolRegister(&printerpool, "printer");
     chThdCreateStatic(waThreadprinter, sizeof(waThreadprinter), NORMALPRIO, Threadprinter, NULL);
 }
@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include <ch.h>
 #include <hal.h>
@@ -44,7 +45,6 @@
 #endif
 
 static THD_WORKING_AREA(waThreadregulator, REGULATOR_STACK_SIZE);
-static MUTEX_DECL(regmtx);
 /*===========================================================================*/
 /* Temperature FIFO.                                                         */
 /*===========================================================================*/
@@ -57,6 +57,13 @@ static MEMORYPOOL_DECL(tempbuffer, sizeof(temperature_t), NULL);
 static inner_buffer_t tempFIFO;
 /**\} */
 
+/** \brief Temperature channel towards the sterilizer thread.
+  *
+  */
+static temperature_t tempchannelobjs[TEMP_CHANNEL_SIZE];
+static msg_t tempchannelmsgs[TEMP_CHANNEL_SIZE];
+static objects_fifo_t tempchannel;
+
 /** \brief Get an empty temperature FIFO item.
   *
   * \return Pointer to FIFO item or NULL, if the FIFO is full.
@@ -104,6 +111,8 @@ static struct{
     uint8_t logfile_error;
     char logbuff[FILE_BUFFER_ITEM_SIZE];
     uint32_t lognum;
+    chprintf_format_t logformat;
+    bool logformat_ok;
 }fuzzyreg;
 
 
@@ -351,6 +360,7 @@ static void startRoutine(void){
 
 /** \brief Stop routine of regulator.
   *         - Disable pwm channels and clear duty cycle.
+  *         - Close log file.
   *         - Regulator state transaction.
   */
 static void stopRoutine(void){
@@ -361,6 +371,7 @@ static void stopRoutine(void){
             pwmDisablePeriodicNotification(fuzzyreg.heat_ch[i].pwmp);
             fuzzyreg.dutycycle[i]=0;
             }
+        closeLogFile();
         fuzzyreg.state = FUZZYREG_STOP;
         setFuzzyregState(&fuzzyreg.state);
         displayHeatPower(fuzzyreg.dutycycle);
@@ -377,6 +388,8 @@ static void disableRoutine(void){
         pwmDisablePeriodicNotification(fuzzyreg.heat_ch[i].pwmp);
         fuzzyreg.dutycycle[i]=0;
     }
+    if (fuzzyreg.state == FUZZYREG_ACTIVE)
+        closeLogFile();
     fuzzyreg.state = FUZZYREG_DISABLE;
     setFuzzyregState(&fuzzyreg.state);
     displayHeatPower(fuzzyreg.dutycycle);
@@ -393,9 +406,9 @@ static void saveLog(void){
     }
     /* Fill it */
     struct fbuff_item *buffer = (struct fbuff_item*)item->data;
-    chsnprintf((char*)buffer->fbuff, FILE_BUFFER_ITEM_SIZE, "%d %3.3f %3.3f %3.3f %1.3f %1.3f %1.3f ", fuzzyreg.lognum++,
-        fuzzyreg.curr_temp.temp[0]*SENSOR_TEMP_QUANTUM, fuzzyreg.curr_temp.temp[1]*SENSOR_TEMP_QUANTUM, fuzzyreg.curr_temp.temp[2]*SENSOR_TEMP_QUANTUM,
-        fuzzyreg.curr_temp.dtemp[0]*SENSOR_TEMP_QUANTUM, fuzzyreg.curr_temp.dtemp[1]*SENSOR_TEMP_QUANTUM,fuzzyreg.curr_temp.dtemp[2]*SENSOR_TEMP_QUANTUM);
+    chsnprintfCompiled((char*)buffer->fbuff, FILE_BUFFER_ITEM_SIZE, &fuzzyreg.logformat, fuzzyreg.lognum++,
+        SENSOR_TEMP_FRAC_BITS, fuzzyreg.curr_temp.temp[0], SENSOR_TEMP_FRAC_BITS, fuzzyreg.curr_temp.temp[1], SENSOR_TEMP_FRAC_BITS, fuzzyreg.curr_temp.temp[2],
+        SENSOR_TEMP_FRAC_BITS, fuzzyreg.curr_temp.dtemp[0], SENSOR_TEMP_FRAC_BITS, fuzzyreg.curr_temp.dtemp[1], SENSOR_TEMP_FRAC_BITS, fuzzyreg.curr_temp.dtemp[2]);
     buffer->element_num = strlen((char*)buffer->fbuff);
     /* Post it */
     postFullLogFileBuffer(item);
@@ -413,9 +426,23 @@ static void saveLog(void){
     postFullLogFileBuffer(item);
 }
 
+/** \brief Posts the current temperature into the temperature channel.
+  *         - The object is filled in place, only its pointer is passed.
+  *         - If there is no free object, the temperature is dropped,
+  *           the sterilizer thread gets the next one.
+  */
+static void postCurrentTemp(void){
+    temperature_t *data = chFifoTakeObjectTimeout(&tempchannel, TIME_IMMEDIATE);
+    if (!data)
+        return;
+    *data = fuzzyreg.curr_temp;
+    chFifoSendObject(&tempchannel, data);
+}
+
 
 /** \brief Regulator thread function.
   *     - Reads temperature form tempFIFO.
+  *     - Posts temperature to the sterilizer thread.
   *     - Calculates pwm duty cycle with fuzzy logic.
   */
 __attribute__((noreturn))
@@ -447,17 +474,11 @@ static THD_FUNCTION(Threadregulator, arg) {
         item = getFullInnerBufferItem(&tempFIFO);
         if (item){
             curr_temp = (temperature_t*)item->data;
-            chMtxLock(&regmtx);
-            for(i=0; i<CHANNEL_NUM; i++){
-                fuzzyreg.curr_temp.temp[i] = curr_temp->temp[i];
-                fuzzyreg.curr_temp.dtemp[i] = curr_temp->dtemp[i];
-            }
-            fuzzyreg.curr_temp.is_sterile = curr_temp->is_sterile;
-            fuzzyreg.curr_temp.timestamp = curr_temp->timestamp;
-            chMtxUnlock(&regmtx);
+            fuzzyreg.curr_temp = *curr_temp;
             /* Put back FIFO item */
             bzero(item, sizeof(temperature_t));
             releaseEmptyInnerBufferItem(&tempFIFO, item);
+            postCurrentTemp();
             switch(fuzzyreg.state){
                 case FUZZYREG_ACTIVE:   for(i=0; i<CHANNEL_NUM; i++){
                                             if (fuzzyreg.curr_temp.temp[i] >= CRITICAL_TEMP)
@@ -505,10 +526,14 @@ static THD_FUNCTION(Threadregulator, arg) {
 
                                         }
                                         displayHeatPower(fuzzyreg.dutycycle);
-                                        fuzzyreg.logfile_error = openLogFile(fuzzyreg.logbuff);
+                                        /* Without a valid log format nothing is logged */
+                                        if (fuzzyreg.logformat_ok)
+                                            fuzzyreg.logfile_error = openLogFile(fuzzyreg.logbuff);
+                                        else
+                                            fuzzyreg.logfile_error = UCHAR_MAX;
                                         if (!fuzzyreg.logfile_error){
                                             saveLog();
-                                            closeLogFile();
+                                            syncLogFile();
                                             }
                                         if (fuzzyreg.fuzzy_errors)
                                             sendErrMail(FUZZY_LOGIC_ERR_MSG);
@@ -547,6 +572,7 @@ void cmd_fuzzyerror(BaseSequentialStream *chp, int argc, char *argv[]) {
     (void) argv;
     uint8_t i, j;
     chprintf(chp, "Fuzzy error num: %d\r\n", fuzzyreg.fuzzy_errors);
+    chprintf(chp, "Log file error: %d\r\n", fuzzyreg.logfile_error);
     chprintf(chp, "Fuzzy error code: \r\n");
     for (i=0; i<FUZZY_INPUT_NUM; i++){
         for (j=0; j<FUZZY_RULES_NUM; j++)
@@ -571,22 +597,30 @@ void sendDisableMailToRegluator(msg_t msg){
     chMBPostAhead(&fuzzyreg_mb, msg, TIME_INFINITE);
 }
 
-/** \brief Get current temperature.
+/** \brief Receives the newest temperature from the temperature channel.
+  *         - Older temperatures are given back to the channel.
   *
-  * \param data     Pointer to temperature object, NULL save.
+  * \return Pointer to the temperature object or NULL, if there is no new temperature.
+  *         The object must be given back with releaseCurrentTemp().
   */
-void getCurrentTemp(temperature_t *data){
-    if (!data)
-        return;
-    uint8_t i;
-    chMtxLock(&regmtx);
-    for (i=0; i<CHANNEL_NUM; i++){
-        data->temp[i] = fuzzyreg.curr_temp.temp[i];
-        data->dtemp[i] = fuzzyreg.curr_temp.dtemp[i];
+temperature_t *receiveCurrentTemp(void){
+    temperature_t *data = NULL;
+    void *next;
+    while (chFifoReceiveObjectTimeout(&tempchannel, &next, TIME_IMMEDIATE) == MSG_OK){
+        if (data)
+            chFifoReturnObject(&tempchannel, data);
+        data = (temperature_t*)next;
     }
-    data->is_sterile = fuzzyreg.curr_temp.is_sterile;
-    data->timestamp = fuzzyreg.curr_temp.timestamp;
-    chMtxUnlock(&regmtx);
+    return data;
+}
+
+/** \brief Gives back a temperature object to the temperature channel.
+  *
+  * \param data     Pointer to temperature object, NULL save.
+  */
+void releaseCurrentTemp(temperature_t *data){
+    if (data)
+        chFifoReturnObject(&tempchannel, data);
 }
 
 /** \brief Initializes regulator
@@ -596,8 +630,14 @@ void getCurrentTemp(temperature_t *data){
   */
 void regulatorInit(void){
     innerBufferInit(&tempFIFO, &tempbuffer, tempitems, TEMP_FIFO_SIZE);
+    chPoolRegister(&tempbuffer, "tempfifo");
+    chFifoObjectInit(&tempchannel, sizeof(temperature_t), TEMP_CHANNEL_SIZE, tempchannelobjs, tempchannelmsgs);
+    chPoolRegister(&tempchannel.free.pool, "tempchannel");
     bzero(&fuzzyreg, sizeof(fuzzyreg));
     bzero(&fuzzy_logic, sizeof(fuzzy_logic));
+    /* The log line is parsed once, it has less conversions than CHPRINTF_MAX_SPECS.
+       If it fails, nothing is logged and the log file error is set. */
+    fuzzyreg.logformat_ok = chprintfCompile(&fuzzyreg.logformat, "%d %3.3q %3.3q %3.3q %1.3q %1.3q %1.3q ");
     heat_channel_t channels[CHANNEL_NUM] = HEAT_CHANNELS;
     uint8_t i;
     for(i=0; i<CHANNEL_NUM; i++){
@@ -57,7 +57,7 @@ static struct{
     msg_t mb_buff[STERILIZER_MAILBOX_SIZE];
     msg_t curr_massage;
     sterilizer_state_t state;
-    temperature_t curr_temp;
+    temperature_t *curr_temp;
     thread_reference_t thread;
     const stm32_dma_stream_t *dma;
     uint32_t dmamode;
@@ -106,6 +106,7 @@ static void resultListInit(void){
     bzero(&result, sizeof(result));
     STAILQ_INIT(&result.head);
     chPoolLoadArray(&resultlist, resultitems, RESULT_LIST_SIZE);
+    chPoolRegister(&resultlist, "results");
     result.freeitem = RESULT_LIST_SIZE;
 }
 
@@ -127,8 +128,8 @@ void putResultToList(temperature_t *data){
         else
             status = "Failure\n";
         uint32_t sec = data->timestamp / 1000;
-        chsnprintf(item->str, sizeof(item->str), "%02d\t%02d:%02d:%02d\t%3.1f C\t%3.1f C\t%3.1f C\t", result.itemnum, sec/3600,  (sec%3600/60), ((sec%3600)%60),
-                                                data->temp[0]*SENSOR_TEMP_QUANTUM, data->temp[1]*SENSOR_TEMP_QUANTUM, data->temp[2]*SENSOR_TEMP_QUANTUM);
+        chsnprintf(item->str, sizeof(item->str), "%02d\t%02d:%02d:%02d\t%3.1q C\t%3.1q C\t%3.1q C\t", result.itemnum, sec/3600,  (sec%3600/60), ((sec%3600)%60),
+                                                SENSOR_TEMP_FRAC_BITS, data->temp[0], SENSOR_TEMP_FRAC_BITS, data->temp[1], SENSOR_TEMP_FRAC_BITS, data->temp[2]);
         strcat(item->str, status);
         STAILQ_INSERT_TAIL(&result.head, item, entries);
         result.itemnum++;
@@ -293,6 +294,7 @@ static THD_FUNCTION(Threadsterilizer, arg) {
     char linebuff[50];
     displaySterilizerState(&sterilizer.state);
     systime_t curr_time;
+    temperature_t *temp;
     while(TRUE) {
         /* read mailbox massages */
         chMBFetch(&steril_mb, &sterilizer.curr_massage, TIME_IMMEDIATE);
@@ -315,13 +317,18 @@ static THD_FUNCTION(Threadsterilizer, arg) {
             default:                    break;
         }
         sterilizer.curr_massage = 0;
+        /* Keep the newest temperature */
+        temp = receiveCurrentTemp();
+        if (temp){
+            releaseCurrentTemp(sterilizer.curr_temp);
+            sterilizer.curr_temp = temp;
+        }
         switch(sterilizer.state){
             /* Put temp into result list, if it save time */
             case STERILIZER_ACTIVE:     curr_time = chVTGetSystemTime();
-                                        if ( curr_time >= result.savetime){
-                                            getCurrentTemp(&sterilizer.curr_temp);
-                                            if (sterilizer.curr_temp.is_sterile){
-                                                putResultToList(&sterilizer.curr_temp);
+                                        if ( curr_time >= result.savetime && sterilizer.curr_temp){
+                                            if (sterilizer.curr_temp->is_sterile){
+                                                putResultToList(sterilizer.curr_temp);
                                                 result.savetime = curr_time + S2ST(STERLIZER_SAVE_INTERVAL_S);
                                                 break;
                                                 }
@@ -332,7 +339,7 @@ static THD_FUNCTION(Threadsterilizer, arg) {
                                                     result.savetime = curr_time + S2ST(STERLIZER_SAVE_INTERVAL_S);
                                                     break;
                                                 }
-                                                putResultToList(&sterilizer.curr_temp);
+                                                putResultToList(sterilizer.curr_temp);
                                                 result.finalresult = FALSE;
                                                 stopRoutine();
                                                 break;
@@ -38,7 +38,12 @@
 
 
 static THD_WORKING_AREA(waThreadtempreader, TEMPREADER_STACK_SIZE);
-static MUTEX_DECL(trmtx);
+/** \brief Sensor error codes snapshot, published by tempreader thread.
+  * \{
+  */
+static uint8_t errsnapbuff[2][CHANNEL_NUM];
+static SNAPSHOT_DECL(errsnap, errsnapbuff, CHANNEL_NUM);
+/**\} */
 /** \brief I2C configuration.
   *
   */
@@ -118,6 +123,7 @@ static THD_FUNCTION(Threadtempreader, arg) {
         if (readmsg != MSG_OK){
             tempreader.sensorstate[ch] = SENSOR_ERROR;
             tempreader.sensor_error_code[ch] = i2cGetErrors(&I2CD1);
+            chSnapshotPublish(&errsnap, tempreader.sensor_error_code);
             sendErrMail(SENSOR0_ERR_MSG+ch);
             setSensorState(tempreader.sensorstate);
             }
@@ -141,6 +147,7 @@ static THD_FUNCTION(Threadtempreader, arg) {
                     if (readmsg != MSG_OK){
                         tempreader.sensorstate[ch] = SENSOR_ERROR;
                         tempreader.sensor_error_code[ch] = i2cGetErrors(&I2CD1);
+                        chSnapshotPublish(&errsnap, tempreader.sensor_error_code);
                         sendErrMail(SENSOR0_ERR_MSG+ch);
                         setSensorState(tempreader.sensorstate);
                         continue;
@@ -212,10 +219,7 @@ void cmd_tempreader(BaseSequentialStream *chp, int argc, char *argv[]) {
     (void) chp;
     uint8_t i;
     uint8_t err[CHANNEL_NUM];
-    chMtxLock(&trmtx);
-    for(i=0; i<CHANNEL_NUM; i++)
-        err[i] = tempreader.sensor_error_code[i];
-    chMtxUnlock(&trmtx);
+    chSnapshotRead(&errsnap, err);
     for(i=0; i<CHANNEL_NUM; i++)
         chprintf(chp, "S%d error: %d\n\r", i, err[i]);
 
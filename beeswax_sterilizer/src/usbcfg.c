@@ -19,25 +19,35 @@
 /* Virtual serial port over USB.*/
 SerialUSBDriver SDU1;
 
+/* SD card as USB mass storage.*/
+USBMassStorageDriver UMSD1;
+
 /*
  * Endpoints to be used for USBD1.
  */
 #define USBD1_DATA_REQUEST_EP           1
 #define USBD1_DATA_AVAILABLE_EP         1
 #define USBD1_INTERRUPT_REQUEST_EP      2
+#define USBD1_MSD_EP                    3
+
+/*
+ * Interface of the mass storage function.
+ */
+#define USBD1_MSD_INTERFACE             2
 
 /*
  * USB Device Descriptor.
  */
 static const uint8_t vcom_device_descriptor_data[18] = {
   USB_DESC_DEVICE       (0x0200,        /* bcdUSB (2.0).                    */
-                         0x02,          /* bDeviceClass (CDC).              */
-                         0x00,          /* bDeviceSubClass.                 */
-                         0x00,          /* bDeviceProtocol.                 */
+                         0xEF,          /* bDeviceClass (Miscellaneous).    */
+                         0x02,          /* bDeviceSubClass (Common Class).  */
+                         0x01,          /* bDeviceProtocol (Interface
+                                           Association Descriptor).         */
                          0x40,          /* bMaxPacketSize.                  */
                          0x0483,        /* idVendor (ST).                   */
                          0x5740,        /* idProduct.                       */
-                         0x0200,        /* bcdDevice.                       */
+                         0x0201,        /* bcdDevice.                       */
                          1,             /* iManufacturer.                   */
                          2,             /* iProduct.                        */
                          3,             /* iSerialNumber.                   */
@@ -52,15 +62,22 @@ static const USBDescriptor vcom_device_descriptor = {
   vcom_device_descriptor_data
 };
 
-/* Configuration Descriptor tree for a CDC.*/
-static const uint8_t vcom_configuration_descriptor_data[67] = {
+/* Configuration Descriptor tree for a CDC and a mass storage.*/
+static const uint8_t vcom_configuration_descriptor_data[98] = {
   /* Configuration Descriptor.*/
-  USB_DESC_CONFIGURATION(67,            /* wTotalLength.                    */
-                         0x02,          /* bNumInterfaces.                  */
+  USB_DESC_CONFIGURATION(98,            /* wTotalLength.                    */
+                         0x03,          /* bNumInterfaces.                  */
                          0x01,          /* bConfigurationValue.             */
                          0,             /* iConfiguration.                  */
                          0xC0,          /* bmAttributes (self powered).     */
                          50),           /* bMaxPower (100mA).               */
+  /* Interface Association Descriptor of the CDC.*/
+  USB_DESC_INTERFACE_ASSOCIATION(0x00,  /* bFirstInterface.                 */
+                         0x02,          /* bInterfaceCount.                 */
+                         0x02,          /* bFunctionClass (CDC).            */
+                         0x02,          /* bFunctionSubClass (ACM).         */
+                         0x01,          /* bFunctionProtocol (AT commands). */
+                         0),            /* iInterface.                      */
   /* Interface Descriptor.*/
   USB_DESC_INTERFACE    (0x00,          /* bInterfaceNumber.                */
                          0x00,          /* bAlternateSetting.               */
@@ -124,6 +141,26 @@ static const uint8_t vcom_configuration_descriptor_data[67] = {
                          0x00),         /* bInterval.                       */
   /* Endpoint 1 Descriptor.*/
   USB_DESC_ENDPOINT     (USBD1_DATA_REQUEST_EP|0x80,    /* bEndpointAddress.*/
+                         0x02,          /* bmAttributes (Bulk).             */
+                         0x0040,        /* wMaxPacketSize.                  */
+                         0x00),         /* bInterval.                       */
+  /* Interface Descriptor.*/
+  USB_DESC_INTERFACE    (USBD1_MSD_INTERFACE,           /* bInterfaceNumber.*/
+                         0x00,          /* bAlternateSetting.               */
+                         0x02,          /* bNumEndpoints.                   */
+                         0x08,          /* bInterfaceClass (Mass Storage).  */
+                         0x06,          /* bInterfaceSubClass (SCSI
+                                           transparent command set).        */
+                         0x50,          /* bInterfaceProtocol (Bulk-Only
+                                           Transport).                      */
+                         0x00),         /* iInterface.                      */
+  /* Endpoint 3 IN Descriptor.*/
+  USB_DESC_ENDPOINT     (USBD1_MSD_EP|0x80,             /* bEndpointAddress.*/
+                         0x02,          /* bmAttributes (Bulk).             */
+                         0x0040,        /* wMaxPacketSize.                  */
+                         0x00),         /* bInterval.                       */
+  /* Endpoint 3 OUT Descriptor.*/
+  USB_DESC_ENDPOINT     (USBD1_MSD_EP,                  /* bEndpointAddress.*/
                          0x02,          /* bmAttributes (Bulk).             */
                          0x0040,        /* wMaxPacketSize.                  */
                          0x00)          /* bInterval.                       */
@@ -260,6 +297,32 @@ static const USBEndpointConfig ep2config = {
   NULL
 };
 
+/**
+ * @brief   IN EP3 state.
+ */
+static USBInEndpointState ep3instate;
+
+/**
+ * @brief   OUT EP3 state.
+ */
+static USBOutEndpointState ep3outstate;
+
+/**
+ * @brief   EP3 initialization structure (both IN and OUT).
+ */
+static const USBEndpointConfig ep3config = {
+  USB_EP_MODE_TYPE_BULK,
+  NULL,
+  msdDataTransmitted,
+  msdDataReceived,
+  0x0040,
+  0x0040,
+  &ep3instate,
+  &ep3outstate,
+  4,
+  NULL
+};
+
 /*
  * Handles the USB driver global events.
  */
@@ -277,10 +340,14 @@ static void usb_event(USBDriver *usbp, usbevent_t event) {
        must be used.*/
     usbInitEndpointI(usbp, USBD1_DATA_REQUEST_EP, &ep1config);
     usbInitEndpointI(usbp, USBD1_INTERRUPT_REQUEST_EP, &ep2config);
+    usbInitEndpointI(usbp, USBD1_MSD_EP, &ep3config);
 
     /* Resetting the state of the CDC subsystem.*/
     sduConfigureHookI(&SDU1);
 
+    /* Starting the mass storage protocol.*/
+    msdConfigureHookI(&UMSD1);
+
     chSysUnlockFromISR();
     return;
   case USB_EVENT_RESET:
@@ -292,6 +359,7 @@ static void usb_event(USBDriver *usbp, usbevent_t event) {
 
     /* Disconnection event on suspend.*/
     sduSuspendHookI(&SDU1);
+    msdSuspendHookI(&UMSD1);
 
     chSysUnlockFromISR();
     return;
@@ -300,6 +368,7 @@ static void usb_event(USBDriver *usbp, usbevent_t event) {
 
     /* Disconnection event on suspend.*/
     sduWakeupHookI(&SDU1);
+    msdConfigureHookI(&UMSD1);
 
     chSysUnlockFromISR();
     return;
@@ -321,13 +390,23 @@ static void sof_handler(USBDriver *usbp) {
   osalSysUnlockFromISR();
 }
 
+/*
+ * Handles the class requests of both functions.
+ */
+static bool requests_hook(USBDriver *usbp) {
+
+  if (msdRequestsHook(&UMSD1, usbp))
+    return true;
+  return sduRequestsHook(usbp);
+}
+
 /*
  * USB driver configuration.
  */
 const USBConfig usbcfg = {
   usb_event,
   get_descriptor,
-  sduRequestsHook,
+  requests_hook,
   sof_handler
 };
 
@@ -340,3 +419,15 @@ const SerialUSBConfig serusbcfg = {
   USBD1_DATA_AVAILABLE_EP,
   USBD1_INTERRUPT_REQUEST_EP
 };
+
+/*
+ * USB mass storage driver configuration.
+ */
+const USBMassStorageConfig msdcfg = {
+  &USBD1,
+  USBD1_MSD_EP,
+  USBD1_MSD_EP,
+  USBD1_MSD_INTERFACE,
+  "Beeswax",
+  "Sterilizer SD"
+};
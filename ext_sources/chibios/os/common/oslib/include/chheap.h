@@ -46,10 +46,38 @@
 #error "unsupported pointer size"
 #endif
 
+/**
+ * @brief   Number of TLSF second level lists per first level class, as
+ *          a power of two.
+ */
+#define CH_HEAP_TLSF_SL_LOG2    3U
+
 /*===========================================================================*/
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Two-Level Segregated Fit heap allocator.
+ * @details If enabled the heap uses a TLSF allocator with constant time
+ *          allocation and deallocation instead of the first-fit free
+ *          list, the API is the same.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_HEAP_TLSF) || defined(__DOXYGEN__)
+#define CH_CFG_HEAP_TLSF                    FALSE
+#endif
+
+/**
+ * @brief   Number of TLSF first level size classes.
+ * @details Each class covers a power of two range of block sizes, the
+ *          largest block is limited to (@p CH_HEAP_ALIGNMENT <<
+ *          (@p CH_HEAP_TLSF_SL_LOG2 + @p CH_CFG_HEAP_TLSF_FL_COUNT - 1))
+ *          bytes, 2MB with the default values on 32 bits architectures.
+ */
+#if !defined(CH_CFG_HEAP_TLSF_FL_COUNT) || defined(__DOXYGEN__)
+#define CH_CFG_HEAP_TLSF_FL_COUNT           16
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -62,6 +90,13 @@
 #error "CH_CFG_USE_HEAP requires CH_CFG_USE_MUTEXES and/or CH_CFG_USE_SEMAPHORES"
 #endif
 
+#if (CH_CFG_HEAP_TLSF == TRUE) &&                                           \
+    ((CH_CFG_HEAP_TLSF_FL_COUNT < 2) ||                                     \
+     ((SIZEOF_PTR == 4) && (CH_CFG_HEAP_TLSF_FL_COUNT > 24)) ||             \
+     ((SIZEOF_PTR == 2) && (CH_CFG_HEAP_TLSF_FL_COUNT > 10)))
+#error "invalid CH_CFG_HEAP_TLSF_FL_COUNT value"
+#endif
+
 /*===========================================================================*/
 /* Module data structures and types.                                         */
 /*===========================================================================*/
@@ -76,6 +111,7 @@ typedef struct memory_heap memory_heap_t;
  */
 typedef union heap_header heap_header_t;
 
+#if (CH_CFG_HEAP_TLSF == FALSE) || defined(__DOXYGEN__)
 /**
  * @brief   Memory heap block header.
  */
@@ -90,6 +126,64 @@ union heap_header {
     size_t              size;       /**< @brief Size of the area in bytes.  */
   } used;
 };
+#else
+/**
+ * @brief   TLSF memory heap block header.
+ * @details Blocks are also linked by physical address so that a freed
+ *          block can be merged with its free neighbours in constant time,
+ *          a zero sized used block terminates each memory region.
+ */
+union heap_header {
+  stkalign_t align;
+  struct {
+    heap_header_t       *prevphys;  /**< @brief Previous physical block or
+                                                @p NULL.                    */
+    size_t              bsize;      /**< @brief Block size in bytes, bit
+                                                zero is set if the block is
+                                                free.                       */
+    union {
+      struct {
+        heap_header_t   *next;      /**< @brief Next block in free list.    */
+        heap_header_t   *prev;      /**< @brief Previous block in free
+                                                list.                       */
+      } free;
+      struct {
+        memory_heap_t   *heap;      /**< @brief Block owner heap.           */
+        size_t          size;       /**< @brief Size of the area in bytes.  */
+      } used;
+    } u;
+  } b;
+};
+#endif
+
+/**
+ * @brief   Heap statistics.
+ */
+typedef struct {
+  /**
+   * @brief   Free space in bytes.
+   */
+  size_t                free;
+  /**
+   * @brief   Size of the largest free block.
+   */
+  size_t                largest;
+  /**
+   * @brief   Number of free blocks.
+   */
+  size_t                nfree;
+  /**
+   * @brief   Number of allocated blocks.
+   */
+  size_t                nused;
+  /**
+   * @brief   Free space not in the largest free block, in per mille of the
+   *          free space.
+   * @note    Zero means that the whole free space can be allocated with a
+   *          single request.
+   */
+  unsigned              fragmentation;
+} heap_stats_t;
 
 /**
  * @brief   Structure describing a memory heap.
@@ -97,7 +191,23 @@ union heap_header {
 struct memory_heap {
   memgetfunc_t          provider;   /**< @brief Memory blocks provider for
                                                 this heap.                  */
+#if (CH_CFG_HEAP_TLSF == FALSE) || defined(__DOXYGEN__)
   heap_header_t         header;     /**< @brief Free blocks list header.    */
+#else
+  uint32_t              flmap;      /**< @brief Non empty first level
+                                                classes.                    */
+  uint8_t               slmap[CH_CFG_HEAP_TLSF_FL_COUNT];
+                                    /**< @brief Non empty second level
+                                                lists of each class.        */
+  heap_header_t         *lists[CH_CFG_HEAP_TLSF_FL_COUNT]
+                              [1U << CH_HEAP_TLSF_SL_LOG2];
+                                    /**< @brief Free blocks lists.          */
+  size_t                free;       /**< @brief Free space in bytes.        */
+  size_t                nfree;      /**< @brief Number of free blocks.      */
+  heap_header_t         *tail;      /**< @brief Terminator of the last
+                                                added region.               */
+#endif
+  size_t                nused;      /**< @brief Number of allocated blocks. */
 #if CH_CFG_USE_MUTEXES == TRUE
   mutex_t               mtx;        /**< @brief Heap access mutex.          */
 #else
@@ -128,6 +238,7 @@ extern "C" {
   void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align);
   void chHeapFree(void *p);
   size_t chHeapStatus(memory_heap_t *heapp, size_t *totalp, size_t *largestp);
+  void chHeapGetStats(memory_heap_t *heapp, heap_stats_t *hsp);
 #ifdef __cplusplus
 }
 #endif
@@ -137,8 +248,7 @@ extern "C" {
 /*===========================================================================*/
 
 /**
- * @brief   Allocates a block of memory from the heap by using the first-fit
- *          algorithm.
+ * @brief   Allocates a block of memory from the heap.
  * @details The allocated block is guaranteed to be properly aligned for a
  *          pointer data type.
  *
@@ -168,7 +278,11 @@ static inline void *chHeapAlloc(memory_heap_t *heapp, size_t size) {
  */
 static inline size_t chHeapGetSize(const void *p) {
 
-  return ((heap_header_t *)p)->used.size;
+#if CH_CFG_HEAP_TLSF == FALSE
+  return ((const heap_header_t *)p - 1U)->used.size;
+#else
+  return ((const heap_header_t *)p - 1U)->b.u.used.size;
+#endif
 }
 
 #endif /* CH_CFG_USE_HEAP == TRUE */
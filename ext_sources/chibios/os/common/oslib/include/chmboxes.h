@@ -119,6 +119,16 @@ extern "C" {
   msg_t chMBFetch(mailbox_t *mbp, msg_t *msgp, systime_t timeout);
   msg_t chMBFetchS(mailbox_t *mbp, msg_t *msgp, systime_t timeout);
   msg_t chMBFetchI(mailbox_t *mbp, msg_t *msgp);
+  cnt_t chMBPostBatch(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                      systime_t timeout);
+  cnt_t chMBPostBatchS(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                       systime_t timeout);
+  cnt_t chMBPostBatchI(mailbox_t *mbp, const msg_t *msgs, cnt_t n);
+  cnt_t chMBFetchBatch(mailbox_t *mbp, msg_t *msgs, cnt_t n,
+                       systime_t timeout);
+  cnt_t chMBFetchBatchS(mailbox_t *mbp, msg_t *msgs, cnt_t n,
+                        systime_t timeout);
+  cnt_t chMBFetchBatchI(mailbox_t *mbp, msg_t *msgs, cnt_t n);
 #ifdef __cplusplus
 }
 #endif
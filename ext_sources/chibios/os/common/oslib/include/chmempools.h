@@ -38,6 +38,30 @@
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Memory pools statistics.
+ * @details If enabled each pool keeps usage counters and pools can be
+ *          registered by name in order to be listed at runtime.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_MEMPOOLS_STATS) || defined(__DOXYGEN__)
+#define CH_CFG_MEMPOOLS_STATS               FALSE
+#endif
+
+/**
+ * @brief   Lock-free memory pools fast path.
+ * @details If enabled @p chPoolAlloc() and @p chPoolFree() access the
+ *          free objects list using exclusive load/store instructions
+ *          instead of entering the kernel critical zone, the critical
+ *          zone is only entered when the list is empty.
+ * @note    The sequence relies on the exclusive monitor being cleared on
+ *          exception entry and return, this is true for ARMv7-M cores.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_MEMPOOLS_LOCKFREE) || defined(__DOXYGEN__)
+#define CH_CFG_MEMPOOLS_LOCKFREE            FALSE
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -46,6 +70,11 @@
 #error "CH_CFG_USE_MEMPOOLS requires CH_CFG_USE_MEMCORE"
 #endif
 
+#if (CH_CFG_MEMPOOLS_LOCKFREE == TRUE) &&                                   \
+    !defined(PORT_ARCHITECTURE_ARM_v7M) && !defined(PORT_ARCHITECTURE_ARM_v7ME)
+#error "CH_CFG_MEMPOOLS_LOCKFREE requires an ARMv7-M port"
+#endif
+
 /*===========================================================================*/
 /* Module data structures and types.                                         */
 /*===========================================================================*/
@@ -58,16 +87,45 @@ struct pool_header {
                                                     header in the list.     */
 };
 
+#if (CH_CFG_MEMPOOLS_STATS == TRUE) || defined(__DOXYGEN__)
 /**
- * @brief   Memory pool descriptor.
+ * @brief   Memory pool statistics.
+ * @note    The objects in use are @p size minus @p free.
  */
 typedef struct {
+  uint32_t              size;           /**< @brief Objects owned by the
+                                                    pool.                   */
+  uint32_t              free;           /**< @brief Objects in the free
+                                                    list.                   */
+  uint32_t              peak;           /**< @brief Maximum objects in
+                                                    use.                    */
+  uint32_t              failures;       /**< @brief Failed allocations.     */
+  uint32_t              allocs;         /**< @brief Successful
+                                                    allocations.            */
+} pool_stats_t;
+#endif
+
+/**
+ * @brief   Type of a memory pool.
+ */
+typedef struct memory_pool memory_pool_t;
+
+/**
+ * @brief   Memory pool descriptor.
+ */
+struct memory_pool {
   struct pool_header    *next;          /**< @brief Pointer to the header.  */
   size_t                object_size;    /**< @brief Memory pool objects
                                                     size.                   */
   memgetfunc_t          provider;       /**< @brief Memory blocks provider
                                                     for this pool.          */
-} memory_pool_t;
+#if (CH_CFG_MEMPOOLS_STATS == TRUE) || defined(__DOXYGEN__)
+  pool_stats_t          stats;          /**< @brief Usage statistics.       */
+  const char            *name;          /**< @brief Registered name or
+                                                    @p NULL.                */
+  memory_pool_t         *reg_next;      /**< @brief Next registered pool.   */
+#endif
+};
 
 #if (CH_CFG_USE_SEMAPHORES == TRUE) || defined(__DOXYGEN__)
 /**
@@ -93,8 +151,13 @@ typedef struct {
  * @param[in] size      size of the memory pool contained objects
  * @param[in] provider  memory provider function for the memory pool
  */
+#if (CH_CFG_MEMPOOLS_STATS == FALSE) || defined(__DOXYGEN__)
 #define _MEMORYPOOL_DATA(name, size, provider)                              \
   {NULL, size, provider}
+#else
+#define _MEMORYPOOL_DATA(name, size, provider)                              \
+  {NULL, size, provider, {0U, 0U, 0U, 0U, 0U}, NULL, NULL}
+#endif
 
 /**
  * @brief   Static memory pool initializer.
@@ -148,9 +211,16 @@ extern "C" {
   void *chPoolAlloc(memory_pool_t *mp);
   void chPoolFreeI(memory_pool_t *mp, void *objp);
   void chPoolFree(memory_pool_t *mp, void *objp);
+  void chPoolRegister(memory_pool_t *mp, const char *name);
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  memory_pool_t *chPoolRegFirst(void);
+  memory_pool_t *chPoolRegNext(memory_pool_t *mp);
+  void chPoolGetStats(memory_pool_t *mp, pool_stats_t *psp);
+#endif
 #if CH_CFG_USE_SEMAPHORES == TRUE
   void chGuardedPoolObjectInit(guarded_memory_pool_t *gmp, size_t size);
   void chGuardedPoolLoadArray(guarded_memory_pool_t *gmp, void *p, size_t n);
+  void *chGuardedPoolAllocI(guarded_memory_pool_t *gmp);
   void *chGuardedPoolAllocTimeoutS(guarded_memory_pool_t *gmp,
                                    systime_t timeout);
   void *chGuardedPoolAllocTimeout(guarded_memory_pool_t *gmp,
@@ -173,17 +243,24 @@ extern "C" {
  *          memory pool.
  * @pre     The added object must be memory aligned to the size of
  *          @p stkalign_t type.
- * @note    This function is just an alias for @p chPoolFree() and has been
+ * @note    This function is just an alias for @p chPoolFreeI() and has been
  *          added for clarity.
+ * @note    With @p CH_CFG_MEMPOOLS_STATS enabled the object is also
+ *          counted in the pool size.
  *
  * @param[in] mp        pointer to a @p memory_pool_t structure
  * @param[in] objp      the pointer to the object to be added
  *
- * @api
+ * @iclass
  */
-static inline void chPoolAdd(memory_pool_t *mp, void *objp) {
+static inline void chPoolAddI(memory_pool_t *mp, void *objp) {
 
-  chPoolFree(mp, objp);
+  chDbgCheckClassI();
+
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  mp->stats.size++;
+#endif
+  chPoolFreeI(mp, objp);
 }
 
 /**
@@ -193,19 +270,25 @@ static inline void chPoolAdd(memory_pool_t *mp, void *objp) {
  *          memory pool.
  * @pre     The added object must be memory aligned to the size of
  *          @p stkalign_t type.
- * @note    This function is just an alias for @p chPoolFreeI() and has been
+ * @note    This function is just an alias for @p chPoolFree() and has been
  *          added for clarity.
+ * @note    With @p CH_CFG_MEMPOOLS_STATS enabled the object is also
+ *          counted in the pool size.
  *
  * @param[in] mp        pointer to a @p memory_pool_t structure
  * @param[in] objp      the pointer to the object to be added
  *
- * @iclass
+ * @api
  */
-static inline void chPoolAddI(memory_pool_t *mp, void *objp) {
-
-  chDbgCheckClassI();
+static inline void chPoolAdd(memory_pool_t *mp, void *objp) {
 
-  chPoolFreeI(mp, objp);
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  chSysLock();
+  chPoolAddI(mp, objp);
+  chSysUnlock();
+#else
+  chPoolFree(mp, objp);
+#endif
 }
 
 #if (CH_CFG_USE_SEMAPHORES == TRUE) || defined(__DOXYGEN__)
@@ -215,17 +298,24 @@ static inline void chPoolAddI(memory_pool_t *mp, void *objp) {
  * @pre     The added object must be of the right size for the specified
  *          guarded memory pool.
  * @pre     The added object must be properly aligned.
- * @note    This function is just an alias for @p chGuardedPoolFree() and
+ * @note    This function is just an alias for @p chGuardedPoolFreeI() and
  *          has been added for clarity.
+ * @note    With @p CH_CFG_MEMPOOLS_STATS enabled the object is also
+ *          counted in the pool size.
  *
  * @param[in] gmp       pointer to a @p guarded_memory_pool_t structure
  * @param[in] objp      the pointer to the object to be added
  *
- * @api
+ * @iclass
  */
-static inline void chGuardedPoolAdd(guarded_memory_pool_t *gmp, void *objp) {
+static inline void chGuardedPoolAddI(guarded_memory_pool_t *gmp, void *objp) {
 
-  chGuardedPoolFree(gmp, objp);
+  chDbgCheckClassI();
+
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  gmp->pool.stats.size++;
+#endif
+  chGuardedPoolFreeI(gmp, objp);
 }
 
 /**
@@ -234,19 +324,26 @@ static inline void chGuardedPoolAdd(guarded_memory_pool_t *gmp, void *objp) {
  * @pre     The added object must be of the right size for the specified
  *          guarded memory pool.
  * @pre     The added object must be properly aligned.
- * @note    This function is just an alias for @p chGuardedPoolFreeI() and
+ * @note    This function is just an alias for @p chGuardedPoolFree() and
  *          has been added for clarity.
+ * @note    With @p CH_CFG_MEMPOOLS_STATS enabled the object is also
+ *          counted in the pool size.
  *
  * @param[in] gmp       pointer to a @p guarded_memory_pool_t structure
  * @param[in] objp      the pointer to the object to be added
  *
- * @iclass
+ * @api
  */
-static inline void chGuardedPoolAddI(guarded_memory_pool_t *gmp, void *objp) {
-
-  chDbgCheckClassI();
+static inline void chGuardedPoolAdd(guarded_memory_pool_t *gmp, void *objp) {
 
-  chGuardedPoolFreeI(gmp, objp);
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  chSysLock();
+  chGuardedPoolAddI(gmp, objp);
+  chSchRescheduleS();
+  chSysUnlock();
+#else
+  chGuardedPoolFree(gmp, objp);
+#endif
 }
 #endif /* CH_CFG_USE_SEMAPHORES == TRUE */
 
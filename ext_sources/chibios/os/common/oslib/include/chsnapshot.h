@@ -0,0 +1,138 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio.
+
+    This file is part of ChibiOS.
+
+    ChibiOS is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    chsnapshot.h
+ * @brief   Snapshots macros and structures.
+ *
+ * @addtogroup snapshots
+ * @{
+ */
+
+#ifndef CHSNAPSHOT_H
+#define CHSNAPSHOT_H
+
+/*===========================================================================*/
+/* Module constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Snapshots APIs.
+ * @details If enabled then the snapshots APIs are included in the kernel.
+ */
+#if !defined(CH_CFG_USE_SNAPSHOTS) || defined(__DOXYGEN__)
+#define CH_CFG_USE_SNAPSHOTS                FALSE
+#endif
+
+#if (CH_CFG_USE_SNAPSHOTS == TRUE) || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Structure representing a snapshot object.
+ */
+typedef struct {
+  volatile ucnt_t       seq;            /**< @brief Sequence counter, odd
+                                                    while the first copy
+                                                    is being updated.       */
+  uint8_t               *buffer;        /**< @brief Pointer to the two
+                                                    copies of the object.   */
+  size_t                size;           /**< @brief Size of the object.     */
+} snapshot_t;
+
+/*===========================================================================*/
+/* Module macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Data part of a static snapshot initializer.
+ * @details This macro should be used when statically initializing a
+ *          snapshot that is part of a bigger structure.
+ *
+ * @param[in] buffer    pointer to the snapshot buffer area, it must be
+ *                      able to hold two copies of the object
+ * @param[in] size      size of the object
+ */
+#define _SNAPSHOT_DATA(buffer, size) {                                      \
+  (ucnt_t)0,                                                                \
+  (uint8_t *)(buffer),                                                      \
+  (size_t)(size)                                                            \
+}
+
+/**
+ * @brief   Static snapshot initializer.
+ * @details Statically initialized snapshots require no explicit
+ *          initialization using @p chSnapshotObjectInit().
+ *
+ * @param[in] name      the name of the snapshot variable
+ * @param[in] buffer    pointer to the snapshot buffer area, it must be
+ *                      able to hold two copies of the object
+ * @param[in] size      size of the object
+ */
+#define SNAPSHOT_DECL(name, buffer, size)                                   \
+  snapshot_t name = _SNAPSHOT_DATA(buffer, size)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void chSnapshotObjectInit(snapshot_t *snp, void *buf, size_t size);
+  void chSnapshotPublish(snapshot_t *snp, const void *objp);
+  ucnt_t chSnapshotRead(snapshot_t *snp, void *objp);
+#ifdef __cplusplus
+}
+#endif
+
+/*===========================================================================*/
+/* Module inline functions.                                                  */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the number of completed publications.
+ * @note    The value can change after reading if a publication is in
+ *          progress.
+ *
+ * @param[in] snp       the pointer to an initialized @p snapshot_t object
+ * @return              The version of the published object.
+ *
+ * @xclass
+ */
+static inline ucnt_t chSnapshotGetVersionX(snapshot_t *snp) {
+
+  return snp->seq >> 1;
+}
+
+#endif /* CH_CFG_USE_SNAPSHOTS == TRUE */
+
+#endif /* CHSNAPSHOT_H */
+
+/** @} */
@@ -29,6 +29,11 @@
  *          library functions. The main difference is that the OS heap APIs
  *          are guaranteed to be thread safe and there is the ability to
  *          return memory blocks aligned to arbitrary powers of two.<br>
+ *          If @p CH_CFG_HEAP_TLSF is enabled then a Two-Level Segregated
+ *          Fit allocator is used instead, free blocks are kept in lists
+ *          segregated by size class and located using two levels of
+ *          bitmaps, both allocation and deallocation are constant time
+ *          operations.<br>
  * @pre     In order to use the heap APIs the @p CH_CFG_USE_HEAP option must
  *          be enabled in @p chconf.h.
  * @note    Compatible with RT and NIL.
@@ -56,6 +61,7 @@
 
 #define H_BLOCK(hp)     ((hp) + 1U)
 
+#if (CH_CFG_HEAP_TLSF == FALSE) || defined(__DOXYGEN__)
 #define H_LIMIT(hp)     (H_BLOCK(hp) + H_PAGES(hp))
 
 #define H_NEXT(hp)      ((hp)->free.next)
@@ -74,6 +80,55 @@
   ((size_t)((p1) - (p2)))                                                   \
   /*lint -restore*/
 
+#else /* CH_CFG_HEAP_TLSF == TRUE */
+#define H_HDR           sizeof (heap_header_t)
+
+#define H_PREV(hp)      ((hp)->b.prevphys)
+
+#define H_BSIZE(hp)     ((hp)->b.bsize & ~(size_t)1U)
+
+#define H_ISFREE(hp)    (((hp)->b.bsize & (size_t)1U) != 0U)
+
+#define H_NEXTPHYS(hp)  ((heap_header_t *)(void *)                          \
+                         ((uint8_t *)H_BLOCK(hp) + H_BSIZE(hp)))
+
+#define H_NEXT(hp)      ((hp)->b.u.free.next)
+
+#define H_PREVFREE(hp)  ((hp)->b.u.free.prev)
+
+#define H_HEAP(hp)      ((hp)->b.u.used.heap)
+
+#define H_SIZE(hp)      ((hp)->b.u.used.size)
+
+#if (CH_HEAP_ALIGNMENT == 8U) || defined(__DOXYGEN__)
+#define T_ALIGN_LOG2    3U
+#else
+#define T_ALIGN_LOG2    2U
+#endif
+
+/*
+ * Number of second level lists in each first level class.
+ */
+#define T_SL_COUNT      (1U << CH_HEAP_TLSF_SL_LOG2)
+
+/*
+ * Blocks smaller than this are in the first class, one list for each
+ * size.
+ */
+#define T_SMALL         ((size_t)CH_HEAP_ALIGNMENT << CH_HEAP_TLSF_SL_LOG2)
+
+/*
+ * Largest block size.
+ */
+#define T_MAX_BLOCK     ((T_SMALL << (CH_CFG_HEAP_TLSF_FL_COUNT - 1)) -     \
+                         CH_HEAP_ALIGNMENT)
+
+/*
+ * Smallest split remainder, a header and the minimum block.
+ */
+#define T_MIN_SPLIT     (H_HDR + CH_HEAP_ALIGNMENT)
+#endif /* CH_CFG_HEAP_TLSF == TRUE */
+
 /*===========================================================================*/
 /* Module exported variables.                                                */
 /*===========================================================================*/
@@ -95,6 +150,355 @@ static memory_heap_t default_heap;
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+#if (CH_CFG_HEAP_TLSF == FALSE) || defined(__DOXYGEN__)
+/**
+ * @brief   Scans the free blocks list.
+ * @note    The heap must be locked.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[out] totalp   total free space in bytes
+ * @param[out] largestp largest free block size in bytes
+ * @return              The number of free blocks.
+ *
+ * @notapi
+ */
+static size_t heap_scan(memory_heap_t *heapp,
+                        size_t *totalp, size_t *largestp) {
+  heap_header_t *qp;
+  size_t n, tpages, lpages;
+
+  tpages = 0U;
+  lpages = 0U;
+  n = 0U;
+  qp = &heapp->header;
+  while (H_NEXT(qp) != NULL) {
+    size_t pages = H_PAGES(H_NEXT(qp));
+
+    /* Updating counters.*/
+    n++;
+    tpages += pages;
+    if (pages > lpages) {
+      lpages = pages;
+    }
+
+    qp = H_NEXT(qp);
+  }
+
+  *totalp   = tpages * CH_HEAP_ALIGNMENT;
+  *largestp = lpages * CH_HEAP_ALIGNMENT;
+
+  return n;
+}
+
+#else /* CH_CFG_HEAP_TLSF == TRUE */
+/**
+ * @brief   Index of the most significant bit set.
+ *
+ * @param[in] x         the word, must not be zero
+ * @return              The bit index.
+ *
+ * @notapi
+ */
+static inline unsigned heap_fls(uint32_t x) {
+
+#if defined(__GNUC__)
+  return 31U - (unsigned)__builtin_clz(x);
+#else
+  unsigned n = 31U;
+
+  while ((x & 0x80000000U) == 0U) {
+    x <<= 1;
+    n--;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief   Index of the least significant bit set.
+ *
+ * @param[in] x         the word, must not be zero
+ * @return              The bit index.
+ *
+ * @notapi
+ */
+static inline unsigned heap_ffs(uint32_t x) {
+
+  return heap_fls(x & (~x + 1U));
+}
+
+/**
+ * @brief   Size class of a block size.
+ *
+ * @param[in] size      the block size, not greater than @p T_MAX_BLOCK
+ * @param[out] flp      first level index
+ * @param[out] slp      second level index
+ *
+ * @notapi
+ */
+static void tlsf_mapping(size_t size, unsigned *flp, unsigned *slp) {
+
+  if (size < T_SMALL) {
+    *flp = 0U;
+    *slp = (unsigned)(size / CH_HEAP_ALIGNMENT);
+  }
+  else {
+    unsigned f = heap_fls((uint32_t)size);
+
+    *flp = (f - (T_ALIGN_LOG2 + CH_HEAP_TLSF_SL_LOG2)) + 1U;
+    *slp = (unsigned)(size >> (f - CH_HEAP_TLSF_SL_LOG2)) & (T_SL_COUNT - 1U);
+  }
+}
+
+/**
+ * @brief   Inserts a block in the free lists.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[in] hp        the block
+ *
+ * @notapi
+ */
+static void tlsf_insert(memory_heap_t *heapp, heap_header_t *hp) {
+  unsigned fl, sl;
+
+  tlsf_mapping(H_BSIZE(hp), &fl, &sl);
+  hp->b.bsize |= (size_t)1U;
+  H_PREVFREE(hp) = NULL;
+  H_NEXT(hp) = heapp->lists[fl][sl];
+  if (H_NEXT(hp) != NULL) {
+    H_PREVFREE(H_NEXT(hp)) = hp;
+  }
+  heapp->lists[fl][sl] = hp;
+  heapp->flmap    |= (uint32_t)1U << fl;
+  heapp->slmap[fl] |= (uint8_t)(1U << sl);
+  heapp->free     += H_BSIZE(hp);
+  heapp->nfree++;
+}
+
+/**
+ * @brief   Removes a block from the free lists.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[in] hp        the block
+ *
+ * @notapi
+ */
+static void tlsf_remove(memory_heap_t *heapp, heap_header_t *hp) {
+  unsigned fl, sl;
+
+  tlsf_mapping(H_BSIZE(hp), &fl, &sl);
+  if (H_NEXT(hp) != NULL) {
+    H_PREVFREE(H_NEXT(hp)) = H_PREVFREE(hp);
+  }
+  if (H_PREVFREE(hp) != NULL) {
+    H_NEXT(H_PREVFREE(hp)) = H_NEXT(hp);
+  }
+  else {
+    heapp->lists[fl][sl] = H_NEXT(hp);
+    if (H_NEXT(hp) == NULL) {
+      heapp->slmap[fl] &= (uint8_t)~(1U << sl);
+      if (heapp->slmap[fl] == 0U) {
+        heapp->flmap &= ~((uint32_t)1U << fl);
+      }
+    }
+  }
+  hp->b.bsize &= ~(size_t)1U;
+  heapp->free -= H_BSIZE(hp);
+  heapp->nfree--;
+}
+
+/**
+ * @brief   Finds a free block of at least the specified size.
+ * @details The size is rounded up to the next size class so that the head
+ *          of any list found using the bitmaps is large enough, if that
+ *          fails the head of the list of the size itself is checked.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[in] size      the block size, not greater than @p T_MAX_BLOCK
+ * @return              A free block, still in its list.
+ * @retval NULL         if there is no suitable block.
+ *
+ * @notapi
+ */
+static heap_header_t *tlsf_find(memory_heap_t *heapp, size_t size) {
+  heap_header_t *hp;
+  unsigned fl, sl;
+  size_t rsize = size;
+
+  if (size >= T_SMALL) {
+    rsize += ((size_t)1U << (heap_fls((uint32_t)size) -
+                             CH_HEAP_TLSF_SL_LOG2)) - 1U;
+  }
+  if (rsize <= T_MAX_BLOCK) {
+    uint32_t map;
+
+    tlsf_mapping(rsize, &fl, &sl);
+    map = (uint32_t)heapp->slmap[fl] & ((uint32_t)0xFFFFFFFFU << sl);
+    if (map == 0U) {
+      map = heapp->flmap & ((uint32_t)0xFFFFFFFFU << (fl + 1U));
+      if (map != 0U) {
+        fl  = heap_ffs(map);
+        map = (uint32_t)heapp->slmap[fl];
+      }
+    }
+    if (map != 0U) {
+      return heapp->lists[fl][heap_ffs(map)];
+    }
+  }
+
+  tlsf_mapping(size, &fl, &sl);
+  hp = heapp->lists[fl][sl];
+  if ((hp != NULL) && (H_BSIZE(hp) >= size)) {
+    return hp;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief   Releases a block into the free lists.
+ * @details The block is merged with its free physical neighbours.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[in] hp        the block, marked as used
+ *
+ * @notapi
+ */
+static void tlsf_release(memory_heap_t *heapp, heap_header_t *hp) {
+  heap_header_t *np;
+
+  /* Merge with the previous block.*/
+  np = H_PREV(hp);
+  if ((np != NULL) && H_ISFREE(np) &&
+      ((H_BSIZE(np) + H_HDR + H_BSIZE(hp)) <= T_MAX_BLOCK)) {
+    tlsf_remove(heapp, np);
+    np->b.bsize += H_HDR + H_BSIZE(hp);
+    hp = np;
+    H_PREV(H_NEXTPHYS(hp)) = hp;
+  }
+
+  /* Merge with the next block, region terminators are never free.*/
+  np = H_NEXTPHYS(hp);
+  if (H_ISFREE(np) &&
+      ((H_BSIZE(hp) + H_HDR + H_BSIZE(np)) <= T_MAX_BLOCK)) {
+    tlsf_remove(heapp, np);
+    hp->b.bsize += H_HDR + H_BSIZE(np);
+    H_PREV(H_NEXTPHYS(hp)) = hp;
+  }
+
+  tlsf_insert(heapp, hp);
+}
+
+/**
+ * @brief   Adds a memory region to the heap.
+ * @details The region is divided in free blocks not exceeding the maximum
+ *          block size and terminated by a zero sized used block. A region
+ *          contiguous to the previous one takes the place of its
+ *          terminator so that blocks can be merged across them.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[in] buf       region base, aligned to @p CH_HEAP_ALIGNMENT
+ * @param[in] size      region size, multiple of @p CH_HEAP_ALIGNMENT
+ *
+ * @notapi
+ */
+static void tlsf_add_region(memory_heap_t *heapp, void *buf, size_t size) {
+  heap_header_t *hp = buf;
+  size_t avail;
+
+  if ((heapp->tail != NULL) && (hp == H_BLOCK(heapp->tail))) {
+    hp = heapp->tail;
+    size += H_HDR;
+  }
+  else {
+    H_PREV(hp) = NULL;
+  }
+
+  avail = size - H_HDR;
+  while (avail >= T_MIN_SPLIT) {
+    heap_header_t *tp;
+    size_t bsize = avail - H_HDR;
+
+    if (bsize > T_MAX_BLOCK) {
+      bsize = T_MAX_BLOCK;
+    }
+
+    /* The block is created as used and a terminator is placed after it,
+       then it is released.*/
+    hp->b.bsize = bsize;
+    tp = H_NEXTPHYS(hp);
+    H_PREV(tp) = hp;
+    tp->b.bsize = 0U;
+    tlsf_release(heapp, hp);
+    avail -= H_HDR + bsize;
+    hp = tp;
+  }
+
+  /* Region terminator.*/
+  hp->b.bsize = 0U;
+  H_HEAP(hp) = heapp;
+  H_SIZE(hp) = 0U;
+  heapp->tail = hp;
+}
+
+/**
+ * @brief   Scans the free blocks lists.
+ * @note    The heap must be locked.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ * @param[out] totalp   total free space in bytes
+ * @param[out] largestp largest free block size in bytes
+ * @return              The number of free blocks.
+ *
+ * @notapi
+ */
+static size_t heap_scan(memory_heap_t *heapp,
+                        size_t *totalp, size_t *largestp) {
+  size_t largest = 0U;
+
+  /* The largest block is in the highest non empty list.*/
+  if (heapp->flmap != 0U) {
+    unsigned fl = heap_fls(heapp->flmap);
+    heap_header_t *hp;
+
+    hp = heapp->lists[fl][heap_fls((uint32_t)heapp->slmap[fl])];
+    while (hp != NULL) {
+      if (H_BSIZE(hp) > largest) {
+        largest = H_BSIZE(hp);
+      }
+      hp = H_NEXT(hp);
+    }
+  }
+
+  *totalp   = heapp->free;
+  *largestp = largest;
+
+  return heapp->nfree;
+}
+
+/**
+ * @brief   Initializes the free lists of a heap.
+ *
+ * @param[in] heapp     pointer to a heap descriptor
+ *
+ * @notapi
+ */
+static void tlsf_init(memory_heap_t *heapp) {
+  unsigned fl, sl;
+
+  heapp->flmap = 0U;
+  for (fl = 0U; fl < (unsigned)CH_CFG_HEAP_TLSF_FL_COUNT; fl++) {
+    heapp->slmap[fl] = 0U;
+    for (sl = 0U; sl < T_SL_COUNT; sl++) {
+      heapp->lists[fl][sl] = NULL;
+    }
+  }
+  heapp->free  = 0U;
+  heapp->nfree = 0U;
+  heapp->tail  = NULL;
+}
+#endif /* CH_CFG_HEAP_TLSF == TRUE */
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -107,8 +511,13 @@ static memory_heap_t default_heap;
 void _heap_init(void) {
 
   default_heap.provider = chCoreAllocAligned;
+#if CH_CFG_HEAP_TLSF == FALSE
   H_NEXT(&default_heap.header) = NULL;
   H_PAGES(&default_heap.header) = 0;
+#else
+  tlsf_init(&default_heap);
+#endif
+  default_heap.nused = 0U;
 #if (CH_CFG_USE_MUTEXES == TRUE) || defined(__DOXYGEN__)
   chMtxObjectInit(&default_heap.mtx);
 #else
@@ -128,6 +537,7 @@ void _heap_init(void) {
  * @init
  */
 void chHeapObjectInit(memory_heap_t *heapp, void *buf, size_t size) {
+#if CH_CFG_HEAP_TLSF == FALSE
   heap_header_t *hp = buf;
 
   chDbgCheck((heapp != NULL) && (size > 0U) &&
@@ -139,6 +549,16 @@ void chHeapObjectInit(memory_heap_t *heapp, void *buf, size_t size) {
   H_PAGES(&heapp->header) = 0;
   H_NEXT(hp) = NULL;
   H_PAGES(hp) = (size - sizeof (heap_header_t)) / CH_HEAP_ALIGNMENT;
+#else
+  chDbgCheck((heapp != NULL) && (size >= (T_MIN_SPLIT + H_HDR)) &&
+             MEM_IS_ALIGNED(buf, CH_HEAP_ALIGNMENT) &&
+             MEM_IS_ALIGNED(size, CH_HEAP_ALIGNMENT));
+
+  heapp->provider = NULL;
+  tlsf_init(heapp);
+  tlsf_add_region(heapp, buf, size);
+#endif
+  heapp->nused = 0U;
 #if (CH_CFG_USE_MUTEXES == TRUE) || defined(__DOXYGEN__)
   chMtxObjectInit(&heapp->mtx);
 #else
@@ -163,6 +583,7 @@ void chHeapObjectInit(memory_heap_t *heapp, void *buf, size_t size) {
  *
  * @api
  */
+#if (CH_CFG_HEAP_TLSF == FALSE) || defined(__DOXYGEN__)
 void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align) {
   heap_header_t *qp, *hp;
   size_t pages;
@@ -242,6 +663,7 @@ void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align) {
       /* Setting in the block owner heap and size.*/
       H_SIZE(hp) = size;
       H_HEAP(hp) = heapp;
+      heapp->nused++;
 
       /* Releasing heap mutex/semaphore.*/
       H_UNLOCK(heapp);
@@ -265,6 +687,9 @@ void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align) {
     if (hp != NULL) {
       H_HEAP(hp) = heapp;
       H_SIZE(hp) = size;
+      H_LOCK(heapp);
+      heapp->nused++;
+      H_UNLOCK(heapp);
 
       /*lint -save -e9087 [11.3] Safe cast.*/
       return (void *)H_BLOCK(hp);
@@ -324,6 +749,7 @@ void chHeapFree(void *p) {
     }
     qp = H_NEXT(qp);
   }
+  heapp->nused--;
 
   /* Releasing heap mutex/semaphore.*/
   H_UNLOCK(heapp);
@@ -331,6 +757,129 @@ void chHeapFree(void *p) {
   return;
 }
 
+#else /* CH_CFG_HEAP_TLSF == TRUE */
+void *chHeapAllocAligned(memory_heap_t *heapp, size_t size, unsigned align) {
+  heap_header_t *hp;
+  size_t bsize, ssize;
+
+  chDbgCheck((size > 0U) && MEM_IS_VALID_ALIGNMENT(align));
+
+  /* If an heap is not specified then the default system header is used.*/
+  if (heapp == NULL) {
+    heapp = &default_heap;
+  }
+
+  /* Minimum alignment is constrained by the heap header structure size.*/
+  if (align < CH_HEAP_ALIGNMENT) {
+    align = CH_HEAP_ALIGNMENT;
+  }
+
+  /* Requests exceeding the largest block cannot be satisfied.*/
+  if (size > T_MAX_BLOCK) {
+    return NULL;
+  }
+
+  /* Size of the block to be searched, with a larger alignment there must
+     be space for splitting a free block in front of the aligned one.*/
+  bsize = MEM_ALIGN_NEXT(size, CH_HEAP_ALIGNMENT);
+  ssize = bsize;
+  if (align > CH_HEAP_ALIGNMENT) {
+    ssize += (size_t)align + T_MIN_SPLIT;
+    if (ssize > T_MAX_BLOCK) {
+      return NULL;
+    }
+  }
+
+  /* Taking heap mutex/semaphore.*/
+  H_LOCK(heapp);
+
+  hp = tlsf_find(heapp, ssize);
+  if (hp == NULL) {
+    void *buf;
+
+    /* More memory is required, tries to get it from the associated
+       provider as a new region else fails.*/
+    buf = NULL;
+    if (heapp->provider != NULL) {
+      buf = heapp->provider(ssize + (2U * H_HDR), CH_HEAP_ALIGNMENT);
+    }
+    if (buf == NULL) {
+      H_UNLOCK(heapp);
+      return NULL;
+    }
+    tlsf_add_region(heapp, buf, ssize + (2U * H_HDR));
+    hp = tlsf_find(heapp, ssize);
+    chDbgAssert(hp != NULL, "region not added");
+  }
+  tlsf_remove(heapp, hp);
+
+  /* Pointer aligned to the requested alignment.*/
+  if (!MEM_IS_ALIGNED(H_BLOCK(hp), align)) {
+    heap_header_t *ahp;
+    size_t lsize;
+
+    /* The block is not properly aligned, the space in front of the aligned
+       area must be large enough to become a free block.*/
+    ahp = (heap_header_t *)MEM_ALIGN_NEXT((uint8_t *)H_BLOCK(hp) +
+                                          T_MIN_SPLIT, align) - 1U;
+    lsize = (size_t)((uint8_t *)ahp - (uint8_t *)H_BLOCK(hp));
+    H_PREV(ahp) = hp;
+    ahp->b.bsize = (H_BSIZE(hp) - lsize) - H_HDR;
+    H_PREV(H_NEXTPHYS(ahp)) = ahp;
+    hp->b.bsize = lsize;
+    tlsf_insert(heapp, hp);
+    hp = ahp;
+  }
+
+  if ((H_BSIZE(hp) - bsize) >= T_MIN_SPLIT) {
+    /* The block is bigger than required, must split the excess.*/
+    heap_header_t *fp;
+
+    fp = (heap_header_t *)(void *)((uint8_t *)H_BLOCK(hp) + bsize);
+    H_PREV(fp) = hp;
+    fp->b.bsize = (H_BSIZE(hp) - bsize) - H_HDR;
+    H_PREV(H_NEXTPHYS(fp)) = fp;
+    hp->b.bsize = bsize;
+    tlsf_insert(heapp, fp);
+  }
+
+  /* Setting in the block owner heap and size.*/
+  H_HEAP(hp) = heapp;
+  H_SIZE(hp) = size;
+  heapp->nused++;
+
+  /* Releasing heap mutex/semaphore.*/
+  H_UNLOCK(heapp);
+
+  /*lint -save -e9087 [11.3] Safe cast.*/
+  return (void *)H_BLOCK(hp);
+  /*lint -restore*/
+}
+
+void chHeapFree(void *p) {
+  heap_header_t *hp;
+  memory_heap_t *heapp;
+
+  chDbgCheck((p != NULL) && MEM_IS_ALIGNED(p, CH_HEAP_ALIGNMENT));
+
+  /*lint -save -e9087 [11.3] Safe cast.*/
+  hp = (heap_header_t *)p - 1U;
+  /*lint -restore*/
+  heapp = H_HEAP(hp);
+
+  chDbgAssert(!H_ISFREE(hp), "not allocated");
+
+  /* Taking heap mutex/semaphore.*/
+  H_LOCK(heapp);
+
+  tlsf_release(heapp, hp);
+  heapp->nused--;
+
+  /* Releasing heap mutex/semaphore.*/
+  H_UNLOCK(heapp);
+}
+#endif /* CH_CFG_HEAP_TLSF == TRUE */
+
 /**
  * @brief   Reports the heap status.
  * @note    This function is meant to be used in the test suite, it should
@@ -347,45 +896,62 @@ void chHeapFree(void *p) {
  * @api
  */
 size_t chHeapStatus(memory_heap_t *heapp, size_t *totalp, size_t *largestp) {
-  heap_header_t *qp;
-  size_t n, tpages, lpages;
+  size_t n, total, largest;
 
   if (heapp == NULL) {
     heapp = &default_heap;
   }
 
   H_LOCK(heapp);
-  tpages = 0U;
-  lpages = 0U;
-  n = 0U;
-  qp = &heapp->header;
-  while (H_NEXT(qp) != NULL) {
-    size_t pages = H_PAGES(H_NEXT(qp));
-
-    /* Updating counters.*/
-    n++;
-    tpages += pages;
-    if (pages > lpages) {
-      lpages = pages;
-    }
-
-    qp = H_NEXT(qp);
-  }
+  n = heap_scan(heapp, &total, &largest);
 
   /* Writing out fragmented free memory.*/
   if (totalp != NULL) {
-    *totalp = tpages * CH_HEAP_ALIGNMENT;
+    *totalp = total;
   }
 
   /* Writing out unfragmented free memory.*/
   if (largestp != NULL) {
-    *largestp = lpages * CH_HEAP_ALIGNMENT;
+    *largestp = largest;
   }
   H_UNLOCK(heapp);
 
   return n;
 }
 
+/**
+ * @brief   Reports the heap statistics.
+ * @details The fragmentation index is the part of the free space that
+ *          cannot be obtained with a single allocation.
+ *
+ * @param[in] heapp     pointer to a heap descriptor or @p NULL in order to
+ *                      access the default heap.
+ * @param[out] hsp      pointer to a @p heap_stats_t structure
+ *
+ * @api
+ */
+void chHeapGetStats(memory_heap_t *heapp, heap_stats_t *hsp) {
+
+  chDbgCheck(hsp != NULL);
+
+  if (heapp == NULL) {
+    heapp = &default_heap;
+  }
+
+  H_LOCK(heapp);
+  hsp->nfree = heap_scan(heapp, &hsp->free, &hsp->largest);
+  hsp->nused = heapp->nused;
+  H_UNLOCK(heapp);
+
+  if (hsp->free > 0U) {
+    hsp->fragmentation = (unsigned)(((hsp->free - hsp->largest) * 1000U) /
+                                    hsp->free);
+  }
+  else {
+    hsp->fragmentation = 0U;
+  }
+}
+
 #endif /* CH_CFG_USE_HEAP == TRUE */
 
 /** @} */
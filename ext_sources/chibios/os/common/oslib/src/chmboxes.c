@@ -31,6 +31,10 @@
  *            priority.
  *          - <b>Fetch</b>: A message is fetched from the mailbox and removed
  *            from the queue.
+ *          - <b>Post Batch</b>: Posts up to N messages in FIFO order within
+ *            a single critical zone, waiting threads are rescheduled once.
+ *          - <b>Fetch Batch</b>: Fetches up to N messages within a single
+ *            critical zone, waiting threads are rescheduled once.
  *          - <b>Reset</b>: The mailbox is emptied and all the stored messages
  *            are lost.
  *          .
@@ -70,6 +74,87 @@
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+/**
+ * @brief   Reserves up to @p n counts of a semaphore without waiting.
+ *
+ * @param[in] sp        pointer to a @p semaphore_t structure
+ * @param[in] n         maximum number of counts to be reserved
+ * @return              The number of reserved counts.
+ *
+ * @notapi
+ */
+static cnt_t mb_reserve(semaphore_t *sp, cnt_t n) {
+  cnt_t i, avail;
+
+  avail = chSemGetCounterI(sp);
+  if (n > avail) {
+    n = avail > (cnt_t)0 ? avail : (cnt_t)0;
+  }
+  for (i = (cnt_t)0; i < n; i++) {
+    chSemFastWaitI(sp);
+  }
+
+  return n;
+}
+
+/**
+ * @brief   Releases @p n counts of a semaphore.
+ * @note    The waiting threads are only made ready, the caller is supposed
+ *          to reschedule once after the whole batch.
+ *
+ * @param[in] sp        pointer to a @p semaphore_t structure
+ * @param[in] n         number of counts to be released
+ *
+ * @notapi
+ */
+static void mb_release(semaphore_t *sp, cnt_t n) {
+
+  while (n > (cnt_t)0) {
+    chSemSignalI(sp);
+    n--;
+  }
+}
+
+/**
+ * @brief   Writes @p n messages in the reserved slots.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the messages to be written
+ * @param[in] n         number of messages
+ *
+ * @notapi
+ */
+static void mb_write(mailbox_t *mbp, const msg_t *msgs, cnt_t n) {
+
+  while (n > (cnt_t)0) {
+    *mbp->wrptr++ = *msgs++;
+    if (mbp->wrptr >= mbp->top) {
+      mbp->wrptr = mbp->buffer;
+    }
+    n--;
+  }
+}
+
+/**
+ * @brief   Reads @p n messages from the used slots.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the buffer receiving the messages
+ * @param[in] n         number of messages
+ *
+ * @notapi
+ */
+static void mb_read(mailbox_t *mbp, msg_t *msgs, cnt_t n) {
+
+  while (n > (cnt_t)0) {
+    *msgs++ = *mbp->rdptr++;
+    if (mbp->rdptr >= mbp->top) {
+      mbp->rdptr = mbp->buffer;
+    }
+    n--;
+  }
+}
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -430,6 +515,207 @@ msg_t chMBFetchI(mailbox_t *mbp, msg_t *msgp) {
 
   return MSG_OK;
 }
+
+/**
+ * @brief   Posts a batch of messages into a mailbox.
+ * @details The invoking thread waits until at least one empty slot in the
+ *          mailbox becomes available or the specified time runs out, then
+ *          posts as many messages as the free slots allow, up to @p n.
+ *          The fetching threads are rescheduled once for the whole batch.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be posted
+ * @param[in] n         number of messages in the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of posted messages, the messages not
+ *                      posted are the last ones in the array.
+ * @retval 0            if the mailbox has been reset while waiting or the
+ *                      operation has timed out.
+ *
+ * @api
+ */
+cnt_t chMBPostBatch(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                    systime_t timeout) {
+  cnt_t posted;
+
+  chSysLock();
+  posted = chMBPostBatchS(mbp, msgs, n, timeout);
+  chSysUnlock();
+
+  return posted;
+}
+
+/**
+ * @brief   Posts a batch of messages into a mailbox.
+ * @details The invoking thread waits until at least one empty slot in the
+ *          mailbox becomes available or the specified time runs out, then
+ *          posts as many messages as the free slots allow, up to @p n.
+ *          The fetching threads are rescheduled once for the whole batch.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be posted
+ * @param[in] n         number of messages in the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of posted messages, the messages not
+ *                      posted are the last ones in the array.
+ * @retval 0            if the mailbox has been reset while waiting or the
+ *                      operation has timed out.
+ *
+ * @sclass
+ */
+cnt_t chMBPostBatchS(mailbox_t *mbp, const msg_t *msgs, cnt_t n,
+                     systime_t timeout) {
+  cnt_t posted;
+
+  chDbgCheckClassS();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+
+  /* Waiting for the first slot only, the rest of the batch is posted if
+     there is space.*/
+  if (chSemWaitTimeoutS(&mbp->emptysem, timeout) != MSG_OK) {
+    return (cnt_t)0;
+  }
+  posted = (cnt_t)1 + mb_reserve(&mbp->emptysem, n - (cnt_t)1);
+  mb_write(mbp, msgs, posted);
+  mb_release(&mbp->fullsem, posted);
+  chSchRescheduleS();
+
+  return posted;
+}
+
+/**
+ * @brief   Posts a batch of messages into a mailbox.
+ * @details This variant is non-blocking, as many messages as the free slots
+ *          allow are posted, up to @p n.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[in] msgs      pointer to the array of messages to be posted
+ * @param[in] n         number of messages in the array
+ * @return              The number of posted messages, the messages not
+ *                      posted are the last ones in the array.
+ * @retval 0            if the mailbox is full.
+ *
+ * @iclass
+ */
+cnt_t chMBPostBatchI(mailbox_t *mbp, const msg_t *msgs, cnt_t n) {
+  cnt_t posted;
+
+  chDbgCheckClassI();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+
+  posted = mb_reserve(&mbp->emptysem, n);
+  mb_write(mbp, msgs, posted);
+  mb_release(&mbp->fullsem, posted);
+
+  return posted;
+}
+
+/**
+ * @brief   Retrieves a batch of messages from a mailbox.
+ * @details The invoking thread waits until at least one message is posted
+ *          in the mailbox or the specified time runs out, then fetches all
+ *          the queued messages, up to @p n. The posting threads are
+ *          rescheduled once for the whole batch.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         size of the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of fetched messages.
+ * @retval 0            if the mailbox has been reset while waiting or the
+ *                      operation has timed out.
+ *
+ * @api
+ */
+cnt_t chMBFetchBatch(mailbox_t *mbp, msg_t *msgs, cnt_t n,
+                     systime_t timeout) {
+  cnt_t fetched;
+
+  chSysLock();
+  fetched = chMBFetchBatchS(mbp, msgs, n, timeout);
+  chSysUnlock();
+
+  return fetched;
+}
+
+/**
+ * @brief   Retrieves a batch of messages from a mailbox.
+ * @details The invoking thread waits until at least one message is posted
+ *          in the mailbox or the specified time runs out, then fetches all
+ *          the queued messages, up to @p n. The posting threads are
+ *          rescheduled once for the whole batch.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         size of the array
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of fetched messages.
+ * @retval 0            if the mailbox has been reset while waiting or the
+ *                      operation has timed out.
+ *
+ * @sclass
+ */
+cnt_t chMBFetchBatchS(mailbox_t *mbp, msg_t *msgs, cnt_t n,
+                      systime_t timeout) {
+  cnt_t fetched;
+
+  chDbgCheckClassS();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+
+  /* Waiting for the first message only, the other queued messages are
+     fetched without waiting.*/
+  if (chSemWaitTimeoutS(&mbp->fullsem, timeout) != MSG_OK) {
+    return (cnt_t)0;
+  }
+  fetched = (cnt_t)1 + mb_reserve(&mbp->fullsem, n - (cnt_t)1);
+  mb_read(mbp, msgs, fetched);
+  mb_release(&mbp->emptysem, fetched);
+  chSchRescheduleS();
+
+  return fetched;
+}
+
+/**
+ * @brief   Retrieves a batch of messages from a mailbox.
+ * @details This variant is non-blocking, all the queued messages are
+ *          fetched, up to @p n.
+ *
+ * @param[in] mbp       the pointer to an initialized @p mailbox_t object
+ * @param[out] msgs     pointer to the array receiving the messages
+ * @param[in] n         size of the array
+ * @return              The number of fetched messages.
+ * @retval 0            if the mailbox is empty.
+ *
+ * @iclass
+ */
+cnt_t chMBFetchBatchI(mailbox_t *mbp, msg_t *msgs, cnt_t n) {
+  cnt_t fetched;
+
+  chDbgCheckClassI();
+  chDbgCheck((mbp != NULL) && (msgs != NULL) && (n > (cnt_t)0));
+
+  fetched = mb_reserve(&mbp->fullsem, n);
+  mb_read(mbp, msgs, fetched);
+  mb_release(&mbp->emptysem, fetched);
+
+  return fetched;
+}
 #endif /* CH_CFG_USE_MAILBOXES == TRUE */
 
 /** @} */
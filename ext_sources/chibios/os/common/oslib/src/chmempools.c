@@ -29,7 +29,10 @@
  *          problems.<br>
  *          Memory Pools do not enforce any alignment constraint on the
  *          contained object however the objects must be properly aligned
- *          to contain a pointer to void.
+ *          to contain a pointer to void.<br>
+ *          With @p CH_CFG_MEMPOOLS_LOCKFREE enabled @p chPoolAlloc() and
+ *          @p chPoolFree() do not enter the critical zone as long as the
+ *          pool is not empty, the I-class functions are unchanged.
  * @pre     In order to use the memory pools APIs the @p CH_CFG_USE_MEMPOOLS option
  *          must be enabled in @p chconf.h.
  * @note    Compatible with RT and NIL.
@@ -52,10 +55,135 @@
 /* Module local variables.                                                   */
 /*===========================================================================*/
 
+#if (CH_CFG_MEMPOOLS_STATS == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Registered pools list.
+ */
+static memory_pool_t *pools_list;
+#endif
+
 /*===========================================================================*/
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+#if (CH_CFG_MEMPOOLS_STATS == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Updates the statistics after an allocation attempt.
+ * @note    Must be called from within the critical zone.
+ *
+ * @param[in] mp        pointer to a @p memory_pool_t structure
+ * @param[in] objp      the allocated object or @p NULL
+ *
+ * @notapi
+ */
+static void pool_count_alloc(memory_pool_t *mp, void *objp) {
+
+  if (objp == NULL) {
+    mp->stats.failures++;
+  }
+  else {
+    uint32_t used = mp->stats.size - mp->stats.free;
+
+    mp->stats.allocs++;
+    if (used > mp->stats.peak) {
+      mp->stats.peak = used;
+    }
+  }
+}
+#endif /* CH_CFG_MEMPOOLS_STATS == TRUE */
+
+#if (CH_CFG_MEMPOOLS_LOCKFREE == TRUE) || defined(__DOXYGEN__)
+/*
+ * Note, an exclusive store fails if an interrupt or a context switch
+ * happened after the exclusive load because the core clears the local
+ * monitor on exception entry and return. The I-class functions can use
+ * plain accesses because they cannot be interrupted by a thread inside
+ * one of these sequences.
+ */
+
+/**
+ * @brief   Removes the first object from the free list.
+ *
+ * @param[in] mp        pointer to a @p memory_pool_t structure
+ * @return              The object.
+ * @retval NULL         if the list is empty.
+ *
+ * @notapi
+ */
+static struct pool_header *pool_pop(memory_pool_t *mp) {
+  volatile uint32_t *headp = (volatile uint32_t *)(void *)&mp->next;
+  struct pool_header *php;
+
+  do {
+    php = (struct pool_header *)__LDREXW(headp);
+    if (php == NULL) {
+      __CLREX();
+      return NULL;
+    }
+  } while (__STREXW((uint32_t)php->next, headp) != 0U);
+
+  return php;
+}
+
+/**
+ * @brief   Inserts an object in the free list.
+ *
+ * @param[in] mp        pointer to a @p memory_pool_t structure
+ * @param[in] php       the object
+ *
+ * @notapi
+ */
+static void pool_push(memory_pool_t *mp, struct pool_header *php) {
+  volatile uint32_t *headp = (volatile uint32_t *)(void *)&mp->next;
+
+  do {
+    php->next = (struct pool_header *)__LDREXW(headp);
+  } while (__STREXW((uint32_t)php, headp) != 0U);
+}
+
+#if (CH_CFG_MEMPOOLS_STATS == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Atomically adds a value to a counter.
+ *
+ * @param[in] p         pointer to the counter
+ * @param[in] n         value to be added, modulo 2^32
+ *
+ * @notapi
+ */
+static void pool_atomic_add(uint32_t *p, uint32_t n) {
+  volatile uint32_t *vp = p;
+
+  while (__STREXW(__LDREXW(vp) + n, vp) != 0U) {
+  }
+}
+
+/**
+ * @brief   Updates the statistics after a lock-free allocation.
+ *
+ * @param[in] mp        pointer to a @p memory_pool_t structure
+ *
+ * @notapi
+ */
+static void pool_count_alloc_lf(memory_pool_t *mp) {
+  volatile uint32_t *peakp = &mp->stats.peak;
+  uint32_t used;
+
+  pool_atomic_add(&mp->stats.free, (uint32_t)-1);
+  pool_atomic_add(&mp->stats.allocs, 1U);
+
+  /* The snapshot can be slightly off under contention, this is
+     acceptable for statistics.*/
+  used = mp->stats.size - mp->stats.free;
+  do {
+    if (used <= __LDREXW(peakp)) {
+      __CLREX();
+      break;
+    }
+  } while (__STREXW(used, peakp) != 0U);
+}
+#endif /* CH_CFG_MEMPOOLS_STATS == TRUE */
+#endif /* CH_CFG_MEMPOOLS_LOCKFREE == TRUE */
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -80,6 +208,15 @@ void chPoolObjectInit(memory_pool_t *mp, size_t size, memgetfunc_t provider) {
   mp->next = NULL;
   mp->object_size = size;
   mp->provider = provider;
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  mp->stats.size     = 0U;
+  mp->stats.free     = 0U;
+  mp->stats.peak     = 0U;
+  mp->stats.failures = 0U;
+  mp->stats.allocs   = 0U;
+  mp->name           = NULL;
+  mp->reg_next       = NULL;
+#endif
 }
 
 /**
@@ -128,12 +265,24 @@ void *chPoolAllocI(memory_pool_t *mp) {
   /*lint -save -e9013 [15.7] There is no else because it is not needed.*/
   if (objp != NULL) {
     mp->next = mp->next->next;
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+    mp->stats.free--;
+#endif
   }
   else if (mp->provider != NULL) {
     objp = mp->provider(mp->object_size, PORT_NATURAL_ALIGN); /* TODO: Alignment is not properly handled */
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+    if (objp != NULL) {
+      mp->stats.size++;
+    }
+#endif
   }
   /*lint -restore*/
 
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  pool_count_alloc(mp, objp);
+#endif
+
   return objp;
 }
 
@@ -150,6 +299,20 @@ void *chPoolAllocI(memory_pool_t *mp) {
 void *chPoolAlloc(memory_pool_t *mp) {
   void *objp;
 
+#if CH_CFG_MEMPOOLS_LOCKFREE == TRUE
+  chDbgCheck(mp != NULL);
+
+  /* Fast path, the critical zone is only entered if the list is empty in
+     order to use the provider or to account the failure.*/
+  objp = pool_pop(mp);
+  if (objp != NULL) {
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+    pool_count_alloc_lf(mp);
+#endif
+    return objp;
+  }
+#endif
+
   chSysLock();
   objp = chPoolAllocI(mp);
   chSysUnlock();
@@ -177,6 +340,9 @@ void chPoolFreeI(memory_pool_t *mp, void *objp) {
 
   php->next = mp->next;
   mp->next = php;
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  mp->stats.free++;
+#endif
 }
 
 /**
@@ -193,11 +359,105 @@ void chPoolFreeI(memory_pool_t *mp, void *objp) {
  */
 void chPoolFree(memory_pool_t *mp, void *objp) {
 
+#if CH_CFG_MEMPOOLS_LOCKFREE == TRUE
+  chDbgCheck((mp != NULL) && (objp != NULL));
+
+  pool_push(mp, objp);
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  pool_atomic_add(&mp->stats.free, 1U);
+#endif
+#else
   chSysLock();
   chPoolFreeI(mp, objp);
   chSysUnlock();
+#endif
 }
 
+/**
+ * @brief   Registers a memory pool by name.
+ * @details Registered pools can be enumerated using @p chPoolRegFirst()
+ *          and @p chPoolRegNext(), pools are never unregistered so this
+ *          function should only be used on static pools.
+ * @note    No action is performed if @p CH_CFG_MEMPOOLS_STATS is disabled.
+ *
+ * @param[in] mp        pointer to a @p memory_pool_t structure
+ * @param[in] name      pool name as a zero terminated string
+ *
+ * @api
+ */
+void chPoolRegister(memory_pool_t *mp, const char *name) {
+
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+  memory_pool_t **mpp;
+
+  chDbgCheck(mp != NULL);
+
+  chSysLock();
+  mp->name     = name;
+  mp->reg_next = NULL;
+
+  /* Appended at the end so that pools are listed in registration order.*/
+  mpp = &pools_list;
+  while (*mpp != NULL) {
+    chDbgAssert(*mpp != mp, "already registered");
+    mpp = &(*mpp)->reg_next;
+  }
+  *mpp = mp;
+  chSysUnlock();
+#else
+  (void)mp;
+  (void)name;
+#endif
+}
+
+#if (CH_CFG_MEMPOOLS_STATS == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the first registered memory pool.
+ *
+ * @return              A pointer to the first pool.
+ * @retval NULL         if no pool has been registered.
+ *
+ * @api
+ */
+memory_pool_t *chPoolRegFirst(void) {
+
+  return pools_list;
+}
+
+/**
+ * @brief   Returns the registered memory pool after the specified one.
+ *
+ * @param[in] mp        pointer to a registered @p memory_pool_t structure
+ * @return              A pointer to the next pool.
+ * @retval NULL         if there are no more pools.
+ *
+ * @api
+ */
+memory_pool_t *chPoolRegNext(memory_pool_t *mp) {
+
+  chDbgCheck(mp != NULL);
+
+  return mp->reg_next;
+}
+
+/**
+ * @brief   Returns a consistent copy of the pool statistics.
+ *
+ * @param[in] mp        pointer to a @p memory_pool_t structure
+ * @param[out] psp      pointer to a @p pool_stats_t structure
+ *
+ * @api
+ */
+void chPoolGetStats(memory_pool_t *mp, pool_stats_t *psp) {
+
+  chDbgCheck((mp != NULL) && (psp != NULL));
+
+  chSysLock();
+  *psp = mp->stats;
+  chSysUnlock();
+}
+#endif /* CH_CFG_MEMPOOLS_STATS == TRUE */
+
 #if (CH_CFG_USE_SEMAPHORES == TRUE) || defined(__DOXYGEN__)
 /**
  * @brief   Initializes an empty guarded memory pool.
@@ -241,6 +501,32 @@ void chGuardedPoolLoadArray(guarded_memory_pool_t *gmp, void *p, size_t n) {
   }
 }
 
+/**
+ * @brief   Allocates an object from a guarded memory pool.
+ * @details The function does not wait, it fails if the pool is empty.
+ * @pre     The guarded memory pool must be already been initialized.
+ *
+ * @param[in] gmp       pointer to a @p guarded_memory_pool_t structure
+ * @return              The pointer to the allocated object.
+ * @retval NULL         if the pool is empty.
+ *
+ * @iclass
+ */
+void *chGuardedPoolAllocI(guarded_memory_pool_t *gmp) {
+
+  chDbgCheckClassI();
+
+  if (chSemGetCounterI(&gmp->sem) <= (cnt_t)0) {
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+    gmp->pool.stats.failures++;
+#endif
+    return NULL;
+  }
+  chSemFastWaitI(&gmp->sem);
+
+  return chPoolAllocI(&gmp->pool);
+}
+
 /**
  * @brief   Allocates an object from a guarded memory pool.
  * @pre     The guarded memory pool must be already been initialized.
@@ -262,6 +548,9 @@ void *chGuardedPoolAllocTimeoutS(guarded_memory_pool_t *gmp,
 
   msg = chSemWaitTimeoutS(&gmp->sem, timeout);
   if (msg != MSG_OK) {
+#if CH_CFG_MEMPOOLS_STATS == TRUE
+    gmp->pool.stats.failures++;
+#endif
     return NULL;
   }
 
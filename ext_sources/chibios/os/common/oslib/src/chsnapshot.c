@@ -0,0 +1,171 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio.
+
+    This file is part of ChibiOS.
+
+    ChibiOS is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    chsnapshot.c
+ * @brief   Snapshots code.
+ *
+ * @addtogroup snapshots
+ * @details Lock-free publication of small shared objects.
+ *          <h2>Operation mode</h2>
+ *          A snapshot holds the last published value of an object of
+ *          fixed size. A single writer publishes new values, any number
+ *          of readers take consistent copies without ever entering a
+ *          critical zone or blocking.<br>
+ *          Two copies of the object are kept, the writer updates them one
+ *          after the other and bumps a sequence counter before each
+ *          update, the counter parity tells readers which copy is not
+ *          being written. A reader copies the stable copy and retries if
+ *          the counter changed meanwhile, this only happens if the reader
+ *          has been preempted by the writer, a reader preempting the
+ *          writer always finds a stable copy and completes at the first
+ *          attempt.<br>
+ *          Operations defined for snapshots:
+ *          - <b>Publish</b>: Stores a new value of the object.
+ *          - <b>Read</b>: Copies the last completely published value.
+ *          .
+ * @pre     In order to use the snapshots APIs the @p CH_CFG_USE_SNAPSHOTS
+ *          option must be enabled in @p chconf.h.
+ * @note    Publications are not serialized, if more than one thread or
+ *          ISR can publish on the same snapshot then the caller must
+ *          serialize them.
+ * @{
+ */
+
+#include <string.h>
+
+#include "ch.h"
+
+#if (CH_CFG_USE_SNAPSHOTS == TRUE) || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Module local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Compiler memory barrier.
+ * @details The copies must not be accessed across the sequence counter
+ *          updates, on single core targets it is enough to prevent the
+ *          compiler from reordering the accesses.
+ */
+#if !defined(SNAPSHOT_BARRIER) || defined(__DOXYGEN__)
+#define SNAPSHOT_BARRIER()      __asm volatile ("" : : : "memory")
+#endif
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local types.                                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a @p snapshot_t object.
+ * @note    The buffer is cleared, readers get a zeroed object until the
+ *          first publication.
+ *
+ * @param[out] snp      the pointer to the @p snapshot_t structure to be
+ *                      initialized
+ * @param[in] buf       pointer to the snapshot buffer area, it must be
+ *                      able to hold two copies of the object
+ * @param[in] size      size of the object
+ *
+ * @init
+ */
+void chSnapshotObjectInit(snapshot_t *snp, void *buf, size_t size) {
+
+  chDbgCheck((snp != NULL) && (buf != NULL) && (size > 0U));
+
+  snp->seq    = (ucnt_t)0;
+  snp->buffer = (uint8_t *)buf;
+  snp->size   = size;
+  memset(buf, 0, size * 2U);
+}
+
+/**
+ * @brief   Publishes a new value of the object.
+ * @details Both copies are updated, readers are diverted on the other
+ *          copy while each one is written.
+ * @note    The writes must be serialized by the caller.
+ *
+ * @param[in] snp       the pointer to an initialized @p snapshot_t object
+ * @param[in] objp      pointer to the new value of the object
+ *
+ * @xclass
+ */
+void chSnapshotPublish(snapshot_t *snp, const void *objp) {
+
+  chDbgCheck((snp != NULL) && (objp != NULL));
+
+  /* Odd counter, readers use the second copy.*/
+  snp->seq++;
+  SNAPSHOT_BARRIER();
+  memcpy(snp->buffer, objp, snp->size);
+  SNAPSHOT_BARRIER();
+
+  /* Even counter, readers use the first copy.*/
+  snp->seq++;
+  SNAPSHOT_BARRIER();
+  memcpy(snp->buffer + snp->size, objp, snp->size);
+  SNAPSHOT_BARRIER();
+}
+
+/**
+ * @brief   Reads a consistent copy of the object.
+ * @details The function never blocks, the copy is retried if the
+ *          sequence counter changed while copying.
+ *
+ * @param[in] snp       the pointer to an initialized @p snapshot_t object
+ * @param[out] objp     pointer to the object receiving the copy
+ * @return              The version of the copied object, it is the number
+ *                      of completed publications.
+ *
+ * @xclass
+ */
+ucnt_t chSnapshotRead(snapshot_t *snp, void *objp) {
+  ucnt_t seq;
+
+  chDbgCheck((snp != NULL) && (objp != NULL));
+
+  do {
+    seq = snp->seq;
+    SNAPSHOT_BARRIER();
+    memcpy(objp, snp->buffer + ((seq & (ucnt_t)1) * snp->size), snp->size);
+    SNAPSHOT_BARRIER();
+  } while (snp->seq != seq);
+
+  return seq >> 1;
+}
+
+#endif /* CH_CFG_USE_SNAPSHOTS == TRUE */
+
+/** @} */
@@ -28,15 +28,30 @@
  *          divided in writable pages.<br>
  *          The module handles flash wear leveling and recovery of damaged
  *          banks (where possible) caused by power loss during operations.
- *          Both operations are transparent to the user.
+ *          Both operations are transparent to the user.<br>
+ *          Records are appended to the current bank, each one is composed
+ *          by a @p mfs_data_header_t header followed by the record data,
+ *          updates and erasures append a new instance and the older ones
+ *          become obsolete. The offset of the most recent instance of each
+ *          record is kept in RAM and is rebuilt when the partition is
+ *          mounted, so reads do not require searching the flash.<br>
+ *          When the current bank is full the valid records are copied in
+ *          the other bank and the old bank is erased, the bank header is
+ *          written after the copy so an interrupted garbage collection is
+ *          recovered on the next mount. Banks are used alternately, both
+ *          banks endure the same number of erase cycles and the writes
+ *          are spread over the whole bank.
  *
  * @addtogroup mfs
  * @{
  */
 
+#include <string.h>
+
 #include "hal.h"
 
 #include "mfs.h"
+#include "crc.h"
 
 /*===========================================================================*/
 /* Driver local definitions.                                                 */
@@ -44,6 +59,30 @@
 
 #define PAIR(a, b) (((unsigned)(a) << 2U) | (unsigned)(b))
 
+/**
+ * @brief   Size of the bank header area covered by the CRC.
+ */
+#define MFS_BANK_HEADER_CRC_SIZE    offsetof(mfs_bank_header_t, crc)
+
+/**
+ * @brief   Size of the bank header area written in flash.
+ */
+#define MFS_BANK_HEADER_SIZE        (MFS_BANK_HEADER_CRC_SIZE +             \
+                                     sizeof (uint16_t))
+
+/**
+ * @brief   Rounds up a size or offset to the records alignment.
+ */
+#define MFS_ALIGN_NEXT(n)                                                   \
+  (((uint32_t)(n) + ((uint32_t)MFS_CFG_MEMORY_ALIGNMENT - 1U)) &            \
+   ~((uint32_t)MFS_CFG_MEMORY_ALIGNMENT - 1U))
+
+/**
+ * @brief   Flash space used by a record of the specified data size.
+ */
+#define MFS_RECORD_SPACE(n)                                                 \
+  MFS_ALIGN_NEXT(sizeof (mfs_data_header_t) + (uint32_t)(n))
+
 /**
  * @brief   Error check helper.
  */
@@ -62,54 +101,34 @@
 /* Driver local variables and types.                                         */
 /*===========================================================================*/
 
-const uint16_t crc16_table[256] = {
-  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
-  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-  0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
-  0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-  0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
-  0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
-  0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
-  0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-  0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
-  0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-  0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
-  0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-  0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
-  0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-  0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
-  0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-  0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
-  0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-  0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
-  0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-  0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
-  0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-  0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
-  0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-  0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
-  0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-  0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
-  0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-  0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
-  0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-  0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
-  0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
-};
-
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
-uint16_t crc16(uint16_t crc, const uint8_t *data, size_t n) {
+/**
+ * @brief   Flash read.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] offset    flash offset
+ * @param[in] n         number of bytes to be read
+ * @param[out] rp       pointer to the data buffer
+ * @return              The operation status.
+ * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
+ *                      failures.
+ *
+ * @notapi
+ */
+static mfs_error_t mfs_flash_read(MFSDriver *devp, flash_offset_t offset,
+                                  size_t n, uint8_t *rp) {
+  flash_error_t ferr;
 
-  while (n > 0U) {
-    crc = (crc << 8U) ^ crc16_table[(crc >> 8U) ^ (uint16_t)*data];
-    data++;
-    n--;
+  ferr = flashRead(devp->config->flashp, offset, n, rp);
+  if (ferr != FLASH_NO_ERROR) {
+    return MFS_ERR_FLASH_FAILURE;
   }
 
-  return crc;
+  return MFS_NO_ERROR;
 }
 
 /**
@@ -119,8 +138,8 @@ uint16_t crc16(uint16_t crc, const uint8_t *data, size_t n) {
  *
  * @param[in] devp      pointer to the @p MFSDriver object
  * @param[in] offset    flash offset
- * @param[in] n         number of bytes to be read
- * @param[out] rp       pointer to the data buffer
+ * @param[in] n         number of bytes to be written
+ * @param[in] p         pointer to the data buffer
  * @return              The operation status.
  * @retval MFS_NO_ERROR if the operation has been successfully completed.
  * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
@@ -139,9 +158,205 @@ static mfs_error_t mfs_flash_write(MFSDriver *devp,
     return MFS_ERR_FLASH_FAILURE;
   }
 
+#if MFS_CFG_WRITE_VERIFY == TRUE
+  /* Reading back the written data, the comparison buffer is on the stack
+     because the data could be in the driver buffer.*/
+  while (n > 0U) {
+    uint8_t cmpbuf[MFS_CFG_BUFFER_SIZE];
+    size_t chunk = n < sizeof cmpbuf ? n : sizeof cmpbuf;
+
+    ferr = flashRead(devp->config->flashp, offset, chunk, cmpbuf);
+    if ((ferr != FLASH_NO_ERROR) || (memcmp(cmpbuf, p, chunk) != 0)) {
+      return MFS_ERR_FLASH_FAILURE;
+    }
+
+    offset += (flash_offset_t)chunk;
+    p      += chunk;
+    n      -= chunk;
+  }
+#endif
+
   return MFS_NO_ERROR;
 }
 
+/**
+ * @brief   Checks if a flash area is erased.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] offset    flash offset
+ * @param[in] n         size of the area
+ * @return              The area state.
+ * @retval false        if the area is not erased or cannot be read.
+ * @retval true         if the area is erased.
+ *
+ * @notapi
+ */
+static bool mfs_flash_is_erased(MFSDriver *devp,
+                                flash_offset_t offset,
+                                size_t n) {
+
+  while (n > 0U) {
+    size_t i, chunk = n < sizeof devp->buffer.data ?
+                      n : sizeof devp->buffer.data;
+
+    if (mfs_flash_read(devp, offset, chunk,
+                       devp->buffer.data) != MFS_NO_ERROR) {
+      return false;
+    }
+    for (i = 0U; i < chunk; i++) {
+      if (devp->buffer.data[i] != 0xFFU) {
+        return false;
+      }
+    }
+
+    offset += (flash_offset_t)chunk;
+    n      -= chunk;
+  }
+
+  return true;
+}
+
+/**
+ * @brief   Calculates the CRC of a flash area.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] offset    flash offset
+ * @param[in] n         size of the area
+ * @param[out] crcp     pointer to the calculated CRC
+ * @return              The operation status.
+ * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
+ *                      failures.
+ *
+ * @notapi
+ */
+static mfs_error_t mfs_flash_crc(MFSDriver *devp,
+                                 flash_offset_t offset,
+                                 size_t n,
+                                 uint16_t *crcp) {
+  uint16_t crc = CRC16_INIT;
+
+  while (n > 0U) {
+    size_t chunk = n < sizeof devp->buffer.data ?
+                   n : sizeof devp->buffer.data;
+
+    RET_ON_ERROR(mfs_flash_read(devp, offset, chunk, devp->buffer.data));
+    crc = crc16(crc, devp->buffer.data, chunk);
+
+    offset += (flash_offset_t)chunk;
+    n      -= chunk;
+  }
+
+  *crcp = crc;
+
+  return MFS_NO_ERROR;
+}
+
+/**
+ * @brief   Copies a flash area.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] doffset   destination flash offset
+ * @param[in] soffset   source flash offset
+ * @param[in] n         size of the area
+ * @return              The operation status.
+ * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
+ *                      failures.
+ *
+ * @notapi
+ */
+static mfs_error_t mfs_flash_copy(MFSDriver *devp,
+                                  flash_offset_t doffset,
+                                  flash_offset_t soffset,
+                                  size_t n) {
+
+  while (n > 0U) {
+    size_t chunk = n < sizeof devp->buffer.data ?
+                   n : sizeof devp->buffer.data;
+
+    RET_ON_ERROR(mfs_flash_read(devp, soffset, chunk, devp->buffer.data));
+    RET_ON_ERROR(mfs_flash_write(devp, doffset, chunk, devp->buffer.data));
+
+    doffset += (flash_offset_t)chunk;
+    soffset += (flash_offset_t)chunk;
+    n       -= chunk;
+  }
+
+  return MFS_NO_ERROR;
+}
+
+/**
+ * @brief   Returns the flash space used by a record instance.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] offset    flash offset of the record instance
+ * @param[out] spacep   pointer to the used space, header included
+ * @return              The operation status.
+ * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
+ *                      failures.
+ *
+ * @notapi
+ */
+static mfs_error_t mfs_record_space(MFSDriver *devp,
+                                    flash_offset_t offset,
+                                    uint32_t *spacep) {
+
+  RET_ON_ERROR(mfs_flash_read(devp, offset, sizeof (mfs_data_header_t),
+                              devp->buffer.data));
+  *spacep = MFS_RECORD_SPACE(devp->buffer.dhdr.size);
+
+  return MFS_NO_ERROR;
+}
+
+/**
+ * @brief   Returns the flash offset of a bank.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] bank      the bank identifier
+ * @return              The offset of the first sector of the bank.
+ *
+ * @notapi
+ */
+static flash_offset_t mfs_bank_get_offset(MFSDriver *devp, mfs_bank_t bank) {
+
+  return flashGetSectorOffset(devp->config->flashp,
+                              bank == MFS_BANK_0 ? devp->config->bank0_start :
+                                                   devp->config->bank1_start);
+}
+
+/**
+ * @brief   Returns the size of a bank.
+ * @note    The sectors of a bank must be contiguous.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] bank      the bank identifier
+ * @return              The bank size in bytes.
+ *
+ * @notapi
+ */
+static uint32_t mfs_bank_get_size(MFSDriver *devp, mfs_bank_t bank) {
+  flash_sector_t sector, end;
+  uint32_t size = 0U;
+
+  if (bank == MFS_BANK_0) {
+    sector = devp->config->bank0_start;
+    end    = devp->config->bank0_start + devp->config->bank0_sectors;
+  }
+  else {
+    sector = devp->config->bank1_start;
+    end    = devp->config->bank1_start + devp->config->bank1_sectors;
+  }
+
+  while (sector < end) {
+    size += flashGetSectorSize(devp->config->flashp, sector);
+    sector++;
+  }
+
+  return size;
+}
+
 /**
  * @brief   Erases and verifies all sectors belonging to a bank.
  *
@@ -204,32 +419,139 @@ static mfs_error_t mfs_bank_erase(MFSDriver *devp, mfs_bank_t bank) {
 static mfs_error_t mfs_bank_set_header(MFSDriver *devp,
                                        mfs_bank_t bank,
                                        uint32_t cnt) {
-  flash_sector_t sector;
   mfs_bank_header_t header;
 
-  if (bank == MFS_BANK_0) {
-    sector = devp->config->bank0_start;
-  }
-  else {
-    sector = devp->config->bank1_start;
-  }
-
-  header.magic1  = MFS_BANK_MAGIC_1;
   header.magic1  = MFS_BANK_MAGIC_1;
+  header.magic2  = MFS_BANK_MAGIC_2;
   header.counter = cnt;
-  header.next    = sizeof (mfs_bank_header_t);
-  header.crc     = crc16(0xFFFFU,
+  header.next    = MFS_ALIGN_NEXT(sizeof (mfs_bank_header_t));
+  header.crc     = crc16(CRC16_INIT,
                          (const uint8_t *)&header,
-                         sizeof (flash_sector_t) - sizeof (uint16_t));
+                         MFS_BANK_HEADER_CRC_SIZE);
 
+  /* The padding after the CRC is left erased.*/
   return mfs_flash_write(devp,
-                         flashGetSectorOffset(devp->config->flashp, sector),
-                         sizeof (mfs_bank_header_t),
+                         mfs_bank_get_offset(devp, bank),
+                         MFS_BANK_HEADER_SIZE,
                          (const uint8_t *)&header);
 }
 
+/**
+ * @brief   Scans a bank and builds the records index.
+ * @details The bank header is validated then the records are walked up to
+ *          the first erased record header, the rest of the bank must be
+ *          erased. The index, the used space and the next free position
+ *          are updated for the scanned bank.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @param[in] bank      the bank identifier
+ * @param[out] cntp     bank counter value, only valid if the bank is not
+ *                      in the @p MFS_BANK_GARBAGE state
+ * @return              The bank state.
+ * @retval MFS_BANK_OK      if the bank contains valid data.
+ * @retval MFS_BANK_PARTIAL if the bank contains a damaged record or a non
+ *                          erased free area, the records preceding it
+ *                          are indexed.
+ * @retval MFS_BANK_GARBAGE if the bank header is not valid.
+ *
+ * @notapi
+ */
+static mfs_bank_state_t mfs_bank_scan(MFSDriver *devp,
+                                      mfs_bank_t bank,
+                                      uint32_t *cntp) {
+  flash_offset_t start, end, offset;
+  mfs_bank_state_t sts = MFS_BANK_OK;
+  unsigned i;
+
+  for (i = 0U; i < (unsigned)MFS_CFG_MAX_RECORDS; i++) {
+    devp->instances[i] = 0U;
+  }
+
+  start = mfs_bank_get_offset(devp, bank);
+  end   = start + devp->banks_size;
+
+  /* Bank header check.*/
+  if (mfs_flash_read(devp, start, sizeof (mfs_bank_header_t),
+                     devp->buffer.data) != MFS_NO_ERROR) {
+    return MFS_BANK_GARBAGE;
+  }
+  if ((devp->buffer.bhdr.magic1 != MFS_BANK_MAGIC_1) ||
+      (devp->buffer.bhdr.magic2 != MFS_BANK_MAGIC_2) ||
+      (devp->buffer.bhdr.crc != crc16(CRC16_INIT, devp->buffer.data,
+                                      MFS_BANK_HEADER_CRC_SIZE)) ||
+      (devp->buffer.bhdr.next < sizeof (mfs_bank_header_t)) ||
+      (devp->buffer.bhdr.next > devp->banks_size)) {
+    return MFS_BANK_GARBAGE;
+  }
+  *cntp  = devp->buffer.bhdr.counter;
+  offset = start + devp->buffer.bhdr.next;
+  devp->used_space = devp->buffer.bhdr.next;
+
+  /* Walking the records chain.*/
+  while ((end - offset) >= sizeof (mfs_data_header_t)) {
+    mfs_data_header_t header;
+    uint16_t crc;
+
+    if (mfs_flash_read(devp, offset, sizeof (mfs_data_header_t),
+                       (uint8_t *)&header) != MFS_NO_ERROR) {
+      sts = MFS_BANK_PARTIAL;
+      break;
+    }
+
+    /* An erased header marks the end of the records.*/
+    if ((header.magic == 0xFFFFU) && (header.crc == 0xFFFFU) &&
+        (header.id == 0xFFFFU) && (header.flags == 0xFFFFU) &&
+        (header.size == 0xFFFFFFFFU)) {
+      break;
+    }
+
+    /* Damaged records, probably an interrupted write.*/
+    if ((header.magic != MFS_HEADER_MAGIC) ||
+        (header.id >= (uint16_t)MFS_CFG_MAX_RECORDS) ||
+        (header.size > (end - offset) - sizeof (mfs_data_header_t)) ||
+        (mfs_flash_crc(devp, offset + sizeof (mfs_data_header_t),
+                       header.size, &crc) != MFS_NO_ERROR) ||
+        (crc != header.crc)) {
+      sts = MFS_BANK_PARTIAL;
+      break;
+    }
+
+    /* The instance replaces the previous ones, a zero size instance is an
+       erasure.*/
+    devp->instances[header.id] = header.size > 0U ? offset : 0U;
+
+    offset += MFS_RECORD_SPACE(header.size);
+    if (offset > end) {
+      offset = end;
+    }
+  }
+  devp->next_offset = offset;
+
+  /* The free area must be erased else it could not be written.*/
+  if ((sts == MFS_BANK_OK) &&
+      !mfs_flash_is_erased(devp, offset, (size_t)(end - offset))) {
+    sts = MFS_BANK_PARTIAL;
+  }
+
+  /* Space used by the most recent instances of the records.*/
+  for (i = 0U; i < (unsigned)MFS_CFG_MAX_RECORDS; i++) {
+    if (devp->instances[i] != 0U) {
+      uint32_t space;
+
+      if (mfs_record_space(devp, devp->instances[i],
+                           &space) != MFS_NO_ERROR) {
+        return MFS_BANK_GARBAGE;
+      }
+      devp->used_space += space;
+    }
+  }
+
+  return sts;
+}
+
 /**
  * @brief   Copies all records from a bank to another.
+ * @note    The bank header of the destination bank is not written.
  *
  * @param[in] devp      pointer to the @p MFSDriver object
  * @param[in] sbank     source bank
@@ -244,10 +566,34 @@ static mfs_error_t mfs_bank_set_header(MFSDriver *devp,
 static mfs_error_t mfs_bank_copy(MFSDriver *devp,
                                  mfs_bank_t sbank,
                                  mfs_bank_t dbank) {
+  flash_offset_t offset;
+  unsigned i;
+
+  /* The index must describe the source bank, it is already the case when
+     collecting garbage from the mounted bank.*/
+  if ((devp->state != MFS_MOUNTED) || (devp->current_bank != sbank)) {
+    uint32_t cnt;
+
+    if (mfs_bank_scan(devp, sbank, &cnt) == MFS_BANK_GARBAGE) {
+      return MFS_ERR_FLASH_FAILURE;
+    }
+  }
 
-  (void)devp;
-  (void)sbank;
-  (void)dbank;
+  offset = mfs_bank_get_offset(devp, dbank) +
+           MFS_ALIGN_NEXT(sizeof (mfs_bank_header_t));
+  for (i = 0U; i < (unsigned)MFS_CFG_MAX_RECORDS; i++) {
+    if (devp->instances[i] != 0U) {
+      uint32_t size;
+
+      /* Copying header and data of the most recent instance.*/
+      RET_ON_ERROR(mfs_flash_read(devp, devp->instances[i],
+                                  sizeof (mfs_data_header_t),
+                                  devp->buffer.data));
+      size = (uint32_t)sizeof (mfs_data_header_t) + devp->buffer.dhdr.size;
+      RET_ON_ERROR(mfs_flash_copy(devp, offset, devp->instances[i], size));
+      offset += MFS_ALIGN_NEXT(size);
+    }
+  }
 
   return MFS_NO_ERROR;
 }
@@ -256,16 +602,49 @@ static mfs_error_t mfs_bank_copy(MFSDriver *devp,
  * @brief   Selects a bank as current.
  *
  * @param[in] devp      pointer to the @p MFSDriver object
- * @param[in] bank      bank to be erased
+ * @param[in] bank      bank to be mounted
  * @return              The operation status.
  * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_ERR_FLASH_FAILURE if the bank cannot be read back.
  *
  * @notapi
  */
 static mfs_error_t mfs_bank_mount(MFSDriver *devp, mfs_bank_t bank) {
+  uint32_t cnt;
+
+  if (mfs_bank_scan(devp, bank, &cnt) != MFS_BANK_OK) {
+    return MFS_ERR_FLASH_FAILURE;
+  }
 
-  (void)devp;
-  (void)bank;
+  devp->current_bank    = bank;
+  devp->current_counter = cnt;
+
+  return MFS_NO_ERROR;
+}
+
+/**
+ * @brief   Moves the valid records in the other bank.
+ * @details The records are copied, the header of the new bank is written
+ *          with an increased usage counter then the old bank is erased.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @return              The operation status.
+ * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
+ *                      failures.
+ *
+ * @notapi
+ */
+static mfs_error_t mfs_garbage_collect(MFSDriver *devp) {
+  mfs_bank_t sbank, dbank;
+
+  sbank = devp->current_bank;
+  dbank = sbank == MFS_BANK_0 ? MFS_BANK_1 : MFS_BANK_0;
+
+  RET_ON_ERROR(mfs_bank_copy(devp, sbank, dbank));
+  RET_ON_ERROR(mfs_bank_set_header(devp, dbank, devp->current_counter + 1U));
+  RET_ON_ERROR(mfs_bank_erase(devp, sbank));
+  RET_ON_ERROR(mfs_bank_mount(devp, dbank));
 
   return MFS_NO_ERROR;
 }
@@ -289,12 +668,26 @@ static mfs_error_t mfs_bank_mount(MFSDriver *devp, mfs_bank_t bank) {
 static mfs_bank_state_t mfs_get_bank_state(MFSDriver *devp,
                                            mfs_bank_t bank,
                                            uint32_t *cntp) {
+  flash_sector_t sector, end;
 
-  (void)devp;
-  (void)bank;
-  (void)cntp;
+  if (bank == MFS_BANK_0) {
+    sector = devp->config->bank0_start;
+    end    = devp->config->bank0_start + devp->config->bank0_sectors;
+  }
+  else {
+    sector = devp->config->bank1_start;
+    end    = devp->config->bank1_start + devp->config->bank1_sectors;
+  }
+
+  /* Checking if all the sectors are erased.*/
+  while (sector < end) {
+    if (flashVerifyErase(devp->config->flashp, sector) != FLASH_NO_ERROR) {
+      return mfs_bank_scan(devp, bank, cntp);
+    }
+    sector++;
+  }
 
-  return MFS_BANK_OK;
+  return MFS_BANK_ERASED;
 }
 
 /**
@@ -449,7 +842,7 @@ static mfs_error_t mfs_try_mount(MFSDriver *devp) {
 
   case PAIR(MFS_BANK_GARBAGE, MFS_BANK_ERASED):
     /* Bank zero is unreadable, bank one is erased.*/
-    RET_ON_ERROR(mfs_bank_erase(devp, MFS_BANK_1));
+    RET_ON_ERROR(mfs_bank_erase(devp, MFS_BANK_0));
     RET_ON_ERROR(mfs_bank_set_header(devp, MFS_BANK_0, 1));
     RET_ON_ERROR(mfs_bank_mount(devp, MFS_BANK_0));
     return MFS_WARN_REPAIR;
@@ -464,7 +857,7 @@ static mfs_error_t mfs_try_mount(MFSDriver *devp) {
     /* Bank zero is unreadable, bank one has problems.*/
     RET_ON_ERROR(mfs_bank_erase(devp, MFS_BANK_0));
     RET_ON_ERROR(mfs_bank_copy(devp, MFS_BANK_1, MFS_BANK_0));
-    RET_ON_ERROR(mfs_bank_set_header(devp, MFS_BANK_0, cnt0 + 1));
+    RET_ON_ERROR(mfs_bank_set_header(devp, MFS_BANK_0, cnt1 + 1));
     RET_ON_ERROR(mfs_bank_erase(devp, MFS_BANK_1));
     RET_ON_ERROR(mfs_bank_mount(devp, MFS_BANK_0));
     return MFS_WARN_REPAIR;
@@ -560,13 +953,28 @@ void mfsStop(MFSDriver *devp) {
 mfs_error_t mfsMount(MFSDriver *devp) {
   unsigned i;
 
+  osalDbgCheck(devp != NULL);
+  osalDbgAssert((devp->state == MFS_READY) || (devp->state == MFS_MOUNTED),
+                "invalid state");
+  osalDbgAssert((flashGetDescriptor(devp->config->flashp)->attributes &
+                 FLASH_ATTR_ERASED_IS_ONE) != 0U,
+                "unsupported flash");
+
+  /* The index is rebuilt.*/
+  devp->state      = MFS_READY;
+  devp->banks_size = mfs_bank_get_size(devp, MFS_BANK_0);
+  osalDbgAssert(devp->banks_size == mfs_bank_get_size(devp, MFS_BANK_1),
+                "banks size mismatch");
+
   /* Attempting to mount the managed partition.*/
   for (i = 0; i < MFS_CFG_MAX_REPAIR_ATTEMPTS; i++) {
     mfs_error_t err;
 
     err = mfs_try_mount(devp);
-    if (!MFS_IS_ERROR(err))
+    if (!MFS_IS_ERROR(err)) {
+      devp->state = MFS_MOUNTED;
       return err;
+    }
   }
 
   return MFS_ERR_FLASH_FAILURE;
@@ -574,16 +982,28 @@ mfs_error_t mfsMount(MFSDriver *devp) {
 
 /**
  * @brief   Unmounts a manage flash storage.
+ *
+ * @param[in] devp      pointer to the @p MFSDriver object
+ * @return              The operation status.
+ * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ *
+ * @api
  */
 mfs_error_t mfsUnmount(MFSDriver *devp) {
 
-  (void)devp;
+  osalDbgCheck(devp != NULL);
+  osalDbgAssert((devp->state == MFS_READY) || (devp->state == MFS_MOUNTED),
+                "invalid state");
+
+  devp->state = MFS_READY;
 
   return MFS_NO_ERROR;
 }
 
 /**
  * @brief   Retrieves and reads a data record.
+ * @details The record is located through the index, only its header and
+ *          data are read from the flash.
  *
  * @param[in] devp      pointer to the @p MFSDriver object
  * @param[in] id        record numeric identifier
@@ -594,22 +1014,55 @@ mfs_error_t mfsUnmount(MFSDriver *devp) {
  * @retval MFS_NO_ERROR if the operation has been successfully completed.
  * @retval MFS_ERR_NOT_FOUND if the specified id does not exists.
  * @retval MFS_ERR_CRC  if retrieved data has a CRC error.
+ * @retval MFS_ERR_INV_STATE if the storage is not mounted.
+ * @retval MFS_ERR_INV_SIZE if the buffer is smaller than the record.
+ * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
+ *                      failures.
  *
  * @api
  */
 mfs_error_t mfsReadRecord(MFSDriver *devp, uint32_t id,
                           uint32_t *np, uint8_t *buffer) {
+  flash_offset_t offset;
+  uint32_t size;
 
-  (void)devp;
-  (void)id;
-  (void)np;
-  (void)buffer;
+  osalDbgCheck((devp != NULL) && (id < (uint32_t)MFS_CFG_MAX_RECORDS) &&
+               (np != NULL) && (buffer != NULL));
+
+  if (devp->state != MFS_MOUNTED) {
+    return MFS_ERR_INV_STATE;
+  }
+
+  offset = devp->instances[id];
+  if (offset == 0U) {
+    return MFS_ERR_NOT_FOUND;
+  }
+
+  /* Reading the header.*/
+  RET_ON_ERROR(mfs_flash_read(devp, offset, sizeof (mfs_data_header_t),
+                              devp->buffer.data));
+  size = devp->buffer.dhdr.size;
+  if (size > *np) {
+    return MFS_ERR_INV_SIZE;
+  }
+
+  /* Reading and checking the data.*/
+  RET_ON_ERROR(mfs_flash_read(devp, offset + sizeof (mfs_data_header_t),
+                              size, buffer));
+  if (crc16(CRC16_INIT, buffer, size) != devp->buffer.dhdr.crc) {
+    return MFS_ERR_CRC;
+  }
+  *np = size;
 
   return MFS_NO_ERROR;
 }
 
 /**
  * @brief   Creates or updates a data record.
+ * @details A new instance of the record is appended to the current bank,
+ *          a garbage collection is performed if there is not enough free
+ *          space. The previous instance remains valid until the new one
+ *          has been written.
  *
  * @param[in] devp      pointer to the @p MFSDriver object
  * @param[in] id        record numeric identifier
@@ -617,38 +1070,151 @@ mfs_error_t mfsReadRecord(MFSDriver *devp, uint32_t id,
  * @param[in] buffer    pointer to a buffer for record data
  * @return              The operation status.
  * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_WARN_GC  if the operation triggered a garbage collection.
+ * @retval MFS_ERR_INV_STATE if the storage is not mounted.
+ * @retval MFS_ERR_OUT_OF_MEM if the record does not fit in the storage.
  * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
- *                      failures.
+ *                      failures, the storage must be mounted again.
  *
  * @api
  */
 mfs_error_t mfsWriteRecord(MFSDriver *devp, uint32_t id,
                            uint32_t n, const uint8_t *buffer) {
+  mfs_error_t err, warning = MFS_NO_ERROR;
+  mfs_data_header_t header;
+  uint32_t space, oldspace = 0U;
 
-  (void)devp;
-  (void)id;
-  (void)n;
-  (void)buffer;
+  osalDbgCheck((devp != NULL) && (id < (uint32_t)MFS_CFG_MAX_RECORDS) &&
+               (n > 0U) && (buffer != NULL));
 
-  return MFS_NO_ERROR;
+  if (devp->state != MFS_MOUNTED) {
+    return MFS_ERR_INV_STATE;
+  }
+
+  if (n > devp->banks_size) {
+    return MFS_ERR_OUT_OF_MEM;
+  }
+  space = MFS_RECORD_SPACE(n);
+
+  if (devp->instances[id] != 0U) {
+    RET_ON_ERROR(mfs_record_space(devp, devp->instances[id], &oldspace));
+  }
+
+  /* Checking for free space at the end of the bank.*/
+  if (space > devp->banks_size - (devp->next_offset -
+                                  mfs_bank_get_offset(devp,
+                                                      devp->current_bank))) {
+
+    /* The old instance is still accounted because it is copied, the new
+       instance must fit in the remaining space.*/
+    if (space > devp->banks_size - devp->used_space) {
+      return MFS_ERR_OUT_OF_MEM;
+    }
+
+    err = mfs_garbage_collect(devp);
+    if (err != MFS_NO_ERROR) {
+      devp->state = MFS_READY;
+      return err;
+    }
+    warning = MFS_WARN_GC;
+  }
+
+  /* Writing the header then the data, an interrupted write leaves a
+     damaged record that is discarded on the next mount.*/
+  header.magic = MFS_HEADER_MAGIC;
+  header.crc   = crc16(CRC16_INIT, buffer, n);
+  header.id    = (uint16_t)id;
+  header.flags = 0U;
+  header.size  = n;
+  err = mfs_flash_write(devp, devp->next_offset,
+                        sizeof (mfs_data_header_t), (const uint8_t *)&header);
+  if (err == MFS_NO_ERROR) {
+    err = mfs_flash_write(devp,
+                          devp->next_offset + sizeof (mfs_data_header_t),
+                          n, buffer);
+  }
+  if (err != MFS_NO_ERROR) {
+    devp->state = MFS_READY;
+    return err;
+  }
+
+  /* Updating the index.*/
+  devp->instances[id] = devp->next_offset;
+  devp->used_space   += space - oldspace;
+  devp->next_offset  += space;
+
+  return warning;
 }
 
 /**
  * @brief   Erases a data record.
+ * @details An erasure instance of the record is appended to the current
+ *          bank, if there is no space for it then the record is simply
+ *          left out of a garbage collection.
  *
  * @param[in] devp      pointer to the @p MFSDriver object
  * @param[in] id        record numeric identifier
  * @return              The operation status.
  * @retval MFS_NO_ERROR if the operation has been successfully completed.
+ * @retval MFS_WARN_GC  if the operation triggered a garbage collection.
+ * @retval MFS_ERR_NOT_FOUND if the specified id does not exists.
+ * @retval MFS_ERR_INV_STATE if the storage is not mounted.
  * @retval MFS_ERR_FLASH_FAILURE if the flash memory is unusable because HW
- *                      failures.
+ *                      failures, the storage must be mounted again.
  *
  * @api
  */
 mfs_error_t mfsEraseRecord(MFSDriver *devp, uint32_t id) {
+  mfs_error_t err;
+  mfs_data_header_t header;
+  uint32_t space, oldspace;
+
+  osalDbgCheck((devp != NULL) && (id < (uint32_t)MFS_CFG_MAX_RECORDS));
+
+  if (devp->state != MFS_MOUNTED) {
+    return MFS_ERR_INV_STATE;
+  }
+
+  if (devp->instances[id] == 0U) {
+    return MFS_ERR_NOT_FOUND;
+  }
+  RET_ON_ERROR(mfs_record_space(devp, devp->instances[id], &oldspace));
+  space = MFS_RECORD_SPACE(0U);
+
+  /* Checking for free space at the end of the bank.*/
+  if (space > devp->banks_size - (devp->next_offset -
+                                  mfs_bank_get_offset(devp,
+                                                      devp->current_bank))) {
+
+    /* Removing the record from the index, it is not copied.*/
+    devp->instances[id] = 0U;
+    devp->used_space   -= oldspace;
+
+    err = mfs_garbage_collect(devp);
+    if (err != MFS_NO_ERROR) {
+      devp->state = MFS_READY;
+      return err;
+    }
+    return MFS_WARN_GC;
+  }
+
+  /* Writing a zero size instance.*/
+  header.magic = MFS_HEADER_MAGIC;
+  header.crc   = 0xFFFFU;
+  header.id    = (uint16_t)id;
+  header.flags = 0U;
+  header.size  = 0U;
+  err = mfs_flash_write(devp, devp->next_offset,
+                        sizeof (mfs_data_header_t), (const uint8_t *)&header);
+  if (err != MFS_NO_ERROR) {
+    devp->state = MFS_READY;
+    return err;
+  }
 
-  (void)devp;
-  (void)id;
+  /* Updating the index.*/
+  devp->instances[id] = 0U;
+  devp->used_space   -= oldspace;
+  devp->next_offset  += space;
 
   return MFS_NO_ERROR;
 }
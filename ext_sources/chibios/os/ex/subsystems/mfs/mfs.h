@@ -66,6 +66,27 @@
 #if !defined(MFS_CFG_WRITE_VERIFY) || defined(__DOXYGEN__)
 #define MFS_CFG_WRITE_VERIFY                TRUE
 #endif
+
+/**
+ * @brief   Size of the internal buffer.
+ * @details The buffer is used for verifying, copying and checking the
+ *          erased state of flash areas, a larger buffer means less flash
+ *          accesses.
+ * @note    It must be a power of two and it cannot be less than 32.
+ */
+#if !defined(MFS_CFG_BUFFER_SIZE) || defined(__DOXYGEN__)
+#define MFS_CFG_BUFFER_SIZE                 32
+#endif
+
+/**
+ * @brief   Alignment of the records in flash.
+ * @details Each record starts at an offset multiple of this value, it
+ *          should be the minimum programmable unit of the flash device.
+ * @note    It must be a power of two.
+ */
+#if !defined(MFS_CFG_MEMORY_ALIGNMENT) || defined(__DOXYGEN__)
+#define MFS_CFG_MEMORY_ALIGNMENT            4
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -80,6 +101,16 @@
 #error "invalid MFS_MAX_REPAIR_ATTEMPTS value"
 #endif
 
+#if (MFS_CFG_BUFFER_SIZE < 32) ||                                           \
+    ((MFS_CFG_BUFFER_SIZE & (MFS_CFG_BUFFER_SIZE - 1)) != 0)
+#error "invalid MFS_CFG_BUFFER_SIZE value"
+#endif
+
+#if (MFS_CFG_MEMORY_ALIGNMENT < 1) ||                                       \
+    ((MFS_CFG_MEMORY_ALIGNMENT & (MFS_CFG_MEMORY_ALIGNMENT - 1)) != 0)
+#error "invalid MFS_CFG_MEMORY_ALIGNMENT value"
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -115,7 +146,10 @@ typedef enum {
   MFS_ERR_NOT_FOUND = -1,
   MFS_ERR_CRC = -2,
   MFS_ERR_FLASH_FAILURE = -3,
-  MFS_ERR_INTERNAL = -4
+  MFS_ERR_INTERNAL = -4,
+  MFS_ERR_INV_STATE = -5,
+  MFS_ERR_INV_SIZE = -6,
+  MFS_ERR_OUT_OF_MEM = -7
 } mfs_error_t;
 
 /**
@@ -150,6 +184,7 @@ typedef struct {
   uint32_t                  counter;
   /**
    * @brief   First data element.
+   * @details Offset of the first record from the bank start.
    */
   flash_offset_t            next;
   /**
@@ -161,6 +196,8 @@ typedef struct {
 /**
  * @brief   Type of a data block header.
  * @details This structure is placed before each written data block.
+ * @note    A header with @p size equal to zero marks the erasure of the
+ *          record.
  */
 typedef struct {
   /**
@@ -229,6 +266,10 @@ typedef struct {
    * @brief   Bank currently in use.
    */
   mfs_bank_t                current_bank;
+  /**
+   * @brief   Usage counter of the current bank.
+   */
+  uint32_t                  current_counter;
   /**
    * @brief   Size in bytes of banks.
    */
@@ -246,6 +287,14 @@ typedef struct {
    * @note    Zero means that ther is not a record with that id.
    */
   flash_offset_t            instances[MFS_CFG_MAX_RECORDS];
+  /**
+   * @brief   Transient buffer.
+   */
+  union {
+    mfs_data_header_t       dhdr;
+    mfs_bank_header_t       bhdr;
+    uint8_t                 data[MFS_CFG_BUFFER_SIZE];
+  } buffer;
 } MFSDriver;
 
 /*===========================================================================*/
@@ -1,4 +1,5 @@
 # List of all the MFS subsystem files.
+# The CRC helpers in os/hal/lib/crc/crc.mk are required.
 MFSSRC := $(CHIBIOS)/os/ex/subsystems/mfs/mfs.c
 
 # Required include directories
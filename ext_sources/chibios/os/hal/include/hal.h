@@ -102,6 +102,10 @@
 #define HAL_USE_USB                         FALSE
 #endif
 
+#if !defined(HAL_USE_USB_MSD)
+#define HAL_USE_USB_MSD                     FALSE
+#endif
+
 #if !defined(HAL_USE_WDG)
 #define HAL_USE_WDG                         FALSE
 #endif
@@ -152,6 +156,7 @@
 /* Complex drivers.*/
 #include "hal_mmc_spi.h"
 #include "hal_serial_usb.h"
+#include "hal_usb_msd.h"
 
 /* Community drivers.*/
 #if defined(HAL_USE_COMMUNITY) || defined(__DOXYGEN__)
@@ -84,6 +84,7 @@
 #define MMCSD_CMD_READ_SINGLE_BLOCK     17U
 #define MMCSD_CMD_READ_MULTIPLE_BLOCK   18U
 #define MMCSD_CMD_SET_BLOCK_COUNT       23U
+#define MMCSD_CMD_SET_WR_BLK_ERASE_COUNT 23U
 #define MMCSD_CMD_WRITE_BLOCK           24U
 #define MMCSD_CMD_WRITE_MULTIPLE_BLOCK  25U
 #define MMCSD_CMD_ERASE_RW_BLK_START    32U
@@ -92,6 +92,17 @@
 #if !defined(SDC_NICE_WAITING) || defined(__DOXYGEN__)
 #define SDC_NICE_WAITING                    TRUE
 #endif
+
+/**
+ * @brief   Pre-erase before multiple blocks writes.
+ * @details If enabled the number of blocks is sent to SD cards using
+ *          ACMD23 before each multiple blocks write, the card can erase
+ *          the blocks in advance and the busy time after the write is
+ *          reduced.
+ */
+#if !defined(SDC_WRITE_PRE_ERASE) || defined(__DOXYGEN__)
+#define SDC_WRITE_PRE_ERASE                 TRUE
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -184,6 +195,7 @@ extern "C" {
   bool sdcGetInfo(SDCDriver *sdcp, BlockDeviceInfo *bdip);
   bool sdcErase(SDCDriver *sdcp, uint32_t startblk, uint32_t endblk);
   bool _sdc_wait_for_transfer_state(SDCDriver *sdcp);
+  bool _sdc_pre_erase(SDCDriver *sdcp, uint32_t n);
 #ifdef __cplusplus
 }
 #endif
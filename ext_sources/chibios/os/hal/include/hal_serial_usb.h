@@ -177,6 +177,12 @@ extern "C" {
   void sduObjectInit(SerialUSBDriver *sdup);
   void sduStart(SerialUSBDriver *sdup, const SerialUSBConfig *config);
   void sduStop(SerialUSBDriver *sdup);
+  uint8_t *sduGetEmptyBufferTimeout(SerialUSBDriver *sdup, size_t *sizep,
+                                    systime_t timeout);
+  void sduPostFullBuffer(SerialUSBDriver *sdup, size_t size);
+  uint8_t *sduGetFullBufferTimeout(SerialUSBDriver *sdup, size_t *sizep,
+                                   systime_t timeout);
+  void sduReleaseEmptyBuffer(SerialUSBDriver *sdup);
   void sduSuspendHookI(SerialUSBDriver *sdup);
   void sduWakeupHookI(SerialUSBDriver *sdup);
   void sduConfigureHookI(SerialUSBDriver *sdup);
@@ -0,0 +1,283 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_usb_msd.h
+ * @brief   USB Mass Storage Driver macros and structures.
+ *
+ * @addtogroup USB_MSD
+ * @{
+ */
+
+#ifndef HAL_USB_MSD_H
+#define HAL_USB_MSD_H
+
+#if (HAL_USE_USB_MSD == TRUE) || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    MSD event flags
+ * @{
+ */
+/**
+ * @brief   The host ejected the medium, it has been detached.
+ */
+#define MSD_EJECTED                 (eventflags_t)1
+/**
+ * @brief   The USB link has been reset or suspended.
+ */
+#define MSD_DISCONNECTED            (eventflags_t)2
+/** @} */
+
+/**
+ * @name    Bulk-Only Transport wrappers sizes
+ * @{
+ */
+#define MSD_CBW_SIZE                31U
+#define MSD_CSW_SIZE                13U
+/** @} */
+
+/**
+ * @brief   Size of the medium blocks.
+ */
+#define MSD_BLOCK_SIZE              512U
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    USB_MSD configuration options
+ * @{
+ */
+/**
+ * @brief   Number of blocks in each of the two transfer buffers.
+ * @details Reads and writes are split in transfers of this size, while a
+ *          buffer is moved on the USB endpoint the other one is moved
+ *          from or to the medium.
+ * @note    The default is 8 blocks.
+ */
+#if !defined(USB_MSD_BUFFER_BLOCKS) || defined(__DOXYGEN__)
+#define USB_MSD_BUFFER_BLOCKS       8
+#endif
+
+/**
+ * @brief   Stack size of the protocol thread.
+ */
+#if !defined(USB_MSD_THREAD_STACK_SIZE) || defined(__DOXYGEN__)
+#define USB_MSD_THREAD_STACK_SIZE   512
+#endif
+
+/**
+ * @brief   Priority of the protocol thread.
+ */
+#if !defined(USB_MSD_THREAD_PRIO) || defined(__DOXYGEN__)
+#define USB_MSD_THREAD_PRIO         NORMALPRIO
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if HAL_USE_USB == FALSE
+#error "USB Mass Storage Driver requires HAL_USE_USB"
+#endif
+
+#if !defined(_CHIBIOS_RT_)
+#error "USB Mass Storage Driver requires ChibiOS/RT"
+#endif
+
+#if USB_MSD_BUFFER_BLOCKS < 1
+#error "invalid USB_MSD_BUFFER_BLOCKS value"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Driver state machine possible states.
+ */
+typedef enum {
+  MSD_UNINIT = 0,                   /**< Not initialized.                   */
+  MSD_STOP = 1,                     /**< Stopped.                           */
+  MSD_READY = 2                     /**< Ready.                             */
+} msdstate_t;
+
+/**
+ * @brief   USB Mass Storage Driver configuration structure.
+ * @details An instance of this structure must be passed to @p msdStart()
+ *          in order to configure and start the driver operations.
+ */
+typedef struct {
+  /**
+   * @brief   USB driver to use.
+   */
+  USBDriver                 *usbp;
+  /**
+   * @brief   Bulk IN endpoint used for outgoing data transfer.
+   */
+  usbep_t                   bulk_in;
+  /**
+   * @brief   Bulk OUT endpoint used for incoming data transfer.
+   */
+  usbep_t                   bulk_out;
+  /**
+   * @brief   Number of the mass storage interface.
+   */
+  uint8_t                   interface;
+  /**
+   * @brief   SCSI vendor identification, 8 characters.
+   */
+  const char                *vendor;
+  /**
+   * @brief   SCSI product identification, 16 characters.
+   */
+  const char                *product;
+} USBMassStorageConfig;
+
+/**
+ * @brief   Structure representing an USB mass storage driver.
+ */
+typedef struct {
+  /**
+   * @brief   Driver state.
+   */
+  msdstate_t                state;
+  /**
+   * @brief   Current configuration data.
+   */
+  const USBMassStorageConfig *config;
+  /**
+   * @brief   Driver events source.
+   */
+  event_source_t            event;
+  /**
+   * @brief   Attached medium or @p NULL.
+   */
+  BaseBlockDevice           *bbdp;
+  /**
+   * @brief   Number of blocks of the attached medium.
+   */
+  uint32_t                  blocks;
+  /**
+   * @brief   Medium lock, held while a command is executed.
+   */
+  mutex_t                   mtx;
+  /**
+   * @brief   Protocol thread while waiting for the USB.
+   */
+  thread_reference_t        wait;
+  /**
+   * @brief   A Bulk-Only Mass Storage Reset has been requested.
+   */
+  bool                      reset;
+  /**
+   * @brief   The medium changed since the last command.
+   */
+  bool                      changed;
+  /**
+   * @brief   Sense data of the last failed command.
+   */
+  uint8_t                   sense_key;
+  uint8_t                   asc;
+  /**
+   * @brief   First block of the read-ahead buffer.
+   */
+  uint32_t                  ra_lba;
+  /**
+   * @brief   Number of blocks in the read-ahead buffer, zero if none.
+   */
+  uint32_t                  ra_count;
+  /**
+   * @brief   Index of the read-ahead buffer.
+   */
+  unsigned                  ra_buf;
+  /**
+   * @brief   Buffer of the pending OUT transfer.
+   */
+  uint8_t                   *rxbuf;
+  /**
+   * @brief   Command Block Wrapper.
+   */
+  uint8_t                   cbw[MSD_CBW_SIZE + 1U];
+  /**
+   * @brief   Command Status Wrapper.
+   */
+  uint8_t                   csw[MSD_CSW_SIZE + 3U];
+  /**
+   * @brief   Buffer of the short command responses.
+   */
+  uint8_t                   resp[36];
+  /**
+   * @brief   Transfer buffers.
+   */
+  uint32_t                  buf[2][USB_MSD_BUFFER_BLOCKS * MSD_BLOCK_SIZE /
+                                   sizeof (uint32_t)];
+  /**
+   * @brief   Pointer to the protocol thread.
+   */
+  thread_t                  *tp;
+  /**
+   * @brief   Working area of the protocol thread.
+   */
+  THD_WORKING_AREA(wa, USB_MSD_THREAD_STACK_SIZE);
+} USBMassStorageDriver;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the driver events source.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ *
+ * @api
+ */
+#define msdGetEventSource(msdp) (&(msdp)->event)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void msdInit(void);
+  void msdObjectInit(USBMassStorageDriver *msdp);
+  void msdStart(USBMassStorageDriver *msdp, const USBMassStorageConfig *config);
+  void msdStop(USBMassStorageDriver *msdp);
+  void msdAttachMedium(USBMassStorageDriver *msdp, BaseBlockDevice *bbdp);
+  void msdDetachMedium(USBMassStorageDriver *msdp);
+  void msdSuspendHookI(USBMassStorageDriver *msdp);
+  void msdConfigureHookI(USBMassStorageDriver *msdp);
+  bool msdRequestsHook(USBMassStorageDriver *msdp, USBDriver *usbp);
+  void msdDataTransmitted(USBDriver *usbp, usbep_t ep);
+  void msdDataReceived(USBDriver *usbp, usbep_t ep);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_USB_MSD == TRUE */
+
+#endif /* HAL_USB_MSD_H */
+
+/** @} */
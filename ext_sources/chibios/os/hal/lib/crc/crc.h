@@ -0,0 +1,122 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    crc.h
+ * @brief   CRC helpers macros and structures.
+ *
+ * @addtogroup crc
+ * @{
+ */
+
+#ifndef CRC_H
+#define CRC_H
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Initial value of a CRC16-CCITT calculation.
+ */
+#define CRC16_INIT                          0xFFFFU
+
+/**
+ * @brief   Initial value of a CRC32 calculation.
+ */
+#define CRC32_INIT                          0U
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Configuration options
+ * @{
+ */
+/**
+ * @brief   Bytes processed per step by the software implementation.
+ * @details Allowed values are 1, 4 and 8, the tables size is 512 bytes
+ *          for the CRC16 and 1kB for the CRC32 per processed byte.
+ */
+#if !defined(CRC_CFG_SLICING) || defined(__DOXYGEN__)
+#define CRC_CFG_SLICING                     4
+#endif
+
+/**
+ * @brief   Use of the hardware CRC unit.
+ * @details Enabled by default if the platform has a programmable CRC unit
+ *          and a driver for it.
+ */
+#if !defined(CRC_USE_HARDWARE) || defined(__DOXYGEN__)
+#if (defined(STM32_HAS_CRC) && (STM32_HAS_CRC == TRUE) &&                   \
+     (STM32_CRC_PROGRAMMABLE == TRUE) && (STM32_ADVANCED_DMA == TRUE)) ||   \
+    defined(__DOXYGEN__)
+#define CRC_USE_HARDWARE                    TRUE
+#else
+#define CRC_USE_HARDWARE                    FALSE
+#endif
+#endif
+
+/**
+ * @brief   Minimum block size processed by the hardware unit.
+ * @details Smaller blocks are processed in software, locking the unit
+ *          costs more than the calculation.
+ */
+#if !defined(CRC_HW_THRESHOLD) || defined(__DOXYGEN__)
+#define CRC_HW_THRESHOLD                    32
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if (CRC_CFG_SLICING != 1) && (CRC_CFG_SLICING != 4) &&                     \
+    (CRC_CFG_SLICING != 8)
+#error "CRC_CFG_SLICING must be 1, 4 or 8"
+#endif
+
+#if CRC_USE_HARDWARE == TRUE
+#include "stm32_crc.h"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  uint16_t crc16X(uint16_t crc, const void *data, size_t n);
+  uint32_t crc32X(uint32_t crc, const void *data, size_t n);
+  uint16_t crc16(uint16_t crc, const void *data, size_t n);
+  uint32_t crc32(uint32_t crc, const void *data, size_t n);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC_H */
+
+/** @} */
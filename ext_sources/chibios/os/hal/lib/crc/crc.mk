@@ -0,0 +1,4 @@
+# CRC helpers files.
+CRCSRC = $(CHIBIOS)/os/hal/lib/crc/crc.c
+
+CRCINC = $(CHIBIOS)/os/hal/lib/crc
@@ -0,0 +1,256 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_ram_flash.c
+ * @brief   RAM flash emulation code.
+ * @details Flash device emulated in a RAM area, it allows to run the
+ *          flash based modules on hosts or on targets without a suitable
+ *          flash memory.
+ *
+ * @addtogroup HAL_RAM_FLASH
+ * @{
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "hal_ram_flash.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+static const flash_descriptor_t *ramflash_get_descriptor(void *instance);
+static flash_error_t ramflash_read(void *instance, flash_offset_t offset,
+                                   size_t n, uint8_t *rp);
+static flash_error_t ramflash_program(void *instance, flash_offset_t offset,
+                                      size_t n, const uint8_t *pp);
+static flash_error_t ramflash_start_erase_all(void *instance);
+static flash_error_t ramflash_start_erase_sector(void *instance,
+                                                 flash_sector_t sector);
+static flash_error_t ramflash_query_erase(void *instance, uint32_t *msec);
+static flash_error_t ramflash_verify_erase(void *instance,
+                                           flash_sector_t sector);
+
+/**
+ * @brief   Virtual methods table.
+ */
+static const struct RAMFlashDriverVMT ramflash_vmt = {
+  ramflash_get_descriptor, ramflash_read, ramflash_program,
+  ramflash_start_erase_all, ramflash_start_erase_sector,
+  ramflash_query_erase, ramflash_verify_erase
+};
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static size_t ramflash_size(RAMFlashDriver *devp) {
+
+  return (size_t)devp->config->sectors_count *
+         (size_t)devp->config->sectors_size;
+}
+
+static const flash_descriptor_t *ramflash_get_descriptor(void *instance) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+
+  osalDbgCheck(instance != NULL);
+  osalDbgAssert((devp->state != FLASH_UNINIT) && (devp->state != FLASH_STOP),
+                "invalid state");
+
+  return &devp->descriptor;
+}
+
+static flash_error_t ramflash_read(void *instance, flash_offset_t offset,
+                                   size_t n, uint8_t *rp) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+
+  osalDbgCheck((instance != NULL) && (rp != NULL) && (n > 0U));
+  osalDbgCheck((size_t)offset + n <= ramflash_size(devp));
+  osalDbgAssert(devp->state == FLASH_READY, "invalid state");
+
+  memcpy(rp, &devp->config->buffer[offset], n);
+
+  return FLASH_NO_ERROR;
+}
+
+static flash_error_t ramflash_program(void *instance, flash_offset_t offset,
+                                      size_t n, const uint8_t *pp) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+  uint8_t *p;
+
+  osalDbgCheck((instance != NULL) && (pp != NULL) && (n > 0U));
+  osalDbgCheck((size_t)offset + n <= ramflash_size(devp));
+  osalDbgAssert(devp->state == FLASH_READY, "invalid state");
+
+  /* Programming can only clear bits, the result is checked like a real
+     device would do.*/
+  p = &devp->config->buffer[offset];
+  while (n > 0U) {
+    if (devp->program_budget == 0U) {
+      return FLASH_ERROR_PROGRAM;
+    }
+    devp->program_budget--;
+
+    *p &= *pp;
+    if (*p != *pp) {
+      return FLASH_ERROR_PROGRAM;
+    }
+
+    p++;
+    pp++;
+    n--;
+  }
+
+  return FLASH_NO_ERROR;
+}
+
+static flash_error_t ramflash_start_erase_all(void *instance) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+
+  osalDbgCheck(instance != NULL);
+  osalDbgAssert(devp->state == FLASH_READY, "invalid state");
+
+  /* The erase is immediate.*/
+  memset(devp->config->buffer, 0xFF, ramflash_size(devp));
+
+  return FLASH_NO_ERROR;
+}
+
+static flash_error_t ramflash_start_erase_sector(void *instance,
+                                                 flash_sector_t sector) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+
+  osalDbgCheck(instance != NULL);
+  osalDbgCheck(sector < devp->config->sectors_count);
+  osalDbgAssert(devp->state == FLASH_READY, "invalid state");
+
+  /* The erase is immediate.*/
+  memset(&devp->config->buffer[sector * devp->config->sectors_size], 0xFF,
+         devp->config->sectors_size);
+
+  return FLASH_NO_ERROR;
+}
+
+static flash_error_t ramflash_query_erase(void *instance, uint32_t *msec) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+
+  osalDbgCheck(instance != NULL);
+  osalDbgAssert(devp->state == FLASH_READY, "invalid state");
+
+  if (msec != NULL) {
+    *msec = 0U;
+  }
+
+  return FLASH_NO_ERROR;
+}
+
+static flash_error_t ramflash_verify_erase(void *instance,
+                                           flash_sector_t sector) {
+  RAMFlashDriver *devp = (RAMFlashDriver *)instance;
+  const uint8_t *p, *end;
+
+  osalDbgCheck(instance != NULL);
+  osalDbgCheck(sector < devp->config->sectors_count);
+  osalDbgAssert(devp->state == FLASH_READY, "invalid state");
+
+  p   = &devp->config->buffer[sector * devp->config->sectors_size];
+  end = p + devp->config->sectors_size;
+  while (p < end) {
+    if (*p != 0xFFU) {
+      return FLASH_ERROR_VERIFY;
+    }
+    p++;
+  }
+
+  return FLASH_NO_ERROR;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes an instance.
+ *
+ * @param[out] devp     pointer to the @p RAMFlashDriver object
+ *
+ * @init
+ */
+void ramflashObjectInit(RAMFlashDriver *devp) {
+
+  osalDbgCheck(devp != NULL);
+
+  devp->vmt    = &ramflash_vmt;
+  devp->state  = FLASH_STOP;
+  devp->config = NULL;
+}
+
+/**
+ * @brief   Configures and activates a RAM flash driver.
+ * @note    The RAM area is not initialized, its content is retained
+ *          across stop and start like a real flash.
+ *
+ * @param[in] devp      pointer to the @p RAMFlashDriver object
+ * @param[in] config    pointer to the configuration
+ *
+ * @api
+ */
+void ramflashStart(RAMFlashDriver *devp, const RAMFlashConfig *config) {
+
+  osalDbgCheck((devp != NULL) && (config != NULL) &&
+               (config->buffer != NULL));
+  osalDbgAssert(devp->state != FLASH_UNINIT, "invalid state");
+
+  devp->config = config;
+
+  if (devp->state == FLASH_STOP) {
+    devp->descriptor.attributes    = FLASH_ATTR_ERASED_IS_ONE;
+    devp->descriptor.page_size     = config->page_size;
+    devp->descriptor.sectors_count = config->sectors_count;
+    devp->descriptor.sectors       = NULL;
+    devp->descriptor.sectors_size  = config->sectors_size;
+    devp->descriptor.address       = 0U;
+    devp->program_budget           = UINT32_MAX;
+    devp->state                    = FLASH_READY;
+  }
+}
+
+/**
+ * @brief   Deactivates a RAM flash driver.
+ *
+ * @param[in] devp      pointer to the @p RAMFlashDriver object
+ *
+ * @api
+ */
+void ramflashStop(RAMFlashDriver *devp) {
+
+  osalDbgCheck(devp != NULL);
+  osalDbgAssert(devp->state != FLASH_UNINIT, "invalid state");
+
+  devp->state = FLASH_STOP;
+}
+
+/** @} */
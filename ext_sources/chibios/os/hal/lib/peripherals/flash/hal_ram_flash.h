@@ -0,0 +1,147 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_ram_flash.h
+ * @brief   RAM flash emulation header.
+ *
+ * @addtogroup HAL_RAM_FLASH
+ * @{
+ */
+
+#ifndef HAL_RAM_FLASH_H
+#define HAL_RAM_FLASH_H
+
+#include "hal_flash.h"
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Type of a RAM flash configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief   RAM area emulating the flash array.
+   * @note    Its size must be @p sectors_count multiplied by
+   *          @p sectors_size.
+   */
+  uint8_t                   *buffer;
+  /**
+   * @brief   Number of emulated sectors.
+   */
+  flash_sector_t            sectors_count;
+  /**
+   * @brief   Size of the emulated sectors.
+   */
+  uint32_t                  sectors_size;
+  /**
+   * @brief   Size of the emulated write pages.
+   */
+  uint32_t                  page_size;
+} RAMFlashConfig;
+
+/**
+ * @brief   @p RAMFlashDriver specific methods.
+ */
+#define _ram_flash_methods                                                  \
+  _base_flash_methods
+
+/**
+ * @extends BaseFlashVMT
+ *
+ * @brief   @p RAMFlashDriver virtual methods table.
+ */
+struct RAMFlashDriverVMT {
+  _ram_flash_methods
+};
+
+/**
+ * @extends BaseFlash
+ *
+ * @brief   Type of RAM flash class.
+ * @details The flash array is emulated in RAM with the programming rules
+ *          of a NOR flash: erasing sets all bits to one, programming can
+ *          only clear bits and a program operation failing to produce the
+ *          requested data is reported as an error.
+ */
+typedef struct {
+  /**
+   * @brief   RAMFlashDriver Virtual Methods Table.
+   */
+  const struct RAMFlashDriverVMT *vmt;
+  _base_flash_data
+  /**
+   * @brief   Current configuration data.
+   */
+  const RAMFlashConfig      *config;
+  /**
+   * @brief   Device descriptor.
+   */
+  flash_descriptor_t        descriptor;
+  /**
+   * @brief   Remaining bytes that can be programmed.
+   * @details When it reaches zero the program operations fail leaving
+   *          the remaining bytes unchanged, this emulates a power loss.
+   * @note    It is set to @p UINT32_MAX on start.
+   */
+  uint32_t                  program_budget;
+} RAMFlashDriver;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Emulates a power loss after the specified number of bytes.
+ *
+ * @param[in] devp      pointer to the @p RAMFlashDriver object
+ * @param[in] n         number of bytes that can still be programmed
+ *
+ * @api
+ */
+#define ramflashSetProgramBudget(devp, n) ((devp)->program_budget = (n))
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void ramflashObjectInit(RAMFlashDriver *devp);
+  void ramflashStart(RAMFlashDriver *devp, const RAMFlashConfig *config);
+  void ramflashStop(RAMFlashDriver *devp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_RAM_FLASH_H */
+
+/** @} */
@@ -27,12 +27,24 @@
  * @{
  */
 
+#include <limits.h>
+
 #include "hal.h"
 #include "chprintf.h"
 #include "memstreams.h"
 
 #define MAX_FILLER 11
 #define FLOAT_PRECISION 9
+#define FIXED_PRECISION 4
+#define FIXED_MAX_FBITS 16
+
+/* Conversion flags.*/
+#define SPEC_LEFT_ALIGN     1U
+#define SPEC_ZERO_FILL      2U
+#define SPEC_LONG           4U
+#define SPEC_WIDTH_ARG      8U
+#define SPEC_PRECISION_ARG  16U
+#define SPEC_PRECISION      32U
 
 static char *long_to_string_with_divisor(char *p,
                                          long num,
@@ -72,6 +84,66 @@ static char *ch_ltoa(char *p, long num, unsigned radix) {
   return long_to_string_with_divisor(p, num, radix, 0);
 }
 
+/* Decimal digit pairs, two digits are produced by each division.*/
+static const char digit_pairs[200] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+/* Powers of ten used for counting the digits.*/
+static const unsigned long dec_pow10[] = {
+  1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+  100000000UL, 1000000000UL
+#if ULONG_MAX > 0xFFFFFFFFUL
+  , 10000000000UL, 100000000000UL, 1000000000000UL, 10000000000000UL,
+  100000000000000UL, 1000000000000000UL, 10000000000000000UL,
+  100000000000000000UL, 1000000000000000000UL, 10000000000000000000UL
+#endif
+};
+
+#define DEC_MAX_DIGITS  (int)(sizeof (dec_pow10) / sizeof (dec_pow10[0]))
+
+/* The digits are counted first then written backward in place, two at
+   time.*/
+static char *ulong_to_dec(char *p, unsigned long num, int mindigits) {
+  char *q;
+  unsigned d;
+  int n;
+
+  n = 1;
+  while ((n < DEC_MAX_DIGITS) && (num >= dec_pow10[n]))
+    n++;
+  if (n < mindigits)
+    n = mindigits;
+
+  q = p + n;
+  while (num >= 100UL) {
+    d = (unsigned)(num % 100UL) * 2U;
+    num /= 100UL;
+    *--q = digit_pairs[d + 1U];
+    *--q = digit_pairs[d];
+  }
+  if (num >= 10UL) {
+    d = (unsigned)num * 2U;
+    *--q = digit_pairs[d + 1U];
+    *--q = digit_pairs[d];
+  }
+  else {
+    *--q = (char)('0' + num);
+  }
+  while (q > p)
+    *--q = '0';
+
+  return p + n;
+}
+
 #if CHPRINTF_USE_FLOAT
 static const long pow10[FLOAT_PRECISION] = {
     10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
@@ -79,112 +151,181 @@ static const long pow10[FLOAT_PRECISION] = {
 
 static char *ftoa(char *p, double num, unsigned long precision) {
   long l;
+  int digits;
 
   if ((precision == 0) || (precision > FLOAT_PRECISION))
     precision = FLOAT_PRECISION;
+  digits = (int)precision;
   precision = pow10[precision - 1];
 
   l = (long)num;
-  p = long_to_string_with_divisor(p, l, 10, 0);
+  p = ulong_to_dec(p, (unsigned long)l, 1);
   *p++ = '.';
   l = (long)((num - l) * precision);
-  return long_to_string_with_divisor(p, l, 10, precision / 10);
+  return ulong_to_dec(p, (unsigned long)l, digits);
 }
 #endif
 
-/**
- * @brief   System formatted output function.
- * @details This function implements a minimal @p vprintf()-like functionality
- *          with output on a @p BaseSequentialStream.
- *          The general parameters format is: %[-][width|*][.precision|*][l|L]p.
- *          The following parameter types (p) are supported:
- *          - <b>x</b> hexadecimal integer.
- *          - <b>X</b> hexadecimal long.
- *          - <b>o</b> octal integer.
- *          - <b>O</b> octal long.
- *          - <b>d</b> decimal signed integer.
- *          - <b>D</b> decimal signed long.
- *          - <b>u</b> decimal unsigned integer.
- *          - <b>U</b> decimal unsigned long.
- *          - <b>c</b> character.
- *          - <b>s</b> string.
- *          .
- *
- * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
- * @param[in] fmt       formatting string
- * @param[in] ap        list of parameters
- * @return              The number of bytes that would have been
- *                      written to @p chp if no stream error occurs
- *
- * @api
- */
-int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap) {
+#if CHPRINTF_USE_FIXED
+static const unsigned long fixed_pow10[FIXED_PRECISION] = {
+    10, 100, 1000, 10000
+};
+
+static char *qtoa(char *p, unsigned long num, unsigned fbits, int precision) {
+  unsigned long fp, scale;
+
+  osalDbgCheck(fbits <= FIXED_MAX_FBITS);
+
+  p = ulong_to_dec(p, num >> fbits, 1);
+  if (precision == 0)
+    return p;
+  if ((precision < 0) || (precision > FIXED_PRECISION))
+    precision = FIXED_PRECISION;
+  scale = fixed_pow10[precision - 1];
+
+  /* The fractional part is truncated like by ftoa(), it fits 32 bits
+     because both the fractional bits and the precision are limited.*/
+  fp = ((num & ((1UL << fbits) - 1UL)) * scale) >> fbits;
+  *p++ = '.';
+  return ulong_to_dec(p, fp, precision);
+}
+#endif
+
+/* Parses a conversion, fmt points after the '%' character, returns the
+   pointer to the first character not parsed.*/
+static const char *parse_spec(const char *fmt, chprintf_spec_t *sp) {
+  char c;
+
+  sp->width = 0;
+  sp->precision = 0;
+  sp->flags = 0U;
+  if (*fmt == '-') {
+    fmt++;
+    sp->flags |= SPEC_LEFT_ALIGN;
+  }
+  if (*fmt == '0') {
+    fmt++;
+    sp->flags |= SPEC_ZERO_FILL;
+  }
+  while (true) {
+    c = *fmt++;
+    if (c >= '0' && c <= '9')
+      sp->width = sp->width * 10 + (c - '0');
+    else if (c == '*')
+      sp->flags |= SPEC_WIDTH_ARG;
+    else
+      break;
+  }
+  if (c == '.') {
+    sp->flags |= SPEC_PRECISION;
+    while (true) {
+      c = *fmt++;
+      if (c >= '0' && c <= '9')
+        sp->precision = sp->precision * 10 + (c - '0');
+      else if (c == '*')
+        sp->flags |= SPEC_PRECISION_ARG;
+      else
+        break;
+    }
+  }
+  /* Long modifier.*/
+  if (c == 'l' || c == 'L') {
+    sp->flags |= SPEC_LONG;
+    if (*fmt)
+      c = *fmt++;
+  }
+  else if ((c >= 'A') && (c <= 'Z'))
+    sp->flags |= SPEC_LONG;
+
+  /* A truncated conversion terminates the format.*/
+  if (c == '\0')
+    fmt--;
+  sp->conv = c;
+  return fmt;
+}
+
+/* Buffered output, the characters are written to the stream in blocks.*/
+#define OUT_PUT(c) do {                                                     \
+  obuf[on++] = (uint8_t)(c);                                                \
+  if (on >= sizeof (obuf)) {                                                \
+    (void)streamWrite(chp, obuf, on);                                       \
+    on = 0U;                                                                \
+  }                                                                         \
+} while (false)
+
+/* Common formatting code, the specifications are either parsed from fmt
+   or taken from the precompiled format cfp.*/
+static int vprintf_common(BaseSequentialStream *chp, const char *fmt,
+                          const void *cfp, va_list ap) {
+  const chprintf_spec_t *sp;
+  chprintf_spec_t spec;
   char *p, *s, c, filler;
   int i, precision, width;
   int n = 0;
   bool is_long, left_align;
   long l;
+  uint8_t obuf[CHPRINTF_BUFFER_SIZE];
+  size_t on = 0U;
 #if CHPRINTF_USE_FLOAT
   float f;
+#endif
+#if CHPRINTF_USE_FLOAT || CHPRINTF_USE_FIXED
   char tmpbuf[2*MAX_FILLER + 1];
 #else
   char tmpbuf[MAX_FILLER + 1];
 #endif
+#if CHPRINTF_USE_FIXED
+  unsigned fbits;
+#endif
+#if CHPRINTF_USE_COMPILED
+  const chprintf_spec_t *end = NULL;
+
+  sp = NULL;
+  if (cfp != NULL) {
+    sp = &((const chprintf_format_t *)cfp)->specs[0];
+    end = sp + ((const chprintf_format_t *)cfp)->n;
+  }
+#else
+  (void)cfp;
+#endif
 
   while (true) {
-    c = *fmt++;
-    if (c == 0)
-      return n;
-    if (c != '%') {
-      streamPut(chp, (uint8_t)c);
-      n++;
-      continue;
-    }
-    p = tmpbuf;
-    s = tmpbuf;
-    left_align = FALSE;
-    if (*fmt == '-') {
-      fmt++;
-      left_align = TRUE;
-    }
-    filler = ' ';
-    if (*fmt == '0') {
-      fmt++;
-      filler = '0';
-    }
-    width = 0;
-    while (TRUE) {
-      c = *fmt++;
-      if (c >= '0' && c <= '9')
-        c -= '0';
-      else if (c == '*')
-        c = va_arg(ap, int);
-      else
+#if CHPRINTF_USE_COMPILED
+    if (cfp != NULL) {
+      /* Precompiled format, literal text then the conversion.*/
+      if (sp >= end)
+        break;
+      for (i = 0; i < (int)sp->litlen; i++)
+        OUT_PUT(sp->lit[i]);
+      n += (int)sp->litlen;
+      if (sp->conv == '\0')
         break;
-      width = width * 10 + c;
     }
-    precision = 0;
-    if (c == '.') {
-      while (TRUE) {
-        c = *fmt++;
-        if (c >= '0' && c <= '9')
-          c -= '0';
-        else if (c == '*')
-          c = va_arg(ap, int);
-        else
-          break;
-        precision *= 10;
-        precision += c;
+    else
+#endif
+    {
+      /* Literal text up to the next conversion.*/
+      while ((c = *fmt++) != '%') {
+        if (c == 0)
+          goto done;
+        OUT_PUT(c);
+        n++;
       }
+      fmt = parse_spec(fmt, &spec);
+      if (spec.conv == '\0')
+        break;
+      sp = &spec;
     }
-    /* Long modifier.*/
-    if (c == 'l' || c == 'L') {
-      is_long = TRUE;
-      if (*fmt)
-        c = *fmt++;
-    }
-    else
-      is_long = (c >= 'A') && (c <= 'Z');
+    p = tmpbuf;
+    s = tmpbuf;
+    left_align = (sp->flags & SPEC_LEFT_ALIGN) != 0U;
+    filler = (sp->flags & SPEC_ZERO_FILL) != 0U ? '0' : ' ';
+    is_long = (sp->flags & SPEC_LONG) != 0U;
+    width = (sp->flags & SPEC_WIDTH_ARG) != 0U ? va_arg(ap, int)
+                                               : sp->width;
+    precision = (sp->flags & SPEC_PRECISION_ARG) != 0U ? va_arg(ap, int)
+                                                       : sp->precision;
+    c = sp->conv;
 
     /* Command decoding.*/
     switch (c) {
@@ -213,7 +354,7 @@ int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap) {
         *p++ = '-';
         l = -l;
       }
-      p = ch_ltoa(p, l, 10);
+      p = ulong_to_dec(p, (unsigned long)l, 1);
       break;
 #if CHPRINTF_USE_FLOAT
     case 'f':
@@ -225,14 +366,36 @@ int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap) {
       p = ftoa(p, f, precision);
       break;
 #endif
+#if CHPRINTF_USE_FIXED
+    case 'Q':
+    case 'q':
+      fbits = va_arg(ap, unsigned);
+      if (is_long)
+        l = va_arg(ap, long);
+      else
+        l = va_arg(ap, int);
+      if (l < 0) {
+        *p++ = '-';
+        l = -l;
+      }
+      /* Without a precision the default one is used.*/
+      if ((sp->flags & SPEC_PRECISION) == 0U)
+        precision = -1;
+      p = qtoa(p, (unsigned long)l, fbits, precision);
+      break;
+#endif
+    case 'U':
+    case 'u':
+      if (is_long)
+        l = va_arg(ap, unsigned long);
+      else
+        l = va_arg(ap, unsigned int);
+      p = ulong_to_dec(p, (unsigned long)l, 1);
+      break;
     case 'X':
     case 'x':
       c = 16;
       goto unsigned_common;
-    case 'U':
-    case 'u':
-      c = 10;
-      goto unsigned_common;
     case 'O':
     case 'o':
       c = 8;
@@ -250,30 +413,108 @@ unsigned_common:
     i = (int)(p - s);
     if ((width -= i) < 0)
       width = 0;
-    if (left_align == FALSE)
+    if (left_align == false)
       width = -width;
     if (width < 0) {
       if (*s == '-' && filler == '0') {
-        streamPut(chp, (uint8_t)*s++);
+        OUT_PUT(*s++);
         n++;
         i--;
       }
       do {
-        streamPut(chp, (uint8_t)filler);
+        OUT_PUT(filler);
         n++;
       } while (++width != 0);
     }
     while (--i >= 0) {
-      streamPut(chp, (uint8_t)*s++);
+      OUT_PUT(*s++);
       n++;
     }
 
     while (width) {
-      streamPut(chp, (uint8_t)filler);
+      OUT_PUT(filler);
       n++;
       width--;
     }
+#if CHPRINTF_USE_COMPILED
+    if (cfp != NULL)
+      sp++;
+#endif
   }
+
+done:
+  if (on > 0U)
+    (void)streamWrite(chp, obuf, on);
+
+  return n;
+}
+
+/* Common code of the string formatting functions, either fmt or cfp is
+   used.*/
+static int ms_vprintf(char *str, size_t size, const char *fmt,
+                      const void *cfp, va_list ap) {
+  MemoryStream ms;
+  BaseSequentialStream *chp;
+  size_t size_wo_nul;
+  int retval;
+
+  if (size > 0)
+    size_wo_nul = size - 1;
+  else
+    size_wo_nul = 0;
+
+  /* Memory stream object to be used as a string writer, reserving one
+     byte for the final zero.*/
+  msObjectInit(&ms, (uint8_t *)str, size_wo_nul, 0);
+
+  /* Performing the print operation using the common code.*/
+  chp = (BaseSequentialStream *)(void *)&ms;
+  retval = vprintf_common(chp, fmt, cfp, ap);
+
+  /* Terminate with a zero, unless size==0.*/
+  if (ms.eos < size)
+      str[ms.eos] = 0;
+
+  /* Return number of bytes that would have been written.*/
+  return retval;
+}
+
+/**
+ * @brief   System formatted output function.
+ * @details This function implements a minimal @p vprintf()-like functionality
+ *          with output on a @p BaseSequentialStream.
+ *          The general parameters format is: %[-][width|*][.precision|*][l|L]p.
+ *          The following parameter types (p) are supported:
+ *          - <b>x</b> hexadecimal integer.
+ *          - <b>X</b> hexadecimal long.
+ *          - <b>o</b> octal integer.
+ *          - <b>O</b> octal long.
+ *          - <b>d</b> decimal signed integer.
+ *          - <b>D</b> decimal signed long.
+ *          - <b>u</b> decimal unsigned integer.
+ *          - <b>U</b> decimal unsigned long.
+ *          - <b>c</b> character.
+ *          - <b>s</b> string.
+ *          - <b>f</b> floating point, if @p CHPRINTF_USE_FLOAT is enabled.
+ *          - <b>q</b> fixed point integer, if @p CHPRINTF_USE_FIXED is
+ *            enabled. Two parameters are taken, the number of fractional
+ *            bits (up to 16) and the scaled value. The fraction is
+ *            truncated to the specified precision like with @p f (up to
+ *            4 digits, 4 if not specified, none if zero).
+ *          - <b>Q</b> fixed point long.
+ *          .
+ *
+ * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
+ * @param[in] fmt       formatting string
+ * @param[in] ap        list of parameters
+ * @return              The number of bytes that would have been
+ *                      written to @p chp if no stream error occurs
+ *
+ * @api
+ */
+int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap) {
+
+  return vprintf_common(chp, fmt, NULL, ap);
 }
 
 /**
@@ -292,6 +533,13 @@ unsigned_common:
  *          - <b>U</b> decimal unsigned long.
  *          - <b>c</b> character.
  *          - <b>s</b> string.
+ *          - <b>f</b> floating point, if @p CHPRINTF_USE_FLOAT is enabled.
+ *          - <b>q</b> fixed point integer, if @p CHPRINTF_USE_FIXED is
+ *            enabled. Two parameters are taken, the number of fractional
+ *            bits (up to 16) and the scaled value. The fraction is
+ *            truncated to the specified precision like with @p f (up to
+ *            4 digits, 4 if not specified, none if zero).
+ *          - <b>Q</b> fixed point long.
  *          .
  *
  * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
@@ -310,6 +558,27 @@ int chprintf(BaseSequentialStream *chp, const char *fmt, ...) {
   return formatted_bytes;
 }
 
+/**
+ * @brief   System formatted output function.
+ * @details This function implements a minimal @p vsnprintf()-like
+ *          functionality, the format is the same of @p chvprintf().
+ * @post    @p str is NUL-terminated, unless @p size is 0.
+ *
+ * @param[in] str       pointer to a buffer
+ * @param[in] size      maximum size of the buffer
+ * @param[in] fmt       formatting string
+ * @param[in] ap        list of parameters
+ * @return              The number of characters (excluding the
+ *                      terminating NUL byte) that would have been
+ *                      stored in @p str if there was room.
+ *
+ * @api
+ */
+int chvsnprintf(char *str, size_t size, const char *fmt, va_list ap) {
+
+  return ms_vprintf(str, size, fmt, NULL, ap);
+}
+
 /**
  * @brief   System formatted output function.
  * @details This function implements a minimal @p snprintf()-like functionality.
@@ -325,6 +594,13 @@ int chprintf(BaseSequentialStream *chp, const char *fmt, ...) {
  *          - <b>U</b> decimal unsigned long.
  *          - <b>c</b> character.
  *          - <b>s</b> string.
+ *          - <b>f</b> floating point, if @p CHPRINTF_USE_FLOAT is enabled.
+ *          - <b>q</b> fixed point integer, if @p CHPRINTF_USE_FIXED is
+ *            enabled. Two parameters are taken, the number of fractional
+ *            bits (up to 16) and the scaled value. The fraction is
+ *            truncated to the specified precision like with @p f (up to
+ *            4 digits, 4 if not specified, none if zero).
+ *          - <b>Q</b> fixed point long.
  *          .
  * @post    @p str is NUL-terminated, unless @p size is 0.
  *
@@ -339,32 +615,117 @@ int chprintf(BaseSequentialStream *chp, const char *fmt, ...) {
  */
 int chsnprintf(char *str, size_t size, const char *fmt, ...) {
   va_list ap;
-  MemoryStream ms;
-  BaseSequentialStream *chp;
-  size_t size_wo_nul;
   int retval;
 
-  if (size > 0)
-    size_wo_nul = size - 1;
-  else
-    size_wo_nul = 0;
+  va_start(ap, fmt);
+  retval = ms_vprintf(str, size, fmt, NULL, ap);
+  va_end(ap);
 
-  /* Memory stream object to be used as a string writer, reserving one
-     byte for the final zero.*/
-  msObjectInit(&ms, (uint8_t *)str, size_wo_nul, 0);
+  return retval;
+}
 
-  /* Performing the print operation using the common code.*/
-  chp = (BaseSequentialStream *)(void *)&ms;
-  va_start(ap, fmt);
-  retval = chvprintf(chp, fmt, ap);
+#if (CHPRINTF_USE_COMPILED == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Precompiles a formatting string.
+ * @details The formatting string is parsed once, the precompiled format
+ *          can then be used by @p chprintfCompiled() and
+ *          @p chsnprintfCompiled() without parsing it again.
+ * @note    The formatting string is not copied and must stay valid while
+ *          the precompiled format is in use.
+ *
+ * @param[out] cfp      pointer to a @p chprintf_format_t object
+ * @param[in] fmt       formatting string
+ * @return              The operation status.
+ * @retval false        if the string has more than @p CHPRINTF_MAX_SPECS
+ *                      conversions.
+ *
+ * @api
+ */
+bool chprintfCompile(chprintf_format_t *cfp, const char *fmt) {
+  chprintf_spec_t *sp = &cfp->specs[0];
+
+  while (true) {
+    sp->lit = fmt;
+    while ((*fmt != '\0') && (*fmt != '%'))
+      fmt++;
+    sp->litlen = (size_t)(fmt - sp->lit);
+    sp->conv = '\0';
+    if (*fmt == '\0')
+      break;
+    fmt = parse_spec(fmt + 1, sp);
+    if (sp->conv == '\0')
+      break;
+    if (++sp > &cfp->specs[CHPRINTF_MAX_SPECS])
+      return false;
+  }
+  cfp->n = (unsigned)(sp - &cfp->specs[0]) + 1U;
+
+  return true;
+}
+
+/**
+ * @brief   System formatted output function using a precompiled format.
+ *
+ * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
+ * @param[in] cfp       pointer to a precompiled format
+ * @param[in] ap        list of parameters
+ * @return              The number of bytes that would have been
+ *                      written to @p chp if no stream error occurs
+ *
+ * @api
+ */
+int chvprintfCompiled(BaseSequentialStream *chp,
+                      const chprintf_format_t *cfp, va_list ap) {
+
+  return vprintf_common(chp, NULL, cfp, ap);
+}
+
+/**
+ * @brief   System formatted output function using a precompiled format.
+ *
+ * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
+ * @param[in] cfp       pointer to a precompiled format
+ * @return              The number of bytes that would have been
+ *                      written to @p chp if no stream error occurs
+ *
+ * @api
+ */
+int chprintfCompiled(BaseSequentialStream *chp,
+                     const chprintf_format_t *cfp, ...) {
+  va_list ap;
+  int formatted_bytes;
+
+  va_start(ap, cfp);
+  formatted_bytes = chvprintfCompiled(chp, cfp, ap);
   va_end(ap);
 
-  /* Terminate with a zero, unless size==0.*/
-  if (ms.eos < size)
-      str[ms.eos] = 0;
+  return formatted_bytes;
+}
+
+/**
+ * @brief   String formatting function using a precompiled format.
+ * @post    @p str is NUL-terminated, unless @p size is 0.
+ *
+ * @param[in] str       pointer to a buffer
+ * @param[in] size      maximum size of the buffer
+ * @param[in] cfp       pointer to a precompiled format
+ * @return              The number of characters (excluding the
+ *                      terminating NUL byte) that would have been
+ *                      stored in @p str if there was room.
+ *
+ * @api
+ */
+int chsnprintfCompiled(char *str, size_t size,
+                       const chprintf_format_t *cfp, ...) {
+  va_list ap;
+  int retval;
+
+  va_start(ap, cfp);
+  retval = ms_vprintf(str, size, NULL, cfp, ap);
+  va_end(ap);
 
-  /* Return number of bytes that would have been written.*/
   return retval;
 }
+#endif /* CHPRINTF_USE_COMPILED == TRUE */
 
 /** @} */
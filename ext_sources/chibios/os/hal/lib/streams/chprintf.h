@@ -34,12 +34,106 @@
 #define CHPRINTF_USE_FLOAT          TRUE
 #endif
 
+/**
+ * @brief   Fixed point type support.
+ * @details If enabled the @p q conversion formats scaled integers without
+ *          any floating point operation.
+ */
+#if !defined(CHPRINTF_USE_FIXED) || defined(__DOXYGEN__)
+#define CHPRINTF_USE_FIXED          TRUE
+#endif
+
+/**
+ * @brief   Precompiled formats support.
+ * @details If enabled a formatting string can be parsed once by
+ *          @p chprintfCompile() and then used many times.
+ */
+#if !defined(CHPRINTF_USE_COMPILED) || defined(__DOXYGEN__)
+#define CHPRINTF_USE_COMPILED       TRUE
+#endif
+
+/**
+ * @brief   Size of the output buffer.
+ * @details The formatted characters are written to the stream in blocks of
+ *          this size, the buffer is allocated on the caller stack.
+ */
+#if !defined(CHPRINTF_BUFFER_SIZE) || defined(__DOXYGEN__)
+#define CHPRINTF_BUFFER_SIZE        32
+#endif
+
+/**
+ * @brief   Maximum number of conversions in a precompiled format.
+ * @note    The literal text after the last conversion takes one more
+ *          entry.
+ */
+#if !defined(CHPRINTF_MAX_SPECS) || defined(__DOXYGEN__)
+#define CHPRINTF_MAX_SPECS          12
+#endif
+
+/**
+ * @brief   Type of a parsed conversion specification.
+ */
+typedef struct {
+  /**
+   * @brief   Literal text preceding the conversion.
+   */
+  const char            *lit;
+  /**
+   * @brief   Length of the literal text.
+   */
+  size_t                litlen;
+  /**
+   * @brief   Field width.
+   */
+  int16_t               width;
+  /**
+   * @brief   Field precision.
+   */
+  int16_t               precision;
+  /**
+   * @brief   Conversion flags.
+   */
+  uint8_t               flags;
+  /**
+   * @brief   Conversion character, zero for the trailing literal text.
+   */
+  char                  conv;
+} chprintf_spec_t;
+
+#if (CHPRINTF_USE_COMPILED == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Type of a precompiled format.
+ * @note    The literal text is not copied, the formatting string must
+ *          stay valid while the precompiled format is in use.
+ */
+typedef struct {
+  /**
+   * @brief   Number of used entries.
+   */
+  unsigned              n;
+  /**
+   * @brief   Parsed conversions.
+   */
+  chprintf_spec_t       specs[CHPRINTF_MAX_SPECS + 1];
+} chprintf_format_t;
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
   int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap);
   int chprintf(BaseSequentialStream *chp, const char *fmt, ...);
+  int chvsnprintf(char *str, size_t size, const char *fmt, va_list ap);
   int chsnprintf(char *str, size_t size, const char *fmt, ...);
+#if CHPRINTF_USE_COMPILED == TRUE
+  bool chprintfCompile(chprintf_format_t *cfp, const char *fmt);
+  int chvprintfCompiled(BaseSequentialStream *chp,
+                        const chprintf_format_t *cfp, va_list ap);
+  int chprintfCompiled(BaseSequentialStream *chp,
+                       const chprintf_format_t *cfp, ...);
+  int chsnprintfCompiled(char *str, size_t size,
+                         const chprintf_format_t *cfp, ...);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,2 @@
+PLATFORMSRC += $(CHIBIOS)/os/hal/ports/STM32/LLD/CRCv1/stm32_crc.c
+PLATFORMINC += $(CHIBIOS)/os/hal/ports/STM32/LLD/CRCv1
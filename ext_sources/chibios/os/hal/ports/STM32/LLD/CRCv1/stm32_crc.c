@@ -0,0 +1,233 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    CRCv1/stm32_crc.c
+ * @brief   Programmable CRC unit helper driver code.
+ *
+ * @addtogroup STM32_CRC
+ * @details The unit is shared, calculations are serialized by a mutex.
+ *          Data is always written in the data register one byte at time,
+ *          the bit order of the input is then handled by the REV_IN field
+ *          and does not depend on the words endianness.<br>
+ *          Small blocks are written by the CPU, large blocks by a memory
+ *          to memory DMA stream reading words from memory and writing
+ *          bytes in the unit, the FIFO of the stream does the unpacking.
+ * @note    The DMA must have been initialized by the HAL, this happens if
+ *          at least one driver using DMA is enabled.
+ * @{
+ */
+
+#include "hal.h"
+#include "stm32_crc.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Maximum number of words in a DMA transfer.
+ */
+#define CRC_DMA_MAX_WORDS                   0xFFFFU
+
+/**
+ * @brief   DMA mode of the feed.
+ */
+#define CRC_DMA_MODE                                                        \
+  (STM32_DMA_CR_CHSEL(0) | STM32_DMA_CR_PL(STM32_CRC_DMA_PRIORITY) |        \
+   STM32_DMA_CR_DIR_M2M | STM32_DMA_CR_PINC | STM32_DMA_CR_PSIZE_WORD |     \
+   STM32_DMA_CR_MSIZE_BYTE | STM32_DMA_CR_TCIE | STM32_DMA_CR_TEIE)
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Unit initialized flag.
+ */
+static bool crc_ready = false;
+
+/**
+ * @brief   Mutex protecting the unit.
+ */
+static mutex_t crc_mutex;
+
+#if (STM32_CRC_USE_DMA == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   DMA stream of the feed.
+ */
+static const stm32_dma_stream_t *crc_dma;
+
+/**
+ * @brief   Thread waiting for the DMA transfer.
+ */
+static thread_reference_t crc_thread = NULL;
+#endif
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+#if (STM32_CRC_USE_DMA == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Shared end-of-transfer service routine.
+ *
+ * @param[in] p         parameter, not used
+ * @param[in] flags     pre-shifted content of the ISR register
+ */
+static void crc_serve_dma_interrupt(void *p, uint32_t flags) {
+
+  (void)p;
+
+  if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0U) {
+    STM32_CRC_DMA_ERROR_HOOK();
+  }
+
+  osalSysLockFromISR();
+  osalThreadResumeI(&crc_thread, MSG_OK);
+  osalSysUnlockFromISR();
+}
+
+/**
+ * @brief   Feeds the unit by DMA.
+ *
+ * @param[in] p         pointer to the data, word aligned
+ * @param[in] words     number of words
+ */
+static void crc_feed_dma(const uint8_t *p, size_t words) {
+
+#if STM32_DMA_CACHE_HANDLING == TRUE
+  /* The DMA reads the memory, the data still in the cache must be
+     written back.*/
+  SCB_CleanDCache_by_Addr((uint32_t *)((uint32_t)p & ~31U),
+                          (int32_t)((words * 4U) + ((uint32_t)p & 31U)));
+#endif
+
+  while (words > 0U) {
+    size_t chunk = words > CRC_DMA_MAX_WORDS ? CRC_DMA_MAX_WORDS : words;
+
+    osalSysLock();
+    dmaStreamSetPeripheral(crc_dma, p);
+    dmaStreamSetMemory0(crc_dma, &CRC->DR);
+    dmaStreamSetTransactionSize(crc_dma, chunk);
+    dmaStreamSetMode(crc_dma, CRC_DMA_MODE);
+    dmaStreamEnable(crc_dma);
+    (void) osalThreadSuspendS(&crc_thread);
+    osalSysUnlock();
+
+    p     += chunk * 4U;
+    words -= chunk;
+  }
+}
+#endif /* STM32_CRC_USE_DMA == TRUE */
+
+/**
+ * @brief   Feeds the unit by CPU.
+ *
+ * @param[in] p         pointer to the data
+ * @param[in] n         number of bytes
+ */
+static void crc_feed_cpu(const uint8_t *p, size_t n) {
+
+  while (n > 0U) {
+    *(volatile uint8_t *)&CRC->DR = *p;
+    p++;
+    n--;
+  }
+}
+
+/**
+ * @brief   Initializes the unit on first use.
+ */
+static void crc_init(void) {
+
+  osalSysLock();
+  if (!crc_ready) {
+    osalMutexObjectInit(&crc_mutex);
+    rccEnableCRC(false);
+#if STM32_CRC_USE_DMA == TRUE
+    crc_dma = STM32_DMA_STREAM(STM32_CRC_DMA_STREAM);
+    {
+      bool b = dmaStreamAllocate(crc_dma, STM32_CRC_DMA_IRQ_PRIORITY,
+                                 crc_serve_dma_interrupt, NULL);
+      osalDbgAssert(!b, "stream already allocated");
+    }
+    dmaStreamSetFIFO(crc_dma, STM32_DMA_FCR_DMDIS | STM32_DMA_FCR_FTH_FULL);
+#endif
+    crc_ready = true;
+  }
+  osalSysUnlock();
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   CRC calculation using the unit.
+ *
+ * @param[in] cr        CR register value, polynomial size and bit reversal
+ * @param[in] pol       polynomial
+ * @param[in] init      initial value of the unit register
+ * @param[in] data      pointer to the data
+ * @param[in] n         number of bytes
+ * @return              The final value of the unit register.
+ *
+ * @api
+ */
+uint32_t crcUnitCalc(uint32_t cr, uint32_t pol, uint32_t init,
+                     const void *data, size_t n) {
+  const uint8_t *p = data;
+  uint32_t crc;
+
+  osalDbgCheck((data != NULL) || (n == 0U));
+
+  if (!crc_ready) {
+    crc_init();
+  }
+
+  osalMutexLock(&crc_mutex);
+
+  CRC->POL  = pol;
+  CRC->INIT = init;
+  CRC->CR   = cr | CRC_CR_RESET;
+
+#if STM32_CRC_USE_DMA == TRUE
+  if (n >= STM32_CRC_DMA_THRESHOLD) {
+    size_t head = (size_t)(0U - (uint32_t)p) & 3U;
+
+    /* Unaligned head by CPU then the words by DMA.*/
+    crc_feed_cpu(p, head);
+    p += head;
+    n -= head;
+    crc_feed_dma(p, n / 4U);
+    p += n & ~(size_t)3U;
+    n &= 3U;
+  }
+#endif
+  crc_feed_cpu(p, n);
+  crc = CRC->DR;
+
+  osalMutexUnlock(&crc_mutex);
+
+  return crc;
+}
+
+/** @} */
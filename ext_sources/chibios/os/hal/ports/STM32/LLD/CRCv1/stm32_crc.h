@@ -0,0 +1,161 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    CRCv1/stm32_crc.h
+ * @brief   Programmable CRC unit helper driver header.
+ *
+ * @addtogroup STM32_CRC
+ * @{
+ */
+
+#ifndef STM32_CRC_H
+#define STM32_CRC_H
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Supported CRC formats
+ * @{
+ */
+/**
+ * @brief   CR register value for the CRC16-CCITT.
+ */
+#define STM32_CRC_CR_CRC16_CCITT            CRC_CR_POLYSIZE_0
+
+/**
+ * @brief   POL register value for the CRC16-CCITT.
+ */
+#define STM32_CRC_POL_CRC16_CCITT           0x1021U
+
+/**
+ * @brief   CR register value for the CRC32, input and output reflected.
+ */
+#define STM32_CRC_CR_CRC32                  (CRC_CR_REV_IN_0 | CRC_CR_REV_OUT)
+
+/**
+ * @brief   POL register value for the CRC32.
+ */
+#define STM32_CRC_POL_CRC32                 0x04C11DB7U
+/** @} */
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Configuration options
+ * @{
+ */
+/**
+ * @brief   Enables the DMA feed of the CRC unit.
+ * @details Large blocks are transferred to the unit by a memory to memory
+ *          DMA stream, the calling thread sleeps meanwhile.
+ */
+#if !defined(STM32_CRC_USE_DMA) || defined(__DOXYGEN__)
+#define STM32_CRC_USE_DMA                   TRUE
+#endif
+
+/**
+ * @brief   Minimum block size transferred by DMA.
+ */
+#if !defined(STM32_CRC_DMA_THRESHOLD) || defined(__DOXYGEN__)
+#define STM32_CRC_DMA_THRESHOLD             256
+#endif
+
+/**
+ * @brief   DMA stream used for the feed.
+ * @note    Memory to memory transfers are only possible on DMA2.
+ */
+#if !defined(STM32_CRC_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_CRC_DMA_STREAM                STM32_DMA_STREAM_ID(2, 7)
+#endif
+
+/**
+ * @brief   DMA stream priority (0..3|lowest..highest).
+ */
+#if !defined(STM32_CRC_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_CRC_DMA_PRIORITY              0
+#endif
+
+/**
+ * @brief   DMA stream interrupt priority level setting.
+ */
+#if !defined(STM32_CRC_DMA_IRQ_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_CRC_DMA_IRQ_PRIORITY          12
+#endif
+
+/**
+ * @brief   DMA error hook.
+ */
+#if !defined(STM32_CRC_DMA_ERROR_HOOK) || defined(__DOXYGEN__)
+#define STM32_CRC_DMA_ERROR_HOOK()          osalSysHalt("DMA failure")
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !STM32_HAS_CRC || !STM32_CRC_PROGRAMMABLE
+#error "programmable CRC unit not present in the selected device"
+#endif
+
+#if STM32_CRC_USE_DMA == TRUE
+#if !STM32_ADVANCED_DMA
+#error "the CRC DMA feed requires the enhanced DMA controller"
+#endif
+
+#if (STM32_CRC_DMA_STREAM < STM32_DMA_STREAM_ID(2, 0)) ||                   \
+    (STM32_CRC_DMA_STREAM > STM32_DMA_STREAM_ID(2, 7))
+#error "invalid DMA stream associated to the CRC unit"
+#endif
+
+#if !STM32_DMA_IS_VALID_PRIORITY(STM32_CRC_DMA_PRIORITY)
+#error "Invalid DMA priority assigned to the CRC unit"
+#endif
+
+#if !OSAL_IRQ_IS_VALID_PRIORITY(STM32_CRC_DMA_IRQ_PRIORITY)
+#error "Invalid IRQ priority assigned to the CRC unit DMA"
+#endif
+#endif /* STM32_CRC_USE_DMA == TRUE */
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  uint32_t crcUnitCalc(uint32_t cr, uint32_t pol, uint32_t init,
+                       const void *data, size_t n);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32_CRC_H */
+
+/** @} */
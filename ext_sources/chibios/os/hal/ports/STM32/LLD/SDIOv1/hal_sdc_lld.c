@@ -178,7 +178,9 @@ static bool sdc_lld_prepare_write(SDCDriver *sdcp, uint32_t startblk,
     startblk *= MMCSD_BLOCK_SIZE;
 
   if (n > 1) {
-    /* Write multiple blocks command.*/
+    /* Pre-erase hint then write multiple blocks command.*/
+    if (_sdc_pre_erase(sdcp, n))
+      return HAL_FAILED;
     if (sdc_lld_send_cmd_short_crc(sdcp, MMCSD_CMD_WRITE_MULTIPLE_BLOCK,
                                    startblk, resp) || MMCSD_R1_ERROR(resp[0]))
       return HAL_FAILED;
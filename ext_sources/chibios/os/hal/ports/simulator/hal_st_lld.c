@@ -34,6 +34,21 @@
 /* Driver exported variables.                                                */
 /*===========================================================================*/
 
+/**
+ * @brief   Simulated free running counter.
+ */
+systime_t st_lld_counter;
+
+/**
+ * @brief   Simulated alarm compare value.
+ */
+systime_t st_lld_alarm;
+
+/**
+ * @brief   Simulated alarm enable.
+ */
+bool st_lld_alarm_active;
+
 /*===========================================================================*/
 /* Driver local types.                                                       */
 /*===========================================================================*/
@@ -62,6 +77,22 @@
 void st_lld_init(void) {
 }
 
+/**
+ * @brief   Advances the simulated counter by one tick.
+ * @note    Invoked by the interrupt simulation in free running mode.
+ *
+ * @return              The alarm status.
+ * @retval false        if the alarm did not expire.
+ * @retval true         if the alarm expired.
+ *
+ * @notapi
+ */
+bool st_lld_advance(void) {
+
+  st_lld_counter++;
+  return st_lld_alarm_active && (st_lld_counter == st_lld_alarm);
+}
+
 #endif /* OSAL_ST_MODE != OSAL_ST_MODE_NONE */
 
 /** @} */
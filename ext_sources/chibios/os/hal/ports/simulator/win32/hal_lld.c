@@ -92,6 +92,12 @@ void _sim_check_for_interrupts(void) {
   if (n.QuadPart > nextcnt.QuadPart) {
     nextcnt.QuadPart += slice.QuadPart;
 
+#if OSAL_ST_MODE == OSAL_ST_MODE_FREERUNNING
+    /* In free running mode the interrupt is raised by the alarm only.*/
+    if (!st_lld_advance())
+      return;
+#endif
+
     CH_IRQ_PROLOGUE();
 
     chSysLockFromISR();
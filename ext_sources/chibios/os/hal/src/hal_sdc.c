@@ -527,6 +527,49 @@ bool _sdc_wait_for_transfer_state(SDCDriver *sdcp) {
   }
 }
 
+/**
+ * @brief   Sends the pre-erase count before a multiple blocks write.
+ * @details SD cards are told the number of blocks going to be written by
+ *          the next multiple blocks write command, the blocks can be erased
+ *          in advance. MMC cards do not support the command, nothing is
+ *          sent to them.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] n         number of blocks going to be written
+ *
+ * @return              The operation status.
+ * @retval HAL_SUCCESS  operation succeeded.
+ * @retval HAL_FAILED   operation failed.
+ *
+ * @notapi
+ */
+bool _sdc_pre_erase(SDCDriver *sdcp, uint32_t n) {
+#if SDC_WRITE_PRE_ERASE == TRUE
+  uint32_t resp[1];
+
+  if ((sdcp->cardmode & SDC_MODE_CARDTYPE_MASK) == SDC_MODE_CARDTYPE_MMC) {
+    return HAL_SUCCESS;
+  }
+
+  if (sdc_lld_send_cmd_short_crc(sdcp, MMCSD_CMD_APP_CMD,
+                                 sdcp->rca, resp) ||
+      MMCSD_R1_ERROR(resp[0])) {
+    return HAL_FAILED;
+  }
+
+  if (sdc_lld_send_cmd_short_crc(sdcp, MMCSD_CMD_SET_WR_BLK_ERASE_COUNT,
+                                 n, resp) ||
+      MMCSD_R1_ERROR(resp[0])) {
+    return HAL_FAILED;
+  }
+#else
+  (void)sdcp;
+  (void)n;
+#endif
+
+  return HAL_SUCCESS;
+}
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
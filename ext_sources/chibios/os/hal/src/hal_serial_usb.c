@@ -265,6 +265,135 @@ void sduStop(SerialUSBDriver *sdup) {
   osalSysUnlock();
 }
 
+/**
+ * @brief   Gets an empty transmit buffer for zero-copy writes.
+ * @details The caller fills the returned buffer in place and then posts it
+ *          using @p sduPostFullBuffer(), this saves the copy performed by
+ *          the stream interface and one USB packet buffer is transmitted
+ *          per call.
+ * @note    If a buffer has been partially filled by the stream interface
+ *          then it is posted before acquiring a new one, the order of the
+ *          data is preserved.
+ * @note    Stream writes must not be performed on the same driver between
+ *          this call and the matching @p sduPostFullBuffer().
+ *
+ * @param[in] sdup      pointer to a @p SerialUSBDriver object
+ * @param[out] sizep    pointer to a variable receiving the buffer size
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              Pointer to the buffer.
+ * @retval NULL         if the operation timed out or the driver has been
+ *                      disconnected.
+ *
+ * @api
+ */
+uint8_t *sduGetEmptyBufferTimeout(SerialUSBDriver *sdup, size_t *sizep,
+                                  systime_t timeout) {
+  output_buffers_queue_t *obqp = &sdup->obqueue;
+  uint8_t *buf = NULL;
+
+  osalDbgCheck((sdup != NULL) && (sizep != NULL));
+
+  osalSysLock();
+
+  /* Posting any data left in the current buffer by the stream writes.*/
+  if ((obqp->ptr != NULL) &&
+      (obqp->ptr > (obqp->bwrptr + sizeof (size_t)))) {
+    obqPostFullBufferS(obqp, (size_t)obqp->ptr -
+                             ((size_t)obqp->bwrptr + sizeof (size_t)));
+  }
+
+  /* An empty current buffer is returned again, else a new one is taken.*/
+  if ((obqp->ptr != NULL) ||
+      (obqGetEmptyBufferTimeoutS(obqp, timeout) == MSG_OK)) {
+    buf    = obqp->ptr;
+    *sizep = (size_t)obqp->top - (size_t)obqp->ptr;
+  }
+
+  osalSysUnlock();
+
+  return buf;
+}
+
+/**
+ * @brief   Posts a buffer filled in place for transmission.
+ * @note    The write pointer of the queue is not moved while the buffer is
+ *          filled so the SOF handler never flushes it half written.
+ *
+ * @param[in] sdup      pointer to a @p SerialUSBDriver object
+ * @param[in] size      number of bytes written in the buffer, it must be
+ *                      greater than zero and not greater than the size
+ *                      returned by @p sduGetEmptyBufferTimeout()
+ *
+ * @api
+ */
+void sduPostFullBuffer(SerialUSBDriver *sdup, size_t size) {
+
+  osalDbgCheck(sdup != NULL);
+
+  obqPostFullBuffer(&sdup->obqueue, size);
+}
+
+/**
+ * @brief   Gets a received buffer for zero-copy reads.
+ * @details The caller processes the returned data in place and then frees
+ *          the buffer using @p sduReleaseEmptyBuffer(), this saves the
+ *          copy performed by the stream interface.
+ * @note    If a buffer has been partially consumed by the stream interface
+ *          then its remaining data is returned.
+ *
+ * @param[in] sdup      pointer to a @p SerialUSBDriver object
+ * @param[out] sizep    pointer to a variable receiving the data size
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              Pointer to the received data.
+ * @retval NULL         if the operation timed out or the driver has been
+ *                      disconnected.
+ *
+ * @api
+ */
+uint8_t *sduGetFullBufferTimeout(SerialUSBDriver *sdup, size_t *sizep,
+                                 systime_t timeout) {
+  input_buffers_queue_t *ibqp = &sdup->ibqueue;
+  uint8_t *buf = NULL;
+
+  osalDbgCheck((sdup != NULL) && (sizep != NULL));
+
+  osalSysLock();
+
+  if ((ibqp->ptr != NULL) ||
+      (ibqGetFullBufferTimeoutS(ibqp, timeout) == MSG_OK)) {
+    buf    = ibqp->ptr;
+    *sizep = (size_t)ibqp->top - (size_t)ibqp->ptr;
+  }
+
+  osalSysUnlock();
+
+  return buf;
+}
+
+/**
+ * @brief   Frees a buffer obtained with @p sduGetFullBufferTimeout().
+ * @note    The buffer is returned to the USB driver for the next OUT
+ *          transaction.
+ *
+ * @param[in] sdup      pointer to a @p SerialUSBDriver object
+ *
+ * @api
+ */
+void sduReleaseEmptyBuffer(SerialUSBDriver *sdup) {
+
+  osalDbgCheck(sdup != NULL);
+
+  ibqReleaseEmptyBuffer(&sdup->ibqueue);
+}
+
 /**
  * @brief   USB device suspend handler.
  * @details Generates a @p CHN_DISCONNECT event and puts queues in
@@ -0,0 +1,942 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_usb_msd.c
+ * @brief   USB Mass Storage Driver code.
+ *
+ * @addtogroup USB_MSD
+ * @details USB Mass Storage class, Bulk-Only Transport with the SCSI
+ *          transparent command set, exposing a @p BaseBlockDevice.<br>
+ *          The protocol is served by a dedicated thread. Reads and writes
+ *          use two buffers, while one is transferred on the USB endpoint
+ *          the other one is read from or written to the medium, so the
+ *          medium and the USB transfers overlap. After a long read the
+ *          following blocks are read ahead, a sequential read issued
+ *          next by the host starts from the buffer already filled.<br>
+ *          The medium is attached and detached by the application, the
+ *          host sees a removable medium.
+ * @{
+ */
+
+#include <string.h>
+
+#include "hal.h"
+
+#if (HAL_USE_USB_MSD == TRUE) || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define MSD_CBW_SIGNATURE               0x43425355U
+#define MSD_CSW_SIGNATURE               0x53425355U
+
+#define MSD_REQ_RESET                   0xFFU
+#define MSD_REQ_GET_MAX_LUN             0xFEU
+
+#define MSD_CSW_PASSED                  0x00U
+#define MSD_CSW_FAILED                  0x01U
+#define MSD_CSW_PHASE_ERROR             0x02U
+
+#define SCSI_TEST_UNIT_READY            0x00U
+#define SCSI_REQUEST_SENSE              0x03U
+#define SCSI_INQUIRY                    0x12U
+#define SCSI_MODE_SENSE_6               0x1AU
+#define SCSI_START_STOP_UNIT            0x1BU
+#define SCSI_PREVENT_ALLOW_REMOVAL      0x1EU
+#define SCSI_READ_FORMAT_CAPACITIES     0x23U
+#define SCSI_READ_CAPACITY_10           0x25U
+#define SCSI_READ_10                    0x28U
+#define SCSI_WRITE_10                   0x2AU
+#define SCSI_VERIFY_10                  0x2FU
+#define SCSI_SYNCHRONIZE_CACHE_10       0x35U
+#define SCSI_MODE_SENSE_10              0x5AU
+
+#define SCSI_SENSE_NO_SENSE             0x00U
+#define SCSI_SENSE_NOT_READY            0x02U
+#define SCSI_SENSE_MEDIUM_ERROR         0x03U
+#define SCSI_SENSE_ILLEGAL_REQUEST      0x05U
+#define SCSI_SENSE_UNIT_ATTENTION       0x06U
+#define SCSI_SENSE_DATA_PROTECT         0x07U
+
+#define SCSI_ASC_NONE                   0x00U
+#define SCSI_ASC_WRITE_ERROR            0x0CU
+#define SCSI_ASC_READ_ERROR             0x11U
+#define SCSI_ASC_INVALID_COMMAND        0x20U
+#define SCSI_ASC_LBA_OUT_OF_RANGE       0x21U
+#define SCSI_ASC_INVALID_FIELD          0x24U
+#define SCSI_ASC_WRITE_PROTECTED        0x27U
+#define SCSI_ASC_MEDIUM_CHANGED         0x28U
+#define SCSI_ASC_MEDIUM_NOT_PRESENT     0x3AU
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/*
+ * Maximum LUN, a single medium.
+ */
+static uint8_t max_lun = 0U;
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static uint32_t get_be32(const uint8_t *p) {
+
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint32_t get_be16(const uint8_t *p) {
+
+  return ((uint32_t)p[0] << 8) | (uint32_t)p[1];
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+
+  return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[1] << 8) | (uint32_t)p[0];
+}
+
+static void put_be32(uint8_t *p, uint32_t x) {
+
+  p[0] = (uint8_t)(x >> 24);
+  p[1] = (uint8_t)(x >> 16);
+  p[2] = (uint8_t)(x >> 8);
+  p[3] = (uint8_t)x;
+}
+
+static void put_le32(uint8_t *p, uint32_t x) {
+
+  p[0] = (uint8_t)x;
+  p[1] = (uint8_t)(x >> 8);
+  p[2] = (uint8_t)(x >> 16);
+  p[3] = (uint8_t)(x >> 24);
+}
+
+static void put_string(uint8_t *p, const char *s, size_t n) {
+
+  while (n-- > 0U) {
+    *p++ = ((s != NULL) && (*s != '\0')) ? (uint8_t)*s++ : (uint8_t)' ';
+  }
+}
+
+static void msd_set_sense(USBMassStorageDriver *msdp,
+                          uint8_t key, uint8_t asc) {
+
+  msdp->sense_key = key;
+  msdp->asc       = asc;
+}
+
+/**
+ * @brief   Returns @p true if the current command must be aborted.
+ * @note    It happens on USB reset or suspend, on a Bulk-Only Mass Storage
+ *          Reset and when the driver is stopped.
+ */
+static bool msd_aborted(USBMassStorageDriver *msdp) {
+
+  return msdp->reset || (msdp->state != MSD_READY) ||
+         (usbGetDriverStateI(msdp->config->usbp) != USB_ACTIVE);
+}
+
+/**
+ * @brief   Waits the end of the IN or OUT transfer.
+ */
+static msg_t msd_wait(USBMassStorageDriver *msdp, bool in) {
+  USBDriver *usbp = msdp->config->usbp;
+  msg_t msg = MSG_OK;
+
+  osalSysLock();
+  while (in ? usbGetTransmitStatusI(usbp, msdp->config->bulk_in) :
+              usbGetReceiveStatusI(usbp, msdp->config->bulk_out)) {
+    if (msd_aborted(msdp)) {
+      break;
+    }
+    (void) osalThreadSuspendS(&msdp->wait);
+  }
+  if (msd_aborted(msdp)) {
+    msg = MSG_RESET;
+  }
+  osalSysUnlock();
+
+  return msg;
+}
+
+static msg_t msd_start_transmit(USBMassStorageDriver *msdp,
+                                const uint8_t *buf, size_t n) {
+  msg_t msg = MSG_RESET;
+
+  osalSysLock();
+  if (!msd_aborted(msdp)) {
+    usbStartTransmitI(msdp->config->usbp, msdp->config->bulk_in, buf, n);
+    msg = MSG_OK;
+  }
+  osalSysUnlock();
+
+  return msg;
+}
+
+static msg_t msd_start_receive(USBMassStorageDriver *msdp,
+                               uint8_t *buf, size_t n) {
+  msg_t msg = MSG_RESET;
+
+  osalSysLock();
+  if (!msd_aborted(msdp)) {
+    msdp->rxbuf = buf;
+    usbStartReceiveI(msdp->config->usbp, msdp->config->bulk_out, buf, n);
+    msg = MSG_OK;
+  }
+  osalSysUnlock();
+
+  return msg;
+}
+
+/**
+ * @brief   Waits for the host to clear the stall condition of an endpoint.
+ */
+static msg_t msd_wait_unstall(USBMassStorageDriver *msdp, bool in) {
+  USBDriver *usbp = msdp->config->usbp;
+  msg_t msg = MSG_OK;
+
+  /* The endpoint status is read in the same locked context used by the
+     standard requests handler.*/
+  osalSysLock();
+  while ((in ? usb_lld_get_status_in(usbp, msdp->config->bulk_in) :
+               usb_lld_get_status_out(usbp, msdp->config->bulk_out)) ==
+         EP_STATUS_STALLED) {
+    if (msd_aborted(msdp)) {
+      msg = MSG_RESET;
+      break;
+    }
+    osalThreadSleepS(OSAL_MS2ST(1));
+  }
+  osalSysUnlock();
+
+  return msg;
+}
+
+/**
+ * @brief   Receives and validates the next Command Block Wrapper.
+ * @details An invalid CBW stalls both endpoints until the host performs
+ *          the reset recovery.
+ */
+static msg_t msd_receive_cbw(USBMassStorageDriver *msdp) {
+  USBDriver *usbp = msdp->config->usbp;
+  size_t n;
+  msg_t msg;
+
+  osalSysLock();
+  msdp->reset = false;
+  if (usbGetReceiveStatusI(usbp, msdp->config->bulk_out)) {
+    /* After a reset the data transfer left pending receives the CBW.*/
+    osalSysUnlock();
+  }
+  else {
+    osalSysUnlock();
+    msg = msd_wait_unstall(msdp, false);
+    if (msg == MSG_OK) {
+      msg = msd_start_receive(msdp, msdp->cbw, MSD_CBW_SIZE);
+    }
+    if (msg != MSG_OK) {
+      return msg;
+    }
+  }
+  msg = msd_wait(msdp, false);
+  if (msg != MSG_OK) {
+    return msg;
+  }
+
+  n = usbGetReceiveTransactionSizeX(usbp, msdp->config->bulk_out);
+  if (msdp->rxbuf != msdp->cbw) {
+    memcpy(msdp->cbw, msdp->rxbuf, n < MSD_CBW_SIZE ? n : MSD_CBW_SIZE);
+  }
+  if ((n == MSD_CBW_SIZE) &&
+      (get_le32(&msdp->cbw[0]) == MSD_CBW_SIGNATURE) &&
+      (msdp->cbw[13] == 0U) &&
+      (msdp->cbw[14] >= 1U) && (msdp->cbw[14] <= 16U)) {
+    return MSG_OK;
+  }
+
+  /* Invalid CBW, waiting for the reset recovery.*/
+  osalSysLock();
+  usbStallReceiveI(usbp, msdp->config->bulk_out);
+  usbStallTransmitI(usbp, msdp->config->bulk_in);
+  while (!msd_aborted(msdp)) {
+    (void) osalThreadSuspendS(&msdp->wait);
+  }
+  osalSysUnlock();
+
+  return MSG_RESET;
+}
+
+/**
+ * @brief   Checks that the medium is ready for the command.
+ */
+static bool msd_medium_ready(USBMassStorageDriver *msdp) {
+
+  if (msdp->bbdp == NULL) {
+    msd_set_sense(msdp, SCSI_SENSE_NOT_READY, SCSI_ASC_MEDIUM_NOT_PRESENT);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief   Reads blocks and transmits them to the host.
+ * @details The next buffer is read while the current one is transmitted.
+ *          When the command is long enough to look like a sequential read
+ *          the blocks following it are read ahead in the free buffer.
+ *
+ * @return              @p MSG_RESET if the command has been aborted.
+ */
+static msg_t msd_read(USBMassStorageDriver *msdp, uint32_t lba,
+                      uint32_t count, uint32_t *donep) {
+  bool streaming = count >= (uint32_t)USB_MSD_BUFFER_BLOCKS;
+  uint32_t n, next;
+  unsigned b = 0U;
+  bool readahead, err = false;
+  msg_t msg;
+
+  if ((msdp->ra_count > 0U) && (msdp->ra_lba == lba)) {
+    b = msdp->ra_buf;
+    n = count < msdp->ra_count ? count : msdp->ra_count;
+  }
+  else {
+    n = count < (uint32_t)USB_MSD_BUFFER_BLOCKS ?
+        count : (uint32_t)USB_MSD_BUFFER_BLOCKS;
+    err = blkRead(msdp->bbdp, lba, (uint8_t *)msdp->buf[b], n);
+  }
+  msdp->ra_count = 0U;
+
+  while (!err) {
+    msg = msd_start_transmit(msdp, (const uint8_t *)msdp->buf[b],
+                             (size_t)n * MSD_BLOCK_SIZE);
+    if (msg != MSG_OK) {
+      return msg;
+    }
+    lba   += n;
+    count -= n;
+
+    /* Reading the next buffer while the current one is transmitted.*/
+    next = count < (uint32_t)USB_MSD_BUFFER_BLOCKS ?
+           count : (uint32_t)USB_MSD_BUFFER_BLOCKS;
+    readahead = (next == 0U) && streaming;
+    if (readahead) {
+      next = msdp->blocks - lba;
+      if (next > (uint32_t)USB_MSD_BUFFER_BLOCKS) {
+        next = (uint32_t)USB_MSD_BUFFER_BLOCKS;
+      }
+    }
+    if (next > 0U) {
+      err = blkRead(msdp->bbdp, lba, (uint8_t *)msdp->buf[b ^ 1U], next);
+    }
+
+    msg = msd_wait(msdp, true);
+    if (msg != MSG_OK) {
+      return msg;
+    }
+    *donep += n * MSD_BLOCK_SIZE;
+
+    if (readahead) {
+      if (!err && (next > 0U)) {
+        msdp->ra_lba   = lba;
+        msdp->ra_count = next;
+        msdp->ra_buf   = b ^ 1U;
+      }
+      return MSG_OK;
+    }
+    if (count == 0U) {
+      return MSG_OK;
+    }
+    b ^= 1U;
+    n  = next;
+  }
+
+  msd_set_sense(msdp, SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_READ_ERROR);
+  return MSG_TIMEOUT;
+}
+
+/**
+ * @brief   Receives blocks from the host and writes them.
+ * @details The next buffer is received while the current one is written.
+ *
+ * @return              @p MSG_RESET if the command has been aborted.
+ */
+static msg_t msd_write(USBMassStorageDriver *msdp, uint32_t lba,
+                       uint32_t count, uint32_t *donep) {
+  USBDriver *usbp = msdp->config->usbp;
+  uint32_t n, next;
+  unsigned b = 0U;
+  msg_t msg;
+
+  msdp->ra_count = 0U;
+  n = count < (uint32_t)USB_MSD_BUFFER_BLOCKS ?
+      count : (uint32_t)USB_MSD_BUFFER_BLOCKS;
+  msg = msd_start_receive(msdp, (uint8_t *)msdp->buf[b],
+                          (size_t)n * MSD_BLOCK_SIZE);
+
+  while (msg == MSG_OK) {
+    msg = msd_wait(msdp, false);
+    if (msg != MSG_OK) {
+      break;
+    }
+    if (usbGetReceiveTransactionSizeX(usbp, msdp->config->bulk_out) !=
+        (size_t)n * MSD_BLOCK_SIZE) {
+      /* The host ended the data phase early.*/
+      return MSG_TIMEOUT;
+    }
+    *donep += n * MSD_BLOCK_SIZE;
+    count  -= n;
+
+    /* Receiving the next buffer while the current one is written.*/
+    next = count < (uint32_t)USB_MSD_BUFFER_BLOCKS ?
+           count : (uint32_t)USB_MSD_BUFFER_BLOCKS;
+    if (next > 0U) {
+      msg = msd_start_receive(msdp, (uint8_t *)msdp->buf[b ^ 1U],
+                              (size_t)next * MSD_BLOCK_SIZE);
+      if (msg != MSG_OK) {
+        break;
+      }
+    }
+
+    if (blkWrite(msdp->bbdp, lba, (const uint8_t *)msdp->buf[b], n)) {
+      msd_set_sense(msdp, SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_WRITE_ERROR);
+      if (next > 0U) {
+        /* The buffer being received is discarded.*/
+        msg = msd_wait(msdp, false);
+        if (msg == MSG_OK) {
+          *donep += usbGetReceiveTransactionSizeX(usbp,
+                                                  msdp->config->bulk_out);
+          msg = MSG_TIMEOUT;
+        }
+        return msg;
+      }
+      return MSG_TIMEOUT;
+    }
+    if (next == 0U) {
+      break;
+    }
+    lba += n;
+    b   ^= 1U;
+    n    = next;
+  }
+
+  return msg;
+}
+
+/**
+ * @brief   Executes the command in the current CBW.
+ * @details The data phase, the stall conditions required by the Bulk-Only
+ *          Transport and the CSW are handled here.
+ */
+static void msd_execute(USBMassStorageDriver *msdp) {
+  const uint8_t *cb = &msdp->cbw[15];
+  uint32_t expected = get_le32(&msdp->cbw[8]);
+  bool in = (msdp->cbw[12] & 0x80U) != 0U;
+  uint8_t status = MSD_CSW_PASSED;
+  const uint8_t *reply = NULL;
+  uint32_t n = 0U, done = 0U, lba, count;
+  msg_t msg = MSG_OK;
+
+  osalMutexLock(&msdp->mtx);
+
+  /* A medium change is reported once to any command but the ones
+     reporting the device status.*/
+  if (msdp->changed && (msdp->bbdp != NULL) &&
+      (cb[0] != SCSI_INQUIRY) && (cb[0] != SCSI_REQUEST_SENSE)) {
+    msdp->changed = false;
+    msd_set_sense(msdp, SCSI_SENSE_UNIT_ATTENTION, SCSI_ASC_MEDIUM_CHANGED);
+    status = MSD_CSW_FAILED;
+  }
+  else {
+    switch (cb[0]) {
+    case SCSI_TEST_UNIT_READY:
+      if (!msd_medium_ready(msdp)) {
+        status = MSD_CSW_FAILED;
+      }
+      break;
+    case SCSI_REQUEST_SENSE:
+      memset(msdp->resp, 0, 18);
+      msdp->resp[0]  = 0x70U;           /* Current error, fixed format.   */
+      msdp->resp[2]  = msdp->sense_key;
+      msdp->resp[7]  = 10U;             /* Additional sense length.       */
+      msdp->resp[12] = msdp->asc;
+      msd_set_sense(msdp, SCSI_SENSE_NO_SENSE, SCSI_ASC_NONE);
+      reply = msdp->resp;
+      n = cb[4] < 18U ? cb[4] : 18U;
+      break;
+    case SCSI_INQUIRY:
+      if ((cb[1] & 0x01U) != 0U) {
+        /* Vital product data pages not supported.*/
+        msd_set_sense(msdp, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      memset(msdp->resp, 0, 36);
+      msdp->resp[1] = 0x80U;            /* Removable medium.              */
+      msdp->resp[2] = 0x04U;            /* SPC-2.                         */
+      msdp->resp[3] = 0x02U;            /* Response data format.          */
+      msdp->resp[4] = 31U;              /* Additional length.             */
+      put_string(&msdp->resp[8], msdp->config->vendor, 8);
+      put_string(&msdp->resp[16], msdp->config->product, 16);
+      put_string(&msdp->resp[32], "1.00", 4);
+      reply = msdp->resp;
+      n = cb[4] < 36U ? cb[4] : 36U;
+      break;
+    case SCSI_MODE_SENSE_6:
+    case SCSI_MODE_SENSE_10:
+      if (!msd_medium_ready(msdp)) {
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      memset(msdp->resp, 0, 8);
+      if (cb[0] == SCSI_MODE_SENSE_6) {
+        msdp->resp[0] = 3U;             /* Mode data length.              */
+        msdp->resp[2] = blkIsWriteProtected(msdp->bbdp) ? 0x80U : 0x00U;
+        n = cb[4] < 4U ? cb[4] : 4U;
+      }
+      else {
+        msdp->resp[1] = 6U;             /* Mode data length.              */
+        msdp->resp[3] = blkIsWriteProtected(msdp->bbdp) ? 0x80U : 0x00U;
+        n = get_be16(&cb[7]) < 8U ? get_be16(&cb[7]) : 8U;
+      }
+      reply = msdp->resp;
+      break;
+    case SCSI_START_STOP_UNIT:
+      if ((cb[4] & 0x03U) == 0x02U) {
+        /* Eject, the medium is given back to the application.*/
+        msdp->bbdp = NULL;
+        msdp->ra_count = 0U;
+        osalEventBroadcastFlags(&msdp->event, MSD_EJECTED);
+      }
+      break;
+    case SCSI_PREVENT_ALLOW_REMOVAL:
+      /* The medium is detached only when the host is not using it.*/
+      break;
+    case SCSI_READ_FORMAT_CAPACITIES:
+      if (!msd_medium_ready(msdp)) {
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      memset(msdp->resp, 0, 12);
+      msdp->resp[3] = 8U;               /* Capacity list length.          */
+      put_be32(&msdp->resp[4], msdp->blocks);
+      put_be32(&msdp->resp[8], MSD_BLOCK_SIZE);
+      msdp->resp[8] = 0x02U;            /* Formatted media.               */
+      reply = msdp->resp;
+      n = get_be16(&cb[7]) < 12U ? get_be16(&cb[7]) : 12U;
+      break;
+    case SCSI_READ_CAPACITY_10:
+      if (!msd_medium_ready(msdp)) {
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      put_be32(&msdp->resp[0], msdp->blocks - 1U);
+      put_be32(&msdp->resp[4], MSD_BLOCK_SIZE);
+      reply = msdp->resp;
+      n = 8U;
+      break;
+    case SCSI_READ_10:
+    case SCSI_WRITE_10:
+    case SCSI_VERIFY_10:
+      if (!msd_medium_ready(msdp)) {
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      lba   = get_be32(&cb[2]);
+      count = get_be16(&cb[7]);
+      if ((lba > msdp->blocks) || (count > msdp->blocks - lba)) {
+        msd_set_sense(msdp, SCSI_SENSE_ILLEGAL_REQUEST,
+                      SCSI_ASC_LBA_OUT_OF_RANGE);
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      if (cb[0] == SCSI_VERIFY_10) {
+        break;
+      }
+      if ((count * MSD_BLOCK_SIZE != expected) ||
+          (in != (cb[0] == SCSI_READ_10))) {
+        /* The host and the command disagree on the data phase.*/
+        status = MSD_CSW_PHASE_ERROR;
+        break;
+      }
+      if (cb[0] == SCSI_WRITE_10) {
+        if (blkIsWriteProtected(msdp->bbdp)) {
+          msd_set_sense(msdp, SCSI_SENSE_DATA_PROTECT,
+                        SCSI_ASC_WRITE_PROTECTED);
+          status = MSD_CSW_FAILED;
+          break;
+        }
+        msg = msd_write(msdp, lba, count, &done);
+      }
+      else if (count > 0U) {
+        msg = msd_read(msdp, lba, count, &done);
+      }
+      if (msg == MSG_TIMEOUT) {
+        msg = MSG_OK;
+        status = MSD_CSW_FAILED;
+      }
+      break;
+    case SCSI_SYNCHRONIZE_CACHE_10:
+      if (!msd_medium_ready(msdp)) {
+        status = MSD_CSW_FAILED;
+        break;
+      }
+      if (blkSync(msdp->bbdp)) {
+        msd_set_sense(msdp, SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_WRITE_ERROR);
+        status = MSD_CSW_FAILED;
+      }
+      break;
+    default:
+      msd_set_sense(msdp, SCSI_SENSE_ILLEGAL_REQUEST,
+                    SCSI_ASC_INVALID_COMMAND);
+      status = MSD_CSW_FAILED;
+      break;
+    }
+  }
+
+  /* Short response data phase.*/
+  if ((msg == MSG_OK) && (reply != NULL)) {
+    if (!in && (expected > 0U)) {
+      status = MSD_CSW_PHASE_ERROR;
+    }
+    else {
+      if (n > expected) {
+        n = expected;
+      }
+      if (n > 0U) {
+        msg = msd_start_transmit(msdp, reply, n);
+        if (msg == MSG_OK) {
+          msg = msd_wait(msdp, true);
+        }
+        done = n;
+      }
+    }
+  }
+
+  osalMutexUnlock(&msdp->mtx);
+
+  if (msg != MSG_OK) {
+    return;
+  }
+
+  /* Data not moved, the host is told stalling the endpoint. A short IN
+     packet already ends the data phase.*/
+  if (done < expected) {
+    USBDriver *usbp = msdp->config->usbp;
+
+    osalSysLock();
+    if (!in) {
+      usbStallReceiveI(usbp, msdp->config->bulk_out);
+    }
+    else if ((done % usbp->epc[msdp->config->bulk_in]->in_maxsize) == 0U) {
+      usbStallTransmitI(usbp, msdp->config->bulk_in);
+    }
+    osalSysUnlock();
+    if (in && (msd_wait_unstall(msdp, true) != MSG_OK)) {
+      return;
+    }
+  }
+
+  put_le32(&msdp->csw[0], MSD_CSW_SIGNATURE);
+  memcpy(&msdp->csw[4], &msdp->cbw[4], 4);
+  put_le32(&msdp->csw[8], expected - done);
+  msdp->csw[12] = status;
+  if (msd_start_transmit(msdp, msdp->csw, MSD_CSW_SIZE) == MSG_OK) {
+    (void) msd_wait(msdp, true);
+  }
+}
+
+/**
+ * @brief   Protocol thread.
+ */
+static THD_FUNCTION(msd_thread, arg) {
+  USBMassStorageDriver *msdp = (USBMassStorageDriver *)arg;
+
+  chRegSetThreadName("usb_msd");
+  while (true) {
+    /* Waiting for the driver started and the configuration selected.*/
+    osalSysLock();
+    while ((msdp->state != MSD_READY) ||
+           (usbGetDriverStateI(msdp->config->usbp) != USB_ACTIVE)) {
+      (void) osalThreadSuspendS(&msdp->wait);
+    }
+    osalSysUnlock();
+
+    if (msd_receive_cbw(msdp) == MSG_OK) {
+      msd_execute(msdp);
+    }
+  }
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   USB Mass Storage Driver initialization.
+ * @note    This function is implicitly invoked by @p halInit(), there is
+ *          no need to explicitly initialize the driver.
+ *
+ * @init
+ */
+void msdInit(void) {
+}
+
+/**
+ * @brief   Initializes a generic USB mass storage driver object.
+ *
+ * @param[out] msdp     pointer to a @p USBMassStorageDriver structure
+ *
+ * @init
+ */
+void msdObjectInit(USBMassStorageDriver *msdp) {
+
+  msdp->state     = MSD_STOP;
+  msdp->config    = NULL;
+  osalEventObjectInit(&msdp->event);
+  msdp->bbdp      = NULL;
+  msdp->blocks    = 0U;
+  osalMutexObjectInit(&msdp->mtx);
+  msdp->wait      = NULL;
+  msdp->reset     = false;
+  msdp->changed   = false;
+  msdp->ra_count  = 0U;
+  msdp->rxbuf     = NULL;
+  msd_set_sense(msdp, SCSI_SENSE_NO_SENSE, SCSI_ASC_NONE);
+  msdp->tp        = NULL;
+}
+
+/**
+ * @brief   Configures and starts the driver.
+ * @note    The protocol thread is created on the first start.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ * @param[in] config    the USB mass storage driver configuration
+ *
+ * @api
+ */
+void msdStart(USBMassStorageDriver *msdp, const USBMassStorageConfig *config) {
+  USBDriver *usbp = config->usbp;
+
+  osalDbgCheck((msdp != NULL) && (config != NULL));
+
+  osalSysLock();
+  osalDbgAssert((msdp->state == MSD_STOP) || (msdp->state == MSD_READY),
+                "invalid state");
+  usbp->in_params[config->bulk_in - 1U]   = msdp;
+  usbp->out_params[config->bulk_out - 1U] = msdp;
+  msdp->config = config;
+  msdp->state  = MSD_READY;
+  if (msdp->tp == NULL) {
+    thread_descriptor_t msd_descriptor = {
+      "usb_msd",
+      THD_WORKING_AREA_BASE(msdp->wa),
+      THD_WORKING_AREA_END(msdp->wa),
+      USB_MSD_THREAD_PRIO,
+      msd_thread,
+      (void *)msdp
+    };
+
+    msdp->tp = chThdCreateI(&msd_descriptor);
+  }
+  osalThreadResumeI(&msdp->wait, MSG_OK);
+  osalOsRescheduleS();
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Stops the driver.
+ * @details The command in progress is aborted, the protocol thread waits
+ *          for the next start.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ *
+ * @api
+ */
+void msdStop(USBMassStorageDriver *msdp) {
+
+  osalDbgCheck(msdp != NULL);
+
+  osalSysLock();
+  osalDbgAssert((msdp->state == MSD_STOP) || (msdp->state == MSD_READY),
+                "invalid state");
+  msdp->state = MSD_STOP;
+  osalThreadResumeS(&msdp->wait, MSG_RESET);
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Attaches a medium.
+ * @details The host is notified of the medium change by the next command.
+ * @pre     The block device must be connected, the application must not
+ *          access it until it is detached.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ * @param[in] bbdp      pointer to the @p BaseBlockDevice to be exposed
+ *
+ * @api
+ */
+void msdAttachMedium(USBMassStorageDriver *msdp, BaseBlockDevice *bbdp) {
+  BlockDeviceInfo bdi;
+
+  osalDbgCheck((msdp != NULL) && (bbdp != NULL));
+
+  osalMutexLock(&msdp->mtx);
+  if (!blkGetInfo(bbdp, &bdi)) {
+    osalDbgAssert(bdi.blk_size == MSD_BLOCK_SIZE, "unsupported block size");
+    msdp->blocks   = bdi.blk_num;
+    msdp->bbdp     = bbdp;
+    msdp->changed  = true;
+    msdp->ra_count = 0U;
+  }
+  osalMutexUnlock(&msdp->mtx);
+}
+
+/**
+ * @brief   Detaches the medium.
+ * @details The function waits the end of the command in progress, on
+ *          return the block device is no more accessed by the driver and
+ *          the host sees the medium as not present.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ *
+ * @api
+ */
+void msdDetachMedium(USBMassStorageDriver *msdp) {
+
+  osalDbgCheck(msdp != NULL);
+
+  osalMutexLock(&msdp->mtx);
+  msdp->bbdp     = NULL;
+  msdp->ra_count = 0U;
+  osalMutexUnlock(&msdp->mtx);
+}
+
+/**
+ * @brief   USB device suspend handler.
+ * @details Aborts the command in progress and generates a
+ *          @p MSD_DISCONNECTED event.
+ * @note    To be called on USB reset, unconfiguration and suspend.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ *
+ * @iclass
+ */
+void msdSuspendHookI(USBMassStorageDriver *msdp) {
+
+  osalThreadResumeI(&msdp->wait, MSG_RESET);
+  osalEventBroadcastFlagsI(&msdp->event, MSD_DISCONNECTED);
+}
+
+/**
+ * @brief   USB device configured handler.
+ * @details The protocol thread starts waiting for commands.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ *
+ * @iclass
+ */
+void msdConfigureHookI(USBMassStorageDriver *msdp) {
+
+  msdp->reset = false;
+  osalThreadResumeI(&msdp->wait, MSG_OK);
+}
+
+/**
+ * @brief   Default requests hook.
+ * @details Handles the Bulk-Only Mass Storage Reset and the Get Max LUN
+ *          class requests addressed to the mass storage interface.
+ *
+ * @param[in] msdp      pointer to a @p USBMassStorageDriver object
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @return              The hook status.
+ * @retval true         Message handled internally.
+ * @retval false        Message not handled.
+ */
+bool msdRequestsHook(USBMassStorageDriver *msdp, USBDriver *usbp) {
+
+  if (((usbp->setup[0] & (USB_RTYPE_TYPE_MASK | USB_RTYPE_RECIPIENT_MASK)) !=
+       (USB_RTYPE_TYPE_CLASS | USB_RTYPE_RECIPIENT_INTERFACE)) ||
+      (usbp->setup[4] != msdp->config->interface)) {
+    return false;
+  }
+
+  switch (usbp->setup[1]) {
+  case MSD_REQ_RESET:
+    osalSysLockFromISR();
+    msdp->reset = true;
+    osalThreadResumeI(&msdp->wait, MSG_RESET);
+    osalSysUnlockFromISR();
+    usbSetupTransfer(usbp, NULL, 0, NULL);
+    return true;
+  case MSD_REQ_GET_MAX_LUN:
+    usbSetupTransfer(usbp, &max_lun, 1, NULL);
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief   Default data transmitted callback.
+ * @details The application must use this function as callback for the
+ *          IN data endpoint.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        IN endpoint number
+ */
+void msdDataTransmitted(USBDriver *usbp, usbep_t ep) {
+  USBMassStorageDriver *msdp = usbp->in_params[ep - 1U];
+
+  if (msdp == NULL) {
+    return;
+  }
+
+  osalSysLockFromISR();
+  osalThreadResumeI(&msdp->wait, MSG_OK);
+  osalSysUnlockFromISR();
+}
+
+/**
+ * @brief   Default data received callback.
+ * @details The application must use this function as callback for the
+ *          OUT data endpoint.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        OUT endpoint number
+ */
+void msdDataReceived(USBDriver *usbp, usbep_t ep) {
+  USBMassStorageDriver *msdp = usbp->out_params[ep - 1U];
+
+  if (msdp == NULL) {
+    return;
+  }
+
+  osalSysLockFromISR();
+  osalThreadResumeI(&msdp->wait, MSG_OK);
+  osalSysUnlockFromISR();
+}
+
+#endif /* HAL_USE_USB_MSD == TRUE */
+
+/** @} */
@@ -173,6 +173,13 @@
 #define HAL_USE_USB                 TRUE
 #endif
 
+/**
+ * @brief   Enables the USB_MSD subsystem.
+ */
+#if !defined(HAL_USE_USB_MSD) || defined(__DOXYGEN__)
+#define HAL_USE_USB_MSD             FALSE
+#endif
+
 /**
  * @brief   Enables the WDG subsystem.
  */
@@ -431,6 +438,21 @@
 #endif
 /** @} */
 
+/*===========================================================================*/
+/**
+ * @name USB_MSD driver related setting
+ * @{
+ */
+/*===========================================================================*/
+
+/**
+ * @brief   Number of blocks in each of the two transfer buffers.
+ */
+#if !defined(USB_MSD_BUFFER_BLOCKS) || defined(__DOXYGEN__)
+#define USB_MSD_BUFFER_BLOCKS       8
+#endif
+/** @} */
+
 #endif /* HALCONF_H */
 
 /** @} */
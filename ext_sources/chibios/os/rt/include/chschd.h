@@ -104,16 +104,63 @@
                                                  from a Memory Pool.        */
 #define CH_FLAG_TERMINATE   (tmode_t)4U     /**< @brief Termination requested
                                                  flag.                      */
+#define CH_FLAG_WKUP_MEASURE (tmode_t)8U    /**< @brief Wakeup latency
+                                                 measurement pending.       */
 /** @} */
 
 /*===========================================================================*/
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Bitmap indexed ready list.
+ * @details If enabled then the ready list is organized as one FIFO queue for
+ *          each priority level plus a bitmap of the non-empty levels. Making
+ *          a thread ready and picking the next thread become constant time
+ *          operations regardless of the number of ready threads.
+ * @note    The scheduling semantic is the same of the linear ready list.
+ * @note    The queues take about 2kB of RAM on 32 bits architectures.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_USE_BITMAP_RLIST) || defined(__DOXYGEN__)
+#define CH_CFG_USE_BITMAP_RLIST             FALSE
+#endif
+
+/**
+ * @brief   Virtual timers kept in a pairing heap.
+ * @details If enabled then, in tick-less mode, the armed virtual timers are
+ *          kept in a pairing heap ordered by expiration time instead of the
+ *          delta list. Arming a timer becomes a constant time operation and
+ *          disarming or expiring a timer takes logarithmic amortized time
+ *          regardless of the number of armed timers.
+ * @note    Requires @p CH_CFG_ST_TIMEDELTA greater than zero.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_ST_TIMERS_HEAP) || defined(__DOXYGEN__)
+#define CH_CFG_ST_TIMERS_HEAP               FALSE
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if (CH_CFG_USE_BITMAP_RLIST == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Number of priority levels in the bitmap indexed ready list.
+ * @note    Must be @p HIGHPRIO plus one.
+ */
+#define CH_RLIST_PRIO_LEVELS    256U
+
+/**
+ * @brief   Number of 32 bits words in the priority bitmap.
+ */
+#define CH_RLIST_MAP_WORDS      (CH_RLIST_PRIO_LEVELS / 32U)
+#endif
+
+#if (CH_CFG_ST_TIMERS_HEAP == TRUE) && (CH_CFG_ST_TIMEDELTA == 0)
+#error "CH_CFG_ST_TIMERS_HEAP requires tick-less mode"
+#endif
+
 #if !defined(CH_CFG_IDLE_ENTER_HOOK)
 #error "CH_CFG_IDLE_ENTER_HOOK not defined in chconf.h"
 #endif
@@ -310,6 +357,14 @@ struct ch_thread {
    * @brief   Thread statistics.
    */
   time_measurement_t    stats;
+  /**
+   * @brief   Realtime counter value when the thread was last woken up.
+   */
+  rtcnt_t               wkuptime;
+  /**
+   * @brief   Worst wakeup to run latency in realtime counter cycles.
+   */
+  rtcnt_t               wkupworst;
 #endif
 #if defined(CH_CFG_THREAD_EXTRA_FIELDS)
   /* Extra fields defined in chconf.h.*/
@@ -325,11 +380,20 @@ struct ch_thread {
 struct ch_virtual_timer {
   virtual_timer_t       *next;      /**< @brief Next timer in the list.     */
   virtual_timer_t       *prev;      /**< @brief Previous timer in the list. */
-  systime_t             delta;      /**< @brief Time delta before timeout.  */
+  systime_t             delta;      /**< @brief Time delta before timeout,
+                                                expiration time in heap
+                                                mode.                       */
   vtfunc_t              func;       /**< @brief Timer callback function
                                                 pointer.                    */
   void                  *par;       /**< @brief Timer callback function
                                                 parameter.                  */
+#if (CH_CFG_ST_TIMERS_HEAP == TRUE) || defined(__DOXYGEN__)
+  virtual_timer_t       *child;     /**< @brief First child in the heap,
+                                                @p next and @p prev link
+                                                the siblings, the first
+                                                sibling @p prev points to
+                                                the parent.                 */
+#endif
 };
 
 /**
@@ -337,6 +401,8 @@ struct ch_virtual_timer {
  * @note    The timers list is implemented as a double link bidirectional list
  *          in order to make the unlink time constant, the reset of a virtual
  *          timer is often used in the code.
+ * @note    In heap mode @p next points to the heap root and @p prev is
+ *          not used.
  */
 struct ch_virtual_timers_list {
   virtual_timer_t       *next;      /**< @brief Next timer in the delta
@@ -372,6 +438,23 @@ struct ch_ready_list {
   /* End of the fields shared with the thread_t structure.*/
   thread_t              *current;   /**< @brief The currently running
                                                 thread.                     */
+#if (CH_CFG_USE_BITMAP_RLIST == TRUE) || defined(__DOXYGEN__)
+  /**
+   * @brief   Non-empty words of @p prmap, bit N represents @p prmap[N].
+   */
+  uint32_t              prmap0;
+  /**
+   * @brief   Priority bitmap, bit N of word W represents the level W*32+N.
+   * @note    A bit can stay set after its queue has been emptied by
+   *          @p queue_dequeue(), it is cleared on the next lookup.
+   */
+  uint32_t              prmap[CH_RLIST_MAP_WORDS];
+  /**
+   * @brief   Ready threads queues, one for each priority level.
+   * @note    The @p queue field is not used in this configuration.
+   */
+  threads_queue_t       prqueue[CH_RLIST_PRIO_LEVELS];
+#endif
 };
 
 /**
@@ -451,6 +534,16 @@ struct ch_system {
  */
 #define firstprio(rlp)  ((rlp)->next->prio)
 
+#if (CH_CFG_USE_BITMAP_RLIST == FALSE) || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the priority of the first thread on the ready list.
+ * @note    Returns @p NOPRIO if the ready list is empty.
+ *
+ * @notapi
+ */
+#define rlist_firstprio() firstprio(&ch.rlist.queue)
+#endif
+
 /**
  * @brief   Current thread pointer access macro.
  * @note    This macro is not meant to be used in the application code but
@@ -641,6 +734,84 @@ static inline thread_t *queue_dequeue(thread_t *tp) {
 }
 #endif /* CH_CFG_OPTIMIZE_SPEED == TRUE */
 
+#if (CH_CFG_USE_BITMAP_RLIST == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Counts the leading zeros of a non-zero word.
+ *
+ * @param[in] w         the word, must not be zero
+ * @return              The number of leading zero bits.
+ *
+ * @notapi
+ */
+static inline unsigned rlist_clz(uint32_t w) {
+
+#if defined(__GNUC__)
+  return (unsigned)__builtin_clz(w);
+#else
+  unsigned n = 0U;
+
+  while ((w & 0x80000000U) == 0U) {
+    w <<= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/**
+ * @brief   Marks a priority level of the ready list as empty.
+ *
+ * @param[in] prio      the priority level
+ *
+ * @notapi
+ */
+static inline void rlist_clrbit(tprio_t prio) {
+  unsigned w = (unsigned)prio >> 5;
+
+  ch.rlist.prmap[w] &= ~((uint32_t)1U << ((unsigned)prio & 31U));
+  if (ch.rlist.prmap[w] == 0U) {
+    ch.rlist.prmap0 &= ~((uint32_t)1U << w);
+  }
+}
+
+/**
+ * @brief   Marks a priority level of the ready list as non-empty.
+ *
+ * @param[in] prio      the priority level
+ *
+ * @notapi
+ */
+static inline void rlist_setbit(tprio_t prio) {
+  unsigned w = (unsigned)prio >> 5;
+
+  ch.rlist.prmap[w] |= (uint32_t)1U << ((unsigned)prio & 31U);
+  ch.rlist.prmap0   |= (uint32_t)1U << w;
+}
+
+/**
+ * @brief   Returns the priority of the first thread on the ready list.
+ * @details The highest set bit of the priority bitmap is searched, levels
+ *          emptied by @p queue_dequeue() are cleared on the way.
+ * @note    Returns @p NOPRIO if the ready list is empty.
+ *
+ * @notapi
+ */
+static inline tprio_t rlist_firstprio(void) {
+
+  while (ch.rlist.prmap0 != 0U) {
+    unsigned w = 31U - rlist_clz(ch.rlist.prmap0);
+    tprio_t prio = (tprio_t)((w << 5) + (31U - rlist_clz(ch.rlist.prmap[w])));
+
+    if (queue_notempty(&ch.rlist.prqueue[prio])) {
+      return prio;
+    }
+    rlist_clrbit(prio);
+  }
+
+  return NOPRIO;
+}
+#endif /* CH_CFG_USE_BITMAP_RLIST == TRUE */
+
 /**
  * @brief   Determines if the current thread must reschedule.
  * @details This function returns @p true if there is a ready thread with
@@ -656,7 +827,7 @@ static inline bool chSchIsRescRequiredI(void) {
 
   chDbgCheckClassI();
 
-  return firstprio(&ch.rlist.queue) > currp->prio;
+  return rlist_firstprio() > currp->prio;
 }
 
 /**
@@ -674,7 +845,7 @@ static inline bool chSchCanYieldS(void) {
 
   chDbgCheckClassS();
 
-  return firstprio(&ch.rlist.queue) >= currp->prio;
+  return rlist_firstprio() >= currp->prio;
 }
 
 /**
@@ -701,7 +872,7 @@ static inline void chSchDoYieldS(void) {
  * @special
  */
 static inline void chSchPreemption(void) {
-  tprio_t p1 = firstprio(&ch.rlist.queue);
+  tprio_t p1 = rlist_firstprio();
   tprio_t p2 = currp->prio;
 
 #if CH_CFG_TIME_QUANTUM > 0
@@ -38,6 +38,18 @@
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Critical zones measurement.
+ * @details If enabled then the duration of the threads and ISRs critical
+ *          zones is measured, this adds a time measurement to each kernel
+ *          lock and unlock. The context switch and wakeup statistics are
+ *          not affected by this setting.
+ * @note    The default is @p TRUE.
+ */
+#if !defined(CH_DBG_STATISTICS_CRITICAL) || defined(__DOXYGEN__)
+#define CH_DBG_STATISTICS_CRITICAL          TRUE
+#endif
+
 #if CH_CFG_USE_TM == FALSE
 #error "CH_DBG_STATISTICS requires CH_CFG_USE_TM"
 #endif
@@ -75,6 +87,7 @@ extern "C" {
 #endif
   void _stats_init(void);
   void _stats_increase_irq(void);
+  void _stats_ready(thread_t *tp);
   void _stats_ctxswc(thread_t *ntp, thread_t *otp);
   void _stats_start_measure_crit_thd(void);
   void _stats_stop_measure_crit_thd(void);
@@ -92,6 +105,7 @@ extern "C" {
 
 /* Stub functions for when the statistics module is disabled. */
 #define _stats_increase_irq()
+#define _stats_ready(tp)
 #define _stats_ctxswc(old, new)
 #define _stats_start_measure_crit_thd()
 #define _stats_stop_measure_crit_thd()
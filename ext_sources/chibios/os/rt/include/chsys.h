@@ -392,8 +392,7 @@ static inline void chSysUnlock(void) {
      in a critical section not followed by a chSchResceduleS(), this means
      that the current thread has a lower priority than the next thread in
      the ready list.*/
-  chDbgAssert((ch.rlist.queue.next == (thread_t *)&ch.rlist.queue) ||
-              (ch.rlist.current->prio >= ch.rlist.queue.next->prio),
+  chDbgAssert(ch.rlist.current->prio >= rlist_firstprio(),
               "priority order violation");
 
   port_unlock();
@@ -481,7 +480,11 @@ static inline void chSysUnconditionalUnlock(void) {
  */
 static inline thread_t *chSysGetIdleThreadX(void) {
 
+#if CH_CFG_USE_BITMAP_RLIST == TRUE
+  return ch.rlist.prqueue[IDLEPRIO].prev;
+#else
   return ch.rlist.queue.prev;
+#endif
 }
 #endif /* CH_CFG_NO_IDLE_THREAD == FALSE */
 
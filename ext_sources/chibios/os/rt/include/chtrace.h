@@ -42,6 +42,47 @@
 #define CH_TRACE_TYPE_ISR_LEAVE             3U
 #define CH_TRACE_TYPE_HALT                  4U
 #define CH_TRACE_TYPE_USER                  5U
+#define CH_TRACE_TYPE_LOST                  6U
+#define CH_TRACE_TYPE_NAME                  7U
+/** @} */
+
+/**
+ * @name    Trace stream format
+ * @details The stream starts with a 12 bytes header: the magic string
+ *          "CHTS", the format version, a flags byte, the size of the
+ *          encoded pointers in bytes, a reserved byte and the time stamps
+ *          clock frequency as a 32 bits little endian value, zero if not
+ *          known.<br>
+ *          The header is followed by variable size records, each one made
+ *          of a type/state byte, the time stamp delta from the previous
+ *          record as an LEB128 varint and a type dependent payload of
+ *          little endian pointers:
+ *          - @p CH_TRACE_TYPE_SWITCH, switched in thread and the object
+ *            where the switched out thread went to sleep.
+ *          - @p CH_TRACE_TYPE_ISR_ENTER and @p CH_TRACE_TYPE_ISR_LEAVE, the
+ *            ISR name.
+ *          - @p CH_TRACE_TYPE_HALT, the halt reason string.
+ *          - @p CH_TRACE_TYPE_USER, the two user parameters.
+ *          - @p CH_TRACE_TYPE_LOST, number of records dropped because the
+ *            stream buffer was full, as a varint.
+ *          - @p CH_TRACE_TYPE_NAME, a pointer followed by a length byte
+ *            and the name it refers to, thread and ISR names are sent
+ *            once before the first record referring to them.
+ *          .
+ *          A @p CH_TRACE_TYPE_UNUSED byte terminates the stream.
+ * @{
+ */
+#define CH_TRACE_STREAM_MAGIC               "CHTS"
+#define CH_TRACE_STREAM_VERSION             1U
+#define CH_TRACE_STREAM_HEADER_SIZE         12U
+#define CH_TRACE_STREAM_FLAGS_RTSTAMP       1U
+#define CH_TRACE_STREAM_NAME_SIZE           31U
+#define CH_TRACE_STREAM_RECORD_MAX          (1U + 5U + (2U * sizeof (void *)))
+#define CH_TRACE_STREAM_NAME_RECORD_MAX     (1U + 1U + sizeof (void *) + 1U + \
+                                             CH_TRACE_STREAM_NAME_SIZE)
+#define CH_TRACE_STREAM_READ_MIN            (CH_TRACE_STREAM_HEADER_SIZE +    \
+                                             CH_TRACE_STREAM_NAME_RECORD_MAX +\
+                                             CH_TRACE_STREAM_RECORD_MAX)
 /** @} */
 
 /**
@@ -83,6 +124,40 @@
 #if !defined(CH_DBG_TRACE_BUFFER_SIZE) || defined(__DOXYGEN__)
 #define CH_DBG_TRACE_BUFFER_SIZE            128
 #endif
+
+/**
+ * @brief   Trace stream buffer size in bytes.
+ * @details When non-zero the traced events are also encoded in a compact
+ *          format into a byte ring that can be drained by a thread using
+ *          @p chDbgReadTraceStream() while the system is running.
+ * @note    The value must be zero or a power of two not lower than 64.
+ * @note    The stream is only allocated if @p CH_DBG_TRACE_MASK is
+ *          different from @p CH_DBG_TRACE_MASK_DISABLED.
+ */
+#if !defined(CH_DBG_TRACE_STREAM_SIZE) || defined(__DOXYGEN__)
+#define CH_DBG_TRACE_STREAM_SIZE            0
+#endif
+
+/**
+ * @brief   Trace stream time stamps clock frequency.
+ * @details Frequency of the realtime counter, written in the stream header
+ *          so that host tools can convert the time stamps. Zero means
+ *          unknown. If the port does not support the realtime counter then
+ *          the system time is used and @p CH_CFG_ST_FREQUENCY is written
+ *          instead.
+ */
+#if !defined(CH_DBG_TRACE_STREAM_CLOCK) || defined(__DOXYGEN__)
+#define CH_DBG_TRACE_STREAM_CLOCK           0
+#endif
+
+/**
+ * @brief   Trace stream names cache size.
+ * @details Number of thread and ISR names remembered by the stream reader
+ *          in order to not repeat @p CH_TRACE_TYPE_NAME records.
+ */
+#if !defined(CH_DBG_TRACE_STREAM_NAMES) || defined(__DOXYGEN__)
+#define CH_DBG_TRACE_STREAM_NAMES           16
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -93,6 +168,16 @@
 #error "CH_CFG_TRACE_HOOK not defined in chconf.h"
 #endif
 
+#if (CH_DBG_TRACE_STREAM_SIZE != 0) &&                                      \
+    ((CH_DBG_TRACE_STREAM_SIZE < 64) ||                                     \
+     ((CH_DBG_TRACE_STREAM_SIZE & (CH_DBG_TRACE_STREAM_SIZE - 1)) != 0))
+#error "CH_DBG_TRACE_STREAM_SIZE must be zero or a power of two >= 64"
+#endif
+
+#if (CH_DBG_TRACE_STREAM_SIZE != 0) && (CH_DBG_TRACE_STREAM_NAMES < 1)
+#error "CH_DBG_TRACE_STREAM_NAMES must be greater than zero"
+#endif
+
 /*===========================================================================*/
 /* Module data structures and types.                                         */
 /*===========================================================================*/
@@ -170,6 +255,51 @@ typedef struct {
 } ch_trace_event_t;
 /*lint -restore*/
 
+#if (CH_DBG_TRACE_STREAM_SIZE > 0) || defined(__DOXYGEN__)
+/**
+ * @brief   Trace stream.
+ * @details Byte ring written by the trace functions from within critical
+ *          zones and read, without locking, by a single drain thread.
+ *          The free running counters are only written by their owner side
+ *          and the buffer is accessed as volatile so that a record is
+ *          complete before the write counter covers it.
+ */
+typedef struct {
+  /**
+   * @brief   Write counter, only advanced by whole records.
+   */
+  volatile uint32_t     wrptr;
+  /**
+   * @brief   Read counter.
+   */
+  volatile uint32_t     rdptr;
+  /**
+   * @brief   Time stamp of the last written record.
+   */
+  uint32_t              laststamp;
+  /**
+   * @brief   Records dropped since the last written record.
+   */
+  uint32_t              lost;
+  /**
+   * @brief   Stream header still to be read.
+   */
+  bool                  header;
+  /**
+   * @brief   Next names cache slot to be replaced.
+   */
+  unsigned              nextname;
+  /**
+   * @brief   Names cache, pointers already described to the reader.
+   */
+  const void            *names[CH_DBG_TRACE_STREAM_NAMES];
+  /**
+   * @brief   Ring buffer.
+   */
+  volatile uint8_t      buffer[CH_DBG_TRACE_STREAM_SIZE];
+} ch_trace_stream_t;
+#endif
+
 /**
  * @brief   Trace buffer header.
  */
@@ -190,6 +320,12 @@ typedef struct {
    * @brief   Ring buffer.
    */
   ch_trace_event_t      buffer[CH_DBG_TRACE_BUFFER_SIZE];
+#if (CH_DBG_TRACE_STREAM_SIZE > 0) || defined(__DOXYGEN__)
+  /**
+   * @brief   Streamable trace.
+   */
+  ch_trace_stream_t     stream;
+#endif
 } ch_trace_buffer_t;
 #endif /* CH_DBG_TRACE_MASK != CH_DBG_TRACE_MASK_DISABLED */
 
@@ -243,6 +379,10 @@ extern "C" {
   void chDbgSuspendTrace(uint16_t mask);
   void chDbgResumeTraceI(uint16_t mask);
   void chDbgResumeTrace(uint16_t mask);
+#if (CH_DBG_TRACE_STREAM_SIZE > 0) || defined(__DOXYGEN__)
+  void chDbgStartTraceStream(void);
+  size_t chDbgReadTraceStream(uint8_t *bp, size_t n);
+#endif
 #endif /* CH_DBG_TRACE_MASK != CH_DBG_TRACE_MASK_DISABLED */
 #ifdef __cplusplus
 }
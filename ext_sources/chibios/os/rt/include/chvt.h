@@ -188,6 +188,9 @@ extern "C" {
   void chVTDoSetI(virtual_timer_t *vtp, systime_t delay,
                   vtfunc_t vtfunc, void *par);
   void chVTDoResetI(virtual_timer_t *vtp);
+#if CH_CFG_ST_TIMERS_HEAP == TRUE
+  void _vt_heap_remove(virtual_timer_t *vtp);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -351,6 +354,9 @@ static inline bool chVTGetTimersStateI(systime_t *timep) {
   if (timep != NULL) {
 #if CH_CFG_ST_TIMEDELTA == 0
     *timep = ch.vtlist.next->delta;
+#elif CH_CFG_ST_TIMERS_HEAP == TRUE
+    *timep = ch.vtlist.next->delta +
+             CH_CFG_ST_TIMEDELTA - chVTGetSystemTimeX();
 #else
     *timep = ch.vtlist.lasttime + ch.vtlist.next->delta +
              CH_CFG_ST_TIMEDELTA - chVTGetSystemTimeX();
@@ -522,6 +528,66 @@ static inline void chVTDoTickI(void) {
       chSysLockFromISR();
     }
   }
+#elif CH_CFG_ST_TIMERS_HEAP == TRUE
+  virtual_timer_t *vtp;
+  systime_t now, delta;
+
+  /* First timer to be processed.*/
+  vtp = ch.vtlist.next;
+  now = chVTGetSystemTimeX();
+
+  /* All timers within the time window are triggered and removed, the
+     heap root is always the first timer to expire.*/
+  while ((vtp != (virtual_timer_t *)&ch.vtlist) &&
+         ((systime_t)(vtp->delta - ch.vtlist.lasttime) <=
+          (systime_t)(now - ch.vtlist.lasttime))) {
+    vtfunc_t fn;
+
+    /* The "last time" becomes this timer's expiration time.*/
+    ch.vtlist.lasttime = vtp->delta;
+
+    _vt_heap_remove(vtp);
+    fn = vtp->func;
+    vtp->func = NULL;
+
+    /* if the heap becomes empty then the timer is stopped.*/
+    if (ch.vtlist.next == (virtual_timer_t *)&ch.vtlist) {
+      port_timer_stop_alarm();
+    }
+
+    /* Leaving the system critical zone in order to execute the callback
+       and in order to give a preemption chance to higher priority
+       interrupts.*/
+    chSysUnlockFromISR();
+
+    /* The callback is invoked outside the kernel critical zone.*/
+    fn(vtp->par);
+
+    /* Re-entering the critical zone in order to continue the exploration
+       of the heap.*/
+    chSysLockFromISR();
+
+    /* Next timer to expire, the current time could have advanced so
+       recalculating the time window.*/
+    vtp = ch.vtlist.next;
+    now = chVTGetSystemTimeX();
+  }
+
+  /* if the heap is empty, nothing else to do.*/
+  if (ch.vtlist.next == (virtual_timer_t *)&ch.vtlist) {
+    return;
+  }
+
+  /* Recalculating the next alarm time.*/
+  delta = vtp->delta - now;
+  if (delta < (systime_t)CH_CFG_ST_TIMEDELTA) {
+    delta = (systime_t)CH_CFG_ST_TIMEDELTA;
+  }
+  port_timer_set_alarm(now + delta);
+
+  chDbgAssert((chVTGetSystemTimeX() - ch.vtlist.lasttime) <=
+              (now + delta - ch.vtlist.lasttime),
+              "exceeding delta");
 #else /* CH_CFG_ST_TIMEDELTA > 0 */
   virtual_timer_t *vtp;
   systime_t now, delta;
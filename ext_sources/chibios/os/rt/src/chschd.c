@@ -53,6 +53,29 @@ ch_system_t ch;
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+/**
+ * @brief   Removes the first thread from the ready list and returns it.
+ * @pre     The ready list must not be empty.
+ *
+ * @return              The removed thread pointer.
+ *
+ * @notapi
+ */
+static inline thread_t *rlist_remove_first(void) {
+#if CH_CFG_USE_BITMAP_RLIST == TRUE
+  tprio_t prio = rlist_firstprio();
+  thread_t *tp = queue_fifo_remove(&ch.rlist.prqueue[prio]);
+
+  if (queue_isempty(&ch.rlist.prqueue[prio])) {
+    rlist_clrbit(prio);
+  }
+
+  return tp;
+#else
+  return queue_fifo_remove(&ch.rlist.queue);
+#endif
+}
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -66,6 +89,19 @@ void _scheduler_init(void) {
 
   queue_init(&ch.rlist.queue);
   ch.rlist.prio = NOPRIO;
+#if CH_CFG_USE_BITMAP_RLIST == TRUE
+  {
+    unsigned i;
+
+    ch.rlist.prmap0 = 0U;
+    for (i = 0U; i < CH_RLIST_MAP_WORDS; i++) {
+      ch.rlist.prmap[i] = 0U;
+    }
+    for (i = 0U; i < CH_RLIST_PRIO_LEVELS; i++) {
+      queue_init(&ch.rlist.prqueue[i]);
+    }
+  }
+#endif
 #if CH_CFG_USE_REGISTRY == TRUE
   ch.rlist.newer = (thread_t *)&ch.rlist;
   ch.rlist.older = (thread_t *)&ch.rlist;
@@ -216,7 +252,9 @@ thread_t *list_remove(threads_list_t *tlp) {
  * @iclass
  */
 thread_t *chSchReadyI(thread_t *tp) {
+#if CH_CFG_USE_BITMAP_RLIST == FALSE
   thread_t *cp;
+#endif
 
   chDbgCheckClassI();
   chDbgCheck(tp != NULL);
@@ -224,7 +262,13 @@ thread_t *chSchReadyI(thread_t *tp) {
               (tp->state != CH_STATE_FINAL),
               "invalid state");
 
+  _stats_ready(tp);
   tp->state = CH_STATE_READY;
+#if CH_CFG_USE_BITMAP_RLIST == TRUE
+  /* Insertion at the end of the priority level queue.*/
+  queue_insert(tp, &ch.rlist.prqueue[tp->prio]);
+  rlist_setbit(tp->prio);
+#else
   cp = (thread_t *)&ch.rlist.queue;
   do {
     cp = cp->queue.next;
@@ -234,6 +278,7 @@ thread_t *chSchReadyI(thread_t *tp) {
   tp->queue.prev             = cp->queue.prev;
   tp->queue.prev->queue.next = tp;
   cp->queue.prev             = tp;
+#endif
 
   return tp;
 }
@@ -263,11 +308,18 @@ thread_t *chSchReadyAheadI(thread_t *tp) {
               (tp->state != CH_STATE_FINAL),
               "invalid state");
 
+  _stats_ready(tp);
   tp->state = CH_STATE_READY;
+#if CH_CFG_USE_BITMAP_RLIST == TRUE
+  /* Insertion at the start of the priority level queue.*/
+  cp = ch.rlist.prqueue[tp->prio].next;
+  rlist_setbit(tp->prio);
+#else
   cp = (thread_t *)&ch.rlist.queue;
   do {
     cp = cp->queue.next;
   } while (cp->prio > tp->prio);
+#endif
   /* Insertion on prev.*/
   tp->queue.next             = cp;
   tp->queue.prev             = cp->queue.prev;
@@ -301,7 +353,7 @@ void chSchGoSleepS(tstate_t newstate) {
 #endif
 
   /* Next thread in ready list becomes current.*/
-  currp = queue_fifo_remove(&ch.rlist.queue);
+  currp = rlist_remove_first();
   currp->state = CH_STATE_CURRENT;
 
   /* Handling idle-enter hook.*/
@@ -413,8 +465,7 @@ void chSchWakeupS(thread_t *ntp, msg_t msg) {
 
   chDbgCheckClassS();
 
-  chDbgAssert((ch.rlist.queue.next == (thread_t *)&ch.rlist.queue) ||
-              (ch.rlist.current->prio >= ch.rlist.queue.next->prio),
+  chDbgAssert(ch.rlist.current->prio >= rlist_firstprio(),
               "priority order violation");
 
   /* Storing the message to be retrieved by the target thread when it will
@@ -475,7 +526,7 @@ void chSchRescheduleS(void) {
  * @special
  */
 bool chSchIsPreemptionRequired(void) {
-  tprio_t p1 = firstprio(&ch.rlist.queue);
+  tprio_t p1 = rlist_firstprio();
   tprio_t p2 = currp->prio;
 
 #if CH_CFG_TIME_QUANTUM > 0
@@ -505,7 +556,7 @@ void chSchDoRescheduleBehind(void) {
   thread_t *otp = currp;
 
   /* Picks the first thread from the ready queue and makes it current.*/
-  currp = queue_fifo_remove(&ch.rlist.queue);
+  currp = rlist_remove_first();
   currp->state = CH_STATE_CURRENT;
 
   /* Handling idle-leave hook.*/
@@ -538,7 +589,7 @@ void chSchDoRescheduleAhead(void) {
   thread_t *otp = currp;
 
   /* Picks the first thread from the ready queue and makes it current.*/
-  currp = queue_fifo_remove(&ch.rlist.queue);
+  currp = rlist_remove_first();
   currp->state = CH_STATE_CURRENT;
 
   /* Handling idle-leave hook.*/
@@ -567,7 +618,7 @@ void chSchDoReschedule(void) {
   thread_t *otp = currp;
 
   /* Picks the first thread from the ready queue and makes it current.*/
-  currp = queue_fifo_remove(&ch.rlist.queue);
+  currp = rlist_remove_first();
   currp->state = CH_STATE_CURRENT;
 
   /* Handling idle-leave hook.*/
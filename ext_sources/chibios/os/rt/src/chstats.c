@@ -77,6 +77,21 @@ void _stats_increase_irq(void) {
   port_unlock_from_isr();
 }
 
+/**
+ * @brief   Starts the wakeup latency measurement of a thread.
+ * @note    Threads re-inserted in the ready list after a preemption are not
+ *          waking up and are not measured.
+ *
+ * @param[in] tp        the thread being made ready
+ */
+void _stats_ready(thread_t *tp) {
+
+  if ((tp->state != CH_STATE_CURRENT) && (tp->state != CH_STATE_READY)) {
+    tp->wkuptime = chSysGetRealtimeCounterX();
+    tp->flags |= CH_FLAG_WKUP_MEASURE;
+  }
+}
+
 /**
  * @brief   Updates context switch related statistics.
  *
@@ -87,6 +102,16 @@ void _stats_ctxswc(thread_t *ntp, thread_t *otp) {
 
   ch.kernel_stats.n_ctxswc++;
   chTMChainMeasurementToX(&otp->stats, &ntp->stats);
+
+  /* The switch time stamp closes the wakeup latency measurement.*/
+  if ((ntp->flags & CH_FLAG_WKUP_MEASURE) != (tmode_t)0) {
+    rtcnt_t latency = ntp->stats.last - ntp->wkuptime;
+
+    ntp->flags &= (tmode_t)~CH_FLAG_WKUP_MEASURE;
+    if (latency > ntp->wkupworst) {
+      ntp->wkupworst = latency;
+    }
+  }
 }
 
 /**
@@ -94,7 +119,9 @@ void _stats_ctxswc(thread_t *ntp, thread_t *otp) {
  */
 void _stats_start_measure_crit_thd(void) {
 
+#if CH_DBG_STATISTICS_CRITICAL == TRUE
   chTMStartMeasurementX(&ch.kernel_stats.m_crit_thd);
+#endif
 }
 
 /**
@@ -102,7 +129,9 @@ void _stats_start_measure_crit_thd(void) {
  */
 void _stats_stop_measure_crit_thd(void) {
 
+#if CH_DBG_STATISTICS_CRITICAL == TRUE
   chTMStopMeasurementX(&ch.kernel_stats.m_crit_thd);
+#endif
 }
 
 /**
@@ -110,7 +139,9 @@ void _stats_stop_measure_crit_thd(void) {
  */
 void _stats_start_measure_crit_isr(void) {
 
+#if CH_DBG_STATISTICS_CRITICAL == TRUE
   chTMStartMeasurementX(&ch.kernel_stats.m_crit_isr);
+#endif
 }
 
 /**
@@ -118,7 +149,9 @@ void _stats_start_measure_crit_isr(void) {
  */
 void _stats_stop_measure_crit_isr(void) {
 
+#if CH_DBG_STATISTICS_CRITICAL == TRUE
   chTMStopMeasurementX(&ch.kernel_stats.m_crit_isr);
+#endif
 }
 
 #endif /* CH_DBG_STATISTICS == TRUE */
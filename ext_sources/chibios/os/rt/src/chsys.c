@@ -240,6 +240,44 @@ bool chSysIntegrityCheckI(unsigned testmask) {
   if ((testmask & CH_INTEGRITY_RLIST) != 0U) {
     thread_t *tp;
 
+#if CH_CFG_USE_BITMAP_RLIST == TRUE
+    tprio_t prio;
+
+    for (prio = (tprio_t)0; prio < (tprio_t)CH_RLIST_PRIO_LEVELS; prio++) {
+      threads_queue_t *tqp = &ch.rlist.prqueue[prio];
+
+      /* Scanning the level queue forward.*/
+      n = (cnt_t)0;
+      tp = tqp->next;
+      while (tp != (thread_t *)tqp) {
+        n++;
+        tp = tp->queue.next;
+      }
+
+      /* Scanning the level queue backward.*/
+      tp = tqp->prev;
+      while (tp != (thread_t *)tqp) {
+        n--;
+        tp = tp->queue.prev;
+      }
+
+      /* The number of elements must match.*/
+      if (n != (cnt_t)0) {
+        return true;
+      }
+
+      /* A non-empty level must be marked in both bitmap levels.*/
+      if (queue_notempty(tqp)) {
+        unsigned w = (unsigned)prio >> 5;
+        uint32_t mask = (uint32_t)1U << ((unsigned)prio & 31U);
+
+        if (((ch.rlist.prmap[w] & mask) == 0U) ||
+            ((ch.rlist.prmap0 & ((uint32_t)1U << w)) == 0U)) {
+          return true;
+        }
+      }
+    }
+#else
     /* Scanning the ready list forward.*/
     n = (cnt_t)0;
     tp = ch.rlist.queue.next;
@@ -259,10 +297,62 @@ bool chSysIntegrityCheckI(unsigned testmask) {
     if (n != (cnt_t)0) {
       return true;
     }
+#endif
   }
 
   /* Timers list integrity check.*/
   if ((testmask & CH_INTEGRITY_VTLIST) != 0U) {
+#if CH_CFG_ST_TIMERS_HEAP == TRUE
+    virtual_timer_t *vtp, *root;
+
+    root = ch.vtlist.next;
+    if (root != (virtual_timer_t *)&ch.vtlist) {
+      if ((root->prev != (virtual_timer_t *)&ch.vtlist) ||
+          (root->next != NULL)) {
+        return true;
+      }
+
+      /* Visiting the whole heap depth first, each node must not expire
+         before its parent and the siblings must be double linked.*/
+      vtp = root;
+      while (vtp != NULL) {
+        virtual_timer_t *cp;
+
+        for (cp = vtp->child; cp != NULL; cp = cp->next) {
+          if ((systime_t)(cp->delta - ch.vtlist.lasttime) <
+              (systime_t)(vtp->delta - ch.vtlist.lasttime)) {
+            return true;
+          }
+          if ((cp->next != NULL) && (cp->next->prev != cp)) {
+            return true;
+          }
+        }
+        if ((vtp->child != NULL) && (vtp->child->prev != vtp)) {
+          return true;
+        }
+
+        if (vtp->child != NULL) {
+          vtp = vtp->child;
+        }
+        else {
+          /* Going up until a node with a next sibling is found, the parent
+             is pointed by the first sibling.*/
+          while ((vtp != root) && (vtp->next == NULL)) {
+            while (vtp->prev->child != vtp) {
+              vtp = vtp->prev;
+            }
+            vtp = vtp->prev;
+          }
+          if (vtp == root) {
+            vtp = NULL;
+          }
+          else {
+            vtp = vtp->next;
+          }
+        }
+      }
+    }
+#else /* CH_CFG_ST_TIMERS_HEAP == FALSE */
     virtual_timer_t * vtp;
 
     /* Scanning the timers list forward.*/
@@ -284,6 +374,7 @@ bool chSysIntegrityCheckI(unsigned testmask) {
     if (n != (cnt_t)0) {
       return true;
     }
+#endif /* CH_CFG_ST_TIMERS_HEAP == FALSE */
   }
 
 #if CH_CFG_USE_REGISTRY == TRUE
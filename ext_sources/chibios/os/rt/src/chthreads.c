@@ -118,6 +118,8 @@ thread_t *_thread_init(thread_t *tp, const char *name, tprio_t prio) {
 #endif
 #if CH_DBG_STATISTICS == TRUE
   chTMObjectInit(&tp->stats);
+  tp->wkuptime  = (rtcnt_t)0;
+  tp->wkupworst = (rtcnt_t)0;
 #endif
   CH_CFG_THREAD_INIT_HOOK(tp);
   return tp;
@@ -32,6 +32,14 @@
 /* Module local definitions.                                                 */
 /*===========================================================================*/
 
+#if (CH_DBG_TRACE_MASK != CH_DBG_TRACE_MASK_DISABLED) &&                    \
+    (CH_DBG_TRACE_STREAM_SIZE > 0)
+/**
+ * @brief   Trace stream ring index mask.
+ */
+#define TRACE_STREAM_MASK       ((uint32_t)CH_DBG_TRACE_STREAM_SIZE - 1U)
+#endif
+
 /*===========================================================================*/
 /* Module exported variables.                                                */
 /*===========================================================================*/
@@ -40,6 +48,18 @@
 /* Module local types.                                                       */
 /*===========================================================================*/
 
+#if (CH_DBG_TRACE_MASK != CH_DBG_TRACE_MASK_DISABLED) &&                    \
+    (CH_DBG_TRACE_STREAM_SIZE > 0)
+/**
+ * @brief   Type of the trace stream time stamps.
+ */
+#if (PORT_SUPPORTS_RT == TRUE) || defined(__DOXYGEN__)
+typedef rtcnt_t trace_stamp_t;
+#else
+typedef systime_t trace_stamp_t;
+#endif
+#endif
+
 /*===========================================================================*/
 /* Module local variables.                                                   */
 /*===========================================================================*/
@@ -49,20 +69,278 @@
 /*===========================================================================*/
 
 #if (CH_DBG_TRACE_MASK != CH_DBG_TRACE_MASK_DISABLED) || defined(__DOXYGEN__)
+#if (CH_DBG_TRACE_STREAM_SIZE > 0) || defined(__DOXYGEN__)
+/**
+ * @brief   Writes a varint in the trace stream.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] wr        write position
+ * @param[in] x         value to be written
+ * @return              The next write position.
+ *
+ * @notapi
+ */
+static uint32_t stream_put_varint(ch_trace_stream_t *tsp,
+                                  uint32_t wr, uint32_t x) {
+
+  while (x >= 0x80U) {
+    tsp->buffer[wr & TRACE_STREAM_MASK] = (uint8_t)(x | 0x80U);
+    wr++;
+    x >>= 7;
+  }
+  tsp->buffer[wr & TRACE_STREAM_MASK] = (uint8_t)x;
+
+  return wr + 1U;
+}
+
+/**
+ * @brief   Writes a pointer in the trace stream.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] wr        write position
+ * @param[in] p         pointer to be written
+ * @return              The next write position.
+ *
+ * @notapi
+ */
+static uint32_t stream_put_ptr(ch_trace_stream_t *tsp,
+                               uint32_t wr, const void *p) {
+  uintptr_t x = (uintptr_t)p;
+  unsigned i;
+
+  for (i = 0U; i < sizeof (void *); i++) {
+    tsp->buffer[wr & TRACE_STREAM_MASK] = (uint8_t)x;
+    wr++;
+    x >>= 8;
+  }
+
+  return wr;
+}
+
+/**
+ * @brief   Reads a byte from the trace stream.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] rd        read position
+ * @return              The byte value.
+ *
+ * @notapi
+ */
+static inline uint8_t stream_get(ch_trace_stream_t *tsp, uint32_t rd) {
+
+  return tsp->buffer[rd & TRACE_STREAM_MASK];
+}
+
+/**
+ * @brief   Skips a varint in the trace stream.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] rd        read position
+ * @return              The position after the varint.
+ *
+ * @notapi
+ */
+static uint32_t stream_skip_varint(ch_trace_stream_t *tsp, uint32_t rd) {
+
+  while ((stream_get(tsp, rd) & 0x80U) != 0U) {
+    rd++;
+  }
+
+  return rd + 1U;
+}
+
+/**
+ * @brief   Reads a pointer from the trace stream.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] rd        read position
+ * @return              The pointer value.
+ *
+ * @notapi
+ */
+static const void *stream_get_ptr(ch_trace_stream_t *tsp, uint32_t rd) {
+  uintptr_t x = 0U;
+  unsigned i = (unsigned)sizeof (void *);
+
+  while (i > 0U) {
+    i--;
+    x = (x << 8) | (uintptr_t)stream_get(tsp, rd + (uint32_t)i);
+  }
+
+  return (const void *)x;
+}
+
+/**
+ * @brief   Size of the stream record at the specified position.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] rd        record position
+ * @return              The record size in bytes.
+ *
+ * @notapi
+ */
+static uint32_t stream_record_size(ch_trace_stream_t *tsp, uint32_t rd) {
+  uint32_t p = stream_skip_varint(tsp, rd + 1U);
+
+  switch (stream_get(tsp, rd) & 7U) {
+  case CH_TRACE_TYPE_SWITCH:
+  case CH_TRACE_TYPE_USER:
+    p += 2U * (uint32_t)sizeof (void *);
+    break;
+  case CH_TRACE_TYPE_ISR_ENTER:
+  case CH_TRACE_TYPE_ISR_LEAVE:
+  case CH_TRACE_TYPE_HALT:
+    p += (uint32_t)sizeof (void *);
+    break;
+  case CH_TRACE_TYPE_LOST:
+    p = stream_skip_varint(tsp, p);
+    break;
+  default:
+    break;
+  }
+
+  return p - rd;
+}
+
+/**
+ * @brief   Pointer of a stream record still to be described by name.
+ *
+ * @param[in] tsp       pointer to the trace stream
+ * @param[in] rd        record position
+ * @param[out] namep    name associated to the pointer, @p NULL if the
+ *                      name is not known
+ * @return              The pointer to be described or @p NULL if the
+ *                      record does not need a name record.
+ *
+ * @notapi
+ */
+static const void *stream_unnamed_ptr(ch_trace_stream_t *tsp, uint32_t rd,
+                                      const char **namep) {
+  uint8_t type = stream_get(tsp, rd) & 7U;
+  const void *p;
+  unsigned i;
+
+  if ((type != CH_TRACE_TYPE_SWITCH) && (type != CH_TRACE_TYPE_ISR_ENTER) &&
+      (type != CH_TRACE_TYPE_ISR_LEAVE) && (type != CH_TRACE_TYPE_HALT)) {
+    return NULL;
+  }
+
+  p = stream_get_ptr(tsp, stream_skip_varint(tsp, rd + 1U));
+  if (p == NULL) {
+    return NULL;
+  }
+  for (i = 0U; i < (unsigned)CH_DBG_TRACE_STREAM_NAMES; i++) {
+    if (tsp->names[i] == p) {
+      return NULL;
+    }
+  }
+
+  *namep = NULL;
+  if (type == CH_TRACE_TYPE_SWITCH) {
+#if CH_CFG_USE_REGISTRY == TRUE
+    /* The whole registry is scanned so that the references taken by the
+       iterator are released.*/
+    thread_t *tp = chRegFirstThread();
+    while (tp != NULL) {
+      if ((const void *)tp == p) {
+        *namep = chRegGetThreadNameX(tp);
+      }
+      tp = chRegNextThread(tp);
+    }
+#endif
+  }
+  else {
+    *namep = (const char *)p;
+  }
+
+  return p;
+}
+
+/**
+ * @brief   Encodes a trace record in the trace stream.
+ * @note    Records not fitting the stream are dropped and counted, the
+ *          count is written in a @p CH_TRACE_TYPE_LOST record as soon as
+ *          there is space again.
+ *
+ * @param[in] tep       the trace record
+ * @param[in] stamp     the record time stamp
+ *
+ * @notapi
+ */
+static void trace_stream_write(ch_trace_event_t *tep, trace_stamp_t stamp) {
+  ch_trace_stream_t *tsp = &ch.dbg.trace_buffer.stream;
+  uint32_t wr = tsp->wrptr;
+  uint32_t space = (uint32_t)CH_DBG_TRACE_STREAM_SIZE - (wr - tsp->rdptr);
+  uint32_t delta;
+
+  if (space < ((tsp->lost > 0U ? 2U : 1U) * CH_TRACE_STREAM_RECORD_MAX)) {
+    tsp->lost++;
+    return;
+  }
+
+  delta = (uint32_t)(trace_stamp_t)(stamp - (trace_stamp_t)tsp->laststamp);
+  tsp->laststamp = (uint32_t)stamp;
+  if (tsp->lost > 0U) {
+    tsp->buffer[wr & TRACE_STREAM_MASK] = (uint8_t)CH_TRACE_TYPE_LOST;
+    wr = stream_put_varint(tsp, wr + 1U, delta);
+    wr = stream_put_varint(tsp, wr, tsp->lost);
+    tsp->lost = 0U;
+    delta = 0U;
+  }
+
+  tsp->buffer[wr & TRACE_STREAM_MASK] = (uint8_t)(tep->type |
+                                                  (tep->state << 3));
+  wr = stream_put_varint(tsp, wr + 1U, delta);
+  switch (tep->type) {
+  case CH_TRACE_TYPE_SWITCH:
+    wr = stream_put_ptr(tsp, wr, tep->u.sw.ntp);
+    wr = stream_put_ptr(tsp, wr, tep->u.sw.wtobjp);
+    break;
+  case CH_TRACE_TYPE_ISR_ENTER:
+  case CH_TRACE_TYPE_ISR_LEAVE:
+    wr = stream_put_ptr(tsp, wr, tep->u.isr.name);
+    break;
+  case CH_TRACE_TYPE_HALT:
+    wr = stream_put_ptr(tsp, wr, tep->u.halt.reason);
+    break;
+  case CH_TRACE_TYPE_USER:
+    wr = stream_put_ptr(tsp, wr, tep->u.user.up1);
+    wr = stream_put_ptr(tsp, wr, tep->u.user.up2);
+    break;
+  default:
+    break;
+  }
+
+  /* The record becomes visible to the reader as a whole.*/
+  tsp->wrptr = wr;
+}
+#endif /* CH_DBG_TRACE_STREAM_SIZE > 0 */
+
 /**
  * @brief   Writes a time stamp and increases the trace buffer pointer.
  *
  * @notapi
  */
 static NOINLINE void trace_next(void) {
+#if PORT_SUPPORTS_RT == TRUE
+  rtcnt_t rt = chSysGetRealtimeCounterX();
+#endif
 
   ch.dbg.trace_buffer.ptr->time    = chVTGetSystemTimeX();
 #if PORT_SUPPORTS_RT == TRUE
-  ch.dbg.trace_buffer.ptr->rtstamp = chSysGetRealtimeCounterX();
+  ch.dbg.trace_buffer.ptr->rtstamp = rt;
 #else
   ch.dbg.trace_buffer.ptr->rtstamp = (rtcnt_t)0;
 #endif
 
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+#if PORT_SUPPORTS_RT == TRUE
+  trace_stream_write(ch.dbg.trace_buffer.ptr, rt);
+#else
+  trace_stream_write(ch.dbg.trace_buffer.ptr, ch.dbg.trace_buffer.ptr->time);
+#endif
+#endif
+
   /* Trace hook, useful in order to interface debug tools.*/
   CH_CFG_TRACE_HOOK(ch.dbg.trace_buffer.ptr);
 
@@ -85,12 +363,23 @@ static NOINLINE void trace_next(void) {
 void _trace_init(void) {
   unsigned i;
 
-  ch.dbg.trace_buffer.suspended = (uint16_t)CH_DBG_TRACE_MASK;
+  ch.dbg.trace_buffer.suspended = (uint16_t)~CH_DBG_TRACE_MASK;
   ch.dbg.trace_buffer.size      = CH_DBG_TRACE_BUFFER_SIZE;
   ch.dbg.trace_buffer.ptr       = &ch.dbg.trace_buffer.buffer[0];
   for (i = 0U; i < (unsigned)CH_DBG_TRACE_BUFFER_SIZE; i++) {
     ch.dbg.trace_buffer.buffer[i].type = CH_TRACE_TYPE_UNUSED;
   }
+#if CH_DBG_TRACE_STREAM_SIZE > 0
+  ch.dbg.trace_buffer.stream.wrptr     = 0U;
+  ch.dbg.trace_buffer.stream.rdptr     = 0U;
+  ch.dbg.trace_buffer.stream.laststamp = 0U;
+  ch.dbg.trace_buffer.stream.lost      = 0U;
+  ch.dbg.trace_buffer.stream.header    = true;
+  ch.dbg.trace_buffer.stream.nextname  = 0U;
+  for (i = 0U; i < (unsigned)CH_DBG_TRACE_STREAM_NAMES; i++) {
+    ch.dbg.trace_buffer.stream.names[i] = NULL;
+  }
+#endif
 }
 
 /**
@@ -260,6 +549,131 @@ void chDbgResumeTrace(uint16_t mask) {
   chDbgResumeTraceI(mask);
   chSysUnlock();
 }
+
+#if (CH_DBG_TRACE_STREAM_SIZE > 0) || defined(__DOXYGEN__)
+/**
+ * @brief   Starts a new trace stream capture.
+ * @details Discards the records not yet read and makes the next
+ *          @p chDbgReadTraceStream() call return the stream header
+ *          followed by the names of the referred threads and ISRs.
+ *
+ * @api
+ */
+void chDbgStartTraceStream(void) {
+  ch_trace_stream_t *tsp = &ch.dbg.trace_buffer.stream;
+  unsigned i;
+
+  chSysLock();
+  tsp->rdptr = tsp->wrptr;
+  tsp->lost  = 0U;
+  chSysUnlock();
+
+  tsp->header   = true;
+  tsp->nextname = 0U;
+  for (i = 0U; i < (unsigned)CH_DBG_TRACE_STREAM_NAMES; i++) {
+    tsp->names[i] = NULL;
+  }
+}
+
+/**
+ * @brief   Reads whole records from the trace stream.
+ * @details The records are read without entering a critical zone, this
+ *          function is meant to be called by a single drain thread
+ *          forwarding the stream to a host.
+ * @note    The buffer must be at least @p CH_TRACE_STREAM_READ_MIN bytes,
+ *          enough for a stream header, a name record and a trace record.
+ *
+ * @param[out] bp       pointer to the buffer
+ * @param[in] n         buffer size
+ * @return              The number of bytes written in the buffer, zero
+ *                      if there are no records to be read.
+ *
+ * @api
+ */
+size_t chDbgReadTraceStream(uint8_t *bp, size_t n) {
+  ch_trace_stream_t *tsp = &ch.dbg.trace_buffer.stream;
+  uint32_t rd = tsp->rdptr;
+  uint32_t wr = tsp->wrptr;
+  size_t i = 0U;
+
+  chDbgCheck((bp != NULL) && (n >= CH_TRACE_STREAM_READ_MIN));
+
+  if (tsp->header) {
+    uint32_t clock;
+
+#if PORT_SUPPORTS_RT == TRUE
+    clock = (uint32_t)CH_DBG_TRACE_STREAM_CLOCK;
+    bp[5] = (uint8_t)CH_TRACE_STREAM_FLAGS_RTSTAMP;
+#else
+    clock = (uint32_t)CH_CFG_ST_FREQUENCY;
+    bp[5] = 0U;
+#endif
+    bp[0]  = (uint8_t)CH_TRACE_STREAM_MAGIC[0];
+    bp[1]  = (uint8_t)CH_TRACE_STREAM_MAGIC[1];
+    bp[2]  = (uint8_t)CH_TRACE_STREAM_MAGIC[2];
+    bp[3]  = (uint8_t)CH_TRACE_STREAM_MAGIC[3];
+    bp[4]  = (uint8_t)CH_TRACE_STREAM_VERSION;
+    bp[6]  = (uint8_t)sizeof (void *);
+    bp[7]  = 0U;
+    bp[8]  = (uint8_t)clock;
+    bp[9]  = (uint8_t)(clock >> 8);
+    bp[10] = (uint8_t)(clock >> 16);
+    bp[11] = (uint8_t)(clock >> 24);
+    i = CH_TRACE_STREAM_HEADER_SIZE;
+    tsp->header = false;
+  }
+
+  while (rd != wr) {
+    uint32_t size = stream_record_size(tsp, rd);
+    const char *name = NULL;
+    const void *p = stream_unnamed_ptr(tsp, rd, &name);
+    size_t len = 0U;
+    uint32_t j;
+
+    if (name != NULL) {
+      while ((len < CH_TRACE_STREAM_NAME_SIZE) && (name[len] != '\0')) {
+        len++;
+      }
+      if (i + (1U + 1U + sizeof (void *) + 1U + len + size) > n) {
+        break;
+      }
+    }
+    else if (i + size > n) {
+      break;
+    }
+
+    if (p != NULL) {
+      tsp->names[tsp->nextname] = p;
+      if (++tsp->nextname >= (unsigned)CH_DBG_TRACE_STREAM_NAMES) {
+        tsp->nextname = 0U;
+      }
+    }
+    if (name != NULL) {
+      uintptr_t x = (uintptr_t)p;
+
+      bp[i++] = (uint8_t)CH_TRACE_TYPE_NAME;
+      bp[i++] = 0U;
+      for (j = 0U; j < (uint32_t)sizeof (void *); j++) {
+        bp[i++] = (uint8_t)x;
+        x >>= 8;
+      }
+      bp[i++] = (uint8_t)len;
+      for (j = 0U; j < (uint32_t)len; j++) {
+        bp[i++] = (uint8_t)name[j];
+      }
+    }
+    for (j = 0U; j < size; j++) {
+      bp[i++] = stream_get(tsp, rd + j);
+    }
+    rd += size;
+  }
+
+  /* Releasing the read records to the writer.*/
+  tsp->rdptr = rd;
+
+  return i;
+}
+#endif /* CH_DBG_TRACE_STREAM_SIZE > 0 */
 #endif /* CH_DBG_TRACE_MASK != CH_DBG_TRACE_MASK_DISABLED */
 
 /** @} */
@@ -48,6 +48,108 @@
 /* Module local functions.                                                   */
 /*===========================================================================*/
 
+#if (CH_CFG_ST_TIMERS_HEAP == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Joins two heaps.
+ * @details The root expiring later becomes the first child of the other.
+ * @note    The @p next and @p prev fields of the returned root are left
+ *          to the caller.
+ *
+ * @param[in] a         root of the first heap
+ * @param[in] b         root of the second heap
+ * @return              The root of the joined heap.
+ *
+ * @notapi
+ */
+static virtual_timer_t *vt_heap_meld(virtual_timer_t *a, virtual_timer_t *b) {
+
+  /* Expiration times are compared as distances from the last tick event,
+     no armed timer expires before it.*/
+  if ((systime_t)(b->delta - ch.vtlist.lasttime) <
+      (systime_t)(a->delta - ch.vtlist.lasttime)) {
+    virtual_timer_t *tmp = a;
+    a = b;
+    b = tmp;
+  }
+
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+
+  return a;
+}
+
+/**
+ * @brief   Joins a list of siblings into a single heap.
+ * @details Two passes pairing: siblings are joined pairwise left to right,
+ *          then the resulting heaps are joined right to left.
+ *
+ * @param[in] vtp       first sibling or @p NULL
+ * @return              The root of the joined heap or @p NULL.
+ *
+ * @notapi
+ */
+static virtual_timer_t *vt_heap_merge_pairs(virtual_timer_t *vtp) {
+  virtual_timer_t *acc = NULL;
+
+  /* First pass, the joined pairs are chained in reverse order using the
+     next field.*/
+  while (vtp != NULL) {
+    virtual_timer_t *a = vtp;
+    virtual_timer_t *b = a->next;
+
+    if (b == NULL) {
+      a->next = acc;
+      acc = a;
+      break;
+    }
+    vtp = b->next;
+    a = vt_heap_meld(a, b);
+    a->next = acc;
+    acc = a;
+  }
+
+  if (acc == NULL) {
+    return NULL;
+  }
+
+  /* Second pass, joining from the last pair back to the first.*/
+  vtp = acc;
+  acc = acc->next;
+  while (acc != NULL) {
+    virtual_timer_t *next = acc->next;
+
+    vtp = vt_heap_meld(vtp, acc);
+    acc = next;
+  }
+  vtp->next = NULL;
+
+  return vtp;
+}
+
+/**
+ * @brief   Makes a timer the root of the timers heap.
+ *
+ * @param[in] vtp       the new root or @p NULL if the heap is empty
+ *
+ * @notapi
+ */
+static inline void vt_heap_set_root(virtual_timer_t *vtp) {
+
+  if (vtp == NULL) {
+    ch.vtlist.next = (virtual_timer_t *)&ch.vtlist;
+  }
+  else {
+    vtp->next = NULL;
+    vtp->prev = (virtual_timer_t *)&ch.vtlist;
+    ch.vtlist.next = vtp;
+  }
+}
+#endif /* CH_CFG_ST_TIMERS_HEAP == TRUE */
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
@@ -70,6 +172,48 @@ void _vt_init(void) {
 #endif /* CH_CFG_ST_TIMEDELTA > 0 */
 }
 
+#if (CH_CFG_ST_TIMERS_HEAP == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Removes a timer from the timers heap.
+ * @note    The alarm is not reprogrammed and the timer is left armed.
+ * @note    Internal use only.
+ *
+ * @param[in] vtp       the @p virtual_timer_t structure pointer
+ *
+ * @notapi
+ */
+void _vt_heap_remove(virtual_timer_t *vtp) {
+  virtual_timer_t *sub;
+
+  /* The children of the removed timer are joined in a single heap.*/
+  sub = vt_heap_merge_pairs(vtp->child);
+
+  /* Removing the root, the joined children become the new heap.*/
+  if (ch.vtlist.next == vtp) {
+    vt_heap_set_root(sub);
+
+    return;
+  }
+
+  /* Unlinking from the siblings list, the first sibling is pointed by
+     the parent.*/
+  if (vtp->prev->child == vtp) {
+    vtp->prev->child = vtp->next;
+  }
+  else {
+    vtp->prev->next = vtp->next;
+  }
+  if (vtp->next != NULL) {
+    vtp->next->prev = vtp->prev;
+  }
+
+  /* The joined children are added back to the heap.*/
+  if (sub != NULL) {
+    vt_heap_set_root(vt_heap_meld(ch.vtlist.next, sub));
+  }
+}
+#endif /* CH_CFG_ST_TIMERS_HEAP == TRUE */
+
 /**
  * @brief   Enables a virtual timer.
  * @details The timer is enabled and programmed to trigger after the delay
@@ -113,6 +257,55 @@ void chVTDoSetI(virtual_timer_t *vtp, systime_t delay,
       delay = (systime_t)CH_CFG_ST_TIMEDELTA;
     }
 
+#if CH_CFG_ST_TIMERS_HEAP == TRUE
+    vtp->child = NULL;
+
+    /* Special case where the timers heap is empty.*/
+    if (&ch.vtlist == (virtual_timers_list_t *)ch.vtlist.next) {
+
+      /* The current time becomes the new reference time.*/
+      ch.vtlist.lasttime = now;
+      vtp->delta = now + delay;
+      vt_heap_set_root(vtp);
+
+      /* Being the only timer the alarm timer is started.*/
+      port_timer_start_alarm(vtp->delta);
+
+      return;
+    }
+
+    /* The reference time is moved forward to the current time, or to the
+       first expiration time if that one is already pending. The order of
+       the armed timers is preserved and the numeric range available to
+       the new timer is maximized.*/
+    p = ch.vtlist.next;
+    if ((systime_t)(p->delta - ch.vtlist.lasttime) <
+        (systime_t)(now - ch.vtlist.lasttime)) {
+      ch.vtlist.lasttime = p->delta;
+    }
+    else {
+      ch.vtlist.lasttime = now;
+    }
+
+    /* Delay as distance from the reference time. A very large delay that
+       exceeds the numeric range is clamped to the farthest time, the error
+       is bounded by the latency of the pending alarm.*/
+    delta = now - ch.vtlist.lasttime + delay;
+    if (delta < now - ch.vtlist.lasttime) {
+      delta = (systime_t)-1;
+    }
+    vtp->delta = ch.vtlist.lasttime + delta;
+
+    /* The timer is inserted in the heap.*/
+    vt_heap_set_root(vt_heap_meld(p, vtp));
+
+    /* If the timer became the first to expire then the alarm is moved.*/
+    if (ch.vtlist.next == vtp) {
+      port_timer_set_alarm(vtp->delta);
+    }
+
+    return;
+#else /* CH_CFG_ST_TIMERS_HEAP == FALSE */
     /* Special case where the timers list is empty.*/
     if (&ch.vtlist == (virtual_timers_list_t *)ch.vtlist.next) {
 
@@ -150,6 +343,7 @@ void chVTDoSetI(virtual_timer_t *vtp, systime_t delay,
         and next deadline.*/
       port_timer_set_alarm(ch.vtlist.lasttime + delta);
     }
+#endif /* CH_CFG_ST_TIMERS_HEAP == FALSE */
   }
 #else /* CH_CFG_ST_TIMEDELTA == 0 */
   /* Delta is initially equal to the specified delay.*/
@@ -206,6 +400,52 @@ void chVTDoResetI(virtual_timer_t *vtp) {
   /* The above code changes the value in the header when the removed element
      is the last of the list, restoring it.*/
   ch.vtlist.delta = (systime_t)-1;
+#elif CH_CFG_ST_TIMERS_HEAP == TRUE
+  systime_t nowdelta, delta;
+  bool first = (bool)(ch.vtlist.next == vtp);
+
+  /* Removing the element from the heap.*/
+  _vt_heap_remove(vtp);
+  vtp->func = NULL;
+
+  /* If the timer was not the first to expire then the alarm is not
+     affected.*/
+  if (!first) {
+    return;
+  }
+
+  /* If the heap become empty then the alarm timer is stopped and done.*/
+  if (&ch.vtlist == (virtual_timers_list_t *)ch.vtlist.next) {
+    port_timer_stop_alarm();
+
+    return;
+  }
+
+  /* If the new first timer expires together with the removed one then the
+     already programmed alarm will serve it.*/
+  if (ch.vtlist.next->delta == vtp->delta) {
+    return;
+  }
+
+  /* Distance in ticks between the reference time and current time.*/
+  nowdelta = chVTGetSystemTimeX() - ch.vtlist.lasttime;
+
+  /* If the current time surpassed the time of the new first timer then
+     the event interrupt is already pending, just return.*/
+  if (nowdelta >= (systime_t)(ch.vtlist.next->delta - ch.vtlist.lasttime)) {
+    return;
+  }
+
+  /* Distance from the next scheduled event and now.*/
+  delta = ch.vtlist.next->delta - ch.vtlist.lasttime - nowdelta;
+
+  /* Making sure to not schedule an event closer than CH_CFG_ST_TIMEDELTA
+     ticks from now.*/
+  if (delta < (systime_t)CH_CFG_ST_TIMEDELTA) {
+    delta = (systime_t)CH_CFG_ST_TIMEDELTA;
+  }
+
+  port_timer_set_alarm(ch.vtlist.lasttime + nowdelta + delta);
 #else /* CH_CFG_ST_TIMEDELTA > 0 */
   systime_t nowdelta, delta;
 
@@ -60,6 +60,18 @@
  */
 #define CH_CFG_ST_TIMEDELTA                 0
 
+/**
+ * @brief   Virtual timers heap.
+ * @details If enabled then, in tick-less mode, the armed virtual timers are
+ *          kept in a pairing heap ordered by expiration time instead of a
+ *          delta list. Arming a timer takes constant time and disarming it
+ *          takes logarithmic amortized time regardless of the number of
+ *          armed timers.
+ * @note    Requires @p CH_CFG_ST_TIMEDELTA greater than zero.
+ * @note    The default is @p FALSE.
+ */
+#define CH_CFG_ST_TIMERS_HEAP               FALSE
+
 /** @} */
 
 /*===========================================================================*/
@@ -124,6 +136,20 @@
  */
 #define CH_CFG_OPTIMIZE_SPEED               TRUE
 
+/**
+ * @brief   Bitmap indexed ready list.
+ * @details If enabled then the ready list is kept as one FIFO queue for
+ *          each priority level plus a two level bitmap of the non-empty
+ *          levels, insertion and selection of the next thread become
+ *          constant time operations regardless of the number of ready
+ *          threads.
+ *
+ * @note    Scheduling semantics are not changed.
+ * @note    Requires about 2kB of additional RAM for the queue headers.
+ * @note    The default is @p FALSE.
+ */
+#define CH_CFG_USE_BITMAP_RLIST             FALSE
+
 /** @} */
 
 /*===========================================================================*/
@@ -285,6 +311,24 @@
  */
 #define CH_CFG_USE_HEAP                     TRUE
 
+/**
+ * @brief   Two-Level Segregated Fit heap allocator.
+ * @details If enabled the heap uses a TLSF allocator with constant time
+ *          allocation and deallocation instead of the first-fit one.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_CFG_USE_HEAP.
+ */
+#define CH_CFG_HEAP_TLSF                    FALSE
+
+/**
+ * @brief   Number of TLSF first level size classes.
+ * @details The largest heap block is 2MB with the default value.
+ *
+ * @note    The default is 16.
+ */
+#define CH_CFG_HEAP_TLSF_FL_COUNT           16
+
 /**
  * @brief   Memory Pools Allocator APIs.
  * @details If enabled then the memory pools allocator APIs are included
@@ -294,6 +338,45 @@
  */
 #define CH_CFG_USE_MEMPOOLS                 TRUE
 
+/**
+ * @brief   Memory Pools statistics.
+ * @details If enabled each memory pool keeps usage counters and pools can
+ *          be registered by name.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_CFG_USE_MEMPOOLS.
+ */
+#define CH_CFG_MEMPOOLS_STATS               FALSE
+
+/**
+ * @brief   Memory Pools lock-free fast path.
+ * @details If enabled @p chPoolAlloc() and @p chPoolFree() use exclusive
+ *          load/store instructions instead of the kernel critical zone.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires an ARMv7-M port.
+ */
+#define CH_CFG_MEMPOOLS_LOCKFREE            FALSE
+
+/**
+ * @brief   Objects FIFOs APIs.
+ * @details If enabled then the objects FIFOs APIs are included
+ *          in the kernel.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_CFG_USE_MEMPOOLS and @p CH_CFG_USE_MAILBOXES.
+ */
+#define CH_CFG_USE_OBJ_FIFOS                FALSE
+
+/**
+ * @brief   Snapshots APIs.
+ * @details If enabled then the lock-free snapshots APIs are included
+ *          in the kernel.
+ *
+ * @note    The default is @p FALSE.
+ */
+#define CH_CFG_USE_SNAPSHOTS                TRUE
+
 /**
  * @brief   Dynamic Threads APIs.
  * @details If enabled then the dynamic threads creation APIs are included
@@ -321,6 +404,17 @@
  */
 #define CH_DBG_STATISTICS                   FALSE
 
+/**
+ * @brief   Debug option, critical zones statistics.
+ * @details If enabled then the kernel statistics also measure the duration
+ *          of the critical zones, this adds a time measurement to each lock
+ *          and unlock operation. Disabling it leaves the per-thread and
+ *          context switch statistics at a lower overhead.
+ *
+ * @note    The default is @p TRUE.
+ */
+#define CH_DBG_STATISTICS_CRITICAL          TRUE
+
 /**
  * @brief   Debug option, system state check.
  * @details If enabled the correct call protocol for system APIs is checked
@@ -364,6 +458,22 @@
  */
 #define CH_DBG_TRACE_BUFFER_SIZE            128
 
+/**
+ * @brief   Trace stream size in bytes.
+ * @details When non-zero the traced events are also encoded into a byte
+ *          ring that a drain thread can forward to a host while the system
+ *          is running, see @p chDbgReadTraceStream().
+ * @note    The value must be zero or a power of two not lower than 64.
+ */
+#define CH_DBG_TRACE_STREAM_SIZE            0
+
+/**
+ * @brief   Trace stream time stamps clock frequency.
+ * @note    Zero means unknown, the host tools then require the frequency
+ *          of the realtime counter as a parameter.
+ */
+#define CH_DBG_TRACE_STREAM_CLOCK           0
+
 /**
  * @brief   Debug option, stack checks.
  * @details If enabled then a runtime stack check is performed.
@@ -5,6 +5,8 @@
 /* disk I/O modules and attach it to FatFs module with common interface. */
 /*-----------------------------------------------------------------------*/
 
+#include <string.h>
+
 #include "hal.h"
 #include "ffconf.h"
 #include "diskio.h"
@@ -25,6 +27,450 @@ extern SDCDriver SDCD1;
 extern RTCDriver RTCD1;
 #endif
 
+/*-----------------------------------------------------------------------*/
+/* SDC write-behind settings, they can be overridden in ffconf.h.        */
+
+/* Enables the write-behind queue between FatFs and the SDC driver.*/
+#if !defined(FATFS_USE_WRITE_BEHIND)
+#define FATFS_USE_WRITE_BEHIND          FALSE
+#endif
+
+/* Number of queued buffers.*/
+#if !defined(FATFS_WB_BUFFERS)
+#define FATFS_WB_BUFFERS                4
+#endif
+
+/* Maximum number of sectors in a buffer, contiguous writes are merged up
+   to this size in a single multiple blocks write.*/
+#if !defined(FATFS_WB_BUFFER_SECTORS)
+#define FATFS_WB_BUFFER_SECTORS         8
+#endif
+
+/* Priority of the writer thread.*/
+#if !defined(FATFS_WB_THREAD_PRIORITY)
+#define FATFS_WB_THREAD_PRIORITY        (NORMALPRIO + 1)
+#endif
+
+/* Stack size of the writer thread.*/
+#if !defined(FATFS_WB_THREAD_STACK_SIZE)
+#define FATFS_WB_THREAD_STACK_SIZE      256
+#endif
+
+/* Number of sectors in the sector cache, zero disables it.*/
+#if !defined(FATFS_CACHE_SECTORS)
+#define FATFS_CACHE_SECTORS             0
+#endif
+
+/* FATFS_CACHE_BUFFER, if defined, is the word aligned address of the
+   sector cache data area, FATFS_CACHE_SECTORS * 512 bytes in external
+   SDRAM for example. If not defined the area is in internal RAM.*/
+
+#define USE_WRITE_BEHIND  (HAL_USE_SDC && FATFS_USE_WRITE_BEHIND && !_FS_READONLY)
+#define USE_SECTOR_CACHE  (HAL_USE_SDC && (FATFS_CACHE_SECTORS > 0))
+
+/* Sector cache statistics ioctl, hits, misses and write-backs in a DWORD
+   array of three elements.*/
+#if !defined(CTRL_CACHE_STATS)
+#define CTRL_CACHE_STATS                30
+#endif
+
+#if USE_WRITE_BEHIND
+#if !CH_CFG_USE_MUTEXES || !CH_CFG_USE_CONDVARS
+#error "FATFS_USE_WRITE_BEHIND requires CH_CFG_USE_MUTEXES and CH_CFG_USE_CONDVARS"
+#endif
+
+/*-----------------------------------------------------------------------*/
+/* SDC write-behind.                                                     */
+/* The written sectors are copied in a FIFO of buffers and written to    */
+/* the card by a dedicated thread, FatFs does not wait for the transfer  */
+/* and the card busy time. Contiguous writes are merged in the last      */
+/* queued buffer until its write starts, the card receives multiple      */
+/* blocks writes. Reads of queued sectors wait for their write,          */
+/* CTRL_SYNC waits for the whole FIFO.                                   */
+
+typedef struct {
+  DWORD                 sector;
+  UINT                  count;
+  uint32_t              data[FATFS_WB_BUFFER_SECTORS * MMCSD_BLOCK_SIZE /
+                             sizeof (uint32_t)];
+} wb_buffer_t;
+
+static struct {
+  wb_buffer_t           buffers[FATFS_WB_BUFFERS];
+  unsigned              head;       /* Oldest queued buffer.             */
+  unsigned              queued;     /* Number of queued buffers.         */
+  bool                  busy;       /* The oldest buffer is being written.*/
+  bool                  error;      /* A write failed after last sync.   */
+  thread_t              *tp;
+} wb;
+
+/* Protects the FIFO, the condition is broadcasted on every change.*/
+static MUTEX_DECL(wb_mtx);
+static CONDVAR_DECL(wb_cond);
+
+/* Serializes the accesses to the driver.*/
+static MUTEX_DECL(sdc_mtx);
+
+static THD_WORKING_AREA(wb_wa, FATFS_WB_THREAD_STACK_SIZE);
+
+static THD_FUNCTION(wb_thread, arg) {
+  wb_buffer_t *bp;
+  bool failed;
+
+  (void)arg;
+  chRegSetThreadName("fatfs_wb");
+  while (true) {
+    /* Waiting for the oldest buffer, it is no more updated once busy.*/
+    chMtxLock(&wb_mtx);
+    while (wb.queued == 0U)
+      chCondWait(&wb_cond);
+    wb.busy = true;
+    bp = &wb.buffers[wb.head];
+    chMtxUnlock(&wb_mtx);
+
+    chMtxLock(&sdc_mtx);
+    failed = (blkGetDriverState(&SDCD1) != BLK_READY) ||
+             sdcWrite(&SDCD1, bp->sector, (const uint8_t *)bp->data,
+                      bp->count);
+    chMtxUnlock(&sdc_mtx);
+
+    chMtxLock(&wb_mtx);
+    wb.error |= failed;
+    wb.busy = false;
+    wb.head = (wb.head + 1U) % FATFS_WB_BUFFERS;
+    wb.queued--;
+    chCondBroadcast(&wb_cond);
+    chMtxUnlock(&wb_mtx);
+  }
+}
+
+static void wb_start(void) {
+
+  if (wb.tp == NULL)
+    wb.tp = chThdCreateStatic(wb_wa, sizeof(wb_wa), FATFS_WB_THREAD_PRIORITY,
+                              wb_thread, NULL);
+}
+
+/* Queues the sectors, the caller owns the mutex and only waits if all
+   buffers are full.*/
+static void wb_queue(DWORD sector, const BYTE *buff, UINT count) {
+  wb_buffer_t *bp;
+  UINT n;
+
+  while (count > 0U) {
+    /* The sectors are merged in the last buffer if it is not being
+       written and they overlap or follow its sectors.*/
+    if (wb.queued > (wb.busy ? 1U : 0U)) {
+      bp = &wb.buffers[(wb.head + wb.queued - 1U) % FATFS_WB_BUFFERS];
+      if ((sector >= bp->sector) && (sector <= bp->sector + bp->count) &&
+          (sector < bp->sector + FATFS_WB_BUFFER_SECTORS)) {
+        n = bp->sector + FATFS_WB_BUFFER_SECTORS - sector;
+        if (n > count)
+          n = count;
+        memcpy((uint8_t *)bp->data + (sector - bp->sector) * MMCSD_BLOCK_SIZE,
+               buff, n * MMCSD_BLOCK_SIZE);
+        if (sector + n > bp->sector + bp->count)
+          bp->count = sector + n - bp->sector;
+        sector += n;
+        buff += n * MMCSD_BLOCK_SIZE;
+        count -= n;
+        continue;
+      }
+    }
+
+    /* A new buffer is queued empty and filled by the next iteration, the
+       mutex is not released meanwhile.*/
+    while (wb.queued >= FATFS_WB_BUFFERS)
+      chCondWait(&wb_cond);
+    bp = &wb.buffers[(wb.head + wb.queued) % FATFS_WB_BUFFERS];
+    bp->sector = sector;
+    bp->count = 0U;
+    wb.queued++;
+    chCondBroadcast(&wb_cond);
+  }
+}
+
+static void wb_write(DWORD sector, const BYTE *buff, UINT count) {
+
+  chMtxLock(&wb_mtx);
+  wb_queue(sector, buff, count);
+  chMtxUnlock(&wb_mtx);
+}
+
+/* Waits until none of the sectors is queued.*/
+static void wb_wait(DWORD sector, UINT count) {
+  unsigned i;
+  wb_buffer_t *bp;
+
+  chMtxLock(&wb_mtx);
+  i = 0U;
+  while (i < wb.queued) {
+    bp = &wb.buffers[(wb.head + i) % FATFS_WB_BUFFERS];
+    if ((sector < bp->sector + bp->count) && (bp->sector < sector + count)) {
+      chCondWait(&wb_cond);
+      i = 0U;
+    }
+    else
+      i++;
+  }
+  chMtxUnlock(&wb_mtx);
+}
+
+/* Waits until the FIFO is empty, returns true if a write failed since the
+   previous call.*/
+static bool wb_sync(void) {
+  bool error;
+
+  chMtxLock(&wb_mtx);
+  while (wb.queued > 0U)
+    chCondWait(&wb_cond);
+  error = wb.error;
+  wb.error = false;
+  chMtxUnlock(&wb_mtx);
+
+  return error;
+}
+#endif /* USE_WRITE_BEHIND */
+
+#if HAL_USE_SDC
+/*-----------------------------------------------------------------------*/
+/* SDC accesses, the writes go through the write-behind FIFO if enabled. */
+
+static bool sdc_read(BYTE *buff, DWORD sector, UINT count) {
+#if USE_WRITE_BEHIND
+  bool failed;
+
+  wb_wait(sector, count);
+  chMtxLock(&sdc_mtx);
+  failed = sdcRead(&SDCD1, sector, buff, count);
+  chMtxUnlock(&sdc_mtx);
+  return failed;
+#else
+  return sdcRead(&SDCD1, sector, buff, count);
+#endif
+}
+
+#if !_FS_READONLY
+static bool sdc_write(const BYTE *buff, DWORD sector, UINT count) {
+#if USE_WRITE_BEHIND
+  wb_write(sector, buff, count);
+  return false;
+#else
+  return sdcWrite(&SDCD1, sector, buff, count);
+#endif
+}
+#endif /* !_FS_READONLY */
+#endif /* HAL_USE_SDC */
+
+#if USE_SECTOR_CACHE
+/*-----------------------------------------------------------------------*/
+/* SDC sector cache.                                                     */
+/* Fully associative LRU cache of single sectors. FatFs moves its window */
+/* one sector at time between the FAT, the directories and the data of   */
+/* every open file, the cache keeps the recently used ones. Single       */
+/* sector writes stay in the cache until the line is evicted or          */
+/* CTRL_SYNC, multiple sectors transfers go to the card and update the   */
+/* cached copies.                                                        */
+
+typedef struct {
+  DWORD                 sector;
+  uint32_t              stamp;      /* Last access, zero if invalid.     */
+  bool                  dirty;
+} cache_line_t;
+
+static struct {
+  cache_line_t          lines[FATFS_CACHE_SECTORS];
+  uint32_t              clock;
+  DWORD                 hits;
+  DWORD                 misses;
+  DWORD                 writebacks;
+} cache;
+
+#if defined(FATFS_CACHE_BUFFER)
+#define cache_data(i) ((BYTE *)(FATFS_CACHE_BUFFER) + (i) * MMCSD_BLOCK_SIZE)
+#else
+static uint32_t cache_buffer[FATFS_CACHE_SECTORS * MMCSD_BLOCK_SIZE /
+                             sizeof (uint32_t)];
+#define cache_data(i) ((BYTE *)cache_buffer + (i) * MMCSD_BLOCK_SIZE)
+#endif
+
+/* Drops all lines, dirty ones included.*/
+static void cache_invalidate(void) {
+  unsigned i;
+
+  for (i = 0U; i < FATFS_CACHE_SECTORS; i++) {
+    cache.lines[i].stamp = 0U;
+    cache.lines[i].dirty = false;
+  }
+  cache.clock = 0U;
+}
+
+static void cache_touch(unsigned i) {
+  unsigned j;
+
+  /* On wrap around the order is lost, all the lines become equally old.*/
+  if (++cache.clock == 0U) {
+    for (j = 0U; j < FATFS_CACHE_SECTORS; j++) {
+      if (cache.lines[j].stamp != 0U)
+        cache.lines[j].stamp = 1U;
+    }
+    cache.clock = 2U;
+  }
+  cache.lines[i].stamp = cache.clock;
+}
+
+static int cache_find(DWORD sector) {
+  unsigned i;
+
+  for (i = 0U; i < FATFS_CACHE_SECTORS; i++) {
+    if ((cache.lines[i].stamp != 0U) && (cache.lines[i].sector == sector))
+      return (int)i;
+  }
+  return -1;
+}
+
+#if !_FS_READONLY
+static bool cache_is_dirty(DWORD sector) {
+  int i = cache_find(sector);
+
+  return (i >= 0) && cache.lines[i].dirty;
+}
+
+/* Writes back a dirty line together with the dirty lines of the
+   contiguous sectors, in ascending order. Files appended at the same time
+   have their sectors interleaved, they are written back in runs. The
+   run is queued at once in the write-behind FIFO and merged in multiple
+   blocks writes, the writer thread cannot start it halfway.*/
+static bool cache_writeback(unsigned i) {
+  DWORD sector;
+  int j;
+  bool failed = false;
+
+  sector = cache.lines[i].sector;
+  while ((sector > 0U) && cache_is_dirty(sector - 1U))
+    sector--;
+#if USE_WRITE_BEHIND
+  chMtxLock(&wb_mtx);
+#endif
+  while (((j = cache_find(sector)) >= 0) && cache.lines[j].dirty) {
+    cache.writebacks++;
+#if USE_WRITE_BEHIND
+    wb_queue(sector, cache_data(j), 1U);
+#else
+    failed |= sdcWrite(&SDCD1, sector, cache_data(j), 1U);
+#endif
+    cache.lines[j].dirty = false;
+    sector++;
+  }
+#if USE_WRITE_BEHIND
+  chMtxUnlock(&wb_mtx);
+#endif
+  return failed;
+}
+#endif /* !_FS_READONLY */
+
+/* Frees the least recently used line, it is written back if dirty.*/
+static bool cache_alloc(DWORD sector, unsigned *ip) {
+  unsigned i, lru;
+
+  lru = 0U;
+  for (i = 0U; i < FATFS_CACHE_SECTORS; i++) {
+    if (cache.lines[i].stamp < cache.lines[lru].stamp)
+      lru = i;
+  }
+#if !_FS_READONLY
+  if (cache.lines[lru].dirty && cache_writeback(lru))
+    return true;
+#endif
+  cache.lines[lru].stamp = 0U;
+  cache.lines[lru].sector = sector;
+  *ip = lru;
+  return false;
+}
+
+static bool cache_read(BYTE *buff, DWORD sector, UINT count) {
+  unsigned i;
+  int found;
+
+  if (count == 1U) {
+    found = cache_find(sector);
+    if (found >= 0) {
+      cache.hits++;
+      memcpy(buff, cache_data(found), MMCSD_BLOCK_SIZE);
+      cache_touch((unsigned)found);
+      return false;
+    }
+    cache.misses++;
+    if (sdc_read(buff, sector, 1U) || cache_alloc(sector, &i))
+      return true;
+    memcpy(cache_data(i), buff, MMCSD_BLOCK_SIZE);
+    cache_touch(i);
+    return false;
+  }
+
+  /* Multiple sectors are read from the card, the cached copies are the
+     most recent.*/
+  if (sdc_read(buff, sector, count))
+    return true;
+  for (i = 0U; i < FATFS_CACHE_SECTORS; i++) {
+    if ((cache.lines[i].stamp != 0U) && (cache.lines[i].sector >= sector) &&
+        (cache.lines[i].sector < sector + count))
+      memcpy(buff + (cache.lines[i].sector - sector) * MMCSD_BLOCK_SIZE,
+             cache_data(i), MMCSD_BLOCK_SIZE);
+  }
+  return false;
+}
+
+#if !_FS_READONLY
+static bool cache_write(const BYTE *buff, DWORD sector, UINT count) {
+  unsigned i;
+  int found;
+
+  if (count == 1U) {
+    found = cache_find(sector);
+    if (found >= 0) {
+      cache.hits++;
+      i = (unsigned)found;
+    }
+    else {
+      cache.misses++;
+      if (cache_alloc(sector, &i))
+        return true;
+    }
+    memcpy(cache_data(i), buff, MMCSD_BLOCK_SIZE);
+    cache.lines[i].dirty = true;
+    cache_touch(i);
+    return false;
+  }
+
+  /* Multiple sectors are written to the card, the cached copies are
+     updated and no more need to be written back.*/
+  for (i = 0U; i < FATFS_CACHE_SECTORS; i++) {
+    if ((cache.lines[i].stamp != 0U) && (cache.lines[i].sector >= sector) &&
+        (cache.lines[i].sector < sector + count)) {
+      memcpy(cache_data(i),
+             buff + (cache.lines[i].sector - sector) * MMCSD_BLOCK_SIZE,
+             MMCSD_BLOCK_SIZE);
+      cache.lines[i].dirty = false;
+    }
+  }
+  return sdc_write(buff, sector, count);
+}
+
+/* Writes back all the dirty lines.*/
+static bool cache_flush(void) {
+  unsigned i;
+  bool failed = false;
+
+  for (i = 0U; i < FATFS_CACHE_SECTORS; i++) {
+    if (cache.lines[i].dirty)
+      failed |= cache_writeback(i);
+  }
+  return failed;
+}
+#endif /* !_FS_READONLY */
+#endif /* USE_SECTOR_CACHE */
+
 /*-----------------------------------------------------------------------*/
 /* Correspondence between physical drive number and physical drive.      */
 
@@ -60,6 +506,13 @@ DSTATUS disk_initialize (
       stat |= STA_NOINIT;
     if (sdcIsWriteProtected(&SDCD1))
       stat |=  STA_PROTECT;
+#if USE_WRITE_BEHIND
+    wb_start();
+#endif
+#if USE_SECTOR_CACHE
+    /* The card could have been changed, CTRL_SYNC is done on removal.*/
+    cache_invalidate();
+#endif
     return stat;
 #endif
   }
@@ -133,8 +586,13 @@ DRESULT disk_read (
   case SDC:
     if (blkGetDriverState(&SDCD1) != BLK_READY)
       return RES_NOTRDY;
-    if (sdcRead(&SDCD1, sector, buff, count))
+#if USE_SECTOR_CACHE
+    if (cache_read(buff, sector, count))
       return RES_ERROR;
+#else
+    if (sdc_read(buff, sector, count))
+      return RES_ERROR;
+#endif
     return RES_OK;
 #endif
   }
@@ -176,8 +634,17 @@ DRESULT disk_write (
   case SDC:
     if (blkGetDriverState(&SDCD1) != BLK_READY)
       return RES_NOTRDY;
-    if (sdcWrite(&SDCD1, sector, buff, count))
+#if USE_WRITE_BEHIND || USE_SECTOR_CACHE
+    if (sdcIsWriteProtected(&SDCD1))
+      return RES_WRPRT;
+#endif
+#if USE_SECTOR_CACHE
+    if (cache_write(buff, sector, count))
+      return RES_ERROR;
+#else
+    if (sdc_write(buff, sector, count))
       return RES_ERROR;
+#endif
     return RES_OK;
 #endif
   }
@@ -221,7 +688,24 @@ DRESULT disk_ioctl (
   case SDC:
     switch (cmd) {
     case CTRL_SYNC:
+      {
+        bool failed = false;
+
+#if USE_SECTOR_CACHE && !_FS_READONLY
+        failed |= cache_flush();
+#endif
+#if USE_WRITE_BEHIND
+        failed |= wb_sync();
+#endif
+        return failed ? RES_ERROR : RES_OK;
+      }
+#if USE_SECTOR_CACHE
+    case CTRL_CACHE_STATS:
+        ((DWORD *)buff)[0] = cache.hits;
+        ((DWORD *)buff)[1] = cache.misses;
+        ((DWORD *)buff)[2] = cache.writebacks;
         return RES_OK;
+#endif
     case GET_SECTOR_COUNT:
         *((DWORD *)buff) = mmcsdGetCardCapacity(&SDCD1);
         return RES_OK;
@@ -235,7 +719,17 @@ DRESULT disk_ioctl (
         return RES_OK;
 #if _USE_TRIM
     case CTRL_TRIM:
+#if USE_SECTOR_CACHE && !_FS_READONLY
+        (void)cache_flush();
+#endif
+#if USE_WRITE_BEHIND
+        (void)wb_sync();
+        chMtxLock(&sdc_mtx);
+        sdcErase(&SDCD1, *((DWORD *)buff), *((DWORD *)buff + 1));
+        chMtxUnlock(&sdc_mtx);
+#else
         sdcErase(&SDCD1, *((DWORD *)buff), *((DWORD *)buff + 1));
+#endif
         return RES_OK;
 #endif
     default:
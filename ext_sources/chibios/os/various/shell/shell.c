@@ -88,6 +88,40 @@ static char *parse_arguments(char *str, char **saveptr) {
   return *p != '\0' ? p : NULL;
 }
 
+static char *split_commands(char *str, char **saveptr) {
+  char *p, *q;
+  bool quoted = false;
+
+  if (str != NULL)
+    *saveptr = str;
+
+  p = *saveptr;
+  if (!p) {
+    return NULL;
+  }
+
+  /* Looking for a separator outside of double quotes.*/
+  for (q = p; *q != '\0'; q++) {
+    if (*q == '"') {
+      quoted = !quoted;
+    }
+    else if ((*q == SHELL_CMD_SEPARATOR) && !quoted) {
+      break;
+    }
+  }
+
+  /* Replacing the separator with a zero.*/
+  if (*q != '\0') {
+    *q++ = '\0';
+    *saveptr = q;
+  }
+  else {
+    *saveptr = NULL;
+  }
+
+  return p;
+}
+
 static void list_commands(BaseSequentialStream *chp, const ShellCommand *scp) {
 
   while (scp->sc_name != NULL) {
@@ -96,17 +130,124 @@ static void list_commands(BaseSequentialStream *chp, const ShellCommand *scp) {
   }
 }
 
-static bool cmdexec(const ShellCommand *scp, BaseSequentialStream *chp,
-                      char *name, int argc, char *argv[]) {
+static void index_add(ShellIndex *sip, const ShellCommand *scp) {
+
+  for (; scp->sc_name != NULL; scp++) {
+    unsigned i;
+    int cmp = 1;
+
+    /* Insertion point, on duplicated names the first entry wins as it did
+       with the linear search.*/
+    for (i = sip->si_count; i > 0U; i--) {
+      cmp = strcmp(sip->si_index[i - 1U]->sc_name, scp->sc_name);
+      if (cmp <= 0)
+        break;
+    }
+    if ((i > 0U) && (cmp == 0))
+      continue;
+
+    if (sip->si_count >= SHELL_MAX_COMMANDS) {
+      sip->si_overflow = true;
+      continue;
+    }
+    memmove(&sip->si_index[i + 1U], &sip->si_index[i],
+            (sip->si_count - i) * sizeof (sip->si_index[0]));
+    sip->si_index[i] = scp;
+    sip->si_count++;
+  }
+}
+
+static const ShellCommand *find_command(const ShellCommand *scp,
+                                        const char *name) {
 
   while (scp->sc_name != NULL) {
-    if (strcmp(scp->sc_name, name) == 0) {
-      scp->sc_function(chp, argc, argv);
+    if (strcmp(scp->sc_name, name) == 0)
+      return scp;
+    scp++;
+  }
+  return NULL;
+}
+
+static bool exec_command(const ShellIndex *sip, BaseSequentialStream *chp,
+                         char *cmdline, bool *batchp) {
+  int n = 0;
+  bool batch = *batchp;
+  char *lp, *cmd, *tokp;
+  char *args[SHELL_MAX_ARGUMENTS + 1];
+  const ShellCommand *scp;
+
+  cmd = parse_arguments(cmdline, &tokp);
+  if (cmd == NULL)
+    return false;
+  while ((lp = parse_arguments(NULL, &tokp)) != NULL) {
+    if (n >= SHELL_MAX_ARGUMENTS) {
+      chprintf(chp, "%stoo many arguments"SHELL_NEWLINE_STR,
+               batch ? SHELL_BATCH_ERR_STR" " : "");
+      return true;
+    }
+    args[n++] = lp;
+  }
+  args[n] = NULL;
+
+  if (strcmp(cmd, "help") == 0) {
+    if (n > 0) {
+      shellUsage(chp, "help");
+    }
+    else {
+      chprintf(chp, "Commands: help batch ");
+      list_commands(chp, shell_local_commands);
+      if (sip->si_commands != NULL)
+        list_commands(chp, sip->si_commands);
+      chprintf(chp, SHELL_NEWLINE_STR);
+    }
+  }
+  else if (strcmp(cmd, "batch") == 0) {
+    if ((n == 1) && (strcmp(args[0], "on") == 0))
+      *batchp = true;
+    else if ((n == 1) && (strcmp(args[0], "off") == 0))
+      *batchp = false;
+    else
+      shellUsage(chp, "batch on|off");
+  }
+  else {
+    scp = shellFindCommand(sip, cmd);
+    if (scp == NULL) {
+      chprintf(chp, "%s%s ?"SHELL_NEWLINE_STR,
+               batch ? SHELL_BATCH_ERR_STR" " : "", cmd);
+      return true;
+    }
+    scp->sc_function(chp, n, args);
+  }
+
+  /* In batch mode the end of each command output is marked, the command
+     status is not known here.*/
+  if (batch)
+    chprintf(chp, SHELL_BATCH_DONE_STR SHELL_NEWLINE_STR);
+  return false;
+}
+
+static bool get_batch_line(BaseSequentialStream *chp, char *line,
+                           unsigned size) {
+  char *p = line;
+
+  while (true) {
+    char c;
+
+    if (streamRead(chp, (uint8_t *)&c, 1) == 0)
+      return true;
+#if (SHELL_CMD_EXIT_ENABLED == TRUE) && !defined(_CHIBIOS_NIL_)
+    if (c == 4)
+      return true;
+#endif
+    if ((c == '\r') || (c == '\n')) {
+      *p = 0;
       return false;
     }
-    scp++;
+    if ((c < 0x20) && (c != '\t'))
+      continue;
+    if (p < line + size - 1)
+      *p++ = (char)c;
   }
-  return true;
 }
 
 #if (SHELL_USE_HISTORY == TRUE) || defined(__DOXYGEN__)
@@ -331,12 +472,11 @@ static void write_completions(ShellConfig *scfg, char *line, int pos) {
  * @param[in] p         pointer to a @p BaseSequentialStream object
  */
 THD_FUNCTION(shellThread, p) {
-  int n;
   ShellConfig *scfg = p;
   BaseSequentialStream *chp = scfg->sc_channel;
-  const ShellCommand *scp = scfg->sc_commands;
-  char *lp, *cmd, *tokp, line[SHELL_MAX_LINE_LENGTH];
-  char *args[SHELL_MAX_ARGUMENTS + 1];
+  char line[SHELL_MAX_LINE_LENGTH];
+  ShellIndex index;
+  bool batch = false;
 
 #if SHELL_USE_HISTORY == TRUE
   *(scfg->sc_histbuf) = 0;
@@ -352,11 +492,22 @@ THD_FUNCTION(shellThread, p) {
   ShellHistory *shp = NULL;
 #endif
 
+  shellIndexInit(&index, scfg->sc_commands);
+
   chprintf(chp, SHELL_NEWLINE_STR);
   chprintf(chp, "ChibiOS/RT Shell"SHELL_NEWLINE_STR);
   while (true) {
-    chprintf(chp, SHELL_PROMPT_STR);
-    if (shellGetLine(scfg, line, sizeof(line), shp)) {
+    bool reset;
+
+    /* Batch mode lines are not prompted nor echoed.*/
+    if (batch) {
+      reset = get_batch_line(chp, line, sizeof(line));
+    }
+    else {
+      chprintf(chp, SHELL_PROMPT_STR);
+      reset = shellGetLine(scfg, line, sizeof(line), shp);
+    }
+    if (reset) {
 #if (SHELL_CMD_EXIT_ENABLED == TRUE) && !defined(_CHIBIOS_NIL_)
       chprintf(chp, SHELL_NEWLINE_STR);
       chprintf(chp, "logout");
@@ -367,36 +518,7 @@ THD_FUNCTION(shellThread, p) {
       osalThreadSleepMilliseconds(100);
 #endif
     }
-    lp = parse_arguments(line, &tokp);
-    cmd = lp;
-    n = 0;
-    while ((lp = parse_arguments(NULL, &tokp)) != NULL) {
-      if (n >= SHELL_MAX_ARGUMENTS) {
-        chprintf(chp, "too many arguments"SHELL_NEWLINE_STR);
-        cmd = NULL;
-        break;
-      }
-      args[n++] = lp;
-    }
-    args[n] = NULL;
-    if (cmd != NULL) {
-      if (strcmp(cmd, "help") == 0) {
-        if (n > 0) {
-          shellUsage(chp, "help");
-          continue;
-        }
-        chprintf(chp, "Commands: help ");
-        list_commands(chp, shell_local_commands);
-        if (scp != NULL)
-          list_commands(chp, scp);
-        chprintf(chp, SHELL_NEWLINE_STR);
-      }
-      else if (cmdexec(shell_local_commands, chp, cmd, n, args) &&
-          ((scp == NULL) || cmdexec(scp, chp, cmd, n, args))) {
-        chprintf(chp, "%s", cmd);
-        chprintf(chp, " ?"SHELL_NEWLINE_STR);
-      }
-    }
+    (void)shellExecute(&index, chp, line, &batch);
   }
   shellExit(MSG_OK);
 }
@@ -431,6 +553,98 @@ void shellExit(msg_t msg) {
 }
 #endif
 
+/**
+ * @brief   Initializes a command dispatch index.
+ * @details The local commands and the commands of the specified table are
+ *          sorted by name, so that commands are found with a binary search
+ *          instead of comparing each name in turn.
+ *
+ * @param[out] sip      pointer to the @p ShellIndex object
+ * @param[in] scp       pointer to the commands table or @p NULL
+ *
+ * @api
+ */
+void shellIndexInit(ShellIndex *sip, const ShellCommand *scp) {
+
+  sip->si_commands = scp;
+  sip->si_count = 0U;
+  sip->si_overflow = false;
+  index_add(sip, shell_local_commands);
+  if (scp != NULL)
+    index_add(sip, scp);
+}
+
+/**
+ * @brief   Finds a command by name.
+ *
+ * @param[in] sip       pointer to the @p ShellIndex object
+ * @param[in] name      command name
+ * @return              The command entry or @p NULL if not found.
+ *
+ * @api
+ */
+const ShellCommand *shellFindCommand(const ShellIndex *sip, const char *name) {
+  const ShellCommand *scp = NULL;
+  unsigned lo = 0U, hi = sip->si_count;
+
+  while (lo < hi) {
+    unsigned mid = (lo + hi) / 2U;
+    int cmp = strcmp(sip->si_index[mid]->sc_name, name);
+
+    if (cmp == 0)
+      return sip->si_index[mid];
+    if (cmp < 0)
+      lo = mid + 1U;
+    else
+      hi = mid;
+  }
+
+  /* Commands not fitting the index.*/
+  if (sip->si_overflow) {
+    scp = find_command(shell_local_commands, name);
+    if ((scp == NULL) && (sip->si_commands != NULL))
+      scp = find_command(sip->si_commands, name);
+  }
+  return scp;
+}
+
+/**
+ * @brief   Executes a command line.
+ * @details The line can hold several commands split by
+ *          @p SHELL_CMD_SEPARATOR, they are executed in order. The built-in
+ *          @p batch command switches the batch mode, in batch mode each
+ *          dispatched command output is terminated by a
+ *          @p SHELL_BATCH_DONE_STR line and rejected commands (unknown or
+ *          with too many arguments) are reported on a line starting with
+ *          @p SHELL_BATCH_ERR_STR, so the output can be parsed by a host.
+ * @note    A dispatched command is not necessarily successful, the
+ *          commands report their own errors in their output.
+ * @note    The line buffer is modified.
+ *
+ * @param[in] sip       pointer to the @p ShellIndex object
+ * @param[in] chp       pointer to a @p BaseSequentialStream object
+ * @param[in] line      pointer to the command line
+ * @param[in,out] batchp pointer to the batch mode flag
+ * @return              The operation status.
+ * @retval true         at least one command was rejected.
+ * @retval false        operation successful.
+ *
+ * @api
+ */
+bool shellExecute(const ShellIndex *sip, BaseSequentialStream *chp,
+                  char *line, bool *batchp) {
+  char *cmdline, *tokp;
+  bool rejected = false;
+
+  cmdline = split_commands(line, &tokp);
+  while (cmdline != NULL) {
+    if (exec_command(sip, chp, cmdline, batchp))
+      rejected = true;
+    cmdline = split_commands(NULL, &tokp);
+  }
+  return rejected;
+}
+
 /**
  * @brief   Reads a whole line from the input channel.
  * @note    Input chars are echoed on the same stream object with the
@@ -64,6 +64,16 @@
 #define SHELL_MAX_HIST_BUFF         8 * SHELL_MAX_LINE_LENGTH
 #endif
 
+/**
+ * @brief   Shell maximum commands in the dispatch index.
+ * @details Local and application commands are sorted by name when the
+ *          shell starts and found with a binary search, commands not
+ *          fitting the index are searched linearly.
+ */
+#if !defined(SHELL_MAX_COMMANDS) || defined(__DOXYGEN__)
+#define SHELL_MAX_COMMANDS          32
+#endif
+
 /**
  * @brief   Enable shell command history
  */
@@ -106,6 +116,30 @@
 #define SHELL_NEWLINE_STR            "\r\n"
 #endif
 
+/**
+ * @brief   Separator of the commands in a multi-command line.
+ */
+#if !defined(SHELL_CMD_SEPARATOR) || defined(__DOXYGEN__)
+#define SHELL_CMD_SEPARATOR         ';'
+#endif
+
+/**
+ * @brief   Batch mode status line of a dispatched command.
+ * @note    It only marks the end of the command output, the shell does not
+ *          know if the command succeeded, commands report their own errors
+ *          in their output.
+ */
+#if !defined(SHELL_BATCH_DONE_STR) || defined(__DOXYGEN__)
+#define SHELL_BATCH_DONE_STR        "#DONE"
+#endif
+
+/**
+ * @brief   Batch mode status line prefix of a rejected command.
+ */
+#if !defined(SHELL_BATCH_ERR_STR) || defined(__DOXYGEN__)
+#define SHELL_BATCH_ERR_STR         "#ERR"
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -143,6 +177,20 @@ typedef struct {
                                                  command in buffer.         */
 } ShellHistory;
 
+/**
+ * @brief   Shell command dispatch index type.
+ */
+typedef struct {
+  const ShellCommand    *si_commands;       /**< @brief Shell extra commands
+                                                 table.                     */
+  const ShellCommand    *si_index[SHELL_MAX_COMMANDS]; /**< @brief Commands
+                                                 sorted by name.            */
+  unsigned              si_count;           /**< @brief Commands in the
+                                                 index.                     */
+  bool                  si_overflow;        /**< @brief Some commands did
+                                                 not fit the index.         */
+} ShellIndex;
+
 /**
  * @brief   Shell descriptor type.
  */
@@ -214,6 +262,10 @@ extern "C" {
   THD_FUNCTION(shellThread, p);
   void shellExit(msg_t msg);
   bool shellGetLine(ShellConfig *scfg, char *line, unsigned size, ShellHistory *shp);
+  void shellIndexInit(ShellIndex *sip, const ShellCommand *scp);
+  const ShellCommand *shellFindCommand(const ShellIndex *sip, const char *name);
+  bool shellExecute(const ShellIndex *sip, BaseSequentialStream *chp,
+                    char *line, bool *batchp);
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,7 @@
  * @{
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "ch.h"
@@ -190,10 +191,247 @@ static void cmd_test(BaseSequentialStream *chp, int argc, char *argv[]) {
 }
 #endif
 
+#if (SHELL_CMD_TOP_ENABLED == TRUE) || defined(__DOXYGEN__)
+/* Stack never used by a thread, the stack is scanned from its base for the
+   fill pattern, 0xFFFFFFFF if it cannot be known.*/
+static uint32_t top_stack_unused(thread_t *tp) {
+#if (CH_DBG_FILL_THREADS == TRUE) &&                                        \
+    ((CH_DBG_ENABLE_STACK_CHECK == TRUE) || (CH_CFG_USE_DYNAMIC == TRUE))
+  const uint8_t *p = (const uint8_t *)tp->wabase;
+
+  if (p == NULL) {
+    return 0xFFFFFFFFU;
+  }
+  while ((p < (const uint8_t *)tp) && (*p == CH_DBG_STACK_FILL_VALUE)) {
+    p++;
+  }
+
+  return (uint32_t)(p - (const uint8_t *)tp->wabase);
+#else
+  (void)tp;
+
+  return 0xFFFFFFFFU;
+#endif
+}
+
+/* Takes a consistent copy of a thread statistics.*/
+static void top_get_record(thread_t *tp, shell_top_record_t *rp) {
+
+  memset(rp, 0, sizeof (shell_top_record_t));
+  chSysLock();
+  rp->cycles        = (uint64_t)tp->stats.cumulative;
+  rp->switches      = (uint32_t)tp->stats.n;
+  rp->worst_run     = (uint32_t)tp->stats.worst;
+  rp->worst_latency = (uint32_t)tp->wkupworst;
+  rp->prio          = (uint8_t)tp->prio;
+  rp->state         = (uint8_t)tp->state;
+  chSysUnlock();
+  rp->stack_unused  = top_stack_unused(tp);
+  if (tp->name != NULL) {
+    strncpy(rp->name, tp->name, sizeof (rp->name) - 1U);
+  }
+}
+
+/* Index of a thread in the samples, the number of samples if not found.*/
+static unsigned top_find(thread_t *const tps[], unsigned n, thread_t *tp) {
+  unsigned i;
+
+  for (i = 0U; i < n; i++) {
+    if (tps[i] == tp) {
+      break;
+    }
+  }
+
+  return i;
+}
+
+static void cmd_top(BaseSequentialStream *chp, int argc, char *argv[]) {
+  static const char *states[] = {CH_STATE_NAMES};
+  thread_t *tps[SHELL_CMD_TOP_THREADS];
+  uint64_t cycles[SHELL_CMD_TOP_THREADS];
+  bool alive[SHELL_CMD_TOP_THREADS];
+  shell_top_record_t rec;
+  uint64_t total;
+  unsigned i, n;
+  uint32_t window = 1000U;
+  thread_t *tp;
+
+  if ((argc == 1) && (strcmp(argv[0], "-b") == 0)) {
+    shell_top_header_t hdr = {SHELL_TOP_DUMP_MAGIC, SHELL_TOP_DUMP_VERSION,
+                              (uint16_t)sizeof (shell_top_record_t)};
+
+    /* Binary dump of the cumulative counters, terminated by a record with
+       zero priority.*/
+    streamWrite(chp, (const uint8_t *)&hdr, sizeof (hdr));
+    tp = chRegFirstThread();
+    do {
+      top_get_record(tp, &rec);
+      streamWrite(chp, (const uint8_t *)&rec, sizeof (rec));
+      tp = chRegNextThread(tp);
+    } while (tp != NULL);
+    memset(&rec, 0, sizeof (rec));
+    streamWrite(chp, (const uint8_t *)&rec, sizeof (rec));
+    return;
+  }
+  if (argc == 1) {
+    window = (uint32_t)atoi(argv[0]);
+  }
+  if ((argc > 1) || (window == 0U) || (window > 10000U)) {
+    shellUsage(chp, "top [-b] [1..10000 ms]");
+    return;
+  }
+
+  /* Cumulative cycles at the window start.*/
+  n = 0U;
+  tp = chRegFirstThread();
+  do {
+    if (n < SHELL_CMD_TOP_THREADS) {
+      top_get_record(tp, &rec);
+      tps[n]    = tp;
+      cycles[n] = rec.cycles;
+      alive[n]  = false;
+      n++;
+    }
+    tp = chRegNextThread(tp);
+  } while (tp != NULL);
+
+  chThdSleepMilliseconds(window);
+
+  /* Cycles spent in the window, the registry is scanned again because
+     the sampled threads could have been disposed meanwhile.*/
+  total = 0U;
+  tp = chRegFirstThread();
+  do {
+    i = top_find(tps, n, tp);
+    if (i < n) {
+      top_get_record(tp, &rec);
+      if (rec.cycles >= cycles[i]) {
+        cycles[i] = rec.cycles - cycles[i];
+        total    += cycles[i];
+        alive[i]  = true;
+      }
+    }
+    tp = chRegNextThread(tp);
+  } while (tp != NULL);
+  if (total == 0U) {
+    total = 1U;
+  }
+
+  chprintf(chp, "  cpu%%     cycles   switches    latency   stkfree prio     state name"SHELL_NEWLINE_STR);
+  tp = chRegFirstThread();
+  do {
+    i = top_find(tps, n, tp);
+    if ((i < n) && alive[i]) {
+      uint32_t permille = (uint32_t)((cycles[i] * 1000U) / total);
+
+      top_get_record(tp, &rec);
+      chprintf(chp, "%3lu.%lu %10lu %10lu %10lu ",
+               permille / 10U, permille % 10U, (uint32_t)cycles[i],
+               rec.switches, rec.worst_latency);
+      if (rec.stack_unused == 0xFFFFFFFFU) {
+        chprintf(chp, "%9s", "-");
+      }
+      else {
+        chprintf(chp, "%9lu", rec.stack_unused);
+      }
+      chprintf(chp, " %4lu %9s %s"SHELL_NEWLINE_STR,
+               (uint32_t)rec.prio, states[rec.state], rec.name);
+    }
+    tp = chRegNextThread(tp);
+  } while (tp != NULL);
+}
+#endif
+
+#if (SHELL_CMD_TRACE_ENABLED == TRUE) || defined(__DOXYGEN__)
+static void cmd_trace(BaseSequentialStream *chp, int argc, char *argv[]) {
+  uint8_t buf[SHELL_CMD_TRACE_CHUNK_SIZE];
+  size_t n, fill = 0U;
+  uint32_t seconds = 10U, elapsed = 0U;
+  systime_t last, now;
+
+  if (argc == 1) {
+    seconds = (uint32_t)atoi(argv[0]);
+  }
+  if ((argc > 1) || (seconds == 0U) || (seconds > 3600U)) {
+    shellUsage(chp, "trace [1..3600 s]");
+    return;
+  }
+
+  /* Binary trace stream for the specified time. Chunks are written when
+     full or when the stream has been drained, a zero byte terminates the
+     stream.*/
+  chDbgStartTraceStream();
+  last = chVTGetSystemTimeX();
+  do {
+    n = chDbgReadTraceStream(&buf[fill], sizeof (buf) - fill);
+    fill += n;
+    if ((n == 0U) || ((sizeof (buf) - fill) < CH_TRACE_STREAM_READ_MIN)) {
+      if (fill > 0U) {
+        streamWrite(chp, buf, fill);
+        fill = 0U;
+      }
+      if (n == 0U) {
+        chThdSleepMilliseconds(10);
+      }
+    }
+    now = chVTGetSystemTimeX();
+    elapsed += (uint32_t)(systime_t)(now - last);
+    last = now;
+  } while (elapsed < seconds * (uint32_t)CH_CFG_ST_FREQUENCY);
+
+  if (fill > 0U) {
+    streamWrite(chp, buf, fill);
+  }
+  streamPut(chp, (uint8_t)CH_TRACE_TYPE_UNUSED);
+}
+#endif
+
 /*===========================================================================*/
 /* Module exported functions.                                                */
 /*===========================================================================*/
 
+#if (SHELL_CMD_POOLS_ENABLED == TRUE) || defined(__DOXYGEN__)
+static void cmd_pools(BaseSequentialStream *chp, int argc, char *argv[]) {
+  uint32_t allocs[SHELL_CMD_POOLS_MAX];
+  pool_stats_t ps;
+  memory_pool_t *mp;
+  uint32_t window = 1000U;
+  unsigned i;
+
+  if (argc == 1) {
+    window = (uint32_t)atoi(argv[0]);
+  }
+  if ((argc > 1) || (window == 0U) || (window > 10000U)) {
+    shellUsage(chp, "pools [1..10000 ms]");
+    return;
+  }
+
+  /* The allocation rate is measured over the sampling window.*/
+  i = 0U;
+  mp = chPoolRegFirst();
+  while ((mp != NULL) && (i < SHELL_CMD_POOLS_MAX)) {
+    chPoolGetStats(mp, &ps);
+    allocs[i++] = ps.allocs;
+    mp = chPoolRegNext(mp);
+  }
+
+  chThdSleepMilliseconds(window);
+
+  chprintf(chp, "    size    used    peak   fails  alloc/s name"SHELL_NEWLINE_STR);
+  i = 0U;
+  mp = chPoolRegFirst();
+  while ((mp != NULL) && (i < SHELL_CMD_POOLS_MAX)) {
+    chPoolGetStats(mp, &ps);
+    chprintf(chp, "%8lu %7lu %7lu %7lu %8lu %s"SHELL_NEWLINE_STR,
+             ps.size, ps.size - ps.free, ps.peak, ps.failures,
+             ((ps.allocs - allocs[i]) * 1000U) / window,
+             mp->name == NULL ? "-" : mp->name);
+    i++;
+    mp = chPoolRegNext(mp);
+  }
+}
+#endif
+
 /**
  * @brief   Array of the default commands.
  */
@@ -218,6 +456,15 @@ const ShellCommand shell_local_commands[] = {
 #endif
 #if SHELL_CMD_TEST_ENABLED == TRUE
   {"test", cmd_test},
+#endif
+#if SHELL_CMD_TOP_ENABLED == TRUE
+  {"top", cmd_top},
+#endif
+#if SHELL_CMD_TRACE_ENABLED == TRUE
+  {"trace", cmd_trace},
+#endif
+#if SHELL_CMD_POOLS_ENABLED == TRUE
+  {"pools", cmd_pools},
 #endif
   {NULL, NULL}
 };
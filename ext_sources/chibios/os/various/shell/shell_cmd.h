@@ -29,6 +29,21 @@
 /* Module constants.                                                         */
 /*===========================================================================*/
 
+/**
+ * @name    Binary threads profile dump
+ * @{
+ */
+/**
+ * @brief   Magic number opening a binary dump, "CHTP" in memory order.
+ */
+#define SHELL_TOP_DUMP_MAGIC                0x50544843U
+
+/**
+ * @brief   Binary dump format version.
+ */
+#define SHELL_TOP_DUMP_VERSION              1U
+/** @} */
+
 /*===========================================================================*/
 /* Module pre-compile time settings.                                         */
 /*===========================================================================*/
@@ -65,6 +80,41 @@
 #define SHELL_CMD_TEST_WA_SIZE              THD_WORKING_AREA_SIZE(256)
 #endif
 
+#if !defined(SHELL_CMD_TOP_ENABLED) || defined(__DOXYGEN__)
+#define SHELL_CMD_TOP_ENABLED               FALSE
+#endif
+
+/**
+ * @brief   Maximum number of threads sampled by the "top" command.
+ */
+#if !defined(SHELL_CMD_TOP_THREADS) || defined(__DOXYGEN__)
+#define SHELL_CMD_TOP_THREADS               16
+#endif
+
+#if !defined(SHELL_CMD_TRACE_ENABLED) || defined(__DOXYGEN__)
+#define SHELL_CMD_TRACE_ENABLED             FALSE
+#endif
+
+/**
+ * @brief   Size of the chunks written by the "trace" command.
+ * @note    The chunk buffer is allocated on the shell stack and must be at
+ *          least twice @p CH_TRACE_STREAM_READ_MIN.
+ */
+#if !defined(SHELL_CMD_TRACE_CHUNK_SIZE) || defined(__DOXYGEN__)
+#define SHELL_CMD_TRACE_CHUNK_SIZE          256
+#endif
+
+#if !defined(SHELL_CMD_POOLS_ENABLED) || defined(__DOXYGEN__)
+#define SHELL_CMD_POOLS_ENABLED             FALSE
+#endif
+
+/**
+ * @brief   Maximum number of pools sampled by the "pools" command.
+ */
+#if !defined(SHELL_CMD_POOLS_MAX) || defined(__DOXYGEN__)
+#define SHELL_CMD_POOLS_MAX                 16
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -81,10 +131,68 @@
 #error "SHELL_CMD_THREADS_ENABLED requires CH_CFG_USE_REGISTRY"
 #endif
 
+#if (SHELL_CMD_TOP_ENABLED == TRUE) && (CH_CFG_USE_REGISTRY == FALSE)
+#error "SHELL_CMD_TOP_ENABLED requires CH_CFG_USE_REGISTRY"
+#endif
+
+#if (SHELL_CMD_TOP_ENABLED == TRUE) && (CH_DBG_STATISTICS == FALSE)
+#error "SHELL_CMD_TOP_ENABLED requires CH_DBG_STATISTICS"
+#endif
+
+#if (SHELL_CMD_TRACE_ENABLED == TRUE) &&                                    \
+    ((CH_DBG_TRACE_MASK == CH_DBG_TRACE_MASK_DISABLED) ||                   \
+     (CH_DBG_TRACE_STREAM_SIZE == 0))
+#error "SHELL_CMD_TRACE_ENABLED requires CH_DBG_TRACE_STREAM_SIZE"
+#endif
+
+#if (SHELL_CMD_POOLS_ENABLED == TRUE) &&                                    \
+    ((CH_CFG_USE_MEMPOOLS == FALSE) || (CH_CFG_MEMPOOLS_STATS == FALSE))
+#error "SHELL_CMD_POOLS_ENABLED requires CH_CFG_MEMPOOLS_STATS"
+#endif
+
 /*===========================================================================*/
 /* Module data structures and types.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Header of a binary threads profile dump.
+ * @details The "top -b" command writes this header followed by one
+ *          @p shell_top_record_t for each thread and by a terminating
+ *          record having a zero priority. Fields are in the target byte
+ *          order, host tools compute the load of each thread from the
+ *          cycles difference between two successive dumps.
+ */
+typedef struct {
+  uint32_t              magic;          /**< @brief SHELL_TOP_DUMP_MAGIC.   */
+  uint16_t              version;        /**< @brief SHELL_TOP_DUMP_VERSION. */
+  uint16_t              recsize;        /**< @brief Size of a record.       */
+} shell_top_header_t;
+
+/**
+ * @brief   Record of a binary threads profile dump.
+ */
+typedef struct {
+  uint64_t              cycles;         /**< @brief Cumulative running
+                                                    time in realtime
+                                                    counter cycles.         */
+  uint32_t              switches;       /**< @brief Number of times the
+                                                    thread was switched
+                                                    out.                    */
+  uint32_t              worst_run;      /**< @brief Longest run without
+                                                    interruption, cycles.   */
+  uint32_t              worst_latency;  /**< @brief Worst wakeup to run
+                                                    latency, cycles.        */
+  uint32_t              stack_unused;   /**< @brief Stack never used, in
+                                                    bytes, or 0xFFFFFFFF
+                                                    if not known.           */
+  uint8_t               prio;           /**< @brief Thread priority, zero
+                                                    in the terminator.      */
+  uint8_t               state;          /**< @brief Thread state.           */
+  uint16_t              reserved;       /**< @brief Must be zero.           */
+  char                  name[20];       /**< @brief Thread name, zero
+                                                    padded.                 */
+} shell_top_record_t;
+
 /*===========================================================================*/
 /* Module macros.                                                            */
 /*===========================================================================*/
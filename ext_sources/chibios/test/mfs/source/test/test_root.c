@@ -0,0 +1,100 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @mainpage Test Suite Specification
+ * Test suite for the Managed Flash Storage module. The purpose of this
+ * suite is to perform unit tests on the MFS module and to converge to 100%
+ * code coverage through successive improvements.
+ *
+ * <h2>Test Sequences</h2>
+ * - @subpage test_sequence_001
+ * .
+ */
+
+/**
+ * @file    test_root.c
+ * @brief   Test Suite root structures code.
+ */
+
+#include "hal.h"
+#include "ch_test.h"
+#include "test_root.h"
+
+#if !defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Array of all the test sequences.
+ */
+const testcase_t * const *test_suite[] = {
+  test_sequence_001,
+  NULL
+};
+
+/*===========================================================================*/
+/* Shared code.                                                              */
+/*===========================================================================*/
+
+/*
+ * Flash array emulated in RAM, two banks of two sectors.
+ */
+static uint8_t ramflash_buffer[TEST_FLASH_SECTORS * TEST_FLASH_SECTOR_SIZE];
+
+static const RAMFlashConfig ramflashcfg1 = {
+  ramflash_buffer,
+  TEST_FLASH_SECTORS,
+  TEST_FLASH_SECTOR_SIZE,
+  256
+};
+
+RAMFlashDriver ramflash1;
+
+MFSDriver mfs1;
+
+const MFSConfig mfscfg1 = {
+  (BaseFlash *)&ramflash1,
+  0,
+  2,
+  2,
+  2
+};
+
+/*
+ * Starts the drivers on a fully erased flash.
+ */
+void test_mfs_start(void) {
+
+  ramflashObjectInit(&ramflash1);
+  ramflashStart(&ramflash1, &ramflashcfg1);
+  (void) flashStartEraseAll(&ramflash1);
+  mfsObjectInit(&mfs1);
+  mfsStart(&mfs1, &mfscfg1);
+}
+
+/*
+ * Stops the drivers.
+ */
+void test_mfs_stop(void) {
+
+  mfsStop(&mfs1);
+  ramflashStop(&ramflash1);
+}
+
+#endif /* !defined(__DOXYGEN__) */
@@ -0,0 +1,70 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    test_root.h
+ * @brief   Test Suite root structures header.
+ */
+
+#ifndef TEST_ROOT_H
+#define TEST_ROOT_H
+
+#include "test_sequence_001.h"
+
+#if !defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+extern const testcase_t * const *test_suite[];
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+/*===========================================================================*/
+/* Shared definitions.                                                       */
+/*===========================================================================*/
+
+#define TEST_SUITE_NAME                     "ChibiOS/HAL MFS Test Suite"
+
+#include "hal_ram_flash.h"
+#include "mfs.h"
+
+#define TEST_FLASH_SECTORS                  4
+#define TEST_FLASH_SECTOR_SIZE              1024
+#define TEST_BANK_SIZE                      (TEST_FLASH_SECTOR_SIZE * 2)
+
+extern RAMFlashDriver ramflash1;
+extern MFSDriver mfs1;
+extern const MFSConfig mfscfg1;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void test_mfs_start(void);
+  void test_mfs_stop(void);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined(__DOXYGEN__) */
+
+#endif /* TEST_ROOT_H */
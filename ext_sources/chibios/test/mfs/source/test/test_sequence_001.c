@@ -0,0 +1,536 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "hal.h"
+#include "ch_test.h"
+#include "test_root.h"
+
+/**
+ * @file    test_sequence_001.c
+ * @brief   Test Sequence 001 code.
+ *
+ * @page test_sequence_001 [1] Functional tests
+ *
+ * File: @ref test_sequence_001.c
+ *
+ * <h2>Description</h2>
+ * The APIs are tested for functionality, correct cases and expected error
+ * cases are tested.
+ *
+ * <h2>Test Cases</h2>
+ * - @subpage test_001_001
+ * - @subpage test_001_002
+ * - @subpage test_001_003
+ * - @subpage test_001_004
+ * - @subpage test_001_005
+ * - @subpage test_001_006
+ * .
+ */
+
+/****************************************************************************
+ * Shared code.
+ ****************************************************************************/
+
+#include <string.h>
+
+static uint8_t mfs_buffer[TEST_BANK_SIZE];
+
+/*
+ * Fills a buffer with a pattern depending on a seed.
+ */
+static void test_fill(uint8_t *p, size_t n, uint8_t seed) {
+
+  while (n > 0U) {
+    *p++ = seed;
+    seed = (uint8_t)((seed * 5U) + 1U);
+    n--;
+  }
+}
+
+/*
+ * Reads a record and compares it with a pattern.
+ */
+static bool test_check(uint32_t id, uint32_t size, uint8_t seed) {
+  uint8_t pattern[TEST_BANK_SIZE];
+  uint32_t n = sizeof mfs_buffer;
+
+  if (mfsReadRecord(&mfs1, id, &n, mfs_buffer) != MFS_NO_ERROR) {
+    return false;
+  }
+  test_fill(pattern, size, seed);
+  return (n == size) && (memcmp(mfs_buffer, pattern, size) == 0);
+}
+
+/****************************************************************************
+ * Test cases.
+ ****************************************************************************/
+
+/**
+ * @page test_001_001 [1.1] Mounting an erased flash
+ *
+ * <h2>Description</h2>
+ * The storage is mounted on a fully erased flash, the first bank must be
+ * initialized and no records must be found.
+ *
+ * <h2>Test Steps</h2>
+ * - [1.1.1] Mounting the erased flash, bank zero must be initialized.
+ * - [1.1.2] Reading all the records, none must be found.
+ * - [1.1.3] Mounting again, the initialized bank must be found.
+ * .
+ */
+
+static void test_001_001_setup(void) {
+  test_mfs_start();
+}
+
+static void test_001_001_teardown(void) {
+  test_mfs_stop();
+}
+
+static void test_001_001_execute(void) {
+  mfs_error_t err;
+  uint32_t id, n;
+
+  /* [1.1.1] Mounting the erased flash, bank zero must be initialized.*/
+  test_set_step(1);
+  {
+    err = mfsMount(&mfs1);
+    test_assert(err == MFS_NO_ERROR, "mount failed");
+    test_assert(mfs1.current_bank == MFS_BANK_0, "wrong bank");
+    test_assert(mfs1.current_counter == 1U, "wrong counter");
+  }
+
+  /* [1.1.2] Reading all the records, none must be found.*/
+  test_set_step(2);
+  {
+    for (id = 0; id < MFS_CFG_MAX_RECORDS; id++) {
+      n = sizeof mfs_buffer;
+      err = mfsReadRecord(&mfs1, id, &n, mfs_buffer);
+      test_assert(err == MFS_ERR_NOT_FOUND, "record found");
+    }
+  }
+
+  /* [1.1.3] Mounting again, the initialized bank must be found.*/
+  test_set_step(3);
+  {
+    err = mfsMount(&mfs1);
+    test_assert(err == MFS_NO_ERROR, "mount failed");
+    test_assert(mfs1.current_bank == MFS_BANK_0, "wrong bank");
+    test_assert(mfs1.current_counter == 1U, "wrong counter");
+  }
+}
+
+static const testcase_t test_001_001 = {
+  "Mounting an erased flash",
+  test_001_001_setup,
+  test_001_001_teardown,
+  test_001_001_execute
+};
+
+/**
+ * @page test_001_002 [1.2] Creating, updating and erasing a record
+ *
+ * <h2>Description</h2>
+ * A record is created, updated and erased, the data read back is checked
+ * after each operation.
+ *
+ * <h2>Test Steps</h2>
+ * - [1.2.1] Creating a record, it must be read back unchanged.
+ * - [1.2.2] Reading the record in a smaller buffer, the operation must
+ *   fail.
+ * - [1.2.3] Updating the record with a different size, the new data must be
+ *   read back.
+ * - [1.2.4] Erasing the record, it must not be found anymore.
+ * .
+ */
+
+static void test_001_002_setup(void) {
+  test_mfs_start();
+  (void) mfsMount(&mfs1);
+}
+
+static void test_001_002_teardown(void) {
+  test_mfs_stop();
+}
+
+static void test_001_002_execute(void) {
+  mfs_error_t err;
+  uint32_t n;
+
+  /* [1.2.1] Creating a record, it must be read back unchanged.*/
+  test_set_step(1);
+  {
+    test_fill(mfs_buffer, 16, 1);
+    err = mfsWriteRecord(&mfs1, 1, 16, mfs_buffer);
+    test_assert(err == MFS_NO_ERROR, "write failed");
+    test_assert(test_check(1, 16, 1), "wrong record");
+  }
+
+  /* [1.2.2] Reading the record in a smaller buffer, the operation must
+     fail.*/
+  test_set_step(2);
+  {
+    n = 8;
+    err = mfsReadRecord(&mfs1, 1, &n, mfs_buffer);
+    test_assert(err == MFS_ERR_INV_SIZE, "size not checked");
+  }
+
+  /* [1.2.3] Updating the record with a different size, the new data must be
+     read back.*/
+  test_set_step(3);
+  {
+    test_fill(mfs_buffer, 32, 2);
+    err = mfsWriteRecord(&mfs1, 1, 32, mfs_buffer);
+    test_assert(err == MFS_NO_ERROR, "write failed");
+    test_assert(test_check(1, 32, 2), "wrong record");
+  }
+
+  /* [1.2.4] Erasing the record, it must not be found anymore.*/
+  test_set_step(4);
+  {
+    err = mfsEraseRecord(&mfs1, 1);
+    test_assert(err == MFS_NO_ERROR, "erase failed");
+    n = sizeof mfs_buffer;
+    err = mfsReadRecord(&mfs1, 1, &n, mfs_buffer);
+    test_assert(err == MFS_ERR_NOT_FOUND, "record found");
+    err = mfsEraseRecord(&mfs1, 1);
+    test_assert(err == MFS_ERR_NOT_FOUND, "record erased twice");
+  }
+}
+
+static const testcase_t test_001_002 = {
+  "Creating, updating and erasing a record",
+  test_001_002_setup,
+  test_001_002_teardown,
+  test_001_002_execute
+};
+
+/**
+ * @page test_001_003 [1.3] Records retention across mounts
+ *
+ * <h2>Description</h2>
+ * All the records are written and one is erased, the records index must be
+ * rebuilt identical after unmounting and mounting the storage again.
+ *
+ * <h2>Test Steps</h2>
+ * - [1.3.1] Writing all the records then erasing record one.
+ * - [1.3.2] Unmounting the storage, the records must not be accessible.
+ * - [1.3.3] Mounting the storage again, the records must be found
+ *   unchanged.
+ * .
+ */
+
+static void test_001_003_setup(void) {
+  test_mfs_start();
+  (void) mfsMount(&mfs1);
+}
+
+static void test_001_003_teardown(void) {
+  test_mfs_stop();
+}
+
+static void test_001_003_execute(void) {
+  mfs_error_t err;
+  uint32_t id, n;
+
+  /* [1.3.1] Writing all the records then erasing record one.*/
+  test_set_step(1);
+  {
+    for (id = 0; id < MFS_CFG_MAX_RECORDS; id++) {
+      test_fill(mfs_buffer, id + 1U, (uint8_t)id);
+      err = mfsWriteRecord(&mfs1, id, id + 1U, mfs_buffer);
+      test_assert(err == MFS_NO_ERROR, "write failed");
+    }
+    err = mfsEraseRecord(&mfs1, 1);
+    test_assert(err == MFS_NO_ERROR, "erase failed");
+  }
+
+  /* [1.3.2] Unmounting the storage, the records must not be accessible.*/
+  test_set_step(2);
+  {
+    err = mfsUnmount(&mfs1);
+    test_assert(err == MFS_NO_ERROR, "unmount failed");
+    n = sizeof mfs_buffer;
+    err = mfsReadRecord(&mfs1, 0, &n, mfs_buffer);
+    test_assert(err == MFS_ERR_INV_STATE, "read while not mounted");
+  }
+
+  /* [1.3.3] Mounting the storage again, the records must be found
+     unchanged.*/
+  test_set_step(3);
+  {
+    err = mfsMount(&mfs1);
+    test_assert(err == MFS_NO_ERROR, "mount failed");
+    for (id = 0; id < MFS_CFG_MAX_RECORDS; id++) {
+      if (id == 1U) {
+        n = sizeof mfs_buffer;
+        err = mfsReadRecord(&mfs1, id, &n, mfs_buffer);
+        test_assert(err == MFS_ERR_NOT_FOUND, "erased record found");
+      }
+      else {
+        test_assert(test_check(id, id + 1U, (uint8_t)id), "wrong record");
+      }
+    }
+  }
+}
+
+static const testcase_t test_001_003 = {
+  "Records retention across mounts",
+  test_001_003_setup,
+  test_001_003_teardown,
+  test_001_003_execute
+};
+
+/**
+ * @page test_001_004 [1.4] Garbage collection
+ *
+ * <h2>Description</h2>
+ * A record is updated until the bank is full, the garbage collection must
+ * move the most recent instances of the records in the other bank.
+ *
+ * <h2>Test Steps</h2>
+ * - [1.4.1] Writing a record that is not updated afterward.
+ * - [1.4.2] Updating another record until the garbage collection is
+ *   triggered, bank one must become the current bank.
+ * - [1.4.3] Reading the records, the most recent instances must be found.
+ * - [1.4.4] Mounting the storage again, bank one must be found.
+ * .
+ */
+
+static void test_001_004_setup(void) {
+  test_mfs_start();
+  (void) mfsMount(&mfs1);
+}
+
+static void test_001_004_teardown(void) {
+  test_mfs_stop();
+}
+
+static void test_001_004_execute(void) {
+  mfs_error_t err;
+  unsigned i;
+
+  /* [1.4.1] Writing a record that is not updated afterward.*/
+  test_set_step(1);
+  {
+    test_fill(mfs_buffer, 64, 3);
+    err = mfsWriteRecord(&mfs1, 2, 64, mfs_buffer);
+    test_assert(err == MFS_NO_ERROR, "write failed");
+  }
+
+  /* [1.4.2] Updating another record until the garbage collection is
+     triggered, bank one must become the current bank.*/
+  test_set_step(2);
+  {
+    err = MFS_NO_ERROR;
+    for (i = 0; (i < 100U) && (err == MFS_NO_ERROR); i++) {
+      test_fill(mfs_buffer, 100, (uint8_t)i);
+      err = mfsWriteRecord(&mfs1, 0, 100, mfs_buffer);
+    }
+    test_assert(err == MFS_WARN_GC, "garbage collection not triggered");
+    test_assert(mfs1.current_bank == MFS_BANK_1, "wrong bank");
+    test_assert(mfs1.current_counter == 2U, "wrong counter");
+  }
+
+  /* [1.4.3] Reading the records, the most recent instances must be found.*/
+  test_set_step(3);
+  {
+    test_assert(test_check(0, 100, (uint8_t)(i - 1U)), "wrong record");
+    test_assert(test_check(2, 64, 3), "wrong record");
+  }
+
+  /* [1.4.4] Mounting the storage again, bank one must be found.*/
+  test_set_step(4);
+  {
+    err = mfsMount(&mfs1);
+    test_assert(err == MFS_NO_ERROR, "mount failed");
+    test_assert(mfs1.current_bank == MFS_BANK_1, "wrong bank");
+    test_assert(test_check(0, 100, (uint8_t)(i - 1U)), "wrong record");
+    test_assert(test_check(2, 64, 3), "wrong record");
+  }
+}
+
+static const testcase_t test_001_004 = {
+  "Garbage collection",
+  test_001_004_setup,
+  test_001_004_teardown,
+  test_001_004_execute
+};
+
+/**
+ * @page test_001_005 [1.5] Recovery of an interrupted write
+ *
+ * <h2>Description</h2>
+ * A power loss is emulated while updating a record, on the next mount the
+ * damaged bank must be repaired and the previous instance of the record
+ * must be found.
+ *
+ * <h2>Test Steps</h2>
+ * - [1.5.1] Creating a record then updating it while emulating a power
+ *   loss, the operation must fail.
+ * - [1.5.2] Mounting the storage again, the bank must be repaired and the
+ *   previous instance of the record must be found.
+ * - [1.5.3] Updating the record again, the new data must be read back.
+ * .
+ */
+
+static void test_001_005_setup(void) {
+  test_mfs_start();
+  (void) mfsMount(&mfs1);
+}
+
+static void test_001_005_teardown(void) {
+  test_mfs_stop();
+}
+
+static void test_001_005_execute(void) {
+  mfs_error_t err;
+  uint32_t n;
+
+  /* [1.5.1] Creating a record then updating it while emulating a power
+     loss, the operation must fail.*/
+  test_set_step(1);
+  {
+    test_fill(mfs_buffer, 32, 4);
+    err = mfsWriteRecord(&mfs1, 3, 32, mfs_buffer);
+    test_assert(err == MFS_NO_ERROR, "write failed");
+    ramflashSetProgramBudget(&ramflash1, 20U);
+    test_fill(mfs_buffer, 32, 5);
+    err = mfsWriteRecord(&mfs1, 3, 32, mfs_buffer);
+    ramflashSetProgramBudget(&ramflash1, UINT32_MAX);
+    test_assert(err == MFS_ERR_FLASH_FAILURE, "failure not detected");
+    n = sizeof mfs_buffer;
+    err = mfsReadRecord(&mfs1, 3, &n, mfs_buffer);
+    test_assert(err == MFS_ERR_INV_STATE, "read while not mounted");
+  }
+
+  /* [1.5.2] Mounting the storage again, the bank must be repaired and the
+     previous instance of the record must be found.*/
+  test_set_step(2);
+  {
+    err = mfsMount(&mfs1);
+    test_assert(err == MFS_WARN_REPAIR, "repair not performed");
+    test_assert(mfs1.current_bank == MFS_BANK_1, "wrong bank");
+    test_assert(test_check(3, 32, 4), "wrong record");
+  }
+
+  /* [1.5.3] Updating the record again, the new data must be read back.*/
+  test_set_step(3);
+  {
+    test_fill(mfs_buffer, 32, 5);
+    err = mfsWriteRecord(&mfs1, 3, 32, mfs_buffer);
+    test_assert(err == MFS_NO_ERROR, "write failed");
+    test_assert(test_check(3, 32, 5), "wrong record");
+  }
+}
+
+static const testcase_t test_001_005 = {
+  "Recovery of an interrupted write",
+  test_001_005_setup,
+  test_001_005_teardown,
+  test_001_005_execute
+};
+
+/**
+ * @page test_001_006 [1.6] Out of memory condition
+ *
+ * <h2>Description</h2>
+ * Records are written until the storage is full, the out of memory
+ * condition must be reported and erasing a record must make space available
+ * again.
+ *
+ * <h2>Test Steps</h2>
+ * - [1.6.1] Writing a record larger than a bank, the operation must fail.
+ * - [1.6.2] Writing records until the storage is full, the fourth record
+ *   must not fit.
+ * - [1.6.3] Erasing a record then writing the fourth record again, a
+ *   garbage collection must make space for it.
+ * .
+ */
+
+static void test_001_006_setup(void) {
+  test_mfs_start();
+  (void) mfsMount(&mfs1);
+}
+
+static void test_001_006_teardown(void) {
+  test_mfs_stop();
+}
+
+static void test_001_006_execute(void) {
+  mfs_error_t err;
+  uint32_t id;
+
+  /* [1.6.1] Writing a record larger than a bank, the operation must fail.*/
+  test_set_step(1);
+  {
+    test_fill(mfs_buffer, TEST_BANK_SIZE, 6);
+    err = mfsWriteRecord(&mfs1, 0, TEST_BANK_SIZE, mfs_buffer);
+    test_assert(err == MFS_ERR_OUT_OF_MEM, "size not checked");
+  }
+
+  /* [1.6.2] Writing records until the storage is full, the fourth record
+     must not fit.*/
+  test_set_step(2);
+  {
+    for (id = 0; id < 3U; id++) {
+      test_fill(mfs_buffer, 500, (uint8_t)id);
+      err = mfsWriteRecord(&mfs1, id, 500, mfs_buffer);
+      test_assert(err == MFS_NO_ERROR, "write failed");
+    }
+    test_fill(mfs_buffer, 500, 3);
+    err = mfsWriteRecord(&mfs1, 3, 500, mfs_buffer);
+    test_assert(err == MFS_ERR_OUT_OF_MEM, "out of memory not detected");
+  }
+
+  /* [1.6.3] Erasing a record then writing the fourth record again, a
+     garbage collection must make space for it.*/
+  test_set_step(3);
+  {
+    err = mfsEraseRecord(&mfs1, 0);
+    test_assert(err == MFS_NO_ERROR, "erase failed");
+    test_fill(mfs_buffer, 500, 3);
+    err = mfsWriteRecord(&mfs1, 3, 500, mfs_buffer);
+    test_assert(err == MFS_WARN_GC, "garbage collection not triggered");
+    for (id = 1; id < 4U; id++) {
+      test_assert(test_check(id, 500, (uint8_t)id), "wrong record");
+    }
+  }
+}
+
+static const testcase_t test_001_006 = {
+  "Out of memory condition",
+  test_001_006_setup,
+  test_001_006_teardown,
+  test_001_006_execute
+};
+
+/****************************************************************************
+ * Exported data.
+ ****************************************************************************/
+
+/**
+ * @brief   Functional tests.
+ */
+const testcase_t * const test_sequence_001[] = {
+  &test_001_001,
+  &test_001_002,
+  &test_001_003,
+  &test_001_004,
+  &test_001_005,
+  &test_001_006,
+  NULL
+};
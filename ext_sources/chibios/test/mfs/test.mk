@@ -0,0 +1,13 @@
+# List of all the MFS test files.
+TESTSRC = ${CHIBIOS}/test/lib/ch_test.c \
+          ${CHIBIOS}/test/mfs/source/test/test_root.c \
+          ${CHIBIOS}/test/mfs/source/test/test_sequence_001.c \
+          ${CHIBIOS}/os/hal/lib/peripherals/flash/hal_flash.c \
+          ${CHIBIOS}/os/hal/lib/peripherals/flash/hal_ram_flash.c \
+          ${CHIBIOS}/os/hal/lib/crc/crc.c
+
+# Required include directories
+TESTINC = ${CHIBIOS}/test/lib \
+          ${CHIBIOS}/test/mfs/source/test \
+          ${CHIBIOS}/os/hal/lib/peripherals/flash \
+          ${CHIBIOS}/os/hal/lib/crc
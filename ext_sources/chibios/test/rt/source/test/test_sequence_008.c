@@ -40,6 +40,8 @@
  * - @subpage test_008_001
  * - @subpage test_008_002
  * - @subpage test_008_003
+ * - @subpage test_008_004
+ * - @subpage test_008_005
  * .
  */
 
@@ -373,6 +375,250 @@ static const testcase_t test_008_003 = {
   test_008_003_execute
 };
 
+#if (CH_CFG_USE_OBJ_FIFOS) || defined(__DOXYGEN__)
+/**
+ * @page test_008_004 [8.4] Objects FIFO zero-copy transfer
+ *
+ * <h2>Description</h2>
+ * The objects FIFO API is tested, objects are filled in place by the sender
+ * and the receiver must get the very same objects without copies.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_OBJ_FIFOS
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [8.4.1] Initializing the FIFO and taking all the objects, the FIFO must
+ *   be exhausted.
+ * - [8.4.2] Filling the objects in place and sending them, the receiver
+ *   must get the same objects in FIFO order.
+ * - [8.4.3] Sending an object ahead of another, it must be received first.
+ * - [8.4.4] Testing chFifoReceiveObjectTimeout() and chFifoReceiveObjectI()
+ *   timeout.
+ * - [8.4.5] Testing that all the objects have been returned to the free
+ *   pool.
+ * .
+ */
+
+static void test_008_004_execute(void) {
+  objects_fifo_t of;
+  msg_t msgbuf[MB_SIZE];
+  void *objbuf[MB_SIZE * 2];
+  msg_t *objs[MB_SIZE];
+  msg_t *p;
+  msg_t msg;
+  unsigned i;
+
+  /* [8.4.1] Initializing the FIFO and taking all the objects, the FIFO must
+     be exhausted.*/
+  test_set_step(1);
+  {
+    chFifoObjectInit(&of, 2U * sizeof (void *), MB_SIZE, objbuf, msgbuf);
+    for (i = 0; i < MB_SIZE; i++) {
+      objs[i] = chFifoTakeObjectTimeout(&of, TIME_IMMEDIATE);
+      test_assert(objs[i] != NULL, "object not available");
+    }
+    p = chFifoTakeObjectTimeout(&of, TIME_IMMEDIATE);
+    test_assert(p == NULL, "FIFO not exhausted");
+    chSysLock();
+    p = chFifoTakeObjectI(&of);
+    chSysUnlock();
+    test_assert(p == NULL, "FIFO not exhausted");
+  }
+
+  /* [8.4.2] Filling the objects in place and sending them, the receiver
+     must get the same objects in FIFO order.*/
+  test_set_step(2);
+  {
+    for (i = 0; i < MB_SIZE; i++) {
+      objs[i][0] = (msg_t)'A' + (msg_t)i;
+      if ((i & 1U) == 0U) {
+        chFifoSendObject(&of, objs[i]);
+      }
+      else {
+        chSysLock();
+        chFifoSendObjectI(&of, objs[i]);
+        chSysUnlock();
+      }
+    }
+    for (i = 0; i < MB_SIZE; i++) {
+      msg = chFifoReceiveObjectTimeout(&of, (void **)&p, TIME_IMMEDIATE);
+      test_assert(msg == MSG_OK, "wrong wake-up message");
+      test_assert(p == objs[i], "object copied or out of order");
+      test_emit_token((char)p[0]);
+      chFifoReturnObject(&of, p);
+    }
+    test_assert_sequence("ABCD", "wrong get sequence");
+  }
+
+  /* [8.4.3] Sending an object ahead of another, it must be received first.*/
+  test_set_step(3);
+  {
+    objs[0] = chFifoTakeObjectTimeout(&of, TIME_IMMEDIATE);
+    objs[1] = chFifoTakeObjectTimeout(&of, TIME_IMMEDIATE);
+    test_assert((objs[0] != NULL) && (objs[1] != NULL), "object not available");
+    chFifoSendObject(&of, objs[0]);
+    chFifoSendObjectAhead(&of, objs[1]);
+    msg = chFifoReceiveObjectTimeout(&of, (void **)&p, TIME_IMMEDIATE);
+    test_assert((msg == MSG_OK) && (p == objs[1]), "ahead object not first");
+    chFifoReturnObject(&of, p);
+    chSysLock();
+    msg = chFifoReceiveObjectI(&of, (void **)&p);
+    if (msg == MSG_OK) {
+      chFifoReturnObjectI(&of, p);
+    }
+    chSysUnlock();
+    test_assert((msg == MSG_OK) && (p == objs[0]), "wrong object");
+  }
+
+  /* [8.4.4] Testing chFifoReceiveObjectTimeout() and chFifoReceiveObjectI()
+     timeout.*/
+  test_set_step(4);
+  {
+    msg = chFifoReceiveObjectTimeout(&of, (void **)&p, 1);
+    test_assert(msg == MSG_TIMEOUT, "wrong wake-up message");
+    chSysLock();
+    msg = chFifoReceiveObjectI(&of, (void **)&p);
+    chSysUnlock();
+    test_assert(msg == MSG_TIMEOUT, "wrong wake-up message");
+  }
+
+  /* [8.4.5] Testing that all the objects have been returned to the free
+     pool.*/
+  test_set_step(5);
+  {
+    for (i = 0; i < MB_SIZE; i++) {
+      p = chFifoTakeObjectTimeout(&of, TIME_IMMEDIATE);
+      test_assert(p != NULL, "object not returned");
+    }
+    p = chFifoTakeObjectTimeout(&of, TIME_IMMEDIATE);
+    test_assert(p == NULL, "FIFO not exhausted");
+  }
+}
+
+static const testcase_t test_008_004 = {
+  "Objects FIFO zero-copy transfer",
+  NULL,
+  NULL,
+  test_008_004_execute
+};
+#endif /* CH_CFG_USE_OBJ_FIFOS */
+
+/**
+ * @page test_008_005 [8.5] Mailbox batch API
+ *
+ * <h2>Description</h2>
+ * The mailbox batch API is tested, messages are posted and fetched in
+ * batches crossing the buffer boundary, partial batches and empty or full
+ * conditions are checked.
+ *
+ * <h2>Test Steps</h2>
+ * - [8.5.1] Posting a batch larger than the mailbox using chMBPostBatch(),
+ *   only MB_SIZE messages must be posted.
+ * - [8.5.2] Posting in the full mailbox using chMBPostBatch() and
+ *   chMBPostBatchI(), no message must be posted.
+ * - [8.5.3] Fetching part of the messages using chMBFetchBatch() then
+ *   posting two more messages using chMBPostBatchI(), the write pointer
+ *   wraps around.
+ * - [8.5.4] Emptying the mailbox using chMBFetchBatchI(), the messages must
+ *   be in FIFO order.
+ * - [8.5.5] Fetching from the empty mailbox using chMBFetchBatchI() and
+ *   chMBFetchBatch() with a timeout, no message must be fetched.
+ * .
+ */
+
+static void test_008_005_setup(void) {
+  chMBObjectInit(&mb1, mb_buffer, MB_SIZE);
+}
+
+static void test_008_005_teardown(void) {
+  chMBReset(&mb1);
+}
+
+static void test_008_005_execute(void) {
+  msg_t msgs[MB_SIZE + 1];
+  cnt_t n;
+  unsigned i;
+
+  /* [8.5.1] Posting a batch larger than the mailbox using chMBPostBatch(),
+     only MB_SIZE messages must be posted.*/
+  test_set_step(1);
+  {
+    for (i = 0; i < MB_SIZE + 1; i++) {
+      msgs[i] = 'A' + i;
+    }
+    n = chMBPostBatch(&mb1, msgs, MB_SIZE + 1, TIME_IMMEDIATE);
+    test_assert(n == MB_SIZE, "wrong number of posted messages");
+    test_assert_lock(chMBGetUsedCountI(&mb1) == MB_SIZE, "not full");
+  }
+
+  /* [8.5.2] Posting in the full mailbox using chMBPostBatch() and
+     chMBPostBatchI(), no message must be posted.*/
+  test_set_step(2);
+  {
+    n = chMBPostBatch(&mb1, msgs, 1, TIME_IMMEDIATE);
+    test_assert(n == 0, "posted in full mailbox");
+    chSysLock();
+    n = chMBPostBatchI(&mb1, msgs, 1);
+    chSysUnlock();
+    test_assert(n == 0, "posted in full mailbox");
+  }
+
+  /* [8.5.3] Fetching part of the messages using chMBFetchBatch() then
+     posting two more messages using chMBPostBatchI(), the write pointer
+     wraps around.*/
+  test_set_step(3);
+  {
+    n = chMBFetchBatch(&mb1, msgs, 3, TIME_INFINITE);
+    test_assert(n == 3, "wrong number of fetched messages");
+    for (i = 0; i < (unsigned)n; i++) {
+      test_emit_token((char)msgs[i]);
+    }
+    msgs[0] = 'E';
+    msgs[1] = 'F';
+    chSysLock();
+    n = chMBPostBatchI(&mb1, msgs, 2);
+    chSysUnlock();
+    test_assert(n == 2, "wrong number of posted messages");
+  }
+
+  /* [8.5.4] Emptying the mailbox using chMBFetchBatchI(), the messages must
+     be in FIFO order.*/
+  test_set_step(4);
+  {
+    chSysLock();
+    n = chMBFetchBatchI(&mb1, msgs, MB_SIZE + 1);
+    chSysUnlock();
+    test_assert(n == 3, "wrong number of fetched messages");
+    for (i = 0; i < (unsigned)n; i++) {
+      test_emit_token((char)msgs[i]);
+    }
+    test_assert_sequence("ABCDEF", "wrong get sequence");
+  }
+
+  /* [8.5.5] Fetching from the empty mailbox using chMBFetchBatchI() and
+     chMBFetchBatch() with a timeout, no message must be fetched.*/
+  test_set_step(5);
+  {
+    chSysLock();
+    n = chMBFetchBatchI(&mb1, msgs, 1);
+    chSysUnlock();
+    test_assert(n == 0, "fetched from empty mailbox");
+    n = chMBFetchBatch(&mb1, msgs, MB_SIZE, MS2ST(10));
+    test_assert(n == 0, "fetched from empty mailbox");
+    test_assert_lock(chMBGetFreeCountI(&mb1) == MB_SIZE, "not empty");
+  }
+}
+
+static const testcase_t test_008_005 = {
+  "Mailbox batch API",
+  test_008_005_setup,
+  test_008_005_teardown,
+  test_008_005_execute
+};
+
 /****************************************************************************
  * Exported data.
  ****************************************************************************/
@@ -384,6 +630,10 @@ const testcase_t * const test_sequence_008[] = {
   &test_008_001,
   &test_008_002,
   &test_008_003,
+#if (CH_CFG_USE_OBJ_FIFOS) || defined(__DOXYGEN__)
+  &test_008_004,
+#endif
+  &test_008_005,
   NULL
 };
 
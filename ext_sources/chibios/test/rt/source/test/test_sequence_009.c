@@ -40,6 +40,7 @@
  * - @subpage test_009_001
  * - @subpage test_009_002
  * - @subpage test_009_003
+ * - @subpage test_009_004
  * .
  */
 
@@ -275,6 +276,80 @@ static const testcase_t test_009_003 = {
 };
 #endif /* CH_CFG_USE_SEMAPHORES */
 
+#if (CH_CFG_MEMPOOLS_STATS) || defined(__DOXYGEN__)
+/**
+ * @page test_009_004 [9.4] Memory Pools statistics
+ *
+ * <h2>Description</h2>
+ * The memory pool statistics are checked while loading and emptying a
+ * pool.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_MEMPOOLS_STATS
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [9.4.1] Adding the objects to the pool using chPoolLoadArray(), the
+ *   objects must be counted as free.
+ * - [9.4.2] Emptying the pool using chPoolAlloc() then allocating once
+ *   more, the failure must be counted.
+ * - [9.4.3] Returning two objects using chPoolFree(), the peak must not
+ *   change.
+ * .
+ */
+
+static void test_009_004_setup(void) {
+  chPoolObjectInit(&mp1, sizeof (uint32_t), NULL);
+}
+
+static void test_009_004_execute(void) {
+  pool_stats_t ps;
+  unsigned i;
+
+  /* [9.4.1] Adding the objects to the pool using chPoolLoadArray(), the
+     objects must be counted as free.*/
+  test_set_step(1);
+  {
+    chPoolLoadArray(&mp1, objects, MEMORY_POOL_SIZE);
+    chPoolGetStats(&mp1, &ps);
+    test_assert((ps.size == MEMORY_POOL_SIZE) && (ps.free == MEMORY_POOL_SIZE), "wrong size");
+    test_assert((ps.peak == 0U) && (ps.allocs == 0U) && (ps.failures == 0U), "wrong counters");
+  }
+
+  /* [9.4.2] Emptying the pool using chPoolAlloc() then allocating once
+     more, the failure must be counted.*/
+  test_set_step(2);
+  {
+    for (i = 0; i < MEMORY_POOL_SIZE; i++)
+      test_assert(chPoolAlloc(&mp1) != NULL, "list empty");
+    test_assert(chPoolAlloc(&mp1) == NULL, "list not empty");
+    chPoolGetStats(&mp1, &ps);
+    test_assert((ps.free == 0U) && (ps.peak == MEMORY_POOL_SIZE), "wrong usage");
+    test_assert((ps.allocs == MEMORY_POOL_SIZE) && (ps.failures == 1U), "wrong counters");
+  }
+
+  /* [9.4.3] Returning two objects using chPoolFree(), the peak must not
+     change.*/
+  test_set_step(3);
+  {
+    chPoolFree(&mp1, &objects[0]);
+    chPoolFree(&mp1, &objects[1]);
+    chPoolGetStats(&mp1, &ps);
+    test_assert((ps.size - ps.free) == (MEMORY_POOL_SIZE - 2U), "wrong usage");
+    test_assert(ps.peak == MEMORY_POOL_SIZE, "wrong peak");
+  }
+}
+
+static const testcase_t test_009_004 = {
+  "Memory Pools statistics",
+  test_009_004_setup,
+  NULL,
+  test_009_004_execute
+};
+#endif /* CH_CFG_MEMPOOLS_STATS */
+
 /****************************************************************************
  * Exported data.
  ****************************************************************************/
@@ -289,6 +364,9 @@ const testcase_t * const test_sequence_009[] = {
 #endif
 #if (CH_CFG_USE_SEMAPHORES) || defined(__DOXYGEN__)
   &test_009_003,
+#endif
+#if (CH_CFG_MEMPOOLS_STATS) || defined(__DOXYGEN__)
+  &test_009_004,
 #endif
   NULL
 };
@@ -47,6 +47,7 @@
  * - @subpage test_012_010
  * - @subpage test_012_011
  * - @subpage test_012_012
+ * - @subpage test_012_013
  * .
  */
 
@@ -63,6 +64,63 @@ static mutex_t mtx1;
 
 static void tmo(void *param) {(void)param;}
 
+/* Number of background timers available to the virtual timers benchmark,
+   it can be raised on targets with enough RAM.*/
+#if !defined(TEST_BMK_VT_TIMERS)
+#if defined(CH_ARCHITECTURE_AVR) || defined(CH_ARCHITECTURE_MSP430) ||     \
+    defined(CH_ARCHITECTURE_STM8)
+#define TEST_BMK_VT_TIMERS      10
+#elif defined(CH_ARCHITECTURE_SIMIA32)
+#define TEST_BMK_VT_TIMERS      1000
+#else
+#define TEST_BMK_VT_TIMERS      100
+#endif
+#endif
+
+#define BMK_VT_COUNT(n)                                                     \
+  ((n) < TEST_BMK_VT_TIMERS ? (n) : TEST_BMK_VT_TIMERS)
+
+static virtual_timer_t bmk_vt[TEST_BMK_VT_TIMERS];
+
+NOINLINE static unsigned int vt_loop_test(unsigned int nt) {
+  static virtual_timer_t vt1, vt2;
+  systime_t start, end;
+  unsigned int i;
+
+  uint32_t n = 0;
+
+  /* Background timers expiring after the measurement window, the second
+     timer is set after all of them.*/
+  chSysLock();
+  for (i = 0; i < nt; i++) {
+    chVTDoSetI(&bmk_vt[i], MS2ST(1500) + (systime_t)i, tmo, NULL);
+  }
+  chSysUnlock();
+
+  start = test_wait_tick();
+  end = start + MS2ST(1000);
+  do {
+    chSysLock();
+    chVTDoSetI(&vt1, 1, tmo, NULL);
+    chVTDoSetI(&vt2, MS2ST(2500), tmo, NULL);
+    chVTDoResetI(&vt1);
+    chVTDoResetI(&vt2);
+    chSysUnlock();
+    n++;
+#if defined(SIMULATOR)
+    _sim_check_for_interrupts();
+#endif
+  } while (chVTIsSystemTimeWithinX(start, end));
+
+  chSysLock();
+  for (i = 0; i < nt; i++) {
+    chVTResetI(&bmk_vt[i]);
+  }
+  chSysUnlock();
+
+  return n * 2;
+}
+
 #if CH_CFG_USE_MESSAGES
 static THD_FUNCTION(bmk_thread1, p) {
   thread_t *tp;
@@ -135,6 +193,57 @@ static THD_FUNCTION(bmk_thread8, p) {
   } while(!chThdShouldTerminateX());
 }
 
+#if CH_CFG_USE_MAILBOXES
+#define BMK_MB_BATCH            8
+
+static msg_t bmk_mb_buffer[BMK_MB_BATCH];
+static MAILBOX_DECL(bmk_mb, bmk_mb_buffer, BMK_MB_BATCH);
+
+/* Fetches one message at time if the parameter is NULL else in batches,
+   a zero message terminates the thread.*/
+static THD_FUNCTION(bmk_thread9, p) {
+  msg_t msgs[BMK_MB_BATCH];
+  cnt_t n;
+
+  do {
+    if (p == NULL) {
+      n = chMBFetch(&bmk_mb, &msgs[0], TIME_INFINITE) == MSG_OK ? 1 : 0;
+    }
+    else {
+      n = chMBFetchBatch(&bmk_mb, msgs, BMK_MB_BATCH, TIME_INFINITE);
+    }
+  } while ((n == 0) || (msgs[n - 1] != 0));
+}
+
+NOINLINE static unsigned int mb_loop_test(bool batch) {
+  msg_t msgs[BMK_MB_BATCH];
+  systime_t start, end;
+  unsigned int i;
+
+  uint32_t n = 0;
+  for (i = 0; i < BMK_MB_BATCH; i++) {
+    msgs[i] = 1;
+  }
+  start = test_wait_tick();
+  end = start + MS2ST(1000);
+  do {
+    if (batch) {
+      n += (uint32_t)chMBPostBatch(&bmk_mb, msgs, BMK_MB_BATCH,
+                                   TIME_INFINITE);
+    }
+    else {
+      (void)chMBPost(&bmk_mb, 1, TIME_INFINITE);
+      n++;
+    }
+#if defined(SIMULATOR)
+    _sim_check_for_interrupts();
+#endif
+  } while (chVTIsSystemTimeWithinX(start, end));
+  (void)chMBPost(&bmk_mb, 0, TIME_INFINITE);
+  return n;
+}
+#endif
+
 /****************************************************************************
  * Test cases.
  ****************************************************************************/
@@ -684,13 +793,21 @@ static const testcase_t test_012_008 = {
  * <h2>Description</h2>
  * A virtual timer is set and immediately reset into a continuous
  * loop.<br> The performance is calculated by measuring the number of
- * iterations after a second of continuous operations.
+ * iterations after a second of continuous operations.<br> The test is
+ * repeated with a growing number of timers armed in background in
+ * order to measure how the timers handling scales.
  *
  * <h2>Test Steps</h2>
  * - [12.9.1] Two timers are set then reset without waiting for their
  *   counter to elapse. The operation is repeated continuously in a
  *   one-second time window.
  * - [12.9.2] The score is printed.
+ * - [12.9.3] The test is repeated with ten timers armed in background,
+ *   the score is printed.
+ * - [12.9.4] The test is repeated with one hundred timers armed in
+ *   background, the score is printed.
+ * - [12.9.5] The test is repeated with one thousand timers armed in
+ *   background, the score is printed.
  * .
  */
 
@@ -729,6 +846,42 @@ static void test_012_009_execute(void) {
     test_printn(n * 2);
     test_println(" timers/S");
   }
+
+  /* [12.9.3] The test is repeated with ten timers armed in background,
+     the score is printed.*/
+  test_set_step(3);
+  {
+    n = vt_loop_test(BMK_VT_COUNT(10U));
+    test_print("--- Score : ");
+    test_printn(n);
+    test_print(" timers/S, ");
+    test_printn(BMK_VT_COUNT(10U));
+    test_println(" armed");
+  }
+
+  /* [12.9.4] The test is repeated with one hundred timers armed in
+     background, the score is printed.*/
+  test_set_step(4);
+  {
+    n = vt_loop_test(BMK_VT_COUNT(100U));
+    test_print("--- Score : ");
+    test_printn(n);
+    test_print(" timers/S, ");
+    test_printn(BMK_VT_COUNT(100U));
+    test_println(" armed");
+  }
+
+  /* [12.9.5] The test is repeated with one thousand timers armed in
+     background, the score is printed.*/
+  test_set_step(5);
+  {
+    n = vt_loop_test(BMK_VT_COUNT(1000U));
+    test_print("--- Score : ");
+    test_printn(n);
+    test_print(" timers/S, ");
+    test_printn(BMK_VT_COUNT(1000U));
+    test_println(" armed");
+  }
 }
 
 static const testcase_t test_012_009 = {
@@ -995,6 +1148,85 @@ static const testcase_t test_012_012 = {
   test_012_012_execute
 };
 
+#if (CH_CFG_USE_MAILBOXES) || defined(__DOXYGEN__)
+/**
+ * @page test_012_013 [12.13] Mailboxes performance, single vs batch
+ *
+ * <h2>Description</h2>
+ * A thread with higher priority than the tester fetches the messages posted
+ * in a mailbox, first one message at time using chMBPost() and chMBFetch()
+ * then in batches of BMK_MB_BATCH messages using chMBPostBatch() and
+ * chMBFetchBatch(). The performance is calculated by measuring the number
+ * of messages transferred after a second of continuous operations.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_MAILBOXES
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [12.13.1] The fetcher thread is created, messages are posted one at
+ *   time. The operation is repeated continuously in a one-second time
+ *   window.
+ * - [12.13.2] The score is printed.
+ * - [12.13.3] The fetcher thread is created, messages are posted in
+ *   batches. The operation is repeated continuously in a one-second time
+ *   window.
+ * - [12.13.4] The score is printed.
+ * .
+ */
+
+static void test_012_013_execute(void) {
+  uint32_t n;
+
+  /* [12.13.1] The fetcher thread is created, messages are posted one at
+     time. The operation is repeated continuously in a one-second time
+     window.*/
+  test_set_step(1);
+  {
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX() + 1,
+                                   bmk_thread9, NULL);
+    n = mb_loop_test(false);
+    test_wait_threads();
+  }
+
+  /* [12.13.2] The score is printed.*/
+  test_set_step(2);
+  {
+    test_print("--- Single: ");
+    test_printn(n);
+    test_println(" msgs/S");
+  }
+
+  /* [12.13.3] The fetcher thread is created, messages are posted in
+     batches. The operation is repeated continuously in a one-second time
+     window.*/
+  test_set_step(3);
+  {
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX() + 1,
+                                   bmk_thread9, &bmk_mb);
+    n = mb_loop_test(true);
+    test_wait_threads();
+  }
+
+  /* [12.13.4] The score is printed.*/
+  test_set_step(4);
+  {
+    test_print("--- Batch : ");
+    test_printn(n);
+    test_println(" msgs/S");
+  }
+}
+
+static const testcase_t test_012_013 = {
+  "Mailboxes performance, single vs batch",
+  NULL,
+  NULL,
+  test_012_013_execute
+};
+#endif /* CH_CFG_USE_MAILBOXES */
+
 /****************************************************************************
  * Exported data.
  ****************************************************************************/
@@ -1027,5 +1259,8 @@ const testcase_t * const test_sequence_012[] = {
   &test_012_011,
 #endif
   &test_012_012,
+#if (CH_CFG_USE_MAILBOXES) || defined(__DOXYGEN__)
+  &test_012_013,
+#endif
   NULL
 };
@@ -0,0 +1,354 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "hal.h"
+#include "ch_test.h"
+#include "test_root.h"
+
+/**
+ * @file    test_sequence_013.c
+ * @brief   Test Sequence 013 code.
+ *
+ * @page test_sequence_013 [13] Heap Benchmarks
+ *
+ * File: @ref test_sequence_013.c
+ *
+ * <h2>Description</h2>
+ * This module implements a series of memory heap benchmarks. The same
+ * sequence is meant to be run with both the first-fit and the TLSF
+ * allocators, see @p CH_CFG_HEAP_TLSF, and the results compared.
+ *
+ * <h2>Conditions</h2>
+ * This sequence is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_HEAP
+ * .
+ *
+ * <h2>Test Cases</h2>
+ * - @subpage test_013_001
+ * - @subpage test_013_002
+ * - @subpage test_013_003
+ * .
+ */
+
+#if (CH_CFG_USE_HEAP) || defined(__DOXYGEN__)
+
+/****************************************************************************
+ * Shared code.
+ ****************************************************************************/
+
+#define BMK_HEAP_SLOTS          16
+#define BMK_HEAP_MAX_SIZE       128
+#define BMK_HEAP_CYCLES         4096
+
+static memory_heap_t bmk_heap;
+static void *bmk_blocks[BMK_HEAP_SLOTS];
+static uint32_t bmk_seed;
+
+static size_t bmk_heap_size(void) {
+
+  bmk_seed = (bmk_seed * 1103515245U) + 12345U;
+  return (size_t)((bmk_seed >> 16) % BMK_HEAP_MAX_SIZE) + 1U;
+}
+
+static void bmk_heap_setup(void) {
+  unsigned i;
+
+  chHeapObjectInit(&bmk_heap, test_buffer, sizeof (test_buffer));
+  for (i = 0; i < BMK_HEAP_SLOTS; i++) {
+    bmk_blocks[i] = NULL;
+  }
+  bmk_seed = 1U;
+}
+
+static void bmk_heap_teardown(void) {
+  unsigned i;
+
+  for (i = 0; i < BMK_HEAP_SLOTS; i++) {
+    if (bmk_blocks[i] != NULL) {
+      chHeapFree(bmk_blocks[i]);
+      bmk_blocks[i] = NULL;
+    }
+  }
+}
+
+static void bmk_heap_cycle(unsigned i) {
+  size_t size = bmk_heap_size();
+
+  if (bmk_blocks[i] != NULL) {
+    chHeapFree(bmk_blocks[i]);
+  }
+  bmk_blocks[i] = chHeapAlloc(&bmk_heap, size);
+}
+
+/****************************************************************************
+ * Test cases.
+ ****************************************************************************/
+
+/**
+ * @page test_013_001 [13.1] Mixed sizes throughput
+ *
+ * <h2>Description</h2>
+ * Blocks of pseudo-random sizes are allocated and freed in a ring of
+ * slots, the number of free and allocate pairs per second is measured
+ * and the result printed on the output log.
+ *
+ * <h2>Test Steps</h2>
+ * - [13.1.1] The allocator type is printed.
+ * - [13.1.2] A block is freed and a new one allocated in each slot in
+ *   turn. The operation is repeated continuously in a one-second time
+ *   window.
+ * - [13.1.3] The score is printed.
+ * .
+ */
+
+static void test_013_001_setup(void) {
+  bmk_heap_setup();
+}
+
+static void test_013_001_teardown(void) {
+  bmk_heap_teardown();
+}
+
+static void test_013_001_execute(void) {
+  uint32_t n;
+
+  /* [13.1.1] The allocator type is printed.*/
+  test_set_step(1);
+  {
+#if CH_CFG_HEAP_TLSF == TRUE
+    test_println("--- Heap  : TLSF");
+#else
+    test_println("--- Heap  : first-fit");
+#endif
+  }
+
+  /* [13.1.2] A block is freed and a new one allocated in each slot in
+     turn. The operation is repeated continuously in a one-second time
+     window.*/
+  test_set_step(2);
+  {
+    systime_t start, end;
+
+    n = 0;
+    start = test_wait_tick();
+    end = start + MS2ST(1000);
+    do {
+      bmk_heap_cycle(n % BMK_HEAP_SLOTS);
+      n++;
+#if defined(SIMULATOR)
+      _sim_check_for_interrupts();
+#endif
+    } while (chVTIsSystemTimeWithinX(start, end));
+  }
+
+  /* [13.1.3] The score is printed.*/
+  test_set_step(3);
+  {
+    test_print("--- Score : ");
+    test_printn(n);
+    test_println(" free+alloc/S");
+  }
+}
+
+static const testcase_t test_013_001 = {
+  "Mixed sizes throughput",
+  test_013_001_setup,
+  test_013_001_teardown,
+  test_013_001_execute
+};
+
+#if (PORT_SUPPORTS_RT == TRUE) || defined(__DOXYGEN__)
+/**
+ * @page test_013_002 [13.2] Worst case execution time
+ *
+ * <h2>Description</h2>
+ * The same pattern of the previous test is repeated a fixed number of
+ * times measuring each operation using the realtime counter, the
+ * longest allocation and free times are printed on the output log.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - PORT_SUPPORTS_RT == TRUE
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [13.2.1] Blocks are freed and allocated measuring the time of each
+ *   operation, the maximum is kept.
+ * - [13.2.2] The worst case times are printed.
+ * .
+ */
+
+static void test_013_002_setup(void) {
+  bmk_heap_setup();
+}
+
+static void test_013_002_teardown(void) {
+  bmk_heap_teardown();
+}
+
+static void test_013_002_execute(void) {
+  rtcnt_t amax, fmax;
+
+  /* [13.2.1] Blocks are freed and allocated measuring the time of each
+     operation, the maximum is kept.*/
+  test_set_step(1);
+  {
+    unsigned i;
+
+    amax = 0;
+    fmax = 0;
+    for (i = 0; i < BMK_HEAP_CYCLES; i++) {
+      unsigned j = i % BMK_HEAP_SLOTS;
+      size_t size = bmk_heap_size();
+      rtcnt_t t;
+
+      if (bmk_blocks[j] != NULL) {
+        t = chSysGetRealtimeCounterX();
+        chHeapFree(bmk_blocks[j]);
+        t = chSysGetRealtimeCounterX() - t;
+        if (t > fmax) {
+          fmax = t;
+        }
+      }
+      t = chSysGetRealtimeCounterX();
+      bmk_blocks[j] = chHeapAlloc(&bmk_heap, size);
+      t = chSysGetRealtimeCounterX() - t;
+      if (t > amax) {
+        amax = t;
+      }
+#if defined(SIMULATOR)
+      _sim_check_for_interrupts();
+#endif
+    }
+  }
+
+  /* [13.2.2] The worst case times are printed.*/
+  test_set_step(2);
+  {
+    test_print("--- Alloc : ");
+    test_printn((uint32_t)amax);
+    test_println(" cycles max");
+    test_print("--- Free  : ");
+    test_printn((uint32_t)fmax);
+    test_println(" cycles max");
+  }
+}
+
+static const testcase_t test_013_002 = {
+  "Worst case execution time",
+  test_013_002_setup,
+  test_013_002_teardown,
+  test_013_002_execute
+};
+#endif /* PORT_SUPPORTS_RT == TRUE */
+
+/**
+ * @page test_013_003 [13.3] Fragmentation
+ *
+ * <h2>Description</h2>
+ * After a series of allocations of pseudo-random sizes every other
+ * block is freed, the heap statistics are printed on the output log.
+ * Finally all blocks are freed and the heap must be back to a single
+ * free block.
+ *
+ * <h2>Test Steps</h2>
+ * - [13.3.1] Blocks are freed and allocated repeatedly then every
+ *   other block is freed.
+ * - [13.3.2] The heap statistics are printed.
+ * - [13.3.3] All blocks are freed, the heap must not be fragmented.
+ * .
+ */
+
+static void test_013_003_setup(void) {
+  bmk_heap_setup();
+}
+
+static void test_013_003_teardown(void) {
+  bmk_heap_teardown();
+}
+
+static void test_013_003_execute(void) {
+
+  /* [13.3.1] Blocks are freed and allocated repeatedly then every
+     other block is freed.*/
+  test_set_step(1);
+  {
+    unsigned i;
+
+    for (i = 0; i < BMK_HEAP_CYCLES; i++) {
+      bmk_heap_cycle(i % BMK_HEAP_SLOTS);
+    }
+    for (i = 1; i < BMK_HEAP_SLOTS; i += 2) {
+      if (bmk_blocks[i] != NULL) {
+        chHeapFree(bmk_blocks[i]);
+        bmk_blocks[i] = NULL;
+      }
+    }
+  }
+
+  /* [13.3.2] The heap statistics are printed.*/
+  test_set_step(2);
+  {
+    heap_stats_t hs;
+
+    chHeapGetStats(&bmk_heap, &hs);
+    test_print("--- Free  : ");
+    test_printn((uint32_t)hs.free);
+    test_print(" bytes in ");
+    test_printn((uint32_t)hs.nfree);
+    test_println(" blocks");
+    test_print("--- Larg. : ");
+    test_printn((uint32_t)hs.largest);
+    test_println(" bytes");
+    test_print("--- Frag. : ");
+    test_printn((uint32_t)hs.fragmentation);
+    test_println(" per mille");
+  }
+
+  /* [13.3.3] All blocks are freed, the heap must not be fragmented.*/
+  test_set_step(3);
+  {
+    bmk_heap_teardown();
+    test_assert(chHeapStatus(&bmk_heap, NULL, NULL) == 1, "heap fragmented");
+  }
+}
+
+static const testcase_t test_013_003 = {
+  "Fragmentation",
+  test_013_003_setup,
+  test_013_003_teardown,
+  test_013_003_execute
+};
+
+/****************************************************************************
+ * Exported data.
+ ****************************************************************************/
+
+/**
+ * @brief   Heap Benchmarks.
+ */
+const testcase_t * const test_sequence_013[] = {
+  &test_013_001,
+#if (PORT_SUPPORTS_RT == TRUE) || defined(__DOXYGEN__)
+  &test_013_002,
+#endif
+  &test_013_003,
+  NULL
+};
+
+#endif /* CH_CFG_USE_HEAP */
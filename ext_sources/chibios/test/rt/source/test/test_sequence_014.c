@@ -0,0 +1,325 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "hal.h"
+#include "ch_test.h"
+#include "test_root.h"
+
+/**
+ * @file    test_sequence_014.c
+ * @brief   Test Sequence 014 code.
+ *
+ * @page test_sequence_014 [14] Snapshots
+ *
+ * File: @ref test_sequence_014.c
+ *
+ * <h2>Description</h2>
+ * This sequence tests the ChibiOS/RT functionalities related to snapshots,
+ * the lock-free publication of shared objects.
+ *
+ * <h2>Conditions</h2>
+ * This sequence is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_SNAPSHOTS
+ * .
+ *
+ * <h2>Test Cases</h2>
+ * - @subpage test_014_001
+ * - @subpage test_014_002
+ * - @subpage test_014_003
+ * .
+ */
+
+#if (CH_CFG_USE_SNAPSHOTS) || defined(__DOXYGEN__)
+
+/****************************************************************************
+ * Shared code.
+ ****************************************************************************/
+
+#define SNAP_WORDS              8
+
+typedef struct {
+  uint32_t              words[SNAP_WORDS];
+} snap_object_t;
+
+static snap_object_t snap_buffer[2];
+static SNAPSHOT_DECL(snap1, snap_buffer, sizeof (snap_object_t));
+static volatile bool snap_stop;
+static volatile uint32_t snap_errors;
+
+static void snap_fill(snap_object_t *op, uint32_t value) {
+  unsigned i;
+
+  for (i = 0; i < SNAP_WORDS; i++) {
+    op->words[i] = value;
+  }
+}
+
+/* The object is consistent if all the words hold the version it has been
+   published with.*/
+static bool snap_check(const snap_object_t *op, ucnt_t version) {
+  unsigned i;
+
+  for (i = 0; i < SNAP_WORDS; i++) {
+    if (op->words[i] != (uint32_t)version) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void snap_publish_next(void) {
+  snap_object_t obj;
+
+  snap_fill(&obj, (uint32_t)chSnapshotGetVersionX(&snap1) + 1U);
+  chSnapshotPublish(&snap1, &obj);
+}
+
+static void snap_read_check(ucnt_t *lastp) {
+  snap_object_t obj;
+  ucnt_t version;
+
+  version = chSnapshotRead(&snap1, &obj);
+  if (!snap_check(&obj, version) || (version < *lastp)) {
+    snap_errors++;
+  }
+  *lastp = version;
+}
+
+static THD_FUNCTION(snap_ticking_writer, p) {
+
+  (void)p;
+  while (!snap_stop) {
+    chThdSleep(1);
+    snap_publish_next();
+  }
+}
+
+static THD_FUNCTION(snap_busy_writer, p) {
+  systime_t start, end;
+
+  (void)p;
+  start = chVTGetSystemTime();
+  end = start + MS2ST(100);
+  do {
+    snap_publish_next();
+#if defined(SIMULATOR)
+    _sim_check_for_interrupts();
+#endif
+  } while (chVTIsSystemTimeWithin(start, end));
+  snap_stop = true;
+}
+
+static THD_FUNCTION(snap_ticking_reader, p) {
+  ucnt_t last = 0;
+
+  (void)p;
+  while (!snap_stop) {
+    chThdSleep(1);
+    snap_read_check(&last);
+  }
+}
+
+static void snap_setup(void) {
+
+  chSnapshotObjectInit(&snap1, snap_buffer, sizeof (snap_object_t));
+  snap_stop = false;
+  snap_errors = 0;
+}
+
+/****************************************************************************
+ * Test cases.
+ ****************************************************************************/
+
+/**
+ * @page test_014_001 [14.1] Snapshot publish and read
+ *
+ * <h2>Description</h2>
+ * The snapshot API is tested without concurrent accesses, the read copy
+ * must always be the last published one.
+ *
+ * <h2>Test Steps</h2>
+ * - [14.1.1] Reading the snapshot before any publication, the object must
+ *   be zeroed and the version zero.
+ * - [14.1.2] Publishing three values, the last one must be read back.
+ * .
+ */
+
+static void test_014_001_setup(void) {
+  snap_setup();
+}
+
+static void test_014_001_execute(void) {
+  snap_object_t obj;
+  ucnt_t version;
+
+  /* [14.1.1] Reading the snapshot before any publication, the object must
+     be zeroed and the version zero.*/
+  test_set_step(1);
+  {
+    version = chSnapshotRead(&snap1, &obj);
+    test_assert(version == 0U, "wrong version");
+    test_assert(snap_check(&obj, 0U), "not zeroed");
+  }
+
+  /* [14.1.2] Publishing three values, the last one must be read back.*/
+  test_set_step(2);
+  {
+    snap_publish_next();
+    snap_publish_next();
+    snap_publish_next();
+    version = chSnapshotRead(&snap1, &obj);
+    test_assert(version == 3U, "wrong version");
+    test_assert(chSnapshotGetVersionX(&snap1) == 3U, "wrong version");
+    test_assert(snap_check(&obj, 3U), "wrong object");
+  }
+}
+
+static const testcase_t test_014_001 = {
+  "Snapshot publish and read",
+  test_014_001_setup,
+  NULL,
+  test_014_001_execute
+};
+
+/**
+ * @page test_014_002 [14.2] Snapshot readers preempted by the writer
+ *
+ * <h2>Description</h2>
+ * A writer thread with higher priority publishes on each system tick while
+ * the test thread reads continuously for 100mS, the writer can preempt the
+ * reader while it is copying the object and every copy must be consistent.
+ *
+ * <h2>Test Steps</h2>
+ * - [14.2.1] Starting the writer thread.
+ * - [14.2.2] Reading and checking the snapshot continuously for 100mS.
+ * - [14.2.3] Stopping the writer, no inconsistent copy must have been read.
+ * .
+ */
+
+static void test_014_002_setup(void) {
+  snap_setup();
+}
+
+static void test_014_002_execute(void) {
+
+  /* [14.2.1] Starting the writer thread.*/
+  test_set_step(1);
+  {
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX() + 1,
+                                   snap_ticking_writer, NULL);
+  }
+
+  /* [14.2.2] Reading and checking the snapshot continuously for 100mS.*/
+  test_set_step(2);
+  {
+    systime_t start, end;
+    ucnt_t last = 0;
+
+    start = test_wait_tick();
+    end = start + MS2ST(100);
+    do {
+      snap_read_check(&last);
+#if defined(SIMULATOR)
+      _sim_check_for_interrupts();
+#endif
+    } while (chVTIsSystemTimeWithinX(start, end));
+    test_assert(last > 0U, "writer never run");
+  }
+
+  /* [14.2.3] Stopping the writer, no inconsistent copy must have been read.*/
+  test_set_step(3);
+  {
+    snap_stop = true;
+    test_wait_threads();
+    test_assert(snap_errors == 0U, "inconsistent copy");
+  }
+}
+
+static const testcase_t test_014_002 = {
+  "Snapshot readers preempted by the writer",
+  test_014_002_setup,
+  NULL,
+  test_014_002_execute
+};
+
+/**
+ * @page test_014_003 [14.3] Snapshot writer preempted by readers
+ *
+ * <h2>Description</h2>
+ * A writer thread with lower priority publishes continuously for 100mS
+ * while reader threads with higher priority wake up on each system tick,
+ * the readers can preempt the writer while it is publishing and must
+ * neither block nor read inconsistent copies.
+ *
+ * <h2>Test Steps</h2>
+ * - [14.3.1] Starting the writer and two reader threads.
+ * - [14.3.2] Waiting for the writer to finish, no inconsistent copy must
+ *   have been read.
+ * .
+ */
+
+static void test_014_003_setup(void) {
+  snap_setup();
+}
+
+static void test_014_003_execute(void) {
+
+  /* [14.3.1] Starting the writer and two reader threads.*/
+  test_set_step(1);
+  {
+    tprio_t prio = chThdGetPriorityX();
+
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, prio + 2,
+                                   snap_ticking_reader, NULL);
+    threads[1] = chThdCreateStatic(wa[1], WA_SIZE, prio + 1,
+                                   snap_ticking_reader, NULL);
+    threads[2] = chThdCreateStatic(wa[2], WA_SIZE, prio - 1,
+                                   snap_busy_writer, NULL);
+  }
+
+  /* [14.3.2] Waiting for the writer to finish, no inconsistent copy must
+     have been read.*/
+  test_set_step(2);
+  {
+    test_wait_threads();
+    test_assert(snap_errors == 0U, "inconsistent copy");
+    test_assert(chSnapshotGetVersionX(&snap1) > 0U, "writer never run");
+  }
+}
+
+static const testcase_t test_014_003 = {
+  "Snapshot writer preempted by readers",
+  test_014_003_setup,
+  NULL,
+  test_014_003_execute
+};
+
+/****************************************************************************
+ * Exported data.
+ ****************************************************************************/
+
+/**
+ * @brief   Snapshots.
+ */
+const testcase_t * const test_sequence_014[] = {
+  &test_014_001,
+  &test_014_002,
+  &test_014_003,
+  NULL
+};
+
+#endif /* CH_CFG_USE_SNAPSHOTS */
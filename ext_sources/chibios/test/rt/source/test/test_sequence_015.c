@@ -0,0 +1,585 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+#include "hal.h"
+#include "ch_test.h"
+#include "test_root.h"
+
+/**
+ * @file    test_sequence_015.c
+ * @brief   Test Sequence 015 code.
+ *
+ * @page test_sequence_015 [15] Latency Benchmarks
+ *
+ * File: @ref test_sequence_015.c
+ *
+ * <h2>Description</h2>
+ * This module implements a series of latency benchmarks. Each benchmark
+ * takes LAT_SAMPLES measurements using the realtime counter and prints the
+ * minimum, median, 90th and 99th percentile and maximum values followed by
+ * a power-of-two histogram. The output format is the same on all ports and
+ * can be parsed for regression tracking.
+ *
+ * <h2>Conditions</h2>
+ * This sequence is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - PORT_SUPPORTS_RT == TRUE
+ * .
+ *
+ * <h2>Test Cases</h2>
+ * - @subpage test_015_001
+ * - @subpage test_015_002
+ * - @subpage test_015_003
+ * - @subpage test_015_004
+ * - @subpage test_015_005
+ * .
+ */
+
+#if (PORT_SUPPORTS_RT == TRUE) || defined(__DOXYGEN__)
+
+/****************************************************************************
+ * Shared code.
+ ****************************************************************************/
+
+#define LAT_SAMPLES             128
+#define LAT_LISTENERS           4
+
+static rtcnt_t lat_samples[LAT_SAMPLES];
+static unsigned lat_n;
+static volatile rtcnt_t lat_t0;
+static volatile rtcnt_t lat_t1;
+static volatile bool lat_first;
+static volatile bool lat_stop;
+static virtual_timer_t lat_vt;
+static thread_reference_t lat_tr;
+
+static void lat_setup(void) {
+
+  lat_n = 0;
+  lat_first = true;
+  lat_stop = false;
+  lat_tr = NULL;
+  chVTObjectInit(&lat_vt);
+}
+
+static void lat_record(rtcnt_t t) {
+
+  if (lat_n < LAT_SAMPLES) {
+    lat_samples[lat_n++] = t;
+  }
+}
+
+static unsigned lat_log2(rtcnt_t t) {
+  unsigned n = 0;
+
+  while (t > (rtcnt_t)1) {
+    t >>= 1;
+    n++;
+  }
+  return n;
+}
+
+/* Insertion sort, the samples are few and often almost in order.*/
+static void lat_sort(void) {
+  unsigned i, j;
+
+  for (i = 1; i < lat_n; i++) {
+    rtcnt_t t = lat_samples[i];
+
+    for (j = i; (j > 0U) && (lat_samples[j - 1U] > t); j--) {
+      lat_samples[j] = lat_samples[j - 1U];
+    }
+    lat_samples[j] = t;
+  }
+}
+
+/* Nearest-rank percentile, the samples must be sorted.*/
+static rtcnt_t lat_percentile(unsigned pc) {
+
+  return lat_samples[(((lat_n * pc) + 99U) / 100U) - 1U];
+}
+
+static void lat_print_field(const char *key, rtcnt_t value) {
+
+  test_print(key);
+  test_printn((uint32_t)value);
+}
+
+/* Two lines are printed for each benchmark, the statistics and the
+   histogram, as space separated fields so that the logs can be parsed by
+   regression scripts. Values are in realtime counter cycles, histogram
+   buckets are powers of two and are printed as "lower_bound:count".*/
+static void lat_report(const char *name) {
+  unsigned i, j, b;
+
+  test_assert(lat_n > 0U, "no samples");
+
+  lat_sort();
+  test_print("--- Lat.  : ");
+  test_print(name);
+  lat_print_field(" n=", (rtcnt_t)lat_n);
+  lat_print_field(" min=", lat_samples[0]);
+  lat_print_field(" p50=", lat_percentile(50U));
+  lat_print_field(" p90=", lat_percentile(90U));
+  lat_print_field(" p99=", lat_percentile(99U));
+  lat_print_field(" max=", lat_samples[lat_n - 1U]);
+  test_println("");
+
+  test_print("--- Hist. : ");
+  test_print(name);
+  for (i = 0; i < lat_n; i = j) {
+    b = lat_log2(lat_samples[i]);
+    for (j = i; (j < lat_n) && (lat_log2(lat_samples[j]) == b); j++) {
+    }
+    lat_print_field(" ", b == 0U ? (rtcnt_t)0 : (rtcnt_t)1 << b);
+    lat_print_field(":", (rtcnt_t)(j - i));
+  }
+  test_println("");
+}
+
+static void lat_wakeup_cb(void *p) {
+
+  (void)p;
+  chSysLockFromISR();
+  lat_t0 = chSysGetRealtimeCounterX();
+  chThdResumeI(&lat_tr, MSG_OK);
+  chSysUnlockFromISR();
+}
+
+static void lat_period_cb(void *p) {
+  rtcnt_t now = chSysGetRealtimeCounterX();
+
+  (void)p;
+  chSysLockFromISR();
+  if (lat_first) {
+    lat_first = false;
+  }
+  else {
+    lat_record(now - lat_t0);
+  }
+  lat_t0 = now;
+  if (lat_n < LAT_SAMPLES) {
+    chVTSetI(&lat_vt, 1, lat_period_cb, NULL);
+  }
+  else {
+    chThdResumeI(&lat_tr, MSG_OK);
+  }
+  chSysUnlockFromISR();
+}
+
+#if (CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES) || defined(__DOXYGEN__)
+static MUTEX_DECL(lat_mtx);
+static SEMAPHORE_DECL(lat_sem, 0);
+static tprio_t lat_boost;
+static volatile bool lat_noboost;
+
+static THD_FUNCTION(lat_mtx_owner, p) {
+  unsigned i;
+
+  (void)p;
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    chMtxLock(&lat_mtx);
+
+    /* The waiter preempts, blocks on the mutex and boosts this thread.*/
+    chSemSignal(&lat_sem);
+    if (chThdGetPriorityX() != lat_boost) {
+      lat_noboost = true;
+    }
+    lat_t0 = chSysGetRealtimeCounterX();
+    chMtxUnlock(&lat_mtx);
+  }
+}
+
+static THD_FUNCTION(lat_mtx_waiter, p) {
+  unsigned i;
+
+  (void)p;
+  for (i = 0; i < LAT_SAMPLES; i++) {
+    chSemWait(&lat_sem);
+    chMtxLock(&lat_mtx);
+    lat_record(chSysGetRealtimeCounterX() - lat_t0);
+    chMtxUnlock(&lat_mtx);
+  }
+}
+#endif
+
+#if CH_CFG_USE_MAILBOXES || defined(__DOXYGEN__)
+static msg_t lat_req_buf[1];
+static msg_t lat_rsp_buf[1];
+static MAILBOX_DECL(lat_req, lat_req_buf, 1);
+static MAILBOX_DECL(lat_rsp, lat_rsp_buf, 1);
+
+/* Echoes the requests back, a zero message terminates the thread.*/
+static THD_FUNCTION(lat_mb_server, p) {
+  msg_t msg;
+
+  (void)p;
+  do {
+    (void)chMBFetch(&lat_req, &msg, TIME_INFINITE);
+    (void)chMBPost(&lat_rsp, msg, TIME_INFINITE);
+  } while (msg != (msg_t)0);
+}
+#endif
+
+#if CH_CFG_USE_EVENTS || defined(__DOXYGEN__)
+static EVENTSOURCE_DECL(lat_es);
+
+static THD_FUNCTION(lat_evt_listener, p) {
+  event_listener_t el;
+
+  (void)p;
+  chEvtRegister(&lat_es, &el, 0);
+  while (true) {
+    (void)chEvtWaitAny(ALL_EVENTS);
+    if (lat_stop) {
+      break;
+    }
+
+    /* The last listener to run leaves its time stamp.*/
+    lat_t1 = chSysGetRealtimeCounterX();
+  }
+  chEvtUnregister(&lat_es, &el);
+}
+#endif
+
+/****************************************************************************
+ * Test cases.
+ ****************************************************************************/
+
+/**
+ * @page test_015_001 [15.1] IRQ-to-thread wakeup latency
+ *
+ * <h2>Description</h2>
+ * A thread is suspended on a reference and resumed by a virtual timer
+ * callback, the time between the callback and the resumed thread running is
+ * measured in realtime counter cycles. The operation is repeated for each
+ * sample and the latency histogram printed.
+ *
+ * <h2>Test Steps</h2>
+ * - [15.1.1] Arming a one tick timer and waiting for its callback to resume
+ *   the thread, the latency is sampled on each cycle.
+ * - [15.1.2] Printing the results.
+ * .
+ */
+
+static void test_015_001_setup(void) {
+  lat_setup();
+}
+
+static void test_015_001_execute(void) {
+
+  /* [15.1.1] Arming a one tick timer and waiting for its callback to resume
+     the thread, the latency is sampled on each cycle.*/
+  test_set_step(1);
+  {
+    unsigned i;
+
+    for (i = 0; i < LAT_SAMPLES; i++) {
+      chSysLock();
+      chVTSetI(&lat_vt, 1, lat_wakeup_cb, NULL);
+      (void)chThdSuspendS(&lat_tr);
+      lat_record(chSysGetRealtimeCounterX() - lat_t0);
+      chSysUnlock();
+    }
+  }
+
+  /* [15.1.2] Printing the results.*/
+  test_set_step(2);
+  {
+    lat_report("irq_wakeup");
+  }
+}
+
+static const testcase_t test_015_001 = {
+  "IRQ-to-thread wakeup latency",
+  test_015_001_setup,
+  NULL,
+  test_015_001_execute
+};
+
+#if (CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES) || defined(__DOXYGEN__)
+/**
+ * @page test_015_002 [15.2] Mutex handoff latency with priority inheritance
+ *
+ * <h2>Description</h2>
+ * A low priority thread owns a mutex while an high priority thread blocks
+ * on it and boosts the owner priority. The time between the owner releasing
+ * the mutex and the waiter acquiring it is measured in realtime counter
+ * cycles for each sample and the latency histogram printed.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [15.2.1] Starting the waiter and the owner threads, the owner priority
+ *   must be boosted on each cycle.
+ * - [15.2.2] Printing the results.
+ * .
+ */
+
+static void test_015_002_setup(void) {
+  lat_setup();
+}
+
+static void test_015_002_execute(void) {
+
+  /* [15.2.1] Starting the waiter and the owner threads, the owner priority
+     must be boosted on each cycle.*/
+  test_set_step(1);
+  {
+    tprio_t prio = chThdGetPriorityX();
+
+    lat_boost = prio + 2;
+    lat_noboost = false;
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, prio + 2,
+                                   lat_mtx_waiter, NULL);
+    threads[1] = chThdCreateStatic(wa[1], WA_SIZE, prio + 1,
+                                   lat_mtx_owner, NULL);
+    test_wait_threads();
+    test_assert(!lat_noboost, "priority not inherited");
+  }
+
+  /* [15.2.2] Printing the results.*/
+  test_set_step(2);
+  {
+    lat_report("mutex_handoff");
+  }
+}
+
+static const testcase_t test_015_002 = {
+  "Mutex handoff latency with priority inheritance",
+  test_015_002_setup,
+  NULL,
+  test_015_002_execute
+};
+#endif /* CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES */
+
+#if (CH_CFG_USE_MAILBOXES) || defined(__DOXYGEN__)
+/**
+ * @page test_015_003 [15.3] Mailbox round trip latency
+ *
+ * <h2>Description</h2>
+ * A message is posted to an higher priority thread that echoes it back
+ * through a second mailbox, the time between the post and the fetch of the
+ * answer is measured in realtime counter cycles for each sample and the
+ * latency histogram printed.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_MAILBOXES
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [15.3.1] Starting the server thread and exchanging messages with it,
+ *   the round trip time is sampled on each exchange.
+ * - [15.3.2] Printing the results.
+ * .
+ */
+
+static void test_015_003_setup(void) {
+  lat_setup();
+}
+
+static void test_015_003_execute(void) {
+
+  /* [15.3.1] Starting the server thread and exchanging messages with it,
+     the round trip time is sampled on each exchange.*/
+  test_set_step(1);
+  {
+    unsigned i;
+    msg_t msg;
+
+    chMBReset(&lat_req);
+    chMBReset(&lat_rsp);
+    threads[0] = chThdCreateStatic(wa[0], WA_SIZE, chThdGetPriorityX() + 1,
+                                   lat_mb_server, NULL);
+    for (i = 0; i < LAT_SAMPLES; i++) {
+      rtcnt_t t = chSysGetRealtimeCounterX();
+
+      (void)chMBPost(&lat_req, (msg_t)1, TIME_INFINITE);
+      (void)chMBFetch(&lat_rsp, &msg, TIME_INFINITE);
+      lat_record(chSysGetRealtimeCounterX() - t);
+    }
+    (void)chMBPost(&lat_req, (msg_t)0, TIME_INFINITE);
+    test_wait_threads();
+  }
+
+  /* [15.3.2] Printing the results.*/
+  test_set_step(2);
+  {
+    lat_report("mailbox_rtt");
+  }
+}
+
+static const testcase_t test_015_003 = {
+  "Mailbox round trip latency",
+  test_015_003_setup,
+  NULL,
+  test_015_003_execute
+};
+#endif /* CH_CFG_USE_MAILBOXES */
+
+#if (CH_CFG_USE_EVENTS) || defined(__DOXYGEN__)
+/**
+ * @page test_015_004 [15.4] Event broadcast latency
+ *
+ * <h2>Description</h2>
+ * An event is broadcast to LAT_LISTENERS higher priority threads, the time
+ * between the broadcast and the last listener running is measured in
+ * realtime counter cycles for each sample and the latency histogram
+ * printed.
+ *
+ * <h2>Conditions</h2>
+ * This test is only executed if the following preprocessor condition
+ * evaluates to true:
+ * - CH_CFG_USE_EVENTS
+ * .
+ *
+ * <h2>Test Steps</h2>
+ * - [15.4.1] Starting the listener threads.
+ * - [15.4.2] Broadcasting the event, all the listeners run before the
+ *   broadcast returns, the latency to the last one is sampled on each
+ *   cycle.
+ * - [15.4.3] Stopping the listeners and printing the results.
+ * .
+ */
+
+static void test_015_004_setup(void) {
+  lat_setup();
+}
+
+static void test_015_004_execute(void) {
+
+  /* [15.4.1] Starting the listener threads.*/
+  test_set_step(1);
+  {
+    unsigned i;
+
+    for (i = 0; i < LAT_LISTENERS; i++) {
+      threads[i] = chThdCreateStatic(wa[i], WA_SIZE, chThdGetPriorityX() + 1,
+                                     lat_evt_listener, NULL);
+    }
+  }
+
+  /* [15.4.2] Broadcasting the event, all the listeners run before the
+     broadcast returns, the latency to the last one is sampled on each
+     cycle.*/
+  test_set_step(2);
+  {
+    unsigned i;
+
+    for (i = 0; i < LAT_SAMPLES; i++) {
+      rtcnt_t t = chSysGetRealtimeCounterX();
+
+      chEvtBroadcast(&lat_es);
+      lat_record(lat_t1 - t);
+    }
+  }
+
+  /* [15.4.3] Stopping the listeners and printing the results.*/
+  test_set_step(3);
+  {
+    lat_stop = true;
+    chEvtBroadcast(&lat_es);
+    test_wait_threads();
+    lat_report("event_broadcast");
+  }
+}
+
+static const testcase_t test_015_004 = {
+  "Event broadcast latency",
+  test_015_004_setup,
+  NULL,
+  test_015_004_execute
+};
+#endif /* CH_CFG_USE_EVENTS */
+
+/**
+ * @page test_015_005 [15.5] Virtual timer jitter
+ *
+ * <h2>Description</h2>
+ * A virtual timer is re-armed with a one tick delay from its own callback,
+ * the interval between consecutive callbacks is measured in realtime
+ * counter cycles for each sample and the histogram printed. The spread of
+ * the intervals around the median is the timer jitter.
+ *
+ * <h2>Test Steps</h2>
+ * - [15.5.1] Starting the periodic timer and waiting for all the samples to
+ *   be taken.
+ * - [15.5.2] Printing the results and the peak-to-peak jitter.
+ * .
+ */
+
+static void test_015_005_setup(void) {
+  lat_setup();
+}
+
+static void test_015_005_execute(void) {
+
+  /* [15.5.1] Starting the periodic timer and waiting for all the samples to
+     be taken.*/
+  test_set_step(1);
+  {
+    chSysLock();
+    chVTSetI(&lat_vt, 1, lat_period_cb, NULL);
+    (void)chThdSuspendS(&lat_tr);
+    chSysUnlock();
+  }
+
+  /* [15.5.2] Printing the results and the peak-to-peak jitter.*/
+  test_set_step(2);
+  {
+    lat_report("vt_period");
+    test_print("--- Jitter: ");
+    test_printn((uint32_t)(lat_samples[lat_n - 1U] - lat_samples[0]));
+    test_println(" cycles pk-pk");
+  }
+}
+
+static const testcase_t test_015_005 = {
+  "Virtual timer jitter",
+  test_015_005_setup,
+  NULL,
+  test_015_005_execute
+};
+
+/****************************************************************************
+ * Exported data.
+ ****************************************************************************/
+
+/**
+ * @brief   Latency Benchmarks.
+ */
+const testcase_t * const test_sequence_015[] = {
+  &test_015_001,
+#if (CH_CFG_USE_MUTEXES && CH_CFG_USE_SEMAPHORES) || defined(__DOXYGEN__)
+  &test_015_002,
+#endif
+#if (CH_CFG_USE_MAILBOXES) || defined(__DOXYGEN__)
+  &test_015_003,
+#endif
+#if (CH_CFG_USE_EVENTS) || defined(__DOXYGEN__)
+  &test_015_004,
+#endif
+  &test_015_005,
+  NULL
+};
+
+#endif /* PORT_SUPPORTS_RT == TRUE */
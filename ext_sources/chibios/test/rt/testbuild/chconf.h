@@ -66,6 +66,20 @@
 #define CH_CFG_ST_TIMEDELTA                 0
 #endif
 
+/**
+ * @brief   Virtual timers heap.
+ * @details If enabled then, in tick-less mode, the armed virtual timers are
+ *          kept in a pairing heap ordered by expiration time instead of a
+ *          delta list. Arming a timer takes constant time and disarming it
+ *          takes logarithmic amortized time regardless of the number of
+ *          armed timers.
+ * @note    Requires @p CH_CFG_ST_TIMEDELTA greater than zero.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_ST_TIMERS_HEAP) || defined(__DOXYGEN__)
+#define CH_CFG_ST_TIMERS_HEAP               FALSE
+#endif
+
 /** @} */
 
 /*===========================================================================*/
@@ -138,6 +152,22 @@
 #define CH_CFG_OPTIMIZE_SPEED               TRUE
 #endif
 
+/**
+ * @brief   Bitmap indexed ready list.
+ * @details If enabled then the ready list is kept as one FIFO queue for
+ *          each priority level plus a two level bitmap of the non-empty
+ *          levels, insertion and selection of the next thread become
+ *          constant time operations regardless of the number of ready
+ *          threads.
+ *
+ * @note    Scheduling semantics are not changed.
+ * @note    Requires about 2kB of additional RAM for the queue headers.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_USE_BITMAP_RLIST) || defined(__DOXYGEN__)
+#define CH_CFG_USE_BITMAP_RLIST             FALSE
+#endif
+
 /** @} */
 
 /*===========================================================================*/
@@ -331,6 +361,28 @@
 #define CH_CFG_USE_HEAP                     TRUE
 #endif
 
+/**
+ * @brief   Two-Level Segregated Fit heap allocator.
+ * @details If enabled the heap uses a TLSF allocator with constant time
+ *          allocation and deallocation instead of the first-fit one.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_CFG_USE_HEAP.
+ */
+#if !defined(CH_CFG_HEAP_TLSF) || defined(__DOXYGEN__)
+#define CH_CFG_HEAP_TLSF                    FALSE
+#endif
+
+/**
+ * @brief   Number of TLSF first level size classes.
+ * @details The largest heap block is 2MB with the default value.
+ *
+ * @note    The default is 16.
+ */
+#if !defined(CH_CFG_HEAP_TLSF_FL_COUNT) || defined(__DOXYGEN__)
+#define CH_CFG_HEAP_TLSF_FL_COUNT           16
+#endif
+
 /**
  * @brief   Memory Pools Allocator APIs.
  * @details If enabled then the memory pools allocator APIs are included
@@ -342,6 +394,53 @@
 #define CH_CFG_USE_MEMPOOLS                 TRUE
 #endif
 
+/**
+ * @brief   Memory Pools statistics.
+ * @details If enabled each memory pool keeps usage counters and pools can
+ *          be registered by name.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_CFG_USE_MEMPOOLS.
+ */
+#if !defined(CH_CFG_MEMPOOLS_STATS) || defined(__DOXYGEN__)
+#define CH_CFG_MEMPOOLS_STATS               FALSE
+#endif
+
+/**
+ * @brief   Memory Pools lock-free fast path.
+ * @details If enabled @p chPoolAlloc() and @p chPoolFree() use exclusive
+ *          load/store instructions instead of the kernel critical zone.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires an ARMv7-M port.
+ */
+#if !defined(CH_CFG_MEMPOOLS_LOCKFREE) || defined(__DOXYGEN__)
+#define CH_CFG_MEMPOOLS_LOCKFREE            FALSE
+#endif
+
+/**
+ * @brief   Objects FIFOs APIs.
+ * @details If enabled then the objects FIFOs APIs are included
+ *          in the kernel.
+ *
+ * @note    The default is @p FALSE.
+ * @note    Requires @p CH_CFG_USE_MEMPOOLS and @p CH_CFG_USE_MAILBOXES.
+ */
+#if !defined(CH_CFG_USE_OBJ_FIFOS) || defined(__DOXYGEN__)
+#define CH_CFG_USE_OBJ_FIFOS                FALSE
+#endif
+
+/**
+ * @brief   Snapshots APIs.
+ * @details If enabled then the lock-free snapshots APIs are included
+ *          in the kernel.
+ *
+ * @note    The default is @p FALSE.
+ */
+#if !defined(CH_CFG_USE_SNAPSHOTS) || defined(__DOXYGEN__)
+#define CH_CFG_USE_SNAPSHOTS                TRUE
+#endif
+
 /**
  * @brief   Dynamic Threads APIs.
  * @details If enabled then the dynamic threads creation APIs are included
@@ -373,6 +472,19 @@
 #define CH_DBG_STATISTICS                   FALSE
 #endif
 
+/**
+ * @brief   Debug option, critical zones statistics.
+ * @details If enabled then the kernel statistics also measure the duration
+ *          of the critical zones, this adds a time measurement to each lock
+ *          and unlock operation. Disabling it leaves the per-thread and
+ *          context switch statistics at a lower overhead.
+ *
+ * @note    The default is @p TRUE.
+ */
+#if !defined(CH_DBG_STATISTICS_CRITICAL) || defined(__DOXYGEN__)
+#define CH_DBG_STATISTICS_CRITICAL          TRUE
+#endif
+
 /**
  * @brief   Debug option, system state check.
  * @details If enabled the correct call protocol for system APIs is checked
@@ -426,6 +538,26 @@
 #define CH_DBG_TRACE_BUFFER_SIZE            128
 #endif
 
+/**
+ * @brief   Trace stream size in bytes.
+ * @details When non-zero the traced events are also encoded into a byte
+ *          ring that a drain thread can forward to a host while the system
+ *          is running, see @p chDbgReadTraceStream().
+ * @note    The value must be zero or a power of two not lower than 64.
+ */
+#if !defined(CH_DBG_TRACE_STREAM_SIZE) || defined(__DOXYGEN__)
+#define CH_DBG_TRACE_STREAM_SIZE            0
+#endif
+
+/**
+ * @brief   Trace stream time stamps clock frequency.
+ * @note    Zero means unknown, the host tools then require the frequency
+ *          of the realtime counter as a parameter.
+ */
+#if !defined(CH_DBG_TRACE_STREAM_CLOCK) || defined(__DOXYGEN__)
+#define CH_DBG_TRACE_STREAM_CLOCK           0
+#endif
+
 /**
  * @brief   Debug option, stack checks.
  * @details If enabled then a runtime stack check is performed.
@@ -117,6 +117,16 @@ test cfg26 "-DCH_DBG_TRACE_MASK=CH_DBG_TRACE_MASK_ALL"
 test cfg28 "-DCH_DBG_FILL_THREADS=TRUE"
 test cfg29 "-DCH_DBG_THREADS_PROFILING=FALSE"
 test cfg30 "-DCH_DBG_SYSTEM_STATE_CHECK=TRUE -DCH_DBG_ENABLE_CHECKS=TRUE -DCH_DBG_ENABLE_ASSERTS=TRUE -DCH_DBG_TRACE_MASK=CH_DBG_TRACE_MASK_ALL -DCH_DBG_FILL_THREADS=TRUE"
+test cfg31 "-DCH_CFG_USE_BITMAP_RLIST=TRUE"
+test cfg32 "-DCH_CFG_USE_BITMAP_RLIST=TRUE -DCH_DBG_SYSTEM_STATE_CHECK=TRUE -DCH_DBG_ENABLE_CHECKS=TRUE -DCH_DBG_ENABLE_ASSERTS=TRUE"
+test cfg33 "-DCH_DBG_STATISTICS=TRUE -DCH_DBG_STATISTICS_CRITICAL=FALSE"
+test cfg34 "-DCH_DBG_TRACE_MASK=CH_DBG_TRACE_MASK_ALL -DCH_DBG_TRACE_STREAM_SIZE=1024"
+test cfg35 "-DCH_CFG_HEAP_TLSF=TRUE"
+test cfg36 "-DCH_CFG_HEAP_TLSF=TRUE -DCH_DBG_ENABLE_CHECKS=TRUE -DCH_DBG_ENABLE_ASSERTS=TRUE"
+test cfg37 "-DCH_CFG_MEMPOOLS_STATS=TRUE"
+test cfg38 "-DCH_CFG_USE_OBJ_FIFOS=TRUE"
+test cfg39 "-DCH_CFG_ST_TIMEDELTA=2 -DCH_CFG_TIME_QUANTUM=0 -DCH_DBG_THREADS_PROFILING=FALSE"
+test cfg40 "-DCH_CFG_ST_TIMEDELTA=2 -DCH_CFG_TIME_QUANTUM=0 -DCH_DBG_THREADS_PROFILING=FALSE -DCH_CFG_ST_TIMERS_HEAP=TRUE"
 
 rm *log.txt 2> /dev/null
 echo
@@ -0,0 +1,175 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    chprintf_bench.c
+ * @brief   chprintf host microbenchmark.
+ * @details Host tool measuring the time per call of @p chsnprintf() with
+ *          the formats used for temperatures, scaled integers with 7
+ *          fractional bits, comparing the floating point conversion with
+ *          the fixed point one and with precompiled formats.<br>
+ *          The fixed point results are first checked against a reference
+ *          computed with integer arithmetic. The cases not supported by
+ *          the compiled chprintf.c are skipped, so the tool can also be
+ *          built against older versions of the file.
+ *
+ *          Build:  gcc -O2 -I. -I../../os/hal/include
+ *                  -I../../os/hal/lib/streams -o chprintf_bench
+ *                  chprintf_bench.c ../../os/hal/lib/streams/chprintf.c
+ *                  ../../os/hal/lib/streams/memstreams.c
+ *          Usage:  chprintf_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hal.h"
+#include "chprintf.h"
+
+#define FBITS               7
+#define QUANTUM             (1.0 / (1 << FBITS))
+#define RUNS                7
+
+static char buf[128];
+static volatile int sink;
+
+static double now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Each case is timed RUNS times and the best result is reported, this
+   filters out most of the noise of the host.*/
+#define BENCH(name, stmt) do {                                              \
+  double best = 1e30, t0;                                                   \
+  int r;                                                                    \
+  for (r = 0; r < RUNS; r++) {                                              \
+    t0 = now_ns();                                                          \
+    for (i = 0; i < n; i++) {                                               \
+      stmt;                                                                 \
+    }                                                                       \
+    t0 = (now_ns() - t0) / n;                                               \
+    if (t0 < best)                                                          \
+      best = t0;                                                            \
+  }                                                                         \
+  printf("%-28s %8.1f ns/call\n", name, best);                              \
+} while (0)
+
+/* Temperatures are swept in the -40..+215 C range.*/
+static int16_t temp(long i) {
+
+  return (int16_t)((i & 0x7FFF) - 0x1400);
+}
+
+#if CHPRINTF_USE_FIXED
+static int check_fixed(void) {
+  static const long pow10[] = {1, 10, 100, 1000, 10000};
+  char ref[48];
+  long t, r, scale;
+  int precision, errors = 0;
+
+  for (precision = 0; precision <= 4; precision++) {
+    scale = pow10[precision];
+    for (t = -32768; t <= 32767; t++) {
+      /* Truncated toward zero like %f, no fraction with precision zero.*/
+      r = (labs(t) * scale) >> FBITS;
+      if (precision == 0)
+        snprintf(ref, sizeof (ref), "%s%ld", t < 0 ? "-" : "", r);
+      else
+        snprintf(ref, sizeof (ref), "%s%ld.%0*ld", t < 0 ? "-" : "",
+                 r / scale, precision, r % scale);
+      chsnprintf(buf, sizeof (buf), "%.*q", precision, FBITS, (int)t);
+      if (strcmp(buf, ref) != 0) {
+        if (errors++ < 10)
+          printf("mismatch: %ld/%d: \"%s\" expected \"%s\"\n",
+                 t, 1 << FBITS, buf, ref);
+      }
+    }
+  }
+  return errors;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+#if CHPRINTF_USE_COMPILED
+  static chprintf_format_t cf1, cf2;
+#endif
+  long i, n = 200000;
+
+  if (argc > 1)
+    n = atol(argv[1]);
+
+#if CHPRINTF_USE_FIXED
+  if (check_fixed() != 0) {
+    printf("fixed point check failed\n");
+    return 1;
+  }
+  printf("fixed point check passed\n");
+#endif
+
+  BENCH("%d",
+        sink += chsnprintf(buf, sizeof (buf), "%d", (int)i));
+
+  BENCH("T%d: %3.1f C",
+        sink += chsnprintf(buf, sizeof (buf), "T%d: %3.1f C", 1,
+                           temp(i) * QUANTUM));
+
+#if CHPRINTF_USE_FIXED
+  BENCH("T%d: %3.1q C",
+        sink += chsnprintf(buf, sizeof (buf), "T%d: %3.1q C", 1,
+                           FBITS, temp(i)));
+#endif
+
+#if CHPRINTF_USE_COMPILED
+  chprintfCompile(&cf1, "T%d: %3.1q C");
+  BENCH("T%d: %3.1q C (compiled)",
+        sink += chsnprintfCompiled(buf, sizeof (buf), &cf1, 1,
+                                   FBITS, temp(i)));
+#endif
+
+  BENCH("log line, %f",
+        sink += chsnprintf(buf, sizeof (buf),
+                           "%d %3.3f %3.3f %3.3f %1.3f %1.3f %1.3f ", (int)i,
+                           temp(i) * QUANTUM, temp(i + 1) * QUANTUM,
+                           temp(i + 2) * QUANTUM, temp(i & 0x1FF) * QUANTUM,
+                           temp(i & 0x2FF) * QUANTUM,
+                           temp(i & 0x3FF) * QUANTUM));
+
+#if CHPRINTF_USE_FIXED
+  BENCH("log line, %q",
+        sink += chsnprintf(buf, sizeof (buf),
+                           "%d %3.3q %3.3q %3.3q %1.3q %1.3q %1.3q ", (int)i,
+                           FBITS, temp(i), FBITS, temp(i + 1),
+                           FBITS, temp(i + 2), FBITS, temp(i & 0x1FF),
+                           FBITS, temp(i & 0x2FF), FBITS, temp(i & 0x3FF)));
+#endif
+
+#if CHPRINTF_USE_COMPILED
+  chprintfCompile(&cf2, "%d %3.3q %3.3q %3.3q %1.3q %1.3q %1.3q ");
+  BENCH("log line, %q (compiled)",
+        sink += chsnprintfCompiled(buf, sizeof (buf), &cf2, (int)i,
+                                   FBITS, temp(i), FBITS, temp(i + 1),
+                                   FBITS, temp(i + 2), FBITS, temp(i & 0x1FF),
+                                   FBITS, temp(i & 0x2FF),
+                                   FBITS, temp(i & 0x3FF)));
+#endif
+
+  return 0;
+}
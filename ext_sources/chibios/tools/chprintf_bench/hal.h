@@ -0,0 +1,44 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal.h
+ * @brief   Host replacement of the HAL header for the chprintf benchmark.
+ * @details Only the definitions used by the streams library are provided.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FALSE               0
+#define TRUE                1
+
+typedef int32_t             msg_t;
+
+#define MSG_OK              (msg_t)0
+#define MSG_TIMEOUT         (msg_t)-1
+#define MSG_RESET           (msg_t)-2
+
+#define osalDbgCheck(c)     assert(c)
+
+#include "hal_streams.h"
+
+#endif /* HAL_H */
@@ -0,0 +1,149 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    crc_bench.c
+ * @brief   CRC host microbenchmark.
+ * @details Host tool checking the CRC library against a bitwise reference
+ *          then measuring its throughput in bytes per cycle for several
+ *          block sizes. The library is compiled with the slicing factor
+ *          selected on the command line so the variants can be compared.
+ *          On x86 hosts the cycles are the time stamp counter ones, on
+ *          other hosts the nanoseconds are reported instead.
+ *
+ *          Build:  gcc -O2 -I. -I../../os/hal/lib/crc -DCRC_CFG_SLICING=8
+ *                  -o crc_bench crc_bench.c ../../os/hal/lib/crc/crc.c
+ *          Usage:  crc_bench [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hal.h"
+#include "crc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UNIT                "bytes/cycle"
+#define now()               (double)__rdtsc()
+#else
+#define UNIT                "bytes/ns"
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+#endif
+
+#define BUFSIZE             4096
+#define RUNS                7
+
+static uint8_t buf[BUFSIZE + 8];
+static volatile uint32_t sink;
+
+static uint16_t ref16(uint16_t crc, const uint8_t *p, size_t n) {
+  int i;
+
+  while (n--) {
+    crc ^= (uint16_t)(*p++ << 8);
+    for (i = 0; i < 8; i++)
+      crc = (uint16_t)((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+  }
+  return crc;
+}
+
+static uint32_t ref32(uint32_t crc, const uint8_t *p, size_t n) {
+  int i;
+
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+  }
+  return ~crc;
+}
+
+/* Random blocks, offsets and chunk splits against the reference.*/
+static int check(void) {
+  const uint8_t *s = (const uint8_t *)"123456789";
+  int i, errors = 0;
+
+  if ((crc16X(CRC16_INIT, s, 9) != 0x29B1) ||
+      (crc32X(CRC32_INIT, s, 9) != 0xCBF43926)) {
+    printf("wrong check values\n");
+    return 1;
+  }
+  for (i = 0; i < BUFSIZE; i++)
+    buf[i] = (uint8_t)rand();
+  for (i = 0; i < 100000; i++) {
+    size_t off = (size_t)rand() % 8, n = (size_t)rand() % 300;
+    size_t k = n ? (size_t)rand() % n : 0;
+    uint16_t c16 = crc16X(crc16X(CRC16_INIT, buf + off, k),
+                          buf + off + k, n - k);
+    uint32_t c32 = crc32X(crc32X(CRC32_INIT, buf + off, k),
+                          buf + off + k, n - k);
+
+    if ((c16 != ref16(CRC16_INIT, buf + off, n)) ||
+        (c32 != ref32(CRC32_INIT, buf + off, n))) {
+      if (errors++ < 10)
+        printf("mismatch: offset %zu size %zu split %zu\n", off, n, k);
+    }
+  }
+  return errors;
+}
+
+/* Each case is timed RUNS times and the best result is reported.*/
+#define BENCH(name, size, stmt) do {                                        \
+  double best = 0.0, t0;                                                    \
+  long loops = total / (size), i;                                           \
+  int r;                                                                    \
+  for (r = 0; r < RUNS; r++) {                                              \
+    t0 = now();                                                             \
+    for (i = 0; i < loops; i++) {                                           \
+      stmt;                                                                 \
+    }                                                                       \
+    t0 = (double)(loops * (size)) / (now() - t0);                           \
+    if (t0 > best)                                                          \
+      best = t0;                                                            \
+  }                                                                         \
+  printf("%-8s %5d bytes %8.3f " UNIT "\n", name, (int)(size), best);      \
+} while (0)
+
+int main(int argc, char *argv[]) {
+  static const long sizes[] = {16, 64, 512, BUFSIZE};
+  long total = 64L << 20;
+  unsigned j;
+
+  if (argc > 1)
+    total = atol(argv[1]) << 20;
+
+  if (check() != 0) {
+    printf("check failed\n");
+    return 1;
+  }
+  printf("check passed, slicing by %d\n", CRC_CFG_SLICING);
+
+  for (j = 0; j < sizeof sizes / sizeof sizes[0]; j++) {
+    BENCH("crc16", sizes[j], sink += crc16X(CRC16_INIT, buf, (size_t)sizes[j]));
+    BENCH("crc32", sizes[j], sink += crc32X(CRC32_INIT, buf, (size_t)sizes[j]));
+  }
+  BENCH("bitwise", BUFSIZE, sink += ref32(CRC32_INIT, buf, BUFSIZE));
+
+  return 0;
+}
@@ -0,0 +1,408 @@
+/*
+    ChibiOS - Copyright (C) 2006..2016 Giovanni Di Sirio.
+
+    This file is part of ChibiOS.
+
+    ChibiOS is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    trace2json.c
+ * @brief   Trace stream to Chrome trace converter.
+ * @details Host tool converting a capture of the RT trace stream (see
+ *          @p chDbgReadTraceStream()) into the Chrome trace event JSON
+ *          format, it can be loaded in chrome://tracing or in the Perfetto
+ *          UI. Threads become tracks with one slice per scheduling run,
+ *          ISRs are nested slices on a separate track, halt, user and lost
+ *          records are instant events.<br>
+ *          Any data before the stream header, like a shell echo, is
+ *          skipped.
+ *
+ *          Build:  gcc -O2 -o trace2json trace2json.c
+ *          Usage:  trace2json [-c clock_hz] [input [output]]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Must match chtrace.h.*/
+#define TYPE_UNUSED         0U
+#define TYPE_SWITCH         1U
+#define TYPE_ISR_ENTER      2U
+#define TYPE_ISR_LEAVE      3U
+#define TYPE_HALT           4U
+#define TYPE_USER           5U
+#define TYPE_LOST           6U
+#define TYPE_NAME           7U
+#define STREAM_MAGIC        "CHTS"
+#define STREAM_VERSION      1U
+#define STREAM_HEADER_SIZE  12U
+
+/* Must match CH_STATE_NAMES in chschd.h.*/
+static const char *state_names[] = {
+  "READY", "CURRENT", "WTSTART", "SUSPENDED", "QUEUED", "WTSEM", "WTMTX",
+  "WTCOND", "SLEEPING", "WTEXIT", "WTOREVT", "WTANDEVT", "SNDMSGQ",
+  "SNDMSG", "WTMSG", "FINAL"
+};
+
+typedef struct {
+  uint64_t      ptr;
+  char          name[32];
+} name_t;
+
+static const uint8_t *data;
+static size_t size, pos;
+static unsigned ptrsize;
+
+static name_t *names;
+static size_t nnames;
+static uint64_t *threads;
+static size_t nthreads;
+
+static FILE *out;
+static int first_event = 1;
+
+static void *xrealloc(void *p, size_t n) {
+
+  p = realloc(p, n);
+  if (p == NULL) {
+    fprintf(stderr, "trace2json: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static int get_varint(uint64_t *xp) {
+  uint64_t x = 0;
+  unsigned shift = 0;
+
+  do {
+    if ((pos >= size) || (shift > 35)) {
+      return -1;
+    }
+    x |= (uint64_t)(data[pos] & 0x7FU) << shift;
+    shift += 7;
+  } while ((data[pos++] & 0x80U) != 0U);
+  *xp = x;
+  return 0;
+}
+
+static int get_ptr(uint64_t *xp) {
+  uint64_t x = 0;
+  unsigned i;
+
+  if (pos + ptrsize > size) {
+    return -1;
+  }
+  for (i = ptrsize; i > 0; i--) {
+    x = (x << 8) | data[pos + i - 1];
+  }
+  pos += ptrsize;
+  *xp = x;
+  return 0;
+}
+
+static name_t *find_name(uint64_t ptr) {
+  size_t i;
+
+  for (i = 0; i < nnames; i++) {
+    if (names[i].ptr == ptr) {
+      return &names[i];
+    }
+  }
+  return NULL;
+}
+
+static void put_string(const char *s) {
+
+  fputc('"', out);
+  for (; *s != '\0'; s++) {
+    if ((*s == '"') || (*s == '\\')) {
+      fprintf(out, "\\%c", *s);
+    }
+    else if ((unsigned char)*s < 0x20U) {
+      fprintf(out, "\\u%04x", (unsigned char)*s);
+    }
+    else {
+      fputc(*s, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static const char *ptr_name(uint64_t ptr, char *buf, size_t n) {
+  name_t *np = find_name(ptr);
+
+  if ((np != NULL) && (np->name[0] != '\0')) {
+    return np->name;
+  }
+  snprintf(buf, n, "0x%llx", (unsigned long long)ptr);
+  return buf;
+}
+
+static void begin_event(const char *ph, const char *name, unsigned tid,
+                        double ts) {
+
+  fputs(first_event ? "\n" : ",\n", out);
+  first_event = 0;
+  fprintf(out, "{\"ph\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"name\":",
+          ph, tid, ts);
+  put_string(name);
+}
+
+static void thread_meta(unsigned tid, const char *name) {
+
+  fputs(first_event ? "\n" : ",\n", out);
+  first_event = 0;
+  fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\","
+          "\"args\":{\"name\":", tid);
+  put_string(name);
+  fputs("}}", out);
+}
+
+/* Track of a thread, tid 0 is reserved to the ISRs.*/
+static unsigned thread_tid(uint64_t ptr) {
+  char buf[24];
+  size_t i;
+
+  for (i = 0; i < nthreads; i++) {
+    if (threads[i] == ptr) {
+      return (unsigned)i + 1U;
+    }
+  }
+  threads = xrealloc(threads, (nthreads + 1) * sizeof *threads);
+  threads[nthreads++] = ptr;
+  thread_meta((unsigned)nthreads, ptr_name(ptr, buf, sizeof buf));
+  return (unsigned)nthreads;
+}
+
+static void usage(void) {
+
+  fprintf(stderr, "usage: trace2json [-c clock_hz] [input [output]]\n");
+  exit(2);
+}
+
+int main(int argc, char *argv[]) {
+  const char *inname = NULL, *outname = NULL;
+  unsigned long clock = 0;
+  FILE *in = stdin;
+  uint8_t *buf = NULL;
+  size_t cap = 0, n;
+  uint64_t stamp = 0, current = 0, lost = 0;
+  double start = 0.0, now = 0.0;
+  int have_current = 0, i;
+  unsigned long records = 0;
+  char nbuf[48];
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-c") == 0) {
+      if (++i >= argc) {
+        usage();
+      }
+      clock = strtoul(argv[i], NULL, 0);
+    }
+    else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage();
+    }
+    else if (inname == NULL) {
+      inname = argv[i];
+    }
+    else if (outname == NULL) {
+      outname = argv[i];
+    }
+    else {
+      usage();
+    }
+  }
+
+  if ((inname != NULL) && (strcmp(inname, "-") != 0)) {
+    in = fopen(inname, "rb");
+    if (in == NULL) {
+      perror(inname);
+      return 1;
+    }
+  }
+  do {
+    if (size == cap) {
+      cap = cap ? cap * 2 : 65536;
+      buf = xrealloc(buf, cap);
+    }
+    n = fread(buf + size, 1, cap - size, in);
+    size += n;
+  } while (n > 0);
+  data = buf;
+
+  /* Looking for the stream header.*/
+  for (pos = 0; pos + STREAM_HEADER_SIZE <= size; pos++) {
+    if (memcmp(data + pos, STREAM_MAGIC, 4) == 0) {
+      break;
+    }
+  }
+  if (pos + STREAM_HEADER_SIZE > size) {
+    fprintf(stderr, "trace2json: stream header not found\n");
+    return 1;
+  }
+  if (data[pos + 4] != STREAM_VERSION) {
+    fprintf(stderr, "trace2json: unsupported stream version %u\n",
+            data[pos + 4]);
+    return 1;
+  }
+  ptrsize = data[pos + 6];
+  if ((ptrsize == 0U) || (ptrsize > 8U)) {
+    fprintf(stderr, "trace2json: invalid pointer size %u\n", ptrsize);
+    return 1;
+  }
+  if (clock == 0) {
+    clock = (unsigned long)data[pos + 8] |
+            ((unsigned long)data[pos + 9] << 8) |
+            ((unsigned long)data[pos + 10] << 16) |
+            ((unsigned long)data[pos + 11] << 24);
+  }
+  if (clock == 0) {
+    fprintf(stderr, "trace2json: time stamps clock unknown, use -c\n");
+    return 1;
+  }
+  pos += STREAM_HEADER_SIZE;
+
+  out = stdout;
+  if ((outname != NULL) && (strcmp(outname, "-") != 0)) {
+    out = fopen(outname, "w");
+    if (out == NULL) {
+      perror(outname);
+      return 1;
+    }
+  }
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+  thread_meta(0, "ISRs");
+
+  while (pos < size) {
+    unsigned type = data[pos] & 7U, state = data[pos] >> 3;
+    uint64_t delta, p1 = 0, p2 = 0;
+
+    if (type == TYPE_UNUSED) {
+      break;
+    }
+    pos++;
+    if (get_varint(&delta) != 0) {
+      break;
+    }
+
+    if (type == TYPE_NAME) {
+      name_t *np;
+      unsigned len, copy;
+
+      if ((get_ptr(&p1) != 0) || (pos >= size)) {
+        break;
+      }
+      len = data[pos++];
+      if (pos + len > size) {
+        break;
+      }
+      np = find_name(p1);
+      if (np == NULL) {
+        names = xrealloc(names, (nnames + 1) * sizeof *names);
+        np = &names[nnames++];
+        np->ptr = p1;
+      }
+      copy = len < sizeof np->name ? len : sizeof np->name - 1;
+      memcpy(np->name, data + pos, copy);
+      np->name[copy] = '\0';
+      pos += len;
+      continue;
+    }
+
+    if ((type == TYPE_SWITCH) || (type == TYPE_USER)) {
+      if ((get_ptr(&p1) != 0) || (get_ptr(&p2) != 0)) {
+        break;
+      }
+    }
+    else if (type == TYPE_LOST) {
+      if (get_varint(&p1) != 0) {
+        break;
+      }
+    }
+    else if (get_ptr(&p1) != 0) {
+      break;
+    }
+
+    stamp += delta;
+    now = (double)stamp * 1000000.0 / (double)clock;
+    records++;
+
+    switch (type) {
+    case TYPE_SWITCH:
+      if (have_current) {
+        begin_event("X", ptr_name(current, nbuf, sizeof nbuf),
+                    thread_tid(current), start);
+        fprintf(out, ",\"dur\":%.3f,\"args\":{\"state\":\"%s\","
+                "\"wtobj\":\"0x%llx\"}}", now - start,
+                state < sizeof state_names / sizeof state_names[0] ?
+                state_names[state] : "?", (unsigned long long)p2);
+      }
+      current = p1;
+      (void)thread_tid(current);
+      have_current = 1;
+      start = now;
+      break;
+    case TYPE_ISR_ENTER:
+    case TYPE_ISR_LEAVE:
+      begin_event(type == TYPE_ISR_ENTER ? "B" : "E",
+                  ptr_name(p1, nbuf, sizeof nbuf), 0, now);
+      fputs("}", out);
+      break;
+    case TYPE_HALT:
+      snprintf(nbuf, sizeof nbuf, "halt: %s",
+               find_name(p1) != NULL ? find_name(p1)->name : "?");
+      begin_event("i", nbuf, have_current ? thread_tid(current) : 0, now);
+      fputs(",\"s\":\"g\"}", out);
+      break;
+    case TYPE_USER:
+      begin_event("i", "user", have_current ? thread_tid(current) : 0, now);
+      fprintf(out, ",\"s\":\"t\",\"args\":{\"up1\":\"0x%llx\","
+              "\"up2\":\"0x%llx\"}}",
+              (unsigned long long)p1, (unsigned long long)p2);
+      break;
+    case TYPE_LOST:
+      /* The running thread is not known after a loss.*/
+      if (have_current) {
+        begin_event("X", ptr_name(current, nbuf, sizeof nbuf),
+                    thread_tid(current), start);
+        fprintf(out, ",\"dur\":%.3f}", now - start);
+        have_current = 0;
+      }
+      snprintf(nbuf, sizeof nbuf, "lost %llu records",
+               (unsigned long long)p1);
+      begin_event("i", nbuf, 0, now);
+      fputs(",\"s\":\"g\"}", out);
+      lost += p1;
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (have_current) {
+    begin_event("X", ptr_name(current, nbuf, sizeof nbuf),
+                thread_tid(current), start);
+    fprintf(out, ",\"dur\":%.3f}", now - start);
+  }
+  fprintf(out, "\n],\"otherData\":{\"clock\":%lu,\"records\":%lu,"
+          "\"lost\":%llu}}\n", clock, records, (unsigned long long)lost);
+
+  fprintf(stderr, "trace2json: %lu records, %llu lost, %.3f ms\n",
+          records, (unsigned long long)lost, now / 1000.0);
+  return 0;
+}
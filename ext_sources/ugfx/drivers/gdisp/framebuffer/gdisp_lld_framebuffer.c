@@ -31,6 +31,32 @@ typedef struct fbPriv {
 #define PIXIL_POS(g, x, y)		((y) * ((fbPriv *)(g)->priv)->fbi.linelen + (x) * sizeof(LLDCOLOR_TYPE))
 #define PIXEL_ADDR(g, pos)		((LLDCOLOR_TYPE *)(((char *)((fbPriv *)(g)->priv)->fbi.pixels)+pos))
 
+// The board can count the pixels written by each driver operation (eg. for performance tests)
+#ifndef board_pixelops
+	#define board_pixelops(g, n)
+#endif
+
+#if GDISP_HARDWARE_BITFILLS || (GDISP_HARDWARE_ALPHABLIT && GDISP_NEED_TEXT && GDISP_NEED_ANTIALIAS)
+	// The frame buffer position of a display pixel in the current orientation
+	static unsigned fb_pos(GDisplay *g, coord_t x, coord_t y) {
+		#if GDISP_NEED_CONTROL
+			switch(g->g.Orientation) {
+			case GDISP_ROTATE_0:
+			default:
+				return PIXIL_POS(g, x, y);
+			case GDISP_ROTATE_90:
+				return PIXIL_POS(g, y, g->g.Width-x-1);
+			case GDISP_ROTATE_180:
+				return PIXIL_POS(g, g->g.Width-x-1, g->g.Height-y-1);
+			case GDISP_ROTATE_270:
+				return PIXIL_POS(g, g->g.Height-y-1, x);
+			}
+		#else
+			return PIXIL_POS(g, x, y);
+		#endif
+	}
+#endif
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -82,8 +108,100 @@ LLDSPEC void gdisp_lld_draw_pixel(GDisplay *g) {
 	#endif
 
 		PIXEL_ADDR(g, pos)[0] = gdispColor2Native(g->p.color);
+		board_pixelops(g, 1);
 }
 
+/* The area operations below are a software version of what a 2D blitter
+ * (eg. the STM32 DMA2D) does. The board turns them on with
+ * GDISP_HARDWARE_FILLS, GDISP_HARDWARE_BITFILLS and GDISP_HARDWARE_ALPHABLIT.
+ */
+#if GDISP_HARDWARE_FILLS
+	// Uses p.x,p.y  p.cx,p.cy  p.color
+	LLDSPEC void gdisp_lld_fill_area(GDisplay *g) {
+		LLDCOLOR_TYPE	c;
+		LLDCOLOR_TYPE	*p;
+		unsigned		pos;
+		coord_t			x, cx, cy;
+
+		#if GDISP_NEED_CONTROL
+			switch(g->g.Orientation) {
+			case GDISP_ROTATE_0:
+			default:
+				pos = PIXIL_POS(g, g->p.x, g->p.y);
+				cx = g->p.cx; cy = g->p.cy;
+				break;
+			case GDISP_ROTATE_90:
+				pos = PIXIL_POS(g, g->p.y, g->g.Width-g->p.x-g->p.cx);
+				cx = g->p.cy; cy = g->p.cx;
+				break;
+			case GDISP_ROTATE_180:
+				pos = PIXIL_POS(g, g->g.Width-g->p.x-g->p.cx, g->g.Height-g->p.y-g->p.cy);
+				cx = g->p.cx; cy = g->p.cy;
+				break;
+			case GDISP_ROTATE_270:
+				pos = PIXIL_POS(g, g->g.Height-g->p.y-g->p.cy, g->p.x);
+				cx = g->p.cy; cy = g->p.cx;
+				break;
+			}
+		#else
+			pos = PIXIL_POS(g, g->p.x, g->p.y);
+			cx = g->p.cx; cy = g->p.cy;
+		#endif
+
+		c = gdispColor2Native(g->p.color);
+		board_pixelops(g, (unsigned)cx * cy);
+		for(; cy; cy--, pos += ((fbPriv *)g->priv)->fbi.linelen) {
+			p = PIXEL_ADDR(g, pos);
+			for(x = 0; x < cx; x++)
+				p[x] = c;
+		}
+	}
+#endif
+
+#if GDISP_HARDWARE_BITFILLS
+	// Uses p.x,p.y  p.cx,p.cy  p.x1,p.y1 (=srcx,srcy)  p.x2 (=srccx), p.ptr (=buffer)
+	LLDSPEC void gdisp_lld_blit_area(GDisplay *g) {
+		const pixel_t	*src;
+		LLDCOLOR_TYPE	*p;
+		coord_t			x, y;
+
+		board_pixelops(g, (unsigned)g->p.cx * g->p.cy);
+		src = (const pixel_t *)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1;
+		for(y = g->p.y; y < g->p.y + g->p.cy; y++, src += g->p.x2) {
+			#if GDISP_NEED_CONTROL
+				if (g->g.Orientation != GDISP_ROTATE_0) {
+					for(x = 0; x < g->p.cx; x++)
+						PIXEL_ADDR(g, fb_pos(g, g->p.x+x, y))[0] = gdispColor2Native(src[x]);
+					continue;
+				}
+			#endif
+			p = PIXEL_ADDR(g, PIXIL_POS(g, g->p.x, y));
+			for(x = 0; x < g->p.cx; x++)
+				p[x] = gdispColor2Native(src[x]);
+		}
+	}
+#endif
+
+#if GDISP_HARDWARE_ALPHABLIT && GDISP_NEED_TEXT && GDISP_NEED_ANTIALIAS
+	// Uses p.x,p.y  p.cx,p.cy  p.x1,p.y1 (=srcx,srcy)  p.x2 (=srccx), p.ptr (=alpha mask) p.color
+	LLDSPEC void gdisp_lld_alpha_blit_area(GDisplay *g) {
+		const uint8_t	*src;
+		LLDCOLOR_TYPE	*p;
+		coord_t			x, y;
+
+		board_pixelops(g, (unsigned)g->p.cx * g->p.cy);
+		src = (const uint8_t *)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1;
+		for(y = g->p.y; y < g->p.y + g->p.cy; y++, src += g->p.x2) {
+			for(x = 0; x < g->p.cx; x++) {
+				if (!src[x])
+					continue;
+				p = PIXEL_ADDR(g, fb_pos(g, g->p.x+x, y));
+				p[0] = gdispColor2Native(src[x] == 255 ? g->p.color : gdispBlendColor(g->p.color, gdispNative2Color(p[0]), src[x]));
+			}
+		}
+	}
+#endif
+
 LLDSPEC	color_t gdisp_lld_get_pixel_color(GDisplay *g) {
 	unsigned		pos;
 	LLDCOLOR_TYPE	color;
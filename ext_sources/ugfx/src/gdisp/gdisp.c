@@ -3312,9 +3312,75 @@ void gdispGDrawBox(GDisplay *g, coord_t x, coord_t y, coord_t cx, coord_t cy, co
 		#define fillcharline	drawcharline
 	#endif
 
+	#if GDISP_NEED_ANTIALIAS && GDISP_HARDWARE_ALPHABLIT && GDISP_ALPHABUF_SIZE != 0
+		#include <string.h>
+
+		/* Callback to render a glyph into the alpha mask buffer. The glyph box is p.x,p.y with size p.x2,p.y2 */
+		static void alphacharline(int16_t x, int16_t y, uint8_t count, uint8_t alpha, void *state) {
+			#define GD	((GDisplay *)state)
+			if (y < GD->p.y || y >= GD->p.y+GD->p.y2 || x+count <= GD->p.x || x >= GD->p.x+GD->p.x2)
+				return;
+			if (x < GD->p.x) {
+				count -= GD->p.x - x;
+				x = GD->p.x;
+			}
+			if (x+count > GD->p.x+GD->p.x2)
+				count = GD->p.x+GD->p.x2 - x;
+			memset(GD->alphabuf + (y-GD->p.y)*GD->p.x2 + (x-GD->p.x), alpha, count);
+			#undef GD
+		}
+
+		/* Render a whole glyph into the alpha mask buffer and blend it onto the display in one operation. */
+		static uint8_t alphacharglyph(GDisplay *g, int16_t x, int16_t y, mf_char ch) {
+			uint8_t		w;
+
+			g->p.x = x; g->p.y = y;
+			g->p.x2 = g->t.font->width; g->p.y2 = g->t.font->height;
+			memset(g->alphabuf, 0, g->p.x2 * g->p.y2);
+			w = mf_render_character(g->t.font, x, y, ch, alphacharline, g);
+
+			// Clip to the text area and (if needed) the display clipping area
+			g->p.cx = g->p.x2; g->p.cy = g->p.y2;
+			if (g->p.x < g->t.clipx0) { g->p.cx -= g->t.clipx0 - g->p.x; g->p.x = g->t.clipx0; }
+			if (g->p.y < g->t.clipy0) { g->p.cy -= g->t.clipy0 - g->p.y; g->p.y = g->t.clipy0; }
+			if (g->p.x + g->p.cx > g->t.clipx1)	g->p.cx = g->t.clipx1 - g->p.x;
+			if (g->p.y + g->p.cy > g->t.clipy1)	g->p.cy = g->t.clipy1 - g->p.y;
+			#if NEED_CLIPPING
+				#if GDISP_HARDWARE_CLIP == HARDWARE_AUTODETECT
+					if (!gvmt(g)->setclip)
+				#endif
+				{
+					if (g->p.x < g->clipx0) { g->p.cx -= g->clipx0 - g->p.x; g->p.x = g->clipx0; }
+					if (g->p.y < g->clipy0) { g->p.cy -= g->clipy0 - g->p.y; g->p.y = g->clipy0; }
+					if (g->p.x + g->p.cx > g->clipx1)	g->p.cx = g->clipx1 - g->p.x;
+					if (g->p.y + g->p.cy > g->clipy1)	g->p.cy = g->clipy1 - g->p.y;
+				}
+			#endif
+			if (g->p.cx <= 0 || g->p.cy <= 0)
+				return w;
+
+			g->p.x1 = g->p.x - x;
+			g->p.y1 = g->p.y - y;
+			g->p.ptr = (void *)g->alphabuf;
+			g->p.color = g->t.color;
+			gdisp_lld_alpha_blit_area(g);
+			return w;
+		}
+	#endif
+
 	/* Callback to render characters. */
 	static uint8_t drawcharglyph(int16_t x, int16_t y, mf_char ch, void *state) {
 		#define GD	((GDisplay *)state)
+			#if GDISP_NEED_ANTIALIAS && GDISP_HARDWARE_ALPHABLIT && GDISP_ALPHABUF_SIZE != 0
+				// Anti-aliased glyphs that fit the alpha mask buffer are blended in hardware
+				#if GDISP_HARDWARE_ALPHABLIT == HARDWARE_AUTODETECT
+					if (gvmt(GD)->alphablit)
+				#endif
+				{
+					if (!(GD->t.font->flags & MF_FONT_FLAG_BW) && GD->t.font->width * GD->t.font->height <= GDISP_ALPHABUF_SIZE)
+						return alphacharglyph(GD, x, y, ch);
+				}
+			#endif
 			return mf_render_character(GD->t.font, x, y, ch, drawcharline, state);
 		#undef GD
 	}
@@ -3361,7 +3427,7 @@ void gdispGDrawBox(GDisplay *g, coord_t x, coord_t y, coord_t cx, coord_t cy, co
 		g->t.clipx1 = x + mf_character_width(font, c) + font->baseline_x;
 		g->t.clipy1 = y + font->height;
 		g->t.color = color;
-		mf_render_character(font, x, y, c, drawcharline, g);
+		drawcharglyph(x, y, c, g);
 		autoflush(g);
 		MUTEX_EXIT(g);
 	}
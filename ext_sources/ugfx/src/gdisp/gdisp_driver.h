@@ -165,6 +165,18 @@
 		#define GDISP_HARDWARE_BITFILLS			HARDWARE_DEFAULT
 	#endif
 
+	/**
+	 * @brief   Hardware accelerated blending of an 8 bit alpha mask in a single color.
+	 * @details Can be set to TRUE, FALSE or HARDWARE_AUTODETECT
+	 *
+	 * @note	HARDWARE_AUTODETECT is only meaningful when GDISP_DRIVER_LIST is defined
+	 * @note	This is used to draw anti-aliased text a whole glyph at a time
+	 * 			rather than pixel by pixel.
+	 */
+	#ifndef GDISP_HARDWARE_ALPHABLIT
+		#define GDISP_HARDWARE_ALPHABLIT		HARDWARE_DEFAULT
+	#endif
+
 	/**
 	 * @brief   Hardware accelerated scrolling.
 	 * @details Can be set to TRUE, FALSE or HARDWARE_AUTODETECT
@@ -266,6 +278,10 @@
 		#undef GDISP_HARDWARE_BITFILLS
 		#define GDISP_HARDWARE_BITFILLS		HARDWARE_AUTODETECT
 	#endif
+	#if GDISP_HARDWARE_ALPHABLIT == TRUE
+		#undef GDISP_HARDWARE_ALPHABLIT
+		#define GDISP_HARDWARE_ALPHABLIT	HARDWARE_AUTODETECT
+	#endif
 	#if GDISP_HARDWARE_SCROLL == TRUE
 		#undef GDISP_HARDWARE_SCROLL
 		#define GDISP_HARDWARE_SCROLL		HARDWARE_AUTODETECT
@@ -377,6 +393,10 @@ struct GDisplay {
 		// A pixel line buffer
 		color_t		linebuf[GDISP_LINEBUF_SIZE];
 	#endif
+	#if GDISP_NEED_TEXT && GDISP_NEED_ANTIALIAS && GDISP_HARDWARE_ALPHABLIT && GDISP_ALPHABUF_SIZE != 0
+		// A glyph alpha mask buffer
+		uint8_t		alphabuf[GDISP_ALPHABUF_SIZE];
+	#endif
 };
 
 typedef struct GDISPVMT {
@@ -402,6 +422,7 @@ typedef struct GDISPVMT {
 	void *(*query)(GDisplay *g);					// Uses p.x (=what);
 	void (*setclip)(GDisplay *g);					// Uses p.x,p.y  p.cx,p.cy
 	void (*flush)(GDisplay *g);						// Uses no parameters
+	void (*alphablit)(GDisplay *g);					// Uses p.x,p.y  p.cx,p.cy  p.x1,p.y1 (=srcx,srcy)  p.x2 (=srccx), p.ptr (=alpha mask) p.color
 } GDISPVMT;
 
 //------------------------------------------------------------------------------------------------------------
@@ -598,6 +619,25 @@ typedef struct GDISPVMT {
 		LLDSPEC	void gdisp_lld_blit_area(GDisplay *g);
 	#endif
 
+	#if (GDISP_HARDWARE_ALPHABLIT && GDISP_NEED_TEXT && GDISP_NEED_ANTIALIAS) || defined(__DOXYGEN__)
+		/**
+		 * @brief   Blend a color into an area using an 8 bit alpha mask
+		 * @pre		GDISP_HARDWARE_ALPHABLIT is TRUE (and the application needs it)
+		 *
+		 * @param[in]	g				The driver structure
+		 * @param[in]	g->p.x,g->p.y	The area position
+		 * @param[in]	g->p.cx,g->p.cy	The area size
+		 * @param[in]	g->p.x1,g->p.y1	The starting position in the alpha mask
+		 * @param[in]	g->p.x2			The width of an alpha mask line
+		 * @param[in]	g->p.ptr		The pointer to the alpha mask (one byte per pixel, 255 = opaque)
+		 * @param[in]	g->p.color		The color to blend
+		 *
+		 * @note		The parameter variables must not be altered by the driver.
+		 * @note		The alpha mask belongs to the caller and may be reused as soon as this returns.
+		 */
+		LLDSPEC	void gdisp_lld_alpha_blit_area(GDisplay *g);
+	#endif
+
 	#if GDISP_HARDWARE_PIXELREAD || defined(__DOXYGEN__)
 		/**
 		 * @brief   Read a pixel from the display
@@ -692,6 +732,7 @@ typedef struct GDISPVMT {
 	#define gdisp_lld_clear(g)				gvmt(g)->clear(g)
 	#define gdisp_lld_fill_area(g)			gvmt(g)->fill(g)
 	#define gdisp_lld_blit_area(g)			gvmt(g)->blit(g)
+	#define gdisp_lld_alpha_blit_area(g)	gvmt(g)->alphablit(g)
 	#define gdisp_lld_get_pixel_color(g)	gvmt(g)->get(g)
 	#define gdisp_lld_vertical_scroll(g)	gvmt(g)->vscroll(g)
 	#define gdisp_lld_control(g)			gvmt(g)->control(g)
@@ -809,6 +850,11 @@ typedef struct GDISPVMT {
 		#else
 			0,
 		#endif
+		#if GDISP_HARDWARE_ALPHABLIT && GDISP_NEED_TEXT && GDISP_NEED_ANTIALIAS
+			gdisp_lld_alpha_blit_area,
+		#else
+			0,
+		#endif
 	}};
 
 	//--------------------------------------------------------------------------------------------------------
@@ -248,6 +248,17 @@
 	#ifndef GDISP_LINEBUF_SIZE
 		#define GDISP_LINEBUF_SIZE				128
 	#endif
+	/**
+	 * @brief   The size of the glyph alpha mask buffer (in bytes).
+	 * @details	Set to zero to guarantee disabling of the buffer.
+	 * @note	Only allocated when the driver supports GDISP_HARDWARE_ALPHABLIT
+	 * 			and anti-aliased text is enabled.
+	 * @note	Glyphs larger than width * height bytes fall back to drawing
+	 * 			pixel by pixel.
+	 */
+	#ifndef GDISP_ALPHABUF_SIZE
+		#define GDISP_ALPHABUF_SIZE				2048
+	#endif
 /**
  * @}
  *
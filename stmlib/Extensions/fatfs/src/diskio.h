@@ -73,6 +73,9 @@ DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 #define ATA_GET_MODEL		21	/* Get model name */
 #define ATA_GET_SN			22	/* Get serial number */
 
+/* ChibiOS bindings specific ioctl command */
+#define CTRL_CACHE_STATS	30	/* Get sector cache hits, misses and write-backs (DWORD[3]) */
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,10 @@
  	#include "stm32_dma2d.h"
 #endif
 
+#if LTDC_USE_DOUBLEBUFFER && !LTDC_USE_DMA2D
+	#include <string.h>
+#endif
+
 typedef struct ltdcLayerConfig {
 	// Frame
 	LLDCOLOR_TYPE*	frame;			// Frame buffer address
@@ -91,12 +95,191 @@ typedef struct ltdcConfig {
 	#define GDISP_INITIAL_BACKLIGHT	100
 #endif
 
+#if LTDC_USE_LAYER2 && GDISP_TOTAL_DISPLAYS != 2
+	#error "GDISP: STM32LTDC - LTDC_USE_LAYER2 needs GDISP_TOTAL_DISPLAYS set to 2"
+#endif
+
+#if LTDC_USE_DOUBLEBUFFER
+	#if !GFX_USE_OS_CHIBIOS
+		#error "GDISP: STM32LTDC - double buffering needs the ChibiOS OSAL for the LTDC interrupt"
+	#endif
+
+	// The back buffer defaults to the memory just after the front buffer
+	#ifndef LTDC_BACKBUFFER
+		#define LTDC_BACKBUFFER		((LLDCOLOR_TYPE *)((uint8_t *)driverCfg.bglayer.frame + driverCfg.bglayer.pitch * driverCfg.bglayer.height))
+	#endif
+	#ifndef LTDC_IRQ_PRIORITY
+		#define LTDC_IRQ_PRIORITY	11
+	#endif
+
+	// Page flip states
+	#define FLIP_IDLE			0	// Both buffers are in sync apart from the dirty area
+	#define FLIP_PENDING		1	// Buffers swapped, waiting for the LTDC to latch the new address
+	#define FLIP_LATCHED		2	// New address latched, back buffer needs the copy forward
+#endif
+
+#if LTDC_USE_DMA2D
+	#if LTDC_DMA2D_QUEUE_SIZE && !GFX_USE_OS_CHIBIOS
+		#error "GDISP: STM32LTDC - the DMA2D queue needs the ChibiOS OSAL for the DMA2D interrupt"
+	#endif
+	#ifndef LTDC_DMA2D_IRQ_PRIORITY
+		#define LTDC_DMA2D_IRQ_PRIORITY	11
+	#endif
+
+	// DMA2D color mode of the frame buffer
+	#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
+		#define DMA2D_LLD_OPFCCR	OPFCCR_RGB565
+		#define DMA2D_LLD_CM		FGPFCCR_CM_RGB565
+	#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
+		#define DMA2D_LLD_OPFCCR	OPFCCR_ARGB8888
+		#define DMA2D_LLD_CM		FGPFCCR_CM_ARGB8888
+	#endif
+
+	// DMA2D color mode of the pixel_t buffers passed to gdisp_lld_blit_area()
+	#if GDISP_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
+		#define DMA2D_PIXEL_CM		FGPFCCR_CM_RGB565
+	#elif GDISP_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
+		// A color_t has no alpha - make it opaque
+		#define DMA2D_PIXEL_CM		(FGPFCCR_CM_ARGB8888 | FGPFCCR_AM_REPLACE | FGPFCCR_ALPHA(0xFF))
+	#endif
+#endif
+
 /*===========================================================================*/
 /* Driver local routines.                                                    */
 /*===========================================================================*/
 
-#define PIXIL_POS(g, x, y)		((y) * driverCfg.bglayer.pitch + (x) * LTDC_PIXELBYTES)
-#define PIXEL_ADDR(g, pos)		((LLDCOLOR_TYPE *)((uint8_t *)driverCfg.bglayer.frame+pos))
+// Each display is an LTDC layer. Display 0 is the background layer, display 1 the foreground (overlay) layer.
+#if LTDC_USE_LAYER2
+	#define LAYER(g)			((const ltdcLayerConfig *)(g)->priv)
+	#define LAYER_REG(g)		((g)->controllerdisplay ? LTDC_Layer2 : LTDC_Layer1)
+	#define IS_OVERLAY(g)		((g)->controllerdisplay != 0)
+#else
+	#define LAYER(g)			(&driverCfg.bglayer)
+	#define LAYER_REG(g)		LTDC_Layer1
+	#define IS_OVERLAY(g)		FALSE
+#endif
+
+#define PIXIL_POS(g, x, y)		((y) * LAYER(g)->pitch + (x) * LTDC_PIXELBYTES)
+#if LTDC_USE_DOUBLEBUFFER
+	// Only the background layer is double buffered
+	#define PIXEL_ADDR(g, pos)	((LLDCOLOR_TYPE *)((uint8_t *)(IS_OVERLAY(g) ? LAYER(g)->frame : drawbuf)+pos))
+#else
+	#define PIXEL_ADDR(g, pos)	((LLDCOLOR_TYPE *)((uint8_t *)LAYER(g)->frame+pos))
+#endif
+
+#if LTDC_USE_DOUBLEBUFFER
+	static LLDCOLOR_TYPE*		drawbuf;		// The buffer we draw into
+	static LLDCOLOR_TYPE*		showbuf;		// The buffer being scanned out
+	static volatile uint8_t		flipstate;		// One of the FLIP_xxx states
+	static thread_reference_t	fliptr;			// Thread waiting for the flip to be latched
+
+	#if LTDC_DOUBLEBUFFER_DIRTYCOPY
+		// Area drawn since the last flip in native (unrotated) coordinates
+		static coord_t			dirtyx0, dirtyy0, dirtyx1, dirtyy1;
+
+		#define IS_DIRTY()		(dirtyx1 > dirtyx0)
+
+		static void _ltdc_clear_dirty(void) {
+			dirtyx0 = driverCfg.bglayer.width;
+			dirtyy0 = driverCfg.bglayer.height;
+			dirtyx1 = dirtyy1 = 0;
+		}
+
+		static void _ltdc_mark_dirty(GDisplay* g, coord_t x, coord_t y, coord_t cx, coord_t cy) {
+			#if GDISP_NEED_CONTROL
+				coord_t		tmp;
+
+				switch(g->g.Orientation) {
+				case GDISP_ROTATE_0:
+				default:
+					break;
+				case GDISP_ROTATE_90:
+					tmp = x; x = y; y = g->g.Width - tmp - cx;
+					tmp = cx; cx = cy; cy = tmp;
+					break;
+				case GDISP_ROTATE_180:
+					x = g->g.Width - x - cx;
+					y = g->g.Height - y - cy;
+					break;
+				case GDISP_ROTATE_270:
+					tmp = y; y = x; x = g->g.Height - tmp - cy;
+					tmp = cx; cx = cy; cy = tmp;
+					break;
+				}
+			#else
+				(void) g;
+			#endif
+
+			if (x < dirtyx0)		dirtyx0 = x;
+			if (y < dirtyy0)		dirtyy0 = y;
+			if (x + cx > dirtyx1)	dirtyx1 = x + cx;
+			if (y + cy > dirtyy1)	dirtyy1 = y + cy;
+		}
+	#else
+		static bool_t			dirty;
+
+		#define IS_DIRTY()		(dirty)
+
+		static GFXINLINE void _ltdc_clear_dirty(void) {
+			dirty = FALSE;
+		}
+
+		static GFXINLINE void _ltdc_mark_dirty(GDisplay* g, coord_t x, coord_t y, coord_t cx, coord_t cy) {
+			(void) g; (void) x; (void) y; (void) cx; (void) cy;
+			dirty = TRUE;
+		}
+	#endif
+
+	// Copy what was drawn in the last frame from the front buffer to the new back buffer
+	static void _ltdc_copy_forward(void) {
+		uint32_t	pos;
+		coord_t		cx, cy;
+
+		#if LTDC_DOUBLEBUFFER_DIRTYCOPY
+			if (!IS_DIRTY())
+				return;
+			pos = dirtyy0 * driverCfg.bglayer.pitch + dirtyx0 * LTDC_PIXELBYTES;
+			cx = dirtyx1 - dirtyx0;
+			cy = dirtyy1 - dirtyy0;
+		#else
+			pos = 0;
+			cx = driverCfg.bglayer.width;
+			cy = driverCfg.bglayer.height;
+		#endif
+
+		#if LTDC_USE_DMA2D
+			// Queued - any drawing that follows is queued behind it
+			dma2d_copy((uint8_t *)showbuf + pos, driverCfg.bglayer.width - cx, DMA2D_LLD_CM,
+						(uint8_t *)drawbuf + pos, driverCfg.bglayer.width - cx, cx, cy);
+		#else
+			for(; cy; cy--, pos += driverCfg.bglayer.pitch)
+				memcpy((uint8_t *)drawbuf + pos, (uint8_t *)showbuf + pos, cx * LTDC_PIXELBYTES);
+		#endif
+
+		_ltdc_clear_dirty();
+	}
+
+	// Make the back buffer ready for drawing. Must be called before touching the back buffer.
+	static GFXINLINE void _ltdc_sync_drawbuf(void) {
+		if (flipstate == FLIP_IDLE)
+			return;
+
+		// The old front buffer is still on the screen until the flip has been latched
+		osalSysLock();
+		if (flipstate == FLIP_PENDING)
+			osalThreadSuspendS(&fliptr);
+		osalSysUnlock();
+
+		_ltdc_copy_forward();
+		flipstate = FLIP_IDLE;
+	}
+
+	#define SYNC_DRAWBUF(g)						{ if (!IS_OVERLAY(g)) _ltdc_sync_drawbuf(); }
+	#define MARK_DIRTY(g, x, y, cx, cy)			{ if (!IS_OVERLAY(g)) _ltdc_mark_dirty(g, x, y, cx, cy); }
+#else
+	#define SYNC_DRAWBUF(g)
+	#define MARK_DIRTY(g, x, y, cx, cy)
+#endif
 
 /*===========================================================================*/
 /* Driver exported functions.                                                */
@@ -108,6 +291,17 @@ static void _ltdc_reload(void) {
 		gfxYield();
 }
 
+static void _ltdc_layer_window(LTDC_Layer_TypeDef* pLayReg, coord_t x, coord_t y, coord_t cx, coord_t cy) {
+	uint32_t start, stop;
+
+	start = (uint32_t)x + driverCfg.hsync + driverCfg.hbackporch;
+	stop  = start + cx - 1;
+	pLayReg->WHPCR = ((start <<  0) & LTDC_LxWHPCR_WHSTPOS) | ((stop  << 16) & LTDC_LxWHPCR_WHSPPOS);
+	start = (uint32_t)y + driverCfg.vsync + driverCfg.vbackporch;
+	stop  = start + cy - 1;
+	pLayReg->WVPCR = ((start <<  0) & LTDC_LxWVPCR_WVSTPOS) | ((stop  << 16) & LTDC_LxWVPCR_WVSPPOS);
+}
+
 static void _ltdc_layer_init(LTDC_Layer_TypeDef* pLayReg, const ltdcLayerConfig* pCfg) {
 	static const uint8_t fmt2Bpp[] = {
 		4, /* LTDC_FMT_ARGB8888 */
@@ -119,7 +313,7 @@ static void _ltdc_layer_init(LTDC_Layer_TypeDef* pLayReg, const ltdcLayerConfig*
 		1, /* LTDC_FMT_AL44 */
 		2  /* LTDC_FMT_AL88 */
 	};
-	uint32_t start, stop;
+	unsigned i;
 
 	// Set the framebuffer dimensions and format
 	pLayReg->PFCR = (pLayReg->PFCR & ~LTDC_LxPFCR_PF) | ((uint32_t)pCfg->fmt & LTDC_LxPFCR_PF);
@@ -128,20 +322,15 @@ static void _ltdc_layer_init(LTDC_Layer_TypeDef* pLayReg, const ltdcLayerConfig*
 	pLayReg->CFBLNR = (uint32_t)pCfg->height & LTDC_LxCFBLNR_CFBLNBR;
 
 	// Set the display window boundaries
-	start = (uint32_t)pCfg->x + driverCfg.hsync + driverCfg.hbackporch;
-	stop  = start + pCfg->cx - 1;
-	pLayReg->WHPCR = ((start <<  0) & LTDC_LxWHPCR_WHSTPOS) | ((stop  << 16) & LTDC_LxWHPCR_WHSPPOS);
-	start = (uint32_t)pCfg->y + driverCfg.vsync + driverCfg.vbackporch;
-	stop  = start + pCfg->cy - 1;
-	pLayReg->WVPCR = ((start <<  0) & LTDC_LxWVPCR_WVSTPOS) | ((stop  << 16) & LTDC_LxWVPCR_WVSPPOS);
+	_ltdc_layer_window(pLayReg, pCfg->x, pCfg->y, pCfg->cx, pCfg->cy);
 
 	// Set colors
 	pLayReg->DCCR = pCfg->defcolor;
 	pLayReg->CKCR = (pLayReg->CKCR & ~0x00FFFFFF) | (pCfg->keycolor & 0x00FFFFFF);
 	pLayReg->CACR = (pLayReg->CACR & ~LTDC_LxCACR_CONSTA) | ((uint32_t)pCfg->alpha & LTDC_LxCACR_CONSTA);
 	pLayReg->BFCR = (pLayReg->BFCR & ~(LTDC_LxBFCR_BF1 | LTDC_LxBFCR_BF2)) | ((uint32_t)pCfg->blending & (LTDC_LxBFCR_BF1 | LTDC_LxBFCR_BF2));
-	for (start = 0; start < pCfg->palettelen; start++)
-		pLayReg->CLUTWR = ((uint32_t)start << 24) | (pCfg->palette[start] & 0x00FFFFFF);
+	for (i = 0; i < pCfg->palettelen; i++)
+		pLayReg->CLUTWR = ((uint32_t)i << 24) | (pCfg->palette[i] & 0x00FFFFFF);
 
 	// Final flags
 	pLayReg->CR = (pLayReg->CR & ~LTDC_LEF_MASK) | ((uint32_t)pCfg->layerflags & LTDC_LEF_MASK);
@@ -212,22 +401,87 @@ static void _ltdc_init(void) {
 	_ltdc_reload();
 	LTDC->GCR |= LTDC_GCR_LTDCEN;
 	_ltdc_reload();
+
+	#if LTDC_USE_DOUBLEBUFFER
+		// The register reload interrupt tells us when a page flip has been latched
+		LTDC->ICR = LTDC_ICR_CRRIF;
+		LTDC->IER = LTDC_IER_RRIE;
+		nvicEnableVector(STM32_LTDC_EV_NUMBER, LTDC_IRQ_PRIORITY);
+	#endif
 }
 
+#if LTDC_USE_DOUBLEBUFFER
+	OSAL_IRQ_HANDLER(STM32_LTDC_EV_HANDLER) {
+		OSAL_IRQ_PROLOGUE();
+
+		LTDC->ICR = LTDC_ICR_CRRIF;
+
+		osalSysLockFromISR();
+		if (flipstate == FLIP_PENDING) {
+			flipstate = FLIP_LATCHED;
+			osalThreadResumeI(&fliptr, MSG_OK);
+		}
+		osalSysUnlockFromISR();
+
+		OSAL_IRQ_EPILOGUE();
+	}
+#endif
+
+#if LTDC_USE_LAYER2
+	// Start the overlay out fully transparent
+	static void _ltdc_clear_overlay(void) {
+		LLDCOLOR_TYPE*	p;
+		LLDCOLOR_TYPE	c;
+		coord_t			x, y;
+
+		// Keyed pixels are transparent. Without a color key a zero (ARGB8888) pixel is.
+		c = 0;
+		if ((driverCfg.fglayer.layerflags & LTDC_LEF_KEYING))
+			c = LLDRGB2COLOR((driverCfg.fglayer.keycolor >> 16) & 0xFF, (driverCfg.fglayer.keycolor >> 8) & 0xFF, driverCfg.fglayer.keycolor & 0xFF);
+
+		for(y = 0; y < driverCfg.fglayer.height; y++) {
+			p = (LLDCOLOR_TYPE *)((uint8_t *)driverCfg.fglayer.frame + y * driverCfg.fglayer.pitch);
+			for(x = 0; x < driverCfg.fglayer.width; x++)
+				*p++ = c;
+		}
+	}
+#endif
+
 LLDSPEC bool_t gdisp_lld_init(GDisplay* g) {
 	// Initialize the private structure
-	g->priv = 0;
+	#if LTDC_USE_LAYER2
+		g->priv = (void *)(g->controllerdisplay ? &driverCfg.fglayer : &driverCfg.bglayer);
+	#else
+		g->priv = 0;
+	#endif
 	g->board = 0;
 
 	// Init the board
 	init_board(g);
 
-	// Initialise the LTDC controller
-	_ltdc_init();
+	if (!IS_OVERLAY(g)) {
+		// Initialise the buffers before the interrupt can fire
+		#if LTDC_USE_DOUBLEBUFFER
+			showbuf = driverCfg.bglayer.frame;
+			drawbuf = LTDC_BACKBUFFER;
+			flipstate = FLIP_IDLE;
+			fliptr = 0;
+			_ltdc_clear_dirty();
+		#endif
 
-	// Initialise DMA2D
-	#if LTDC_USE_DMA2D
-		dma2d_init();
+		// Initialise the LTDC controller (both layers)
+		_ltdc_init();
+
+		// Initialise DMA2D
+		#if LTDC_USE_DMA2D
+			dma2d_init();
+		#endif
+	}
+	#if LTDC_USE_LAYER2
+		else {
+			// The layer is already running - just clear it
+			_ltdc_clear_overlay();
+		}
 	#endif
 
     // Finish Init the board
@@ -237,8 +491,8 @@ LLDSPEC bool_t gdisp_lld_init(GDisplay* g) {
 	set_backlight(g, GDISP_INITIAL_BACKLIGHT);
 
 	// Initialise the GDISP structure
-	g->g.Width = driverCfg.bglayer.width;
-	g->g.Height = driverCfg.bglayer.height;
+	g->g.Width = LAYER(g)->width;
+	g->g.Height = LAYER(g)->height;
 	g->g.Orientation = GDISP_ROTATE_0;
 	g->g.Powermode = powerOn;
 	g->g.Backlight = GDISP_INITIAL_BACKLIGHT;
@@ -270,8 +524,11 @@ LLDSPEC void gdisp_lld_draw_pixel(GDisplay* g) {
 		pos = PIXIL_POS(g, g->p.x, g->p.y);
 	#endif
 
+	SYNC_DRAWBUF(g);
+	MARK_DIRTY(g, g->p.x, g->p.y, 1, 1);
+
 	#if LTDC_USE_DMA2D
-		while(DMA2D->CR & DMA2D_CR_START);
+		dma2d_wait();
 	#endif
 
 	PIXEL_ADDR(g, pos)[0] = gdispColor2Native(g->p.color);
@@ -301,8 +558,10 @@ LLDSPEC	color_t gdisp_lld_get_pixel_color(GDisplay* g) {
 		pos = PIXIL_POS(g, g->p.x, g->p.y);
 	#endif
 
+	SYNC_DRAWBUF(g);
+
 	#if LTDC_USE_DMA2D
-		while(DMA2D->CR & DMA2D_CR_START);
+		dma2d_wait();
 	#endif
 
 	color = PIXEL_ADDR(g, pos)[0];
@@ -311,6 +570,23 @@ LLDSPEC	color_t gdisp_lld_get_pixel_color(GDisplay* g) {
 }
 
 #if GDISP_NEED_CONTROL
+	// The RGB888 value the LTDC compares against the color key for a color
+	static uint32_t _ltdc_colorkey(color_t c) {
+		#if LTDC_PIXELFORMAT == LTDC_FMT_RGB565
+			uint32_t	r, gr, b;
+			uint16_t	n;
+
+			// The LTDC expands 565 to 888 by repeating the top bits
+			n = gdispColor2Native(c);
+			r = (n >> 11) & 0x1F;
+			gr = (n >> 5) & 0x3F;
+			b = n & 0x1F;
+			return (((r << 3) | (r >> 2)) << 16) | (((gr << 2) | (gr >> 4)) << 8) | ((b << 3) | (b >> 2));
+		#else
+			return gdispColor2Native(c) & 0x00FFFFFF;
+		#endif
+	}
+
 	LLDSPEC void gdisp_lld_control(GDisplay* g) {
 		switch(g->p.x) {
 		case GDISP_CONTROL_POWER:
@@ -367,39 +643,230 @@ LLDSPEC	color_t gdisp_lld_get_pixel_color(GDisplay* g) {
 			// TODO
 			g->g.Contrast = (unsigned)g->p.ptr;
 			return;
+
+		// The layer settings below are latched by the LTDC during the next vertical blanking
+
+		case LTDC_CONTROL_ALPHA:
+			if ((unsigned)g->p.ptr > 255) g->p.ptr = (void *)255;
+			LAYER_REG(g)->CACR = (unsigned)g->p.ptr & LTDC_LxCACR_CONSTA;
+			LTDC->SRCR = LTDC_SRCR_VBR;
+			return;
+
+		case LTDC_CONTROL_COLORKEY:
+			if (g->p.ptr == LTDC_COLORKEY_NONE) {
+				LAYER_REG(g)->CR &= ~LTDC_LxCR_COLKEN;
+			} else {
+				LAYER_REG(g)->CKCR = _ltdc_colorkey((color_t)(unsigned)g->p.ptr);
+				LAYER_REG(g)->CR |= LTDC_LxCR_COLKEN;
+			}
+			LTDC->SRCR = LTDC_SRCR_VBR;
+			return;
+
+		case LTDC_CONTROL_POSITION:
+			{
+				coord_t		x, y;
+
+				// Keep the window on the screen
+				x = LTDC_POSITION_X(g->p.ptr);
+				y = LTDC_POSITION_Y(g->p.ptr);
+				if (x > driverCfg.width - LAYER(g)->cx)		x = driverCfg.width - LAYER(g)->cx;
+				if (y > driverCfg.height - LAYER(g)->cy)	y = driverCfg.height - LAYER(g)->cy;
+				if (x < 0)	x = 0;
+				if (y < 0)	y = 0;
+				_ltdc_layer_window(LAYER_REG(g), x, y, LAYER(g)->cx, LAYER(g)->cy);
+				LTDC->SRCR = LTDC_SRCR_VBR;
+			}
+			return;
 		}
 	}
 #endif
 
+#if LTDC_USE_DOUBLEBUFFER
+	LLDSPEC void gdisp_lld_flush(GDisplay* g) {
+		LLDCOLOR_TYPE*	tmp;
+
+		// The overlay is drawn straight to the screen
+		if (IS_OVERLAY(g))
+			return;
+
+		// Nothing new to show or the last flip has not been consumed yet
+		if (flipstate != FLIP_IDLE || !IS_DIRTY())
+			return;
+
+		// Make sure all the drawing has landed in the back buffer
+		#if LTDC_USE_DMA2D
+			dma2d_wait();
+		#endif
+
+		tmp = showbuf;
+		showbuf = drawbuf;
+		drawbuf = tmp;
+
+		// Latch the new address during the next vertical blanking.
+		// We don't wait here - the next drawing operation does that.
+		flipstate = FLIP_PENDING;
+		LTDC_Layer1->CFBAR = (uint32_t)showbuf & LTDC_LxCFBAR_CFBADD;
+		LTDC->SRCR = LTDC_SRCR_VBR;
+	}
+#endif
+
 #if LTDC_USE_DMA2D
+	static GFXINLINE void _dma2d_start(const dma2dCommand* cmd) {
+		DMA2D->FGMAR = cmd->fgmar;
+		DMA2D->FGOR = cmd->fgor;
+		DMA2D->FGPFCCR = cmd->fgpfccr;
+		DMA2D->FGCOLR = cmd->fgcolr;
+		DMA2D->BGMAR = cmd->bgmar;
+		DMA2D->BGOR = cmd->bgor;
+		DMA2D->BGPFCCR = cmd->bgpfccr;
+		DMA2D->OMAR = cmd->omar;
+		DMA2D->OOR = cmd->oor;
+		DMA2D->OCOLR = cmd->ocolr;
+		DMA2D->NLR = cmd->nlr;
+		#if LTDC_DMA2D_QUEUE_SIZE
+			DMA2D->CR = cmd->cr | DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE | DMA2D_CR_START;
+		#else
+			DMA2D->CR = cmd->cr | DMA2D_CR_START;
+		#endif
+	}
+
+	#if LTDC_DMA2D_QUEUE_SIZE
+		static dma2dCommand			dma2dQueue[LTDC_DMA2D_QUEUE_SIZE];
+		static unsigned				dma2dHead;		// Next free slot
+		static unsigned				dma2dTail;		// The operation in progress
+		static volatile unsigned	dma2dCount;		// Operations queued including the one in progress
+		static threads_queue_t		dma2dWaiters;	// Threads waiting for a free slot or for the queue to drain
+
+		OSAL_IRQ_HANDLER(STM32_DMA2D_HANDLER) {
+			OSAL_IRQ_PROLOGUE();
+
+			// Done (or failed) - either way move on to the next one
+			DMA2D->IFCR = DMA2D_IFCR_CTCIF | DMA2D_IFCR_CTEIF | DMA2D_IFCR_CCEIF;
+
+			osalSysLockFromISR();
+			if (++dma2dTail >= LTDC_DMA2D_QUEUE_SIZE)
+				dma2dTail = 0;
+			if (--dma2dCount)
+				_dma2d_start(&dma2dQueue[dma2dTail]);
+			osalThreadDequeueAllI(&dma2dWaiters, MSG_OK);
+			osalSysUnlockFromISR();
+
+			OSAL_IRQ_EPILOGUE();
+		}
+
+		// Queue an operation. Only blocks if the queue is full.
+		static void dma2d_submit(const dma2dCommand* cmd) {
+			osalSysLock();
+			while (dma2dCount >= LTDC_DMA2D_QUEUE_SIZE)
+				osalThreadEnqueueTimeoutS(&dma2dWaiters, TIME_INFINITE);
+			dma2dQueue[dma2dHead] = *cmd;
+			if (++dma2dHead >= LTDC_DMA2D_QUEUE_SIZE)
+				dma2dHead = 0;
+			if (dma2dCount++ == 0)
+				_dma2d_start(&dma2dQueue[dma2dTail]);
+			osalSysUnlock();
+		}
+
+		// Wait until every queued operation has completed
+		static void dma2d_wait(void) {
+			if (!dma2dCount)
+				return;
+			osalSysLock();
+			while (dma2dCount)
+				osalThreadEnqueueTimeoutS(&dma2dWaiters, TIME_INFINITE);
+			osalSysUnlock();
+		}
+	#else
+		static void dma2d_submit(const dma2dCommand* cmd) {
+			while(DMA2D->CR & DMA2D_CR_START);
+			_dma2d_start(cmd);
+		}
+
+		static void dma2d_wait(void) {
+			while(DMA2D->CR & DMA2D_CR_START);
+		}
+	#endif
+
 	static void dma2d_init(void) {
 		// Enable DMA2D clock
 		RCC->AHB1ENR |= RCC_AHB1ENR_DMA2DEN;
 
-		// Output color format
-		#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
-			DMA2D->OPFCCR = OPFCCR_RGB565;
-		#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
-			DMA2D->OPFCCR = OPFCCR_ARGB8888;
-		#endif
+		// Output color format - all our output goes to a frame buffer
+		DMA2D->OPFCCR = DMA2D_LLD_OPFCCR;
 
 		// Foreground color format
-		#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
-			DMA2D->FGPFCCR = FGPFCCR_CM_RGB565;
-		#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
-			DMA2D->FGPFCCR = FGPFCCR_CM_ARGB8888;
+		DMA2D->FGPFCCR = DMA2D_LLD_CM;
+
+		#if LTDC_DMA2D_QUEUE_SIZE
+			dma2dHead = dma2dTail = dma2dCount = 0;
+			osalThreadQueueObjectInit(&dma2dWaiters);
+			nvicEnableVector(STM32_DMA2D_NUMBER, LTDC_DMA2D_IRQ_PRIORITY);
 		#endif
 	}
 
+	// Fill an area with a native color
+	static void dma2d_fill(void* dst, uint32_t dstoff, coord_t cx, coord_t cy, uint32_t color) {
+		dma2dCommand	cmd;
+
+		cmd.cr = DMA2D_CR_MODE_R2M;
+		cmd.fgmar = cmd.fgor = cmd.fgcolr = 0;
+		cmd.fgpfccr = DMA2D_LLD_CM;
+		cmd.bgmar = cmd.bgor = 0;
+		cmd.bgpfccr = DMA2D_LLD_CM;
+		cmd.omar = (uint32_t)dst;
+		cmd.oor = dstoff;
+		cmd.ocolr = color;
+		cmd.nlr = ((uint32_t)cx << 16) | (cy);
+		dma2d_submit(&cmd);
+	}
+
+	// Copy an area converting it from the srcfmt color mode if needed
+	static void dma2d_copy(const void* src, uint32_t srcoff, uint32_t srcfmt, void* dst, uint32_t dstoff, coord_t cx, coord_t cy) {
+		dma2dCommand	cmd;
+
+		cmd.cr = srcfmt == DMA2D_LLD_CM ? DMA2D_CR_MODE_M2M : DMA2D_CR_MODE_M2M_PFC;
+		cmd.fgmar = (uint32_t)src;
+		cmd.fgor = srcoff;
+		cmd.fgpfccr = srcfmt;
+		cmd.fgcolr = 0;
+		cmd.bgmar = cmd.bgor = 0;
+		cmd.bgpfccr = DMA2D_LLD_CM;
+		cmd.omar = (uint32_t)dst;
+		cmd.oor = dstoff;
+		cmd.ocolr = 0;
+		cmd.nlr = ((uint32_t)cx << 16) | (cy);
+		dma2d_submit(&cmd);
+	}
+
+	// Blend an area in fgfmt color mode over the frame buffer.
+	// fgcolor is the color for the alpha only (A8, A4) color modes.
+	static void dma2d_blend(const void* fg, uint32_t fgoff, uint32_t fgfmt, uint32_t fgcolor, void* dst, uint32_t dstoff, coord_t cx, coord_t cy) {
+		dma2dCommand	cmd;
+
+		cmd.cr = DMA2D_CR_MODE_M2M_BLEND;
+		cmd.fgmar = (uint32_t)fg;
+		cmd.fgor = fgoff;
+		cmd.fgpfccr = fgfmt;
+		cmd.fgcolr = fgcolor;
+		cmd.bgmar = (uint32_t)dst;
+		cmd.bgor = dstoff;
+		cmd.bgpfccr = DMA2D_LLD_CM;
+		cmd.omar = (uint32_t)dst;
+		cmd.oor = dstoff;
+		cmd.ocolr = 0;
+		cmd.nlr = ((uint32_t)cx << 16) | (cy);
+		dma2d_submit(&cmd);
+	}
+
 	// Uses p.x,p.y  p.cx,p.cy  p.color
 	LLDSPEC void gdisp_lld_fill_area(GDisplay* g)
 	{
 		uint32_t pos;
 		uint32_t lineadd;
-		uint32_t shape;
+		coord_t cx, cy;
 
-		// Wait until DMA2D is ready
-		while(DMA2D->CR & DMA2D_CR_START);
+		SYNC_DRAWBUF(g);
+		MARK_DIRTY(g, g->p.x, g->p.y, g->p.cx, g->p.cy);
 
 		#if GDISP_NEED_CONTROL
 			switch(g->g.Orientation) {
@@ -407,99 +874,140 @@ LLDSPEC	color_t gdisp_lld_get_pixel_color(GDisplay* g) {
 			default:
 				pos = PIXIL_POS(g, g->p.x, g->p.y);
 				lineadd = g->g.Width - g->p.cx;
-				shape = (g->p.cx << 16) | (g->p.cy);
+				cx = g->p.cx; cy = g->p.cy;
 				break;
 			case GDISP_ROTATE_90:
 				pos = PIXIL_POS(g, g->p.y, g->g.Width-g->p.x-g->p.cx);
 				lineadd = g->g.Height - g->p.cy;
-				shape = (g->p.cy << 16) | (g->p.cx);
+				cx = g->p.cy; cy = g->p.cx;
 				break;
 			case GDISP_ROTATE_180:
 				pos = PIXIL_POS(g, g->g.Width-g->p.x-g->p.cx, g->g.Height-g->p.y-g->p.cy);
 				lineadd = g->g.Width - g->p.cx;
-				shape = (g->p.cx << 16) | (g->p.cy);
+				cx = g->p.cx; cy = g->p.cy;
 				break;
 			case GDISP_ROTATE_270:
 				pos = PIXIL_POS(g, g->g.Height-g->p.y-g->p.cy, g->p.x);
 				lineadd = g->g.Height - g->p.cy;
-				shape = (g->p.cy << 16) | (g->p.cx);
+				cx = g->p.cy; cy = g->p.cx;
 				break;
 			}
 		#else
 			pos = PIXIL_POS(g, g->p.x, g->p.y);
 			lineadd = g->g.Width - g->p.cx;
-			shape = (g->p.cx << 16) | (g->p.cy);
-		#endif
-
-		// Start the DMA2D
-		// Output color format
-		#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
-			DMA2D->OPFCCR = OPFCCR_RGB565;
-		#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
-			DMA2D->OPFCCR = OPFCCR_ARGB8888;
+			cx = g->p.cx; cy = g->p.cy;
 		#endif
 
-		// Foreground color format
-		#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
-			DMA2D->FGPFCCR = FGPFCCR_CM_RGB565;
-		#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
-			DMA2D->FGPFCCR = FGPFCCR_CM_ARGB8888;
-		#endif
-		DMA2D->OMAR = (uint32_t)PIXEL_ADDR(g, pos);
-		DMA2D->OOR = lineadd;
-		DMA2D->NLR = shape;
-		DMA2D->OCOLR = (uint32_t)(gdispColor2Native(g->p.color));
-		DMA2D->CR = DMA2D_CR_MODE_R2M | DMA2D_CR_START;
+		// Queued - we don't wait for it to finish
+		dma2d_fill(PIXEL_ADDR(g, pos), lineadd, cx, cy, (uint32_t)(gdispColor2Native(g->p.color)));
 	}
 
-	/* Oops - the DMA2D only supports GDISP_ROTATE_0.
-	 *
-	 * Where the width is 1 we can trick it for other orientations.
-	 * That is worthwhile as a width of 1 is common. For other
-	 * situations we need to fall back to pixel pushing.
+	#if (GDISP_HARDWARE_BITFILLS || GDISP_HARDWARE_ALPHABLIT) && GDISP_NEED_CONTROL
+		// The native pixel position of a display pixel in the current orientation
+		static unsigned _ltdc_rotated_pos(GDisplay* g, coord_t x, coord_t y) {
+			switch(g->g.Orientation) {
+			case GDISP_ROTATE_0:
+			default:
+				return PIXIL_POS(g, x, y);
+			case GDISP_ROTATE_90:
+				return PIXIL_POS(g, y, g->g.Width-x-1);
+			case GDISP_ROTATE_180:
+				return PIXIL_POS(g, g->g.Width-x-1, g->g.Height-y-1);
+			case GDISP_ROTATE_270:
+				return PIXIL_POS(g, g->g.Height-y-1, x);
+			}
+		}
+	#endif
+
+	/* The DMA2D only supports GDISP_ROTATE_0 for blits.
 	 *
-	 * Additionally, although DMA2D can translate color formats
-	 * it can only do it for a small range of formats. For any
-	 * other formats we also need to fall back to pixel pushing.
+	 * For the other orientations we pixel push here. It just
+	 * uses more CPU.
 	 *
-	 * As the code to actually do all that for other than the
-	 * simplest case (orientation == GDISP_ROTATE_0 and
-	 * GDISP_PIXELFORMAT == GDISP_LLD_PIXELFORMAT) is very complex
-	 * we will always pixel push for now. In practice that is OK as
-	 * access to the framebuffer is fast - probably faster than DMA2D.
-	 * It just uses more CPU.
+	 * Color translation is done by the DMA2D for the pixel formats
+	 * it can read (see DMA2D_PIXEL_CM).
 	 */
 	#if GDISP_HARDWARE_BITFILLS
+		#if GDISP_NEED_CONTROL
+			static void _ltdc_blit_rotated(GDisplay* g) {
+				const pixel_t*	src;
+				coord_t			x, y;
+
+				dma2d_wait();
+
+				src = (const pixel_t *)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1;
+				for(y = g->p.y; y < g->p.y + g->p.cy; y++, src += g->p.x2) {
+					for(x = 0; x < g->p.cx; x++)
+						PIXEL_ADDR(g, _ltdc_rotated_pos(g, g->p.x+x, y))[0] = gdispColor2Native(src[x]);
+				}
+			}
+		#endif
+
 		// Uses p.x,p.y  p.cx,p.cy  p.x1,p.y1 (=srcx,srcy)  p.x2 (=srccx), p.ptr (=buffer)
 		LLDSPEC void gdisp_lld_blit_area(GDisplay* g) {
-			// Wait until DMA2D is ready
-			while(DMA2D->CR & DMA2D_CR_START);
+			SYNC_DRAWBUF(g);
+			MARK_DIRTY(g, g->p.x, g->p.y, g->p.cx, g->p.cy);
 
-			// Output color format
-		#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
-			DMA2D->OPFCCR = OPFCCR_RGB565;
-		#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
-			DMA2D->OPFCCR = OPFCCR_ARGB8888;
-		#endif
+			#if GDISP_NEED_CONTROL
+				if (g->g.Orientation != GDISP_ROTATE_0) {
+					_ltdc_blit_rotated(g);
+					return;
+				}
+			#endif
 
-		// Foreground color format
-		#if GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565
-			DMA2D->FGPFCCR = FGPFCCR_CM_RGB565;
-		#elif GDISP_LLD_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
-			DMA2D->FGPFCCR = FGPFCCR_CM_ARGB8888;
+			dma2d_copy((const pixel_t *)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1, g->p.x2 - g->p.cx, DMA2D_PIXEL_CM,
+						PIXEL_ADDR(g, PIXIL_POS(g, g->p.x, g->p.y)), g->g.Width - g->p.cx, g->p.cx, g->p.cy);
+
+			// The source buffer belongs to the caller and may be reused as soon as we return
+			dma2d_wait();
+		}
+	#endif
+
+	/* Anti-aliased text.
+	 *
+	 * The glyph is an A8 alpha mask. The DMA2D blends it in the text
+	 * color straight onto the frame buffer so the CPU never reads back
+	 * the pixels. Other orientations are blended by the CPU.
+	 */
+	#if GDISP_HARDWARE_ALPHABLIT && GDISP_NEED_TEXT && GDISP_NEED_ANTIALIAS
+		#if GDISP_NEED_CONTROL
+			static void _ltdc_alpha_blit_rotated(GDisplay* g) {
+				const uint8_t*	src;
+				LLDCOLOR_TYPE*	dst;
+				coord_t			x, y;
+
+				dma2d_wait();
+
+				src = (const uint8_t *)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1;
+				for(y = g->p.y; y < g->p.y + g->p.cy; y++, src += g->p.x2) {
+					for(x = 0; x < g->p.cx; x++) {
+						if (!src[x])
+							continue;
+						dst = PIXEL_ADDR(g, _ltdc_rotated_pos(g, g->p.x+x, y));
+						dst[0] = gdispColor2Native(src[x] == 255 ? g->p.color : gdispBlendColor(g->p.color, gdispNative2Color(dst[0]), src[x]));
+					}
+				}
+			}
 		#endif
 
-			// Source setup
-			DMA2D->FGMAR = LTDC_PIXELBYTES * (g->p.y1 * g->p.x2 + g->p.x1) + (uint32_t)g->p.ptr;
-			DMA2D->FGOR = g->p.x2 - g->p.cx;
+		// Uses p.x,p.y  p.cx,p.cy  p.x1,p.y1 (=srcx,srcy)  p.x2 (=srccx), p.ptr (=alpha mask) p.color
+		LLDSPEC void gdisp_lld_alpha_blit_area(GDisplay* g) {
+			SYNC_DRAWBUF(g);
+			MARK_DIRTY(g, g->p.x, g->p.y, g->p.cx, g->p.cy);
+
+			#if GDISP_NEED_CONTROL
+				if (g->g.Orientation != GDISP_ROTATE_0) {
+					_ltdc_alpha_blit_rotated(g);
+					return;
+				}
+			#endif
 
-			// Output setup
-			DMA2D->OMAR = (uint32_t)PIXEL_ADDR(g, PIXIL_POS(g, g->p.x, g->p.y));
-			DMA2D->OOR = g->g.Width - g->p.cx;
-			DMA2D->NLR = (g->p.cx << 16) | (g->p.cy);
+			dma2d_blend((const uint8_t *)g->p.ptr + g->p.y1 * g->p.x2 + g->p.x1, g->p.x2 - g->p.cx, FGPFCCR_CM_A8,
+						((uint32_t)RED_OF(g->p.color) << 16) | ((uint32_t)GREEN_OF(g->p.color) << 8) | BLUE_OF(g->p.color),
+						PIXEL_ADDR(g, PIXIL_POS(g, g->p.x, g->p.y)), g->g.Width - g->p.cx, g->p.cx, g->p.cy);
 
-			// Set MODE to M2M and Start the process
-			DMA2D->CR = DMA2D_CR_MODE_M2M | DMA2D_CR_START;
+			// The alpha mask belongs to the caller and may be reused as soon as we return
+			dma2d_wait();
 		}
 	#endif
 
@@ -19,6 +19,25 @@
 #define GDISP_HARDWARE_PIXELREAD			TRUE
 #define GDISP_HARDWARE_CONTROL				TRUE
 
+// Draw into a back buffer and flip it to the screen on gdispFlush().
+// The flip is latched by the LTDC during vertical blanking so the screen never tears.
+// Requires a second frame buffer (see LTDC_BACKBUFFER in the board file) and
+// something that flushes the display eg. GDISP_NEED_TIMERFLUSH.
+#ifndef LTDC_USE_DOUBLEBUFFER
+	#define LTDC_USE_DOUBLEBUFFER			FALSE
+#endif
+// After a flip only copy the area drawn in the last frame forward to the new back buffer
+// instead of the whole frame.
+#ifndef LTDC_DOUBLEBUFFER_DIRTYCOPY
+	#define LTDC_DOUBLEBUFFER_DIRTYCOPY		TRUE
+#endif
+
+// Expose the LTDC foreground layer as a second display (GDISP_TOTAL_DISPLAYS must be 2).
+// It is composited over the background display by the LTDC. Configure it with fglayer in the board file.
+#ifndef LTDC_USE_LAYER2
+	#define LTDC_USE_LAYER2					FALSE
+#endif
+
 // Both these pixel formats are supported - pick one.
 // RGB565 obviously is faster and uses less RAM but with lower color resolution than RGB888
 #define GDISP_LLD_PIXELFORMAT				GDISP_PIXELFORMAT_RGB565
@@ -33,13 +52,40 @@
 	// DMA2D supports accelerated fills
  	#define GDISP_HARDWARE_FILLS		TRUE
 
-	// Accelerated bitfills are also possible but only for GDISP_ROTATE_0
-	//	and if no color translation is required (for now)
-	#if !GDISP_NEED_CONTROL && GDISP_PIXELFORMAT == GDISP_LLD_PIXELFORMAT
+	// Accelerated bitfills are also possible for the color formats the DMA2D can translate.
+	//	Orientations other than GDISP_ROTATE_0 are pixel pushed by the driver.
+	#if GDISP_PIXELFORMAT == GDISP_PIXELFORMAT_RGB565 || GDISP_PIXELFORMAT == GDISP_PIXELFORMAT_RGB888
  		#define GDISP_HARDWARE_BITFILLS	TRUE
 	#endif
+
+	// Anti-aliased text glyphs are blended by the DMA2D from an A8 alpha mask.
+	#define GDISP_HARDWARE_ALPHABLIT	TRUE
+
+	// Number of DMA2D operations that can be queued. The drawing thread only waits
+	//	for the DMA2D when it needs the result (or the queue is full).
+	//	Set to 0 to busy wait for each operation instead.
+	#ifndef LTDC_DMA2D_QUEUE_SIZE
+		#define LTDC_DMA2D_QUEUE_SIZE	16
+	#endif
 #endif /* GDISP_USE_DMA2D */
 
+// Layer control codes for gdispGControl() on either display.
+//	LTDC_CONTROL_ALPHA		- p.ptr = constant alpha 0 (transparent) .. 255 (opaque)
+//	LTDC_CONTROL_COLORKEY	- p.ptr = the color_t drawn transparent, or LTDC_COLORKEY_NONE
+//	LTDC_CONTROL_POSITION	- p.ptr = LTDC_POSITION(x, y) of the layer window on the screen
+#define LTDC_CONTROL_ALPHA				(GDISP_CONTROL_LLD+0)
+#define LTDC_CONTROL_COLORKEY			(GDISP_CONTROL_LLD+1)
+#define LTDC_CONTROL_POSITION			(GDISP_CONTROL_LLD+2)
+#define LTDC_COLORKEY_NONE				((void *)-1)
+#define LTDC_POSITION(x, y)				((void *)(((uint32_t)(uint16_t)(x) << 16) | (uint16_t)(y)))
+#define LTDC_POSITION_X(p)				((coord_t)(int16_t)((uint32_t)(p) >> 16))
+#define LTDC_POSITION_Y(p)				((coord_t)(int16_t)((uint32_t)(p) & 0xFFFF))
+
+#if LTDC_USE_DOUBLEBUFFER
+	// The page flip is done by the flush
+	#define GDISP_HARDWARE_FLUSH		TRUE
+#endif
+
 #endif	/* GFX_USE_GDISP */
 
 #endif	/* _GDISP_LLD_CONFIG_H */
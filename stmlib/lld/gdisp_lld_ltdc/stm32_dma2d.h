@@ -10,10 +10,42 @@
 #define FGPFCCR_CM_ARGB8888	0x00
 #define FGPFCCR_CM_RGB888	0x01
 #define FGPFCCR_CM_RGB565	0x02
+#define FGPFCCR_CM_ARGB1555	0x03
+#define FGPFCCR_CM_ARGB4444	0x04
+#define FGPFCCR_CM_L8		0x05
+#define FGPFCCR_CM_AL44		0x06
+#define FGPFCCR_CM_AL88		0x07
+#define FGPFCCR_CM_L4		0x08
+#define FGPFCCR_CM_A8		0x09
+#define FGPFCCR_CM_A4		0x0A
 
-#define DMA2D_CR_MODE_R2M	((uint32_t)0x00030000)	/* Register-to-memory mode */
-#define DMA2D_CR_MODE_M2M	((uint32_t)0x00000000)	/* Register-to-memory mode */
+#define FGPFCCR_AM_NONE		((uint32_t)0x00000000)	/* Keep the alpha of the pixel */
+#define FGPFCCR_AM_REPLACE	((uint32_t)0x00010000)	/* Replace the alpha with FGPFCCR_ALPHA */
+#define FGPFCCR_AM_MULTIPLY	((uint32_t)0x00020000)	/* Multiply the alpha with FGPFCCR_ALPHA */
+#define FGPFCCR_ALPHA(a)	((uint32_t)(a) << 24)
+
+#define DMA2D_CR_MODE_R2M		((uint32_t)0x00030000)	/* Register-to-memory mode */
+#define DMA2D_CR_MODE_M2M		((uint32_t)0x00000000)	/* Memory-to-memory mode */
+#define DMA2D_CR_MODE_M2M_PFC	((uint32_t)0x00010000)	/* Memory-to-memory mode with pixel format conversion */
+#define DMA2D_CR_MODE_M2M_BLEND	((uint32_t)0x00020000)	/* Memory-to-memory mode with blending */
+
+// A DMA2D operation - the register values to load when it is started
+typedef struct dma2dCommand {
+	uint32_t	cr;					// Mode
+	uint32_t	fgmar, fgor;		// Foreground address and line offset (pixels)
+	uint32_t	fgpfccr, fgcolr;	// Foreground format and color
+	uint32_t	bgmar, bgor;		// Background address and line offset (pixels)
+	uint32_t	bgpfccr;			// Background format
+	uint32_t	omar, oor;			// Output address and line offset (pixels)
+	uint32_t	ocolr;				// Output color (register-to-memory mode)
+	uint32_t	nlr;				// Pixels per line and number of lines
+} dma2dCommand;
 
 static void dma2d_init(void);
+static void dma2d_submit(const dma2dCommand* cmd);
+static void dma2d_wait(void);
+static void dma2d_fill(void* dst, uint32_t dstoff, coord_t cx, coord_t cy, uint32_t color);
+static void dma2d_copy(const void* src, uint32_t srcoff, uint32_t srcfmt, void* dst, uint32_t dstoff, coord_t cx, coord_t cy);
+static void dma2d_blend(const void* fg, uint32_t fgoff, uint32_t fgfmt, uint32_t fgcolor, void* dst, uint32_t dstoff, coord_t cx, coord_t cy);
 
 #endif /* _STM32_DMA2D_H */
@@ -0,0 +1,6 @@
+GFXINC  += $(STMLIB)/ugfx_boardfiles/host_framebuffer $(STMLIB)/devices/displays/rk043fn48h
+GFXSRC  += $(STMLIB)/ugfx_boardfiles/host_framebuffer/gmouse_lld_script.c
+GFXDEFS += -DGFX_USE_OS_LINUX=TRUE
+GFXLIBS += rt
+
+include $(GFXLIB)/drivers/gdisp/framebuffer/driver.mk
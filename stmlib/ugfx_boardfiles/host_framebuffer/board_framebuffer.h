@@ -0,0 +1,130 @@
+/*
+ * This file is subject to the terms of the GFX License. If a copy of
+ * the license was not distributed with this file, you can obtain one at:
+ *
+ *              http://ugfx.org/license.html
+ */
+
+/* Host (Linux) memory frame buffer with the geometry and pixel format of the
+ * STM32F746 discovery LTDC display. Nothing is shown - the frame buffer is
+ * only inspected by the program eg. for automated GUI performance tests.
+ */
+
+#ifndef _HOSTFB_BOARD_H
+#define _HOSTFB_BOARD_H
+
+#include <rk043fn48h.h>
+
+// The pixel format of the STM32LTDC driver (see stmlib/lld/gdisp_lld_ltdc/gdisp_lld_config.h)
+#ifndef GDISP_LLD_PIXELFORMAT
+	#define GDISP_LLD_PIXELFORMAT		GDISP_PIXELFORMAT_RGB565
+#endif
+
+// Software versions of the DMA2D operations the STM32LTDC driver uses
+#define GDISP_HARDWARE_FILLS		TRUE
+#define GDISP_HARDWARE_BITFILLS		TRUE
+#define GDISP_HARDWARE_ALPHABLIT	TRUE
+
+// A flush marks the end of a frame
+#define GDISP_HARDWARE_FLUSH		TRUE
+
+typedef struct hostfbStats {
+	uint32_t	frames;			// Flushes with something new to show
+	uint32_t	flushes;		// All flushes
+	uint32_t	ops;			// Driver drawing operations
+	uint64_t	pixelops;		// Pixels written by the driver
+	} hostfbStats;
+
+extern hostfbStats		hostfb_stats;
+extern uint16_t			hostfb_pixels[LCD_HEIGHT][LCD_WIDTH];
+extern volatile int		hostfb_dirty;
+
+// Checksum of the frame buffer contents (32 bit FNV-1a)
+uint32_t hostfbChecksum(void);
+
+// Write the frame buffer to a binary PPM file. Returns 0 on success.
+int hostfbSavePPM(const char *filename);
+
+#define board_pixelops(g, n)	{ hostfb_stats.ops++; hostfb_stats.pixelops += (n); hostfb_dirty = 1; }
+
+#endif /* _HOSTFB_BOARD_H */
+
+#ifdef GDISP_DRIVER_VMT
+
+	#include <stdio.h>
+
+	hostfbStats		hostfb_stats;
+	uint16_t		hostfb_pixels[LCD_HEIGHT][LCD_WIDTH];
+	volatile int	hostfb_dirty;
+
+	uint32_t hostfbChecksum(void) {
+		const uint8_t	*p;
+		uint32_t		h;
+		size_t			i;
+
+		h = 2166136261UL;
+		p = (const uint8_t *)hostfb_pixels;
+		for(i = 0; i < sizeof(hostfb_pixels); i++) {
+			h ^= p[i];
+			h *= 16777619UL;
+		}
+		return h;
+	}
+
+	int hostfbSavePPM(const char *filename) {
+		FILE		*f;
+		uint16_t	c;
+		coord_t		x, y;
+
+		if (!(f = fopen(filename, "wb")))
+			return -1;
+		fprintf(f, "P6\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT);
+		for(y = 0; y < LCD_HEIGHT; y++) {
+			for(x = 0; x < LCD_WIDTH; x++) {
+				c = hostfb_pixels[y][x];
+				fputc(((c >> 11) & 0x1F) << 3, f);
+				fputc(((c >> 5) & 0x3F) << 2, f);
+				fputc((c & 0x1F) << 3, f);
+			}
+		}
+		return fclose(f) ? -1 : 0;
+	}
+
+	static void board_init(GDisplay *g, fbInfo *fbi) {
+		g->g.Width = LCD_WIDTH;
+		g->g.Height = LCD_HEIGHT;
+		g->g.Backlight = 100;
+		g->g.Contrast = 50;
+		fbi->linelen = LCD_WIDTH * sizeof(LLDCOLOR_TYPE);
+		fbi->pixels = hostfb_pixels;
+	}
+
+	#if GDISP_HARDWARE_FLUSH
+		static void board_flush(GDisplay *g) {
+			(void) g;
+			hostfb_stats.flushes++;
+			if (hostfb_dirty) {
+				hostfb_dirty = 0;
+				hostfb_stats.frames++;
+			}
+		}
+	#endif
+
+	#if GDISP_NEED_CONTROL
+		static void board_backlight(GDisplay *g, uint8_t percent) {
+			(void) g;
+			(void) percent;
+		}
+
+		static void board_contrast(GDisplay *g, uint8_t percent) {
+			(void) g;
+			(void) percent;
+		}
+
+		static void board_power(GDisplay *g, powermode_t pwr) {
+			(void) g;
+			(void) pwr;
+		}
+	#endif
+
+#endif /* GDISP_DRIVER_VMT */
@@ -0,0 +1,79 @@
+/*
+ * This file is subject to the terms of the GFX License. If a copy of
+ * the license was not distributed with this file, you can obtain one at:
+ *
+ *              http://ugfx.org/license.html
+ */
+
+#include "gfx.h"
+
+#if GFX_USE_GINPUT && GINPUT_NEED_MOUSE
+
+#define GMOUSE_DRIVER_VMT		GMOUSEVMT_Script
+#include "src/ginput/ginput_driver_mouse.h"
+
+#include "gmouse_lld_script.h"
+
+#define GMOUSE_SCRIPT_Z_MIN			0
+#define GMOUSE_SCRIPT_Z_MAX			100
+#define GMOUSE_SCRIPT_Z_TOUCHON		80
+#define GMOUSE_SCRIPT_Z_TOUCHOFF	70
+
+static volatile coord_t		touchx, touchy;
+static volatile bool_t		touched;
+
+void gmouseScriptTouch(coord_t x, coord_t y) {
+	touchx = x;
+	touchy = y;
+	touched = TRUE;
+}
+
+void gmouseScriptRelease(void) {
+	touched = FALSE;
+}
+
+static bool_t init_board(GMouse *m, unsigned driverinstance) {
+	(void) m;
+	(void) driverinstance;
+	touched = FALSE;
+	return TRUE;
+}
+
+static bool_t read_xyz(GMouse *m, GMouseReading *prd) {
+	(void) m;
+	prd->x = touchx;
+	prd->y = touchy;
+	prd->z = touched ? GMOUSE_SCRIPT_Z_MAX : GMOUSE_SCRIPT_Z_MIN;
+	prd->buttons = 0;
+	return TRUE;
+}
+
+const GMouseVMT GMOUSE_DRIVER_VMT[1] = {{
+	{
+		GDRIVER_TYPE_TOUCH,
+		GMOUSE_VFLG_TOUCH|GMOUSE_VFLG_SELFROTATION,
+		sizeof(GMouse),
+		_gmouseInitDriver, _gmousePostInitDriver, _gmouseDeInitDriver
+	},
+	GMOUSE_SCRIPT_Z_MAX,		// z_max
+	GMOUSE_SCRIPT_Z_MIN,		// z_min
+	GMOUSE_SCRIPT_Z_TOUCHON,	// z_touchon
+	GMOUSE_SCRIPT_Z_TOUCHOFF,	// z_touchoff
+	{				// pen_jitter
+		0,						// calibrate
+		0,						// click
+		0						// move
+	},
+	{				// finger_jitter
+		0,						// calibrate
+		0,						// click
+		0						// move
+	},
+	init_board,		// init
+	0,				// deinit
+	read_xyz,		// get
+	0,				// calsave
+	0				// calload
+}};
+
+#endif /* GFX_USE_GINPUT && GINPUT_NEED_MOUSE */
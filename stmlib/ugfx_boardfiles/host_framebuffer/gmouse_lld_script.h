@@ -0,0 +1,27 @@
+/*
+ * This file is subject to the terms of the GFX License. If a copy of
+ * the license was not distributed with this file, you can obtain one at:
+ *
+ *              http://ugfx.org/license.html
+ */
+
+#ifndef _GMOUSE_LLD_SCRIPT_H
+#define _GMOUSE_LLD_SCRIPT_H
+
+/* A touch panel driven by the program instead of hardware (eg. from a test script).
+ * The position is in display coordinates - no calibration is needed.
+ * The change is seen on the next mouse poll (GINPUT_MOUSE_POLL_PERIOD).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gmouseScriptTouch(coord_t x, coord_t y);
+void gmouseScriptRelease(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GMOUSE_LLD_SCRIPT_H */
@@ -11,6 +11,11 @@
 #include <stmlib.h>
 #include <rk043fn48h.h>
 #include <mt48lc4m32b2.h>
+#include <board_sdram.h>
+
+#if LTDC_PIXELBYTES != BOARD_SDRAM_PIXELBYTES
+	#error "GDISP: STM32LTDC - the pixel format does not match the SDRAM layout in board_sdram.h"
+#endif
 
 #if !GFX_USE_OS_CHIBIOS
 	#define AFRL	AFR[0]
@@ -26,7 +31,7 @@ static const ltdcConfig driverCfg = {
 	0x000000,								// Clear color (RGB888)
 
 	{										        // Background layer config
-		(LLDCOLOR_TYPE *)SDRAM_BANK1_BASE_ADDR,     // Frame buffer address
+		(LLDCOLOR_TYPE *)BOARD_SDRAM_FRONTBUFFER,   // Frame buffer address
 		LCD_WIDTH, LCD_HEIGHT,						// Width, Height (pixels)
 		LCD_WIDTH * LTDC_PIXELBYTES,				// Line pitch (bytes)
 		LTDC_PIXELFORMAT,					        // Pixel format
@@ -41,9 +46,30 @@ static const ltdcConfig driverCfg = {
 		LTDC_LEF_ENABLE						        // Layer configuration flags
 	},
 
+#if LTDC_USE_LAYER2
+	{										        // Foreground layer config (overlay display)
+		(LLDCOLOR_TYPE *)BOARD_SDRAM_OVERLAYBUFFER, // Frame buffer address
+		LCD_WIDTH, LCD_HEIGHT,						// Width, Height (pixels)
+		LCD_WIDTH * LTDC_PIXELBYTES,				// Line pitch (bytes)
+		LTDC_PIXELFORMAT,					        // Pixel format
+		0, 0,								        // Start pixel position (x, y)
+		LCD_WIDTH, LCD_HEIGHT,						// Size of virtual layer (cx, cy)
+		0x00000000,							        // Default color (ARGB8888)
+		0xFF00FF,							        // Color key (RGB888) - exact in RGB565
+		LTDC_BLEND_MOD1_MOD2,				        // Blending factors - keyed pixels have zero alpha
+		0,									        // Palette (RGB888, can be NULL)
+		0,									        // Palette length
+		0xFF,								        // Constant alpha factor
+		LTDC_LEF_ENABLE | LTDC_LEF_KEYING	        // Layer configuration flags
+	}
+#else
 	LTDC_UNUSED_LAYER_CONFIG				            // Foreground layer config
+#endif
 };
 
+// Second frame buffer for LTDC_USE_DOUBLEBUFFER, right after the first one
+#define LTDC_BACKBUFFER		((LLDCOLOR_TYPE *)BOARD_SDRAM_BACKBUFFER)
+
 static SdramBankConfig b1cfg = {
     SDRAMBANK_CAS_LATENCY_3_CYCLE | SDRAMBANK_INTERNAL_BANK_NUM_4 |SDRAMBANK_MWID_16 |SDRAMBANK_ROW_ADDR_BITS_12 | SDRAMBANK_COL_ADDR_BITS_8,
     SDRAMBANK_TRCD_2_CYCLE | SDRAMBANK_TWR_2_CYCLE | SDRAMBANK_TRAS_4_CYCLE | SDRAMBANK_TXSR_7_CYCLE |SDRAMBANK_TMRD_2_CYCLE,
@@ -0,0 +1,29 @@
+/*
+ * This file is subject to the terms of the GFX License. If a copy of
+ * the license was not distributed with this file, you can obtain one at:
+ *
+ *              http://ugfx.org/license.html
+ */
+
+#ifndef _BOARD_SDRAM_H
+#define _BOARD_SDRAM_H
+
+#include <rk043fn48h.h>
+
+// SDRAM layout of the board. The LTDC frame buffers are at the beginning of the bank 1:
+// front buffer, back buffer (LTDC_USE_DOUBLEBUFFER) and overlay buffer (LTDC_USE_LAYER2).
+// Their places are kept even if unused, so the layout does not depend on the GDISP options.
+// The values are plain integers, they can be used in #if and without GDISP (eg. in ffconf.h).
+#define BOARD_SDRAM_BASE			0xC0000000				// SDRAM_BANK1_BASE_ADDR
+#define BOARD_SDRAM_SIZE			0x800000				// SDRAM_DEVICE_SIZE
+#define BOARD_SDRAM_PIXELBYTES		2						// LTDC_PIXELBYTES of GDISP_PIXELFORMAT_RGB565
+#define BOARD_SDRAM_FRAMESIZE		(LCD_WIDTH * LCD_HEIGHT * BOARD_SDRAM_PIXELBYTES)
+#define BOARD_SDRAM_FRONTBUFFER		BOARD_SDRAM_BASE
+#define BOARD_SDRAM_BACKBUFFER		(BOARD_SDRAM_BASE + BOARD_SDRAM_FRAMESIZE)
+#define BOARD_SDRAM_OVERLAYBUFFER	(BOARD_SDRAM_BASE + 2 * BOARD_SDRAM_FRAMESIZE)
+
+// End of the frame buffers, the SDRAM after it is free for the application
+#define BOARD_SDRAM_FB_END			(BOARD_SDRAM_BASE + 3 * BOARD_SDRAM_FRAMESIZE)
+#define BOARD_SDRAM_END				(BOARD_SDRAM_BASE + BOARD_SDRAM_SIZE)
+
+#endif /* _BOARD_SDRAM_H */